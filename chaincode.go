@@ -15,6 +15,7 @@ package chaincode_wrapper
 
 import (
 	"context"
+	"crypto/sha256"
 	"encoding/hex"
 	"fmt"
 	"time"
@@ -32,8 +33,89 @@ type ChaincodeWrapper struct {
 
 const (
 	address = "192.168.1.143:50051"
+	// client-side bound on one invocation (unchanged from before deadlines were propagated). The deadline
+	// travels with the call, but tighter per-transaction limits are the proxy's job (--tx-timeout)
+	invocationTimeout = 10 * time.Minute
 )
 
+// version of a state value reported to chaincode_proxy, which caches values together with it
+// and asks the wrapper to confirm cached reads before the transaction ends
+func stateVersion(value []byte) string {
+	sum := sha256.Sum256(value)
+	return hex.EncodeToString(sum[:])
+}
+
+// ledger iterator opened for chaincode_proxy (range, partial composite key or history query);
+// the proxy pulls it page by page with NextPageRequest
+type pageIterator struct {
+	hasNext func() bool
+	next    func() (*grpcpb.KeyValue, error)
+	close   func() error
+}
+
+func openIterator(stub shim.ChaincodeStubInterface, req *grpcpb.OpenIteratorRequest) (*pageIterator, error) {
+	switch req.Kind {
+	case grpcpb.OpenIteratorRequest_RANGE, grpcpb.OpenIteratorRequest_PARTIAL_COMPOSITE_KEY:
+		var iter shim.StateQueryIteratorInterface
+		var err error
+		if req.Kind == grpcpb.OpenIteratorRequest_RANGE {
+			iter, err = stub.GetStateByRange(req.StartKey, req.EndKey)
+		} else {
+			iter, err = stub.GetStateByPartialCompositeKey(req.StartKey, req.Attributes)
+		}
+		if err != nil {
+			return nil, err
+		}
+		return &pageIterator{
+			hasNext: iter.HasNext,
+			next: func() (*grpcpb.KeyValue, error) {
+				kv, err := iter.Next()
+				if err != nil {
+					return nil, err
+				}
+				return &grpcpb.KeyValue{Key: kv.Key, Value: string(kv.Value), Version: stateVersion(kv.Value)}, nil
+			},
+			close: iter.Close,
+		}, nil
+	case grpcpb.OpenIteratorRequest_HISTORY:
+		iter, err := stub.GetHistoryForKey(req.StartKey)
+		if err != nil {
+			return nil, err
+		}
+		return &pageIterator{
+			hasNext: iter.HasNext,
+			next: func() (*grpcpb.KeyValue, error) {
+				mod, err := iter.Next()
+				if err != nil {
+					return nil, err
+				}
+				// the key of a history entry is the transaction id, a deletion has an empty value
+				value := ""
+				if !mod.IsDelete {
+					value = string(mod.Value)
+				}
+				return &grpcpb.KeyValue{Key: mod.TxId, Value: value}, nil
+			},
+			close: iter.Close,
+		}, nil
+	}
+	return nil, fmt.Errorf("unknown iterator kind %v", req.Kind)
+}
+
+// reads up to size entries; has_more is false once the ledger iterator is exhausted
+func (it *pageIterator) page(id uint32, size uint32) (*grpcpb.IteratorPage, error) {
+	page := &grpcpb.IteratorPage{IteratorId: id}
+	for uint32(len(page.Entries)) < size && it.hasNext() {
+		kv, err := it.next()
+		if err != nil {
+			return nil, err
+		}
+		page.Entries = append(page.Entries, kv)
+	}
+	page.HasMore = it.hasNext()
+	return page, nil
+}
+
 // instantiate chaincode_wrapper
 func (t *ChaincodeWrapper) Init(stub shim.ChaincodeStubInterface) pb.Response {
 	return shim.Success(nil)
@@ -86,11 +168,13 @@ func (t *ChaincodeWrapper) invoke(stub shim.ChaincodeStubInterface) pb.Response
 	client := grpcpb.NewInvocationClient(conn)
 
 	// Setup context with timeout.
-	// chaincode_wrapper waits at max 10 minutes for the gRPC to complete.
+	// chaincode_wrapper waits at max invocationTimeout for the gRPC to complete; the
+	// deadline travels with the call, so the proxy aborts the transaction in the TEE as well
+	// (the proxy applies the earlier of this deadline and its own --tx-timeout).
 	// After the timeout the start of the gRPC call TransactionInvocation and
 	// any send or receive will fail with an error. This error is caught by a cleanup.
-	ctx, cancel := context.WithTimeout(context.Background(), time.Duration(10)*time.Minute) // client wait at max 10 minutes for the gRPC to complete                                                                    // cancel context (https://godoc.org/google.golang.org/grpc#ClientConn.NewStream)
-	defer cancel()                                                                          // https://godoc.org/google.golang.org/grpc#ClientConn.NewStream
+	ctx, cancel := context.WithTimeout(context.Background(), invocationTimeout) // cancelling the context also cancels the transaction in the TEE
+	defer cancel()                                                              // https://godoc.org/google.golang.org/grpc#ClientConn.NewStream
 
 	// create the grpc client stream
 	stream, err := client.TransactionInvocation(ctx) // if no timeout do client.TransactionInvocation(context.Background()) (not used)
@@ -115,6 +199,31 @@ func (t *ChaincodeWrapper) invoke(stub shim.ChaincodeStubInterface) pb.Response
 		return shim.Error(err.Error())
 	}
 
+	// iterators opened by chaincode_proxy, closed when exhausted or when the invocation ends
+	iterators := make(map[uint32]*pageIterator)
+	defer func() {
+		for _, it := range iterators {
+			it.close()
+		}
+	}()
+	sendPage := func(id uint32, size uint32) error {
+		it, ok := iterators[id]
+		if !ok {
+			return fmt.Errorf("unknown iterator %d", id)
+		}
+		page, err := it.page(id, size)
+		if err != nil {
+			return err
+		}
+		if !page.HasMore {
+			it.close()
+			delete(iterators, id)
+		}
+		return stream.Send(&grpcpb.ChaincodeWrapperMessage{
+			MessageOneof: &grpcpb.ChaincodeWrapperMessage_IteratorPage{IteratorPage: page},
+		})
+	}
+
 	for {
 		// wait for the message of the chaincode_proxy and act accordingly
 		proxyMsg, err := stream.Recv()
@@ -153,7 +262,8 @@ func (t *ChaincodeWrapper) invoke(stub shim.ChaincodeStubInterface) pb.Response
 				wrapperMsg := &grpcpb.ChaincodeWrapperMessage{
 					MessageOneof: &grpcpb.ChaincodeWrapperMessage_GetStateResponse{
 						GetStateResponse: &grpcpb.GetStateResponse{
-							Value: valueString,
+							Value:   valueString,
+							Version: stateVersion(value),
 						},
 					},
 				}
@@ -187,6 +297,55 @@ func (t *ChaincodeWrapper) invoke(stub shim.ChaincodeStubInterface) pb.Response
 					return shim.Error(err.Error())
 				}
 			}
+		case *grpcpb.ChaincodeProxyMessage_ValidateReadsRequest:
+			{
+				// chaincode_proxy served these reads from its state cache: read them again so they
+				// land in this transaction's read set, and report the ones that changed meanwhile
+				var staleKeys []string
+				for _, read := range u.ValidateReadsRequest.Reads {
+					value, err := stub.GetState(read.Key)
+					if err != nil {
+						return shim.Error(err.Error())
+					}
+					if stateVersion(value) != read.Version {
+						staleKeys = append(staleKeys, read.Key)
+					}
+				}
+
+				wrapperMsg := &grpcpb.ChaincodeWrapperMessage{
+					MessageOneof: &grpcpb.ChaincodeWrapperMessage_ValidateReadsResponse{
+						ValidateReadsResponse: &grpcpb.ValidateReadsResponse{
+							StaleKeys: staleKeys,
+						},
+					},
+				}
+				err := stream.Send(wrapperMsg)
+				if err != nil {
+					return shim.Error(err.Error())
+				}
+			}
+		case *grpcpb.ChaincodeProxyMessage_OpenIteratorRequest:
+			{
+				// open the ledger iterator under the id chosen by chaincode_proxy and send its first page
+				request := u.OpenIteratorRequest
+				it, err := openIterator(stub, request)
+				if err != nil {
+					return shim.Error(err.Error())
+				}
+				if old, ok := iterators[request.IteratorId]; ok {
+					old.close()
+				}
+				iterators[request.IteratorId] = it
+				if err := sendPage(request.IteratorId, request.PageSize); err != nil {
+					return shim.Error(err.Error())
+				}
+			}
+		case *grpcpb.ChaincodeProxyMessage_NextPageRequest:
+			{
+				if err := sendPage(u.NextPageRequest.IteratorId, u.NextPageRequest.PageSize); err != nil {
+					return shim.Error(err.Error())
+				}
+			}
 		}
 	}
 }
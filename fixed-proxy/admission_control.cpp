@@ -0,0 +1,113 @@
+#include <algorithm>
+
+#include "admission_control.h"
+#include "proxy_metrics.h"
+
+/* 처리 시간을 아직 모를 때 쓰는 값과 지수 이동 평균의 가중치 */
+static const double INITIAL_SERVICE_MS = 20.0;
+static const double SERVICE_EWMA_ALPHA = 0.1;
+/* 기다리는 동안 클라이언트 취소를 확인하는 간격 */
+static const std::chrono::milliseconds CANCEL_POLL(50);
+
+AdmissionControl::AdmissionControl(uint32_t max_inflight, uint32_t max_queued, uint32_t max_wait_ms,
+                                   uint32_t reserved)
+    : max_inflight_(std::max(max_inflight, (uint32_t)1)), max_queued_(max_queued), max_wait_ms_(max_wait_ms),
+      reserved_(std::min(reserved, max_inflight_ - 1)),
+      inflight_(0), queued_(0), queued_priority_(0), next_waiter_(0), service_ms_(INITIAL_SERVICE_MS)
+{
+}
+
+AdmissionControl::Ticket::~Ticket()
+{
+    if (owner_) owner_->release(units_, std::chrono::steady_clock::now() - started_);
+}
+
+uint32_t AdmissionControl::estimated_wait_ms(uint32_t ahead_units) const
+{
+    // 실행 중인 것 중 하나가 끝나야 자리가 나므로 앞의 단위가 없어도 한 차례는 기다린다
+    uint32_t rounds = (ahead_units + max_inflight_) / max_inflight_;
+    return (uint32_t)(rounds * service_ms_);
+}
+
+void AdmissionControl::publish_locked()
+{
+    ProxyMetrics& m = proxy_metrics();
+    m.set("admission_inflight", inflight_);
+    m.set("admission_queue_depth", queued_);
+    m.set("admission_estimated_wait_ms", queued_ ? estimated_wait_ms(queued_) : 0);
+    m.max("admission_queue_depth_max", queued_);
+}
+
+AdmissionControl::Result AdmissionControl::admit(uint32_t units, const tx_deadline& deadline,
+                                                 Ticket* ticket, uint32_t* retry_after_ms, bool priority)
+{
+    std::chrono::steady_clock::time_point arrived = std::chrono::steady_clock::now();
+    // 일반 요청은 우선 요청 몫(reserved_)을 뺀 자리까지만 쓴다
+    uint32_t limit = priority ? max_inflight_ : max_inflight_ - reserved_;
+    units = std::max(std::min(units, limit), (uint32_t)1);
+    uint32_t& ahead = priority ? queued_priority_ : queued_;
+    *retry_after_ms = 0;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!(ahead == 0 && inflight_ + units <= limit)) {
+        // 기다려야 한다: 큐가 넘치거나 예상 대기가 한도를 넘으면 바로 거절
+        uint32_t wait_ms = estimated_wait_ms(ahead);
+        if (queued_ + units > max_queued_ || (max_wait_ms_ && wait_ms > max_wait_ms_)) {
+            *retry_after_ms = std::max(wait_ms, (uint32_t)1);
+            proxy_metrics().add("admission_rejected", 1);
+            return REJECTED;
+        }
+
+        // 우선 요청은 기다리는 우선 요청들 바로 뒤(일반 요청들 앞)에 선다
+        std::pair<uint64_t, bool> me(next_waiter_++, priority);
+        std::deque<std::pair<uint64_t, bool> >::iterator pos = waiters_.end();
+        if (priority) {
+            pos = waiters_.begin();
+            while (pos != waiters_.end() && pos->second) ++pos;
+        }
+        waiters_.insert(pos, me);
+        queued_ += units;
+        if (priority) queued_priority_ += units;
+        publish_locked();
+        while (!(waiters_.front() == me && inflight_ + units <= limit)) {
+            if (deadline.expired()) {
+                waiters_.erase(std::find(waiters_.begin(), waiters_.end(), me));
+                queued_ -= units;
+                if (priority) queued_priority_ -= units;
+                publish_locked();
+                cv_.notify_all();  // 뒤에서 기다리던 작업이 맨 앞이 됐을 수 있다
+                proxy_metrics().add("admission_expired", 1);
+                return EXPIRED;
+            }
+            std::chrono::steady_clock::time_point until = std::min(deadline.at, std::chrono::steady_clock::now() + CANCEL_POLL);
+            cv_.wait_until(lock, until);
+        }
+        waiters_.pop_front();
+        queued_ -= units;
+        if (priority) queued_priority_ -= units;
+        cv_.notify_all();  // 남은 자리가 있으면 다음 작업도 들어간다
+    }
+    inflight_ += units;
+    publish_locked();
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    ProxyMetrics& m = proxy_metrics();
+    m.add("admission_admitted", 1);
+    m.add("admission_wait_us", (double)std::chrono::duration_cast<std::chrono::microseconds>(now - arrived).count());
+
+    ticket->owner_ = this;
+    ticket->units_ = units;
+    ticket->started_ = now;
+    return ADMITTED;
+}
+
+void AdmissionControl::release(uint32_t units, std::chrono::steady_clock::duration service)
+{
+    double ms = std::chrono::duration_cast<std::chrono::microseconds>(service).count() / 1000.0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    inflight_ -= units;
+    // 배치도 차지한 자리들을 같은 시간 동안 잡고 있으므로 그대로 반영한다
+    service_ms_ += SERVICE_EWMA_ALPHA * (ms - service_ms_);
+    publish_locked();
+    cv_.notify_all();
+}
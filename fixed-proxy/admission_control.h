@@ -0,0 +1,75 @@
+#ifndef ADMISSION_CONTROL_H
+#define ADMISSION_CONTROL_H
+
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+#include "tee_session.h"
+
+/*
+ * 수락 제어: TEE에서 동시에 실행하는 작업(max_inflight 단위)과 그 뒤에서 기다리는 작업
+ * (max_queued 단위)을 제한한다. 자리가 없으면 도착 순서대로 기다리게 하되, 큐가 가득 찼거나
+ * 예상 대기 시간(앞에 쌓인 단위 수 × 최근 평균 처리 시간 / max_inflight)이 max_wait_ms를
+ * 넘으면 기다리지 않고 바로 거절하고 retry_after_ms에 다시 시도할 시간을 알려준다.
+ * 과부하에서 gRPC 스레드가 TEEC_InvokeCommand 뒤에 끝없이 쌓이는 대신 빨리 실패하므로
+ * 받아들인 요청의 지연(p99)이 대기 한도 근처에 묶인다.
+ *
+ * 트랜잭션 하나는 1단위, 배치는 트랜잭션 수만큼(최대 max_inflight) 차지한다.
+ * 우선 요청(조회)은 일반 요청보다 앞에 줄을 서고, max_inflight 중 reserved 단위는
+ * 우선 요청만 쓸 수 있어 읽기-쓰기 요청이 몰려도 조회는 바로 들어간다.
+ */
+class AdmissionControl {
+public:
+    enum Result {
+        ADMITTED,
+        REJECTED,   /* 큐가 가득 찼거나 예상 대기가 너무 김: retry_after_ms 뒤에 재시도 */
+        EXPIRED,    /* 기다리는 동안 deadline이 지나거나 클라이언트가 취소 */
+    };
+
+    /* max_queued는 0이면 큐 없이 자리가 없을 때 바로 거절, max_wait_ms는 0이면 예상 대기로 거절하지 않음 */
+    AdmissionControl(uint32_t max_inflight, uint32_t max_queued, uint32_t max_wait_ms, uint32_t reserved = 0);
+
+    /* 들어온 작업이 끝나면(성공/실패 무관) 소멸자에서 자리를 돌려준다 */
+    class Ticket {
+    public:
+        Ticket() : owner_(NULL), units_(0) {}
+        ~Ticket();
+    private:
+        friend class AdmissionControl;
+        Ticket(const Ticket&);
+        Ticket& operator=(const Ticket&);
+        AdmissionControl* owner_;
+        uint32_t units_;
+        std::chrono::steady_clock::time_point started_;
+    };
+
+    Result admit(uint32_t units, const tx_deadline& deadline, Ticket* ticket, uint32_t* retry_after_ms,
+                 bool priority = false);
+
+    uint32_t max_inflight() const { return max_inflight_; }
+
+private:
+    void release(uint32_t units, std::chrono::steady_clock::duration service);
+    uint32_t estimated_wait_ms(uint32_t ahead_units) const;
+    void publish_locked();
+
+    const uint32_t max_inflight_;
+    const uint32_t max_queued_;
+    const uint32_t max_wait_ms_;
+    const uint32_t reserved_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    uint32_t inflight_;             /* 실행 중인 단위 */
+    uint32_t queued_;               /* 기다리는 단위 */
+    uint32_t queued_priority_;      /* 그중 우선 요청의 단위 */
+    std::deque<std::pair<uint64_t, bool> > waiters_;  /* 기다리는 작업의 (순번, 우선) - 앞에서부터 들어간다 */
+    uint64_t next_waiter_;
+    double service_ms_;             /* 단위 하나의 처리 시간 지수 이동 평균 */
+};
+
+#endif /* ADMISSION_CONTROL_H */
@@ -0,0 +1,258 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include <openssl/sha.h>
+
+#include "aot_compiler.h"
+#include "proxy_metrics.h"
+#include "tee_session.h"
+
+extern char** environ;
+
+/* 컴파일러 스레드(와 그 wamrc)의 nice 값 */
+static const int COMPILE_NICE = 10;
+/*
+ * 체인코드 Makefile(WAMRC_FLAGS)과 같은 옵션. 보드의 wamrc로 컴파일한 이미지는 wamrc 버전까지 같아야
+ * Makefile이 서명한 <x.wasm>.aot.sig와 맞으므로, 계층 이미지는 Makefile이 만든 <x.wasm>.aot를 먼저 쓴다
+ */
+static const char* const WAMRC_OPTIONS[] = {
+    "--target=aarch64", "--bounds-checks=0", "--size-level=3", "--opt-level=2", "--disable-aux-stack-check",
+};
+
+bool is_tiered_module(const std::string& aot_file)
+{
+    static const std::string ext = ".wasm";
+    return aot_file.size() > ext.size() && aot_file.compare(aot_file.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+AotCompiler& aot_compiler()
+{
+    static AotCompiler compiler;
+    return compiler;
+}
+
+/* sha256sum과 같은 64자리 소문자 hex (캐시 키, .wasm 버전 확인) */
+static std::string sha256_hex(const std::vector<uint8_t>& data)
+{
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    SHA256(data.empty() ? NULL : &data[0], data.size(), digest);
+    char hex[2 * SHA256_DIGEST_LENGTH + 1];
+    for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+    return std::string(hex, 2 * SHA256_DIGEST_LENGTH);
+}
+
+static bool read_file(const std::string& path, std::vector<uint8_t>* data)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in) return false;
+    data->assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return !in.bad();
+}
+
+/* sha256sum 형식 파일의 첫 토큰 ("" : 없음) */
+static std::string read_hash_file(const std::string& path)
+{
+    char hex[65] = {0};
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) return "";
+    if (fscanf(f, "%64s", hex) != 1) hex[0] = 0;
+    fclose(f);
+    return hex;
+}
+
+static bool write_file(const std::string& path, const void* data, size_t size)
+{
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(data, 1, size, f) == size;
+    return fclose(f) == 0 && ok;
+}
+
+static const uint8_t AOT_MAGIC[4] = { 0x00, 'a', 'o', 't' };
+
+/*
+ * 다 쓰인 AOT 이미지가 있는지 (캐시와 체인코드 Makefile이 보낸 <x.wasm>.aot). 캐시는 임시 이름으로 쓴 뒤
+ * rename하므로 쓰다 끊긴 파일은 이 이름으로 보이지 않는다. 이것은 검증이 아니다: 이미지가 맞는지는
+ * TA가 설치할 때 서명으로 확인한다
+ */
+static bool cached_image_ok(const std::string& image)
+{
+    uint8_t magic[sizeof(AOT_MAGIC)];
+    FILE* f = fopen(image.c_str(), "rb");
+    if (!f) return false;
+    bool ok = fread(magic, 1, sizeof(magic), f) == sizeof(magic) && memcmp(magic, AOT_MAGIC, sizeof(magic)) == 0;
+    fclose(f);
+    return ok;
+}
+
+/* wamrc를 실행해 input을 output으로 컴파일한다 (stdout은 버린다) */
+static bool run_wamrc(const std::string& wamrc, const std::string& input, const std::string& output)
+{
+    std::vector<std::string> argv_s;
+    argv_s.push_back(wamrc);
+    for (size_t i = 0; i < sizeof(WAMRC_OPTIONS) / sizeof(WAMRC_OPTIONS[0]); i++) argv_s.push_back(WAMRC_OPTIONS[i]);
+    argv_s.push_back("-o");
+    argv_s.push_back(output);
+    argv_s.push_back(input);
+    std::vector<char*> argv;
+    for (size_t i = 0; i < argv_s.size(); i++) argv.push_back(&argv_s[i][0]);
+    argv.push_back(NULL);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    pid_t pid;
+    int err = posix_spawnp(&pid, wamrc.c_str(), &actions, NULL, &argv[0], environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (err != 0) {
+        printf("%s AOT 컴파일러 실행 실패: %s (%s)\n", get_timestamp().c_str(), wamrc.c_str(), strerror(err));
+        return false;
+    }
+    int wstatus = 0;
+    while (waitpid(pid, &wstatus, 0) < 0 && errno == EINTR) {
+    }
+    return WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0;
+}
+
+AotCompiler::AotCompiler() : wamrc_(DEFAULT_WAMRC), stopping_(false) {}
+
+AotCompiler::~AotCompiler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+void AotCompiler::set_wamrc(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    wamrc_ = path;
+}
+
+AotCompiler::status AotCompiler::poll(const std::string& wasm_file, const std::string& version, std::string* image)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::string key = wasm_file + "@" + version;
+    std::map<std::string, result>::iterator it = results_.find(key);
+    if (it == results_.end()) {
+        results_[key] = result();
+        job next;
+        next.wasm_file = wasm_file;
+        next.version = version;
+        jobs_.push_back(next);
+        if (!thread_.joinable()) thread_ = std::thread(&AotCompiler::compiler_main, this);
+        cv_.notify_all();
+        return PENDING;
+    }
+    if (it->second.state == READY) *image = it->second.image;
+    return it->second.state;
+}
+
+void AotCompiler::compiler_main()
+{
+    // 이 스레드(와 여기서 띄우는 wamrc)만 우선순위를 낮춘다
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), COMPILE_NICE);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        cv_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+        if (stopping_) return;
+        job next = jobs_.front();
+        jobs_.pop_front();
+        lock.unlock();
+
+        std::string image;
+        bool ok = compile(next, &image);
+
+        lock.lock();
+        result& r = results_[next.wasm_file + "@" + next.version];
+        r.state = ok ? READY : FAILED;
+        r.image = image;
+    }
+}
+
+bool AotCompiler::compile(const job& next, std::string* image)
+{
+    std::string wamrc;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wamrc = wamrc_;
+    }
+
+    // 그 사이 파일이 바뀌었으면 이 버전은 더 이상 쓰이지 않는다 (새 버전이 따로 온다)
+    std::vector<uint8_t> wasm;
+    if (read_module_version(next.wasm_file) != next.version ||
+        !read_file("./chaincode/" + next.wasm_file, &wasm) || wasm.empty() ||
+        read_module_version(next.wasm_file) != next.version) {
+        printf("%s AOT 컴파일 건너뜀 (파일이 바뀜): %s@%s\n", get_timestamp().c_str(), next.wasm_file.c_str(),
+               next.version.c_str());
+        return false;
+    }
+    // 버전 이름(.sha256)이 가리키는 바이트코드만 컴파일한다 (그 버전 id로 서명된 AOT와 짝이 맞도록)
+    std::string hash = sha256_hex(wasm);
+    std::string expected = read_hash_file("./chaincode/" + next.wasm_file + ".sha256");
+    if (!expected.empty() && expected != hash) {
+        printf("%s AOT 컴파일 거부 (해시 불일치): %s\n", get_timestamp().c_str(), next.wasm_file.c_str());
+        proxy_metrics().add("aot_compile_failures", 1);
+        return false;
+    }
+
+    // 체인코드 Makefile이 서명한 바로 그 이미지가 있으면 컴파일하지 않고 그것을 설치한다
+    const std::string shipped = "./chaincode/" + next.wasm_file + AOT_TIER_SUFFIX;
+    if (cached_image_ok(shipped)) {
+        *image = shipped;
+        proxy_metrics().add("aot_shipped", 1);
+        printf("%s AOT 계층 이미지 사용 (컴파일 생략): %s\n", get_timestamp().c_str(), shipped.c_str());
+        return true;
+    }
+
+    *image = std::string(AOT_CACHE_DIR) + "/" + hash + ".aot";
+    if (cached_image_ok(*image)) {
+        proxy_metrics().add("aot_cache_hits", 1);
+        printf("%s AOT 캐시 적중: %s → %s\n", get_timestamp().c_str(), next.wasm_file.c_str(), image->c_str());
+        return true;
+    }
+
+    printf("%s AOT 컴파일 시작: %s@%s\n", get_timestamp().c_str(), next.wasm_file.c_str(), next.version.c_str());
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    mkdir(AOT_CACHE_DIR, 0755);
+    // 해시한 바로 그 바이트를 컴파일하도록 캐시 디렉터리에 사본을 두고 컴파일한다
+    const std::string input = *image + ".wasm.tmp";
+    const std::string output = *image + ".tmp";
+    std::vector<uint8_t> aot;
+    bool ok = write_file(input, &wasm[0], wasm.size()) && run_wamrc(wamrc, input, output) && read_file(output, &aot);
+    unlink(input.c_str());
+
+    // AOT 이미지인지 확인하고 제자리에 둔다
+    ok = ok && aot.size() > sizeof(AOT_MAGIC) && memcmp(&aot[0], AOT_MAGIC, sizeof(AOT_MAGIC)) == 0;
+    ok = ok && rename(output.c_str(), image->c_str()) == 0;
+    unlink(output.c_str());
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (!ok) {
+        proxy_metrics().add("aot_compile_failures", 1);
+        printf("%s AOT 컴파일 실패, 인터프리터로 계속: %s (%.0fms)\n", get_timestamp().c_str(),
+               next.wasm_file.c_str(), ms);
+        return false;
+    }
+    proxy_metrics().add("aot_compiles", 1);
+    proxy_metrics().add("aot_compile_ms", ms);
+    printf("%s AOT 컴파일 완료: %s → %s (%zu Bytes, %.0fms)\n", get_timestamp().c_str(), next.wasm_file.c_str(),
+           image->c_str(), aot.size(), ms);
+    return true;
+}
@@ -0,0 +1,71 @@
+#ifndef AOT_COMPILER_H
+#define AOT_COMPILER_H
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/* wamrc 기본 경로 (PATH에서 찾는다, --wamrc로 바꾼다) */
+#define DEFAULT_WAMRC "wamrc"
+/* 컴파일 결과 캐시: <.wasm 내용의 sha256>.aot */
+#define AOT_CACHE_DIR "./chaincode/aot-cache"
+/* AOT 계층 모듈 id: "<x.wasm>@<버전>"을 컴파일한 것은 "<x.wasm>@<버전>.aot" */
+#define AOT_TIER_SUFFIX ".aot"
+
+/* 계층 실행 대상 (./chaincode/의 .wasm 바이트코드) */
+bool is_tiered_module(const std::string& aot_file);
+
+/*
+ * 계층 실행의 백그라운드 AOT 컴파일러.
+ * .wasm 모듈은 처음부터 TA의 fast interpreter(INTERP=1로 빌드한 TA)로 실행하고, 그동안 AOT 이미지를 준비한다.
+ * 체인코드 Makefile이 만들어 서명한 ./chaincode/<x.wasm>.aot가 있으면 그것을 쓰고, 없으면 여기서 wamrc로
+ * Makefile과 같은 옵션(aarch64)의 AOT를 만든다 (wamrc 버전이 다르면 서명이 맞지 않는다). 결과는 .wasm 내용 해시로 AOT_CACHE_DIR에 두므로
+ * 같은 바이트코드는 프록시를 다시 시작해도, 다른 이름으로 배포해도 다시 컴파일하지 않는다.
+ * 컴파일은 한 번에 하나씩 낮은 우선순위(nice)로 돌려 트랜잭션 처리와 다투지 않는다.
+ * 교체는 ModuleRegistry가 새 버전처럼 설치(TA가 <x.wasm>.aot.sig 서명 확인)하고 모든 TA 인스턴스에
+ * 로드한 뒤에 한다. 캐시 파일 자체는 신뢰하지 않는다.
+ */
+class AotCompiler {
+public:
+    enum status { PENDING, READY, FAILED };
+
+    AotCompiler();
+    ~AotCompiler();
+
+    void set_wamrc(const std::string& path);
+    /*
+     * wasm_file의 version을 컴파일한 AOT. 처음 물으면 컴파일을 큐에 넣고 PENDING을 돌려준다.
+     * READY면 *image에 캐시 파일 경로
+     */
+    status poll(const std::string& wasm_file, const std::string& version, std::string* image);
+
+private:
+    struct job {
+        std::string wasm_file;
+        std::string version;
+    };
+    struct result {
+        result() : state(PENDING) {}
+        status state;
+        std::string image;
+    };
+
+    void compiler_main();
+    bool compile(const job& next, std::string* image);
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::string wamrc_;
+    std::map<std::string, result> results_;     /* "<wasm_file>@<버전>" → 결과 */
+    std::deque<job> jobs_;
+    bool stopping_;
+    std::thread thread_;                        /* 첫 poll에서 시작 */
+};
+
+/* 프로세스에 하나 (캐시 디렉터리를 함께 쓴다) */
+AotCompiler& aot_compiler();
+
+#endif /* AOT_COMPILER_H */
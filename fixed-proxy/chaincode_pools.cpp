@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include <wamr_ta.h>
+
+#include "chaincode_pools.h"
+#include "proxy_metrics.h"
+
+/* 유휴 풀을 찾는 간격의 상한 */
+static const std::chrono::seconds REAPER_MAX_INTERVAL(30);
+
+ChaincodePools::ChaincodePools(TeeWorkerPool& default_pool, const chaincode_pool_options& options,
+                               uint32_t max_window_us, uint64_t fuel_limit, const sched_options& sched)
+    : default_pool_(default_pool), default_lease_(&default_pool, [](TeeWorkerPool*) {}),
+      options_(options), max_window_us_(max_window_us), fuel_limit_(fuel_limit), sched_(sched), stopping_(false)
+{
+    if (options_.idle_timeout_s) reaper_ = std::thread(&ChaincodePools::reaper_main, this);
+}
+
+ChaincodePools::~ChaincodePools()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (reaper_.joinable()) reaper_.join();
+    pools_.clear();
+}
+
+void ChaincodePools::publish_locked()
+{
+    proxy_metrics().set("chaincode_pools_open", pools_.size());
+}
+
+/*
+ * idle 이상 쓰이지 않았고 지금 빌려 간 곳이 없는 풀 중 가장 오래된 것을 목록에서 뺀다
+ * (mutex_ 보유 상태에서 호출). 풀은 closed로 넘겨 잠금 밖에서 닫게 한다.
+ */
+bool ChaincodePools::evict_one_locked(std::chrono::steady_clock::duration idle, std::shared_ptr<TeeWorkerPool>* closed)
+{
+    typedef std::map<std::string, std::shared_ptr<Entry> >::iterator Iter;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::vector<std::pair<std::chrono::steady_clock::time_point, Iter> > idle_pools;
+    for (Iter it = pools_.begin(); it != pools_.end(); ++it) {
+        if (now - it->second->last_used >= idle) idle_pools.push_back(std::make_pair(it->second->last_used, it));
+    }
+    std::sort(idle_pools.begin(), idle_pools.end(),
+              [](const std::pair<std::chrono::steady_clock::time_point, Iter>& a,
+                 const std::pair<std::chrono::steady_clock::time_point, Iter>& b) { return a.first < b.first; });
+
+    for (size_t i = 0; i < idle_pools.size(); i++) {
+        // 열리는 중이거나 실행 중인 호출이 있으면 건드리지 않는다
+        Iter victim = idle_pools[i].second;
+        Entry& e = *victim->second;
+        std::unique_lock<std::mutex> open(e.open_mutex, std::try_to_lock);
+        if (!open.owns_lock() || !e.pool || e.pool.use_count() > 1) continue;
+
+        printf("%s 체인코드 풀 닫기: TA %s\n", get_timestamp().c_str(), victim->first.c_str());
+        closed->swap(e.pool);
+        open.unlock();
+        pools_.erase(victim);
+        proxy_metrics().add("chaincode_pools_evicted", 1);
+        publish_locked();
+        return true;
+    }
+    return false;
+}
+
+void ChaincodePools::reaper_main()
+{
+    std::chrono::steady_clock::duration idle = std::chrono::seconds(options_.idle_timeout_s);
+    std::chrono::steady_clock::duration interval =
+        std::min<std::chrono::steady_clock::duration>(idle / 4 + std::chrono::seconds(1), REAPER_MAX_INTERVAL);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        cv_.wait_for(lock, interval);
+        std::shared_ptr<TeeWorkerPool> closed;
+        while (!stopping_ && evict_one_locked(idle, &closed)) {
+            // 세션 종료(워커 join)는 잠금 밖에서: 그동안 다른 체인코드의 acquire가 막히지 않게
+            lock.unlock();
+            closed.reset();
+            lock.lock();
+        }
+    }
+}
+
+ChaincodePools::Result ChaincodePools::acquire(const std::string& chaincode_uuid, std::shared_ptr<TeeWorkerPool>* pool)
+{
+    static const TEEC_UUID default_uuid = TA_WAMR_UUID;
+    TEEC_UUID uuid;
+    if (chaincode_uuid.empty()) {
+        *pool = default_lease_;
+        return OK;
+    }
+    if (!uuid_from_bytes(chaincode_uuid, &uuid)) return BAD_UUID;
+    if (memcmp(&uuid, &default_uuid, sizeof(uuid)) == 0) {
+        *pool = default_lease_;
+        return OK;
+    }
+
+    std::string key = uuid_to_string(uuid);
+    for (;;) {
+        std::shared_ptr<Entry> entry;
+        std::shared_ptr<TeeWorkerPool> closed;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::map<std::string, std::shared_ptr<Entry> >::iterator it = pools_.find(key);
+            if (it == pools_.end()) {
+                // 자리가 없으면 가장 오래 쉬고 있는 풀을 닫는다
+                if (pools_.size() >= options_.max_pools && !evict_one_locked(std::chrono::seconds(0), &closed)) {
+                    proxy_metrics().add("chaincode_pools_rejected", 1);
+                    return TOO_MANY;
+                }
+                it = pools_.insert(std::make_pair(key, std::make_shared<Entry>())).first;
+                publish_locked();
+            }
+            entry = it->second;
+            entry->last_used = std::chrono::steady_clock::now();
+        }
+        closed.reset();
+
+        std::lock_guard<std::mutex> open(entry->open_mutex);
+        {
+            // mutex_를 놓은 사이 evict_one_locked가 이 항목을 목록에서 뺐으면(풀은 이미 닫힘) 처음부터 다시
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::map<std::string, std::shared_ptr<Entry> >::iterator it = pools_.find(key);
+            if (it == pools_.end() || it->second != entry) continue;
+        }
+        if (!entry->pool) {
+            // 풀의 워커는 세션을 열지 못하면 프로세스를 끝내므로 TA가 있는지 먼저 열어 본다
+            tee_ctx probe = tee_ctx();
+            if (open_tee_session(&probe, uuid) != TEEC_SUCCESS) {
+                printf("%s Error: 체인코드 TA를 열 수 없음: %s\n", get_timestamp().c_str(), key.c_str());
+                std::lock_guard<std::mutex> lock(mutex_);
+                std::map<std::string, std::shared_ptr<Entry> >::iterator it = pools_.find(key);
+                if (it != pools_.end() && it->second == entry) pools_.erase(it);
+                publish_locked();
+                return NO_TA;
+            }
+            terminate_tee_session(&probe);
+
+            printf("%s 체인코드 풀 열기: TA %s (워커 %d개, heap %u bytes)\n", get_timestamp().c_str(), key.c_str(),
+                   options_.workers, options_.heap_size);
+            entry->pool.reset(new TeeWorkerPool(options_.workers, options_.heap_size, false, max_window_us_,
+                                                 fuel_limit_, sched_, &uuid));
+            proxy_metrics().add("chaincode_pools_opened", 1);
+        }
+        *pool = entry->pool;
+        return OK;
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef CHAINCODE_POOLS_H
+#define CHAINCODE_POOLS_H
+
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "tee_worker_pool.h"
+
+/* 체인코드(TA UUID)별 워커 풀 설정 */
+struct chaincode_pool_options {
+    chaincode_pool_options() : workers(1), heap_size(0), idle_timeout_s(300), max_pools(8) {}
+    int workers;                /* 체인코드마다의 워커(세션) 수 */
+    uint32_t heap_size;         /* 체인코드 TA 인스턴스마다의 heap 크기 */
+    uint32_t idle_timeout_s;    /* 이 시간 동안 쓰이지 않은 풀은 닫는다 (0: 닫지 않음) */
+    uint32_t max_pools;         /* 동시에 열어 두는 체인코드 풀 수 */
+};
+
+/*
+ * 래퍼가 보낸 chaincode_uuid로 체인코드마다 따로 TA 인스턴스(워커 풀)를 연다.
+ * 같은 TA 바이너리를 체인코드 UUID로 빌드해 두면(wrapper_ta/ta: make CHAINCODE_TA_UUID=...)
+ * 체인코드마다 heap, 모듈 캐시, 보안 저장소가 분리되어 한 체인코드의 메모리 압박이나
+ * 세션 재시작이 다른 체인코드의 지연에 영향을 주지 않는다.
+ * UUID가 없거나 TA_WAMR_UUID이면 기본 풀을 쓴다. 체인코드 풀은 처음 호출될 때 열고,
+ * idle_timeout_s 동안 쓰이지 않으면 닫는다 (실행 중인 호출이 있으면 기다린다).
+ */
+class ChaincodePools {
+public:
+    enum Result {
+        OK,
+        BAD_UUID,       /* 16바이트가 아님 */
+        NO_TA,          /* 그 UUID의 TA를 열 수 없음 (설치되지 않음 등) */
+        TOO_MANY,       /* max_pools개가 모두 쓰이는 중 */
+    };
+
+    ChaincodePools(TeeWorkerPool& default_pool, const chaincode_pool_options& options,
+                   uint32_t max_window_us, uint64_t fuel_limit, const sched_options& sched);
+    ~ChaincodePools();
+
+    /* 호출에 쓸 풀. 반환된 포인터를 들고 있는 동안 풀은 닫히지 않는다 */
+    Result acquire(const std::string& chaincode_uuid, std::shared_ptr<TeeWorkerPool>* pool);
+
+    TeeWorkerPool& default_pool() { return default_pool_; }
+
+private:
+    struct Entry {
+        std::mutex open_mutex;      /* 한 체인코드의 풀은 한 번만 연다 */
+        std::shared_ptr<TeeWorkerPool> pool;
+        std::chrono::steady_clock::time_point last_used;
+    };
+
+    bool evict_one_locked(std::chrono::steady_clock::duration idle, std::shared_ptr<TeeWorkerPool>* closed);
+    void reaper_main();
+    void publish_locked();
+
+    TeeWorkerPool& default_pool_;
+    std::shared_ptr<TeeWorkerPool> default_lease_;
+    chaincode_pool_options options_;
+    uint32_t max_window_us_;
+    uint64_t fuel_limit_;
+    sched_options sched_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::map<std::string, std::shared_ptr<Entry> > pools_;   /* UUID 문자열 → 풀 */
+    bool stopping_;
+    std::thread reaper_;
+};
+
+#endif /* CHAINCODE_POOLS_H */
@@ -11,10 +11,15 @@
 #define ARGS_NUMBER 10
 #define RESPONSE_SIZE 256  // 증가된 VAL_SIZE와 일치
 #define ACK_SIZE 20
+#define MODULE_ID_SIZE 64  /* 보안 저장소에 설치된 모듈 이름 (aot_file) */
+#define MODULE_HASH_SIZE 32
+#define MODULE_SIGNATURE_MAX 512  /* 설치 서명 (RSA 키 크기, 4096비트까지) */
 
 #define INVOCATION_RESPONSE 0
 #define GET_STATE_REQUEST 1
 #define PUT_STATE_REQUEST  2
+#define ITER_OPEN_REQUEST 3  /* 범위/부분 복합 키/이력 조회 시작 + 첫 페이지 */
+#define ITER_NEXT_REQUEST 4  /* 열린 반복자의 다음 페이지 */
 #define ERROR 100
 
 /* used for InvokeCommand API */
@@ -30,12 +35,152 @@ struct arguments {
 	char arguments[ARGS_NUMBER][ARG_SIZE];
 };
 
+/* invocation_response.flags */
+#define RESPONSE_FUEL_METERED (1 << 0)  /* 계량 모듈: fuel_used가 유효 (실행한 wasm 명령 수) */
+#define RESPONSE_OUT_OF_FUEL  (1 << 1)  /* 연료 한도(COMMAND_CONFIGURE_FUEL)를 넘어 중단됨 */
+
 struct invocation_response {
 	char execution_response[RESPONSE_SIZE];
+	uint32_t flags;          /* RESPONSE_* */
+	uint32_t fuel_used_lo;   /* 사용한 연료 (64비트, TA가 32비트여도 같은 배치가 되도록 나눠 둔다) */
+	uint32_t fuel_used_hi;
 };
 
 struct acknowledgement {
 	char acknowledgement[ACK_SIZE];
 };
 
+/* COMMAND_LOAD_MODULE 결과 (benchmark_buffer로 전달) */
+struct module_load_stats {
+	uint32_t cache_hit;      /* 1이면 이미 로드된 모듈 재사용 (복사 없음) */
+	uint32_t xip;            /* 1이면 XIP 이미지를 신뢰 사본에서 바로 실행 */
+	uint32_t image_size;
+	uint32_t copied_bytes;   /* TA가 REE 버퍼에서 신뢰 영역으로 복사한 바이트 수 */
+	uint32_t load_time_ms;   /* 해시 + 복사 + wasm_runtime_load 시간 */
+	uint32_t heap_peak_bytes; /* 보안 메모리 최고 사용량: 모듈 이미지 사본 + WAMR 힙 풀 highmark (세션 시작부터) */
+};
+
+/*
+ * 배치 실행 (COMMAND_RUN_BATCH / COMMAND_BATCH_STATE) 메일박스 레코드.
+ * type: GET_STATE_REQUEST = 필요한 키(NEED_STATE) 또는 read set 항목(DONE),
+ *       PUT_STATE_REQUEST = write set 항목, INVOCATION_RESPONSE = 응답, ERROR = 실패 사유
+ */
+#define BATCH_MAX_TX 16    /* TA에 한 번에 상주하는 배치 트랜잭션 수 */
+#define BATCH_RW_MAX 16    /* 트랜잭션당 read set / write set 최대 키 수 */
+#define BATCH_DONE 0       /* params[1].value.a: 레코드는 트랜잭션별 결과 */
+#define BATCH_NEED_STATE 1 /* params[1].value.a: 레코드는 TA가 아직 모르는 키 목록 */
+
+struct batch_record {
+	uint32_t tx;      /* 배치 안에서의 트랜잭션 번호 */
+	uint32_t type;
+	uint32_t flags;          /* 응답 레코드: invocation_response와 같은 의미 */
+	uint32_t fuel_used_lo;
+	uint32_t fuel_used_hi;
+	char key[KEY_SIZE];
+	char value[VAL_SIZE];
+};
+
+/* 트랜잭션마다 read set + write set + 응답 레코드가 모두 들어가는 크기 */
+#define BATCH_MAILBOX_SIZE (BATCH_MAX_TX * (1 + 2 * BATCH_RW_MAX) * sizeof(struct batch_record))
+
+/*
+ * 범위/부분 복합 키/이력 조회 (cc_iter_open / cc_iter_next).
+ * TA → REE 요청은 메일박스의 iter로, REE → TA 페이지는 단건 RESUME의 params[2]에 struct iter_reply로
+ * 넘긴다 (페이지는 메일박스보다 커서 COMMAND_MULTI_STEP에는 싣지 않는다). TA는 헤더와 레코드를 그대로
+ * WASM 버퍼에 복사하므로 체인코드가 보는 형식도 같다: 레코드는 [u32 키 길이][키][u32 값 길이][값]
+ * (리틀 엔디언). 이력 조회 레코드의 키는 트랜잭션 id이고 삭제된 값은 빈 값이다.
+ */
+#define ITER_RANGE 0              /* start 이상 end 미만 (end가 비면 끝까지) */
+#define ITER_PARTIAL_COMPOSITE 1  /* start = object type, end = 속성들을 ITER_ATTR_SEPARATOR로 이은 것 */
+#define ITER_HISTORY 2            /* start = 키 */
+#define ITER_ATTR_SEPARATOR '\x1f'
+#define ITER_PAGE_BYTES (32 * 1024)
+
+struct iter_request {
+	uint32_t kind;        /* ITER_OPEN_REQUEST: ITER_* */
+	uint32_t iter_id;     /* ITER_NEXT_REQUEST: 반복자 번호 */
+	uint32_t max_bytes;   /* 페이지 레코드에 쓸 수 있는 바이트 (WASM 버퍼 - 헤더, ITER_PAGE_BYTES 이하) */
+	char start[KEY_SIZE];
+	char end[KEY_SIZE];
+};
+
+struct iter_page_header {
+	uint32_t iter_id;     /* REE가 정한 반복자 번호 (cc_iter_next에 넘긴다) */
+	uint32_t count;       /* 이 페이지의 레코드 수 */
+	uint32_t has_more;    /* 1이면 cc_iter_next로 더 읽을 수 있다 */
+	uint32_t used;        /* data에 쓴 바이트 수 */
+};
+
+struct iter_reply {
+	struct iter_page_header header;
+	uint8_t data[ITER_PAGE_BYTES];
+};
+
+/*
+ * 시작 메일박스: arguments 뒤에 REE가 미리 읽어 둔 (키, 값)을 싣는다 (manifest의 prefetch 규칙).
+ * TA는 GET_STATE가 이 중 하나를 찾으면 REE로 나가지 않고 바로 넘긴다.
+ * arguments가 맨 앞이므로 prefetch를 모르는 쪽과도 그대로 맞는다 (메일박스 크기로 구분)
+ */
+#define PREFETCH_MAX 4
+
+struct start_request {
+	struct arguments args;
+	uint32_t prefetched;     /* prefetch에 든 항목 수 */
+	struct key_value prefetch[PREFETCH_MAX];
+};
+
+/* 단건 RUN/RESUME 명령의 params[2] 메일박스: 단계마다 아래 중 하나로 쓰인다 */
+union step_mailbox {
+	struct arguments args;
+	struct start_request start;
+	struct iter_request iter;
+	struct key_value kv;
+	struct acknowledgement ack;
+	struct invocation_response resp;
+};
+
+/*
+ * COMMAND_MULTI_STEP 레코드: 단건 RUN_WASM_BY_ID(START) 또는 RESUME_WASM(RESUME) 하나.
+ * mailbox는 단건 명령의 params[2]와 같은 용도로 쓰이고 결과도 그 자리에 돌아온다.
+ */
+#define STEP_OP_START 1
+#define STEP_OP_RESUME 2
+
+struct step_record {
+	uint32_t op;      /* STEP_OP_* */
+	uint32_t slot;    /* RESUME: 재개할 슬롯 / 결과: 트랜잭션 슬롯 */
+	uint32_t type;    /* 결과: INVOCATION_RESPONSE / GET_STATE_REQUEST / PUT_STATE_REQUEST */
+	uint32_t result;  /* 결과: 이 레코드의 TEE_Result */
+	uint32_t budget_ms;  /* START: 남은 시간(ms), 0이면 마감 없음 */
+	char module_id[MODULE_ID_SIZE];  /* START */
+	union step_mailbox mailbox;
+};
+
+/*
+ * 체인코드 로그 링 (SPSC). REE가 세션마다 공유 메모리에 잡아 실행 명령(RUN/RESUME/MULTI_STEP/배치)의
+ * params[3]로 넘긴다: 앞 sizeof(struct log_ring)는 링, 그 뒤 LOG_STDOUT_SIZE는 WASI stdout 버퍼.
+ * TA는 cc_log 레코드를 TEE를 나가지 않고 data에 이어 쓰고 head를 올린다. REE의 수집 스레드는
+ * tail까지 읽어 간다. 자리가 없으면 레코드를 버리고 dropped를 센다.
+ * head/tail은 누적 바이트 수이고 위치는 % LOG_RING_DATA. 레코드: struct log_record + 메시지
+ * (링 끝에서 앞으로 이어질 수 있음). magic이 다르거나 버퍼가 작으면 TA는 링 없이 전체를 stdout에 쓴다.
+ */
+#define LOG_RING_MAGIC 0x52474f4c   /* "LOGR" */
+#define LOG_RING_DATA (16 * 1024)   /* 2의 거듭제곱 */
+#define LOG_RECORD_MAX 256          /* 메시지 최대 바이트 (넘으면 잘림) */
+#define LOG_STDOUT_SIZE (5 * 1024)
+
+struct log_ring {
+	uint32_t magic;
+	uint32_t head;      /* TA가 쓴 누적 바이트 (TA만 씀) */
+	uint32_t tail;      /* REE가 읽은 누적 바이트 (REE만 씀) */
+	uint32_t dropped;   /* 자리가 없어 버린 레코드 수 (TA만 씀) */
+	uint8_t data[LOG_RING_DATA];
+};
+
+struct log_record {
+	uint16_t len;       /* 뒤따르는 메시지 바이트 수 */
+	uint8_t slot;       /* 로그를 남긴 트랜잭션 슬롯 */
+	uint8_t reserved;
+};
+
 #endif /* CHAINCODE_TEE_REE_COMMUNICATION_H */
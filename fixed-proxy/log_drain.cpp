@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+#include "chaincode_tee_ree_communication.h"
+
+#include "log_drain.h"
+#include "proxy_log.h"
+#include "proxy_metrics.h"
+
+/* 링을 비우는 간격 (링 크기와 함께 초당 쓸 수 있는 로그 양을 정한다) */
+static const std::chrono::milliseconds POLL_INTERVAL(20);
+
+void LogDrain::add(struct log_ring* ring, const std::string& source)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Source s;
+    s.ring = ring;
+    s.name = source;
+    s.dropped = 0;
+    sources_.push_back(s);
+    if (!started_) {
+        // 프로세스가 끝날 때까지 돈다 (세션이 없으면 빈 목록을 볼 뿐)
+        started_ = true;
+        std::thread(&LogDrain::run, this).detach();
+    }
+}
+
+void LogDrain::remove(struct log_ring* ring)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < sources_.size(); i++) {
+        if (sources_[i].ring != ring) continue;
+        drain(&sources_[i]);
+        sources_.erase(sources_.begin() + i);
+        return;
+    }
+}
+
+void LogDrain::run()
+{
+    for (;;) {
+        std::this_thread::sleep_for(POLL_INTERVAL);
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < sources_.size(); i++) drain(&sources_[i]);
+    }
+}
+
+/* at(누적 위치)부터 len 바이트를 링에서 읽는다 (끝에 닿으면 앞에서 이어서) */
+static void ring_read(const struct log_ring* ring, uint32_t at, void* dst, size_t len)
+{
+    uint32_t pos = at % LOG_RING_DATA;
+    size_t first = std::min(len, (size_t)(LOG_RING_DATA - pos));
+    memcpy(dst, ring->data + pos, first);
+    if (first < len) memcpy((uint8_t*)dst + first, ring->data, len - first);
+}
+
+void LogDrain::drain(Source* source)
+{
+    struct log_ring* ring = source->ring;
+    ProxyMetrics& m = proxy_metrics();
+
+    uint32_t dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+    if (dropped != source->dropped) {
+        m.add("chaincode_log_dropped", (double)(uint32_t)(dropped - source->dropped));
+        source->dropped = dropped;
+    }
+
+    // head까지의 레코드는 TA가 다 쓴 것이다 (TA는 레코드를 쓴 뒤 release로 head를 올린다)
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint32_t tail = ring->tail;
+    if (head - tail > LOG_RING_DATA) {
+        m.add("chaincode_log_corrupt", 1);
+        __atomic_store_n(&ring->tail, head, __ATOMIC_RELEASE);
+        return;
+    }
+
+    char msg[LOG_RECORD_MAX + 1];
+    while (head - tail >= sizeof(struct log_record)) {
+        struct log_record rec;
+        ring_read(ring, tail, &rec, sizeof(rec));
+        if (rec.len > LOG_RECORD_MAX || head - tail - sizeof(rec) < rec.len) {
+            // 레코드 경계를 잃었다: 남은 것을 버리고 TA가 새로 쓰는 곳부터 다시 읽는다
+            m.add("chaincode_log_corrupt", 1);
+            tail = head;
+            break;
+        }
+        ring_read(ring, tail + sizeof(rec), msg, rec.len);
+        msg[rec.len] = '\0';
+        tail += sizeof(rec) + rec.len;
+        printf("%s [chaincode] ta=%s slot=%u msg=\"%s\"\n", get_timestamp().c_str(),
+               source->name.c_str(), rec.slot, msg);
+        m.add("chaincode_log_records", 1);
+        m.add("chaincode_log_bytes", rec.len);
+    }
+    // 읽은 자리를 TA에 돌려준다
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+}
+
+LogDrain& chaincode_log_drain()
+{
+    // 분리된 수집 스레드가 참조하므로 프로세스 끝까지 둔다
+    static LogDrain* drain = new LogDrain();
+    return *drain;
+}
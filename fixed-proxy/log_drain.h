@@ -0,0 +1,42 @@
+#ifndef LOG_DRAIN_H
+#define LOG_DRAIN_H
+
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct log_ring;
+
+/*
+ * TA 세션들의 체인코드 로그 링(struct log_ring)을 한 스레드가 주기적으로 비워 프록시 로그로 낸다.
+ * 세션을 열 때 add, 닫기 전(공유 메모리 해제 전)에 remove한다. remove는 남은 레코드를 마저 읽는다.
+ * 지표: chaincode_log_records, chaincode_log_bytes, chaincode_log_dropped(링이 가득 차 TA가 버림),
+ * chaincode_log_corrupt(헤더가 맞지 않아 건너뜀)
+ */
+class LogDrain {
+public:
+    LogDrain() : started_(false) {}
+
+    void add(struct log_ring* ring, const std::string& source);
+    void remove(struct log_ring* ring);
+
+private:
+    struct Source {
+        struct log_ring* ring;
+        std::string name;
+        uint32_t dropped;   /* 마지막으로 본 TA의 dropped */
+    };
+
+    void run();
+    void drain(Source* source);
+
+    std::mutex mutex_;     /* sources_와, 링을 읽는 동안 remove를 막는다 */
+    std::vector<Source> sources_;
+    bool started_;
+};
+
+LogDrain& chaincode_log_drain();
+
+#endif /* LOG_DRAIN_H */
@@ -9,14 +9,31 @@
 #include <csignal>
 #include <chrono>
 #include <iomanip>
-
-// GlobalPlatform Client API
-#include <tee_client_api.h>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <fstream>
+#include <mutex>
+#include <unistd.h>
 
 // GlobalPlatfrom TA
 #include <wamr_ta.h>
 #include "chaincode_tee_ree_communication.h"
 
+#include "admission_control.h"
+#include "aot_compiler.h"
+#include "chaincode_pools.h"
+#include "proxy_metrics.h"
+#include "ree_runtime.h"
+#include "result_cache.h"
+#include "state_cache.h"
+#include "stream_state.h"
+#include "tee_session.h"
+#include "tee_worker_pool.h"
+#include "warmup.h"
+
 // gRPC includes
 #include <grpcpp/grpcpp.h>
 #include "invocation.grpc.pb.h"
@@ -30,367 +47,259 @@ using grpc::Status;
 using invocation::ChaincodeProxyMessage;
 using invocation::ChaincodeWrapperMessage;
 using invocation::GetStateRequest;
+using invocation::GetStateResponse;
 using invocation::PutStateRequest;
 using invocation::InvocationResponse;
 using invocation::Invocation;
+using invocation::BatchProxyMessage;
+using invocation::BatchWrapperMessage;
+using invocation::BatchResponse;
+using invocation::GetStatesRequest;
+using invocation::InvocationRequest;
+using invocation::KeyValue;
+using invocation::TransactionResult;
+using invocation::MetricsRequest;
+using invocation::MetricsResponse;
+using invocation::ValidateReadsRequest;
+using invocation::ValidateReadsResponse;
+using invocation::OpenIteratorRequest;
+using invocation::NextPageRequest;
+using invocation::IteratorPage;
+using invocation::CommitNotification;
+using invocation::CommitAck;
+using invocation::HealthRequest;
+using invocation::HealthResponse;
+using invocation::ModuleHealth;
+
+/* TA 인스턴스(워커 세션)마다 잡히는 WAMR 힙 풀 크기 */
+static const uint32_t TA_HEAP_SIZE = 10 * 1024 * 1024;
+
+/* 클라이언트 deadline이 더 길거나 없을 때 적용하는 트랜잭션 마감 */
+static const uint32_t DEFAULT_TX_TIMEOUT_MS = 30 * 1000;
+
+/* 자리를 기다리는 요청의 예상 대기가 이보다 길면 바로 거절 (RESOURCE_EXHAUSTED) */
+static const uint32_t DEFAULT_MAX_QUEUE_WAIT_MS = 1000;
+/* 기본 대기 큐 크기: 동시 실행 한도의 배수 */
+static const uint32_t DEFAULT_QUEUE_FACTOR = 4;
+/* 상태 캐시: 키 수와, 이보다 큰 값은 캐시하지 않는 크기 */
+static const size_t DEFAULT_STATE_CACHE_ENTRIES = 10000;
+static const size_t STATE_CACHE_MAX_VALUE_SIZE = 64 * 1024;
+/* 조회 결과 캐시: 이보다 큰 응답은 캐시하지 않는다 */
+static const size_t RESULT_CACHE_MAX_RESPONSE_SIZE = 64 * 1024;
 
-/* TEE resources */
-typedef struct _tee_ctx {
-	TEEC_Context ctx;
-	TEEC_Session sess;
-    uint8_t *output_buffer;
-    uint64_t output_buffer_size;
-    uint8_t *benchmark_buffer;
-    uint64_t benchmark_buffer_size;
-} tee_ctx;
+/* 서버 모드 명령행 옵션 */
+struct server_options {
+    server_options()
+        : workers(0), batch_window_us(TeeWorkerPool::DEFAULT_BATCH_WINDOW_US),
+          tx_timeout_ms(DEFAULT_TX_TIMEOUT_MS), fuel_limit(0),
+          max_inflight(0), max_queued(-1), max_queue_wait_ms(DEFAULT_MAX_QUEUE_WAIT_MS),
+          state_cache_entries(DEFAULT_STATE_CACHE_ENTRIES), result_cache_entries(0),
+          warmup_manifest(DEFAULT_WARMUP_MANIFEST), warm_instances(1), wamrc(DEFAULT_WAMRC) {}
+    int workers;                /* 0: 온라인 코어 수 */
+    uint32_t batch_window_us;
+    uint32_t tx_timeout_ms;     /* 0: 클라이언트 deadline만 */
+    uint64_t fuel_limit;        /* 계량 모듈의 트랜잭션당 연료 한도, 0: 없음 */
+    uint32_t max_inflight;      /* 동시에 실행하는 트랜잭션 수, 0: 워커 수 × TA_TX_SLOTS */
+    int max_queued;             /* 자리를 기다리는 트랜잭션 수, 음수: max_inflight × DEFAULT_QUEUE_FACTOR */
+    uint32_t max_queue_wait_ms; /* 0: 예상 대기로는 거절하지 않음 */
+    sched_options sched;        /* 조회 차선, 체인코드별 가중치, 읽기 전용 함수 이름 */
+    chaincode_pool_options chaincode;   /* chaincode_uuid별 TA 풀 */
+    size_t state_cache_entries; /* 트랜잭션 사이 상태 캐시 크기, 0: 끔 */
+    size_t result_cache_entries;    /* 조회 결과 캐시 크기, 0: 끔 */
+    std::string warmup_manifest;    /* 포트를 열기 전에 예열할 모듈 목록 (없으면 건너뜀) */
+    uint32_t warm_instances;        /* 예열 목록에 instances=가 없을 때 워커마다 미리 만들 인스턴스 수 */
+    std::string wamrc;              /* .wasm 모듈을 백그라운드에서 AOT로 컴파일할 wamrc */
+};
 
 /* Forward declarations */
-static void prepare_tee_session(tee_ctx* ctx);
-static void configure_heap_size(tee_ctx *ctx, uint32_t size);
-static void allocate_buffers(tee_ctx* ctx, uint64_t buffers_size);
-static void terminate_tee_session(tee_ctx* ctx);
-static void free_buffers(tee_ctx* ctx);
 void cleanup(int signum);
-static void run_server();
-
-/* Time measurement utility */
-static std::string get_timestamp() {
-    auto now = std::chrono::steady_clock::now();
-    auto duration = now.time_since_epoch();
-    auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
-    return "[" + std::to_string(millis) + "ms]";
-}
+static void run_server(const server_options& options);
+static int run_load_benchmark(int argc, char *argv[]);
+static int run_deploy(int argc, char *argv[]);
+static int run_scale_benchmark(int argc, char *argv[]);
+static int run_batch_benchmark(int argc, char *argv[]);
+static int run_ree_benchmark(int argc, char *argv[]);
+static int run_pgo_collect(int argc, char *argv[]);
+static int run_pgo_benchmark(int argc, char *argv[]);
 
-static void prepare_tee_session(tee_ctx* ctx)
+void cleanup(int signum)
 {
-	TEEC_UUID uuid = TA_WAMR_UUID;
-	uint32_t origin;
-	TEEC_Result res;
-
-	/* Initialize a context connecting us to the TEE */
-	printf("%s TEE context 초기화 시작\n", get_timestamp().c_str());
-	res = TEEC_InitializeContext(NULL, &ctx->ctx);
-	if (res != TEEC_SUCCESS) {
-		fprintf(stderr, "TEEC_InitializeContext failed with code 0x%x\n", res);
-		exit(1);
-	}
-	printf("%s TEE context 초기화 완료\n", get_timestamp().c_str());
-
-	/* Open a session with the TA */
-	printf("%s TEE session 오픈 시작\n", get_timestamp().c_str());
-	res = TEEC_OpenSession(&ctx->ctx, &ctx->sess, &uuid,
-			       TEEC_LOGIN_PUBLIC, NULL, NULL, &origin);
-	if (res != TEEC_SUCCESS) {
-		fprintf(stderr, "TEEC_OpenSession failed with code 0x%x origin 0x%x\n", res, origin);
-		exit(1);
-	}
-	printf("%s TEE session 오픈 완료\n", get_timestamp().c_str());
+	exit(0);
 }
 
-static void configure_heap_size(tee_ctx *ctx, uint32_t size) {
-    TEEC_Operation op;
-	uint32_t origin;
-	TEEC_Result res;
+/* 배치 실행의 상태 읽기를 라운드마다 GetStatesRequest 하나로 chaincode_wrapper에 묻는다 */
+class BatchStreamStateBackend : public StateBackend {
+public:
+    explicit BatchStreamStateBackend(ServerReaderWriter<BatchProxyMessage, BatchWrapperMessage>* stream)
+        : stream_(stream) {}
 
-    memset(&op, 0, sizeof(op));
-	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE, TEEC_NONE, TEEC_NONE);
-	op.params[0].value.a = size;
+    bool get_state(const std::string& key, std::string* value) override {
+        std::vector<std::string> values;
+        if (!get_states(std::vector<std::string>(1, key), &values)) return false;
+        *value = values[0];
+        return true;
+    }
 
-	printf("%s WaTZ heap 크기 설정 시작 (%u bytes)\n", get_timestamp().c_str(), size);
-	res = TEEC_InvokeCommand(&ctx->sess, COMMAND_CONFIGURE_HEAP, &op, &origin);
-    if (res != TEEC_SUCCESS) {
-        printf("%s WaTZ heap 크기 설정 실패. Error: %x\n", get_timestamp().c_str(), res);
-    } else {
-        printf("%s WaTZ heap 크기 설정 완료\n", get_timestamp().c_str());
+    /* 배치의 쓰기는 write set으로만 돌려주므로 래퍼로 보내지 않는다 */
+    bool put_state(const std::string&, const std::string&, std::string*) override {
+        return false;
     }
-}
 
-static void allocate_buffers(tee_ctx* ctx, uint64_t buffers_size) {
-    printf("%s 버퍼 할당 시작 (%lu bytes)\n", get_timestamp().c_str(), buffers_size);
-    // The output buffer is used to capture writes to stdout from the WASM
-    ctx->output_buffer = (uint8_t*)malloc(buffers_size);
-    ctx->output_buffer_size = buffers_size;
+    bool get_states(const std::vector<std::string>& keys, std::vector<std::string>* values,
+                    std::vector<std::string>* versions = NULL) override {
+        BatchProxyMessage proxy_msg;
+        GetStatesRequest* request = proxy_msg.mutable_get_states_request();
+        for (size_t i = 0; i < keys.size(); i++) request->add_keys(keys[i]);
+        if (!stream_->Write(proxy_msg)) {
+            printf("Failed to send GET_STATES_REQUEST to chaincode_wrapper\n");
+            return false;
+        }
+
+        BatchWrapperMessage wrapper_msg;
+        if (!stream_->Read(&wrapper_msg) || !wrapper_msg.has_get_states_response()) return false;
+
+        // 응답은 키로 맞춘다 (래퍼가 돌려주지 않은 키는 없는 상태 = 빈 값)
+        std::map<std::string, const KeyValue*> received;
+        const invocation::GetStatesResponse& response = wrapper_msg.get_states_response();
+        for (int i = 0; i < response.values_size(); i++) {
+            received[response.values(i).key()] = &response.values(i);
+        }
+        values->assign(keys.size(), std::string());
+        if (versions) versions->assign(keys.size(), std::string());
+        for (size_t i = 0; i < keys.size(); i++) {
+            std::map<std::string, const KeyValue*>::const_iterator it = received.find(keys[i]);
+            if (it == received.end()) continue;
+            (*values)[i] = it->second->value();
+            if (versions) (*versions)[i] = it->second->version();
+        }
+        return true;
+    }
+
+    /* 응답 전에 캐시에서 내준 읽기를 한 번에 확인받는다 (StreamStateBackend::validate_reads와 같음) */
+    bool validate_reads(const std::map<std::string, std::string>& reads, std::vector<std::string>* stale) {
+        BatchProxyMessage proxy_msg;
+        ValidateReadsRequest* request = proxy_msg.mutable_validate_reads_request();
+        for (std::map<std::string, std::string>::const_iterator it = reads.begin(); it != reads.end(); ++it) {
+            KeyValue* kv = request->add_reads();
+            kv->set_key(it->first);
+            kv->set_version(it->second);
+        }
+        if (!stream_->Write(proxy_msg)) {
+            printf("Failed to send VALIDATE_READS_REQUEST to chaincode_wrapper\n");
+            return false;
+        }
+
+        BatchWrapperMessage wrapper_msg;
+        if (!stream_->Read(&wrapper_msg) || !wrapper_msg.has_validate_reads_response()) return false;
+        const ValidateReadsResponse& response = wrapper_msg.validate_reads_response();
+        stale->assign(response.stale_keys().begin(), response.stale_keys().end());
+        return true;
+    }
 
-    // The benchmark buffer is used to capture benchmark information from the TA
-    ctx->benchmark_buffer = (uint8_t*)malloc(buffers_size);
-    ctx->benchmark_buffer_size = buffers_size;
-    printf("%s 버퍼 할당 완료\n", get_timestamp().c_str());
+private:
+    ServerReaderWriter<BatchProxyMessage, BatchWrapperMessage>* stream_;
+};
+
+/* Send final response to chaincode_wrapper */
+static Status send_invocation_response(ServerReaderWriter<ChaincodeProxyMessage, ChaincodeWrapperMessage>* stream,
+                                       const std::string& response, uint64_t fuel_used)
+{
+    ChaincodeProxyMessage proxy_msg;
+    InvocationResponse* invocation_response = proxy_msg.mutable_invocation_response();
+    invocation_response->set_execution_response(response);
+    invocation_response->set_fuel_used(fuel_used);
+    if (!stream->Write(proxy_msg)) {
+        return Status(grpc::StatusCode::UNKNOWN, "Failed to send invocation response");
+    }
+    return Status::OK;
 }
 
-static void terminate_tee_session(tee_ctx* ctx)
+static void add_key_values(const kv_list& from, google::protobuf::RepeatedPtrField<KeyValue>* to)
 {
-	printf("%s TEE 세션 종료 시작\n", get_timestamp().c_str());
-	TEEC_CloseSession(&ctx->sess);
-	TEEC_FinalizeContext(&ctx->ctx);
-	printf("%s TEE 세션 종료 완료\n", get_timestamp().c_str());
+    for (size_t i = 0; i < from.size(); i++) {
+        KeyValue* kv = to->Add();
+        kv->set_key(from[i].first);
+        kv->set_value(from[i].second);
+    }
 }
 
-static void free_buffers(tee_ctx* ctx) {
-    ctx->output_buffer_size = 0;
-    ctx->benchmark_buffer_size = 0;
-    free(ctx->output_buffer);
-    free(ctx->benchmark_buffer);
+/*
+ * 트랜잭션 마감: 클라이언트가 준 gRPC deadline과 서버 기본값(timeout_ms, 0이면 없음) 중
+ * 이른 쪽. 클라이언트가 호출을 취소해도 멈춘다
+ */
+static tx_deadline deadline_for(ServerContext *context, uint32_t timeout_ms)
+{
+    tx_deadline deadline;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (timeout_ms > 0) deadline.at = now + std::chrono::milliseconds(timeout_ms);
+
+    // 클라이언트 deadline은 system_clock 기준이므로 남은 시간으로 옮긴다 (없으면 아주 먼 미래)
+    std::chrono::system_clock::duration left = context->deadline() - std::chrono::system_clock::now();
+    if (left < std::chrono::hours(24 * 365)) {
+        deadline.at = std::min(deadline.at, now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(left));
+    }
+    deadline.cancelled = [context] { return context->IsCancelled(); };
+    return deadline;
 }
 
-void cleanup(int signum)
+/* 마감 초과/취소로 실패한 호출의 gRPC 상태 */
+static Status cancelled_status(ServerContext *context, const char *what)
 {
-	exit(0);
+    if (context->IsCancelled()) return Status(grpc::StatusCode::CANCELLED, what);
+    return Status(grpc::StatusCode::DEADLINE_EXCEEDED, what);
 }
 
 /* gRPC Server Implementation */
 class InvocationImpl final : public Invocation::Service
 {
 private:
-    tee_ctx ctx;
-    
-    /* write the uuid received from the chaincode_wrapper to the shared memory */
-	static void set_uuid(ChaincodeWrapperMessage *wrapper_msg, TEEC_UUID *uuid)
-	{
-		std::string chaincode_uuid = wrapper_msg->invocation_request().chaincode_uuid();
-		uuid->clockSeqAndNode[0] = chaincode_uuid[8];
-		uuid->clockSeqAndNode[1] = chaincode_uuid[9];
-		uuid->clockSeqAndNode[2] = chaincode_uuid[10];
-		uuid->clockSeqAndNode[3] = chaincode_uuid[11];
-		uuid->clockSeqAndNode[4] = chaincode_uuid[12];
-		uuid->clockSeqAndNode[5] = chaincode_uuid[13];
-		uuid->clockSeqAndNode[6] = chaincode_uuid[14];
-		uuid->clockSeqAndNode[7] = chaincode_uuid[15];
-		uuid->timeLow = (chaincode_uuid[0] << 24) | (chaincode_uuid[1] << 16) | (chaincode_uuid[2] << 8) | (chaincode_uuid[3]);
-		uuid->timeMid = (chaincode_uuid[4] << 8) | (chaincode_uuid[5]);
-		uuid->timeHiAndVersion = (chaincode_uuid[6] << 8) | (chaincode_uuid[7]);
-	}
+    ChaincodePools& pools;
+    AdmissionControl& admission;
+    StateCache& cache;
+    ResultCache& result_cache;
+    const server_options& options;
+    const Warmup& warmup;
 
-    /* execute WASM with gRPC proxy loop */
-    bool execute_wasm_with_grpc_proxy(const std::string& aot_file,
-                                     const std::string& function_name, 
-                                     const std::vector<std::string>& args,
-                                     ServerReaderWriter<ChaincodeProxyMessage, ChaincodeWrapperMessage>* stream)
+    /* chaincode_uuid의 TA 풀 (없으면 기본 TA) */
+    Status acquire_pool(const std::string& chaincode_uuid, std::shared_ptr<TeeWorkerPool>* pool)
     {
-        TEEC_Operation op;
-        uint32_t origin;
-        TEEC_Result res;
-        FILE* wasm_file = NULL;
-        long wasm_file_length;
-        unsigned char *wasm_bytecode = NULL;
-        
-        // AOT 파일 로드
-        std::string aot_path = "./chaincode/" + aot_file;
-        printf("%s AOT 파일 로드 시작: %s\n", get_timestamp().c_str(), aot_path.c_str());
-        
-        wasm_file = fopen(aot_path.c_str(), "rb");
-        if (!wasm_file) {
-            printf("%s Error: AOT 파일 열기 실패: %s\n", get_timestamp().c_str(), aot_path.c_str());
-            return false;
-        }
-        
-        fseek(wasm_file, 0, SEEK_END);
-        wasm_file_length = ftell(wasm_file);
-        wasm_bytecode = (unsigned char*)malloc(wasm_file_length);
-        rewind(wasm_file);
-        fread(wasm_bytecode, wasm_file_length, 1, wasm_file);
-        fclose(wasm_file);
-        
-        printf("%s AOT 파일 로드 완료: %ld Bytes\n", get_timestamp().c_str(), wasm_file_length);
-        
-        // 공유 버퍼 설정
-        size_t structure_sizes[] = { sizeof(struct key_value), sizeof(struct acknowledgement), sizeof(struct invocation_response), sizeof(struct arguments) };
-        size_t max_size = 0;
-        for (size_t i = 0; i < sizeof(structure_sizes)/sizeof(structure_sizes[0]); i++)
-            if (structure_sizes[i] > max_size) max_size = structure_sizes[i];
-        uint8_t *shared_buf = (uint8_t*)calloc(1, max_size);
-        if (!shared_buf) {
-            free(wasm_bytecode);
-            return false;
-        }
-
-        memset(&op, 0, sizeof(op));
-        // AOT 바이트코드와 arguments 전달
-        op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT, TEEC_VALUE_INOUT, TEEC_MEMREF_TEMP_INOUT, TEEC_MEMREF_TEMP_INOUT);
-
-        op.params[0].tmpref.buffer = wasm_bytecode;
-        op.params[0].tmpref.size = wasm_file_length;
-        op.params[1].value.a = 0;
-        op.params[2].tmpref.buffer = shared_buf;
-        op.params[2].tmpref.size = max_size;
-        op.params[3].tmpref.buffer = ctx.output_buffer;
-        op.params[3].tmpref.size = ctx.output_buffer_size;
-
-        // struct arguments 설정
-        memset(shared_buf, 0, max_size);
-        struct arguments *arguments_data = (struct arguments *)shared_buf;
-        
-        // function_name을 arguments[0]에 설정
-        size_t fn_len = function_name.length();
-        if (fn_len >= ARG_SIZE) fn_len = ARG_SIZE - 1;
-        memcpy(arguments_data->arguments[0], function_name.c_str(), fn_len);
-        arguments_data->arguments[0][fn_len] = '\0';
-        
-        printf("%s gRPC arguments 설정:\n", get_timestamp().c_str());
-        printf("   Function (args[0]): '%s'\n", arguments_data->arguments[0]);
-        
-        // 나머지 arguments 설정
-        size_t n = args.size();
-        if (n > ARGS_NUMBER - 1) n = ARGS_NUMBER - 1;
-        for (size_t i = 0; i < n; i++) {
-            size_t alen = args[i].length();
-            if (alen >= ARG_SIZE) alen = ARG_SIZE - 1;
-            memcpy(arguments_data->arguments[i + 1], args[i].c_str(), alen);
-            arguments_data->arguments[i + 1][alen] = '\0';
-            printf("   Arg%zu (args[%zu]): '%s'\n", i, i+1, arguments_data->arguments[i + 1]);
-        }
-
-        printf("%s TEE에서 WASM 실행 시작...\n", get_timestamp().c_str());
-        res = TEEC_InvokeCommand(&ctx.sess, COMMAND_RUN_WASM, &op, &origin);
-        if (res != TEEC_SUCCESS) {
-            printf("%s WASM 실행 실패! res=0x%x origin=0x%x\n", get_timestamp().c_str(), res, origin);
-            free(shared_buf);
-            free(wasm_bytecode);
-            return false;
+        switch (pools.acquire(chaincode_uuid, pool)) {
+        case ChaincodePools::OK:
+            return Status::OK;
+        case ChaincodePools::BAD_UUID:
+            return Status(grpc::StatusCode::INVALID_ARGUMENT, "chaincode_uuid must be 16 bytes");
+        case ChaincodePools::NO_TA:
+            return Status(grpc::StatusCode::FAILED_PRECONDITION, "No TA installed for chaincode_uuid");
+        case ChaincodePools::TOO_MANY:
+        default:
+            return Status(grpc::StatusCode::RESOURCE_EXHAUSTED, "Too many chaincode TAs in use");
         }
-
-        bool ok = true;
-        printf("%s gRPC proxy 루프 진입...\n", get_timestamp().c_str());
-        while (true) {
-            switch (op.params[1].value.a) {
-                case INVOCATION_RESPONSE: {
-                    struct invocation_response *resp = (struct invocation_response *)shared_buf;
-                    printf("%s [INVOCATION_RESPONSE] %s\n", get_timestamp().c_str(), resp->execution_response);
-                    
-                    // Send final response to chaincode_wrapper
-                    ChaincodeProxyMessage proxy_msg;
-                    InvocationResponse* invocation_response = new InvocationResponse();
-                    invocation_response->set_execution_response(resp->execution_response);
-                    proxy_msg.set_allocated_invocation_response(invocation_response);
-                    ok = stream->Write(proxy_msg);
-                    goto out;
-                }
-                case GET_STATE_REQUEST: {
-                    struct key_value *kv = (struct key_value *)shared_buf;
-                    printf("%s [GET_STATE_REQUEST] chaincode_wrapper로 전송: key='%s'\n", get_timestamp().c_str(), kv->key);
-                    
-                    // Forward GET_STATE to chaincode_wrapper
-                    ChaincodeProxyMessage proxy_msg;
-                    GetStateRequest* get_state_request = new GetStateRequest();
-                    get_state_request->set_key(kv->key);
-                    proxy_msg.set_allocated_get_state_request(get_state_request);
-                    if (!stream->Write(proxy_msg)) {
-                        printf("Failed to send GET_STATE_REQUEST to chaincode_wrapper\n");
-                        ok = false; goto out;
-                    }
-                    
-                    // Wait for response from chaincode_wrapper
-                    ChaincodeWrapperMessage wrapper_msg;
-                    if (!stream->Read(&wrapper_msg)) {
-                        printf("%s ❌ chaincode_wrapper로부터 GET_STATE_RESPONSE 수신 실패\n", get_timestamp().c_str());
-                        ok = false; goto out;
-                    }
-                    std::string get_state_response = wrapper_msg.get_state_response().value();
-                    printf("%s [GET_STATE_RESPONSE] chaincode_wrapper로부터 수신: value='%s' (len=%zu)\n", 
-                           get_timestamp().c_str(), get_state_response.c_str(), get_state_response.length());
-                    
-                    // Write response back to shared memory
-                    memset(shared_buf, 0, max_size);
-                    kv = (struct key_value *)shared_buf;
-                    if (get_state_response.length() < VAL_SIZE) {
-                        strncpy(kv->value, get_state_response.c_str(), VAL_SIZE - 1);
-                    }
-                    printf("%s [GET_STATE_RESPONSE] TA 공유 메모리에 쓰기: value='%s'\n", get_timestamp().c_str(), kv->value);
-                    
-                    // Resume WASM execution
-                    printf("%s WASM 실행 재개 (GET_STATE 응답 후)\n", get_timestamp().c_str());
-                    op.paramTypes = TEEC_PARAM_TYPES(TEEC_NONE, TEEC_VALUE_INOUT, TEEC_MEMREF_TEMP_INOUT, TEEC_MEMREF_TEMP_INOUT);
-                    res = TEEC_InvokeCommand(&ctx.sess, COMMAND_RESUME_WASM, &op, &origin);
-                    if (res != TEEC_SUCCESS) { 
-                        ok = false; goto out; 
-                    }
-                    break;
-                }
-                case PUT_STATE_REQUEST: {
-                    struct key_value *kv = (struct key_value *)shared_buf;
-                    printf("%s [PUT_STATE_REQUEST] chaincode_wrapper로 전송: key='%s', value='%s'\n", get_timestamp().c_str(), kv->key, kv->value);
-                    
-                    // Forward PUT_STATE to chaincode_wrapper
-                    ChaincodeProxyMessage proxy_msg;
-                    PutStateRequest* put_state_request = new PutStateRequest();
-                    put_state_request->set_key(kv->key);
-                    put_state_request->set_value(kv->value);
-                    proxy_msg.set_allocated_put_state_request(put_state_request);
-                    if (!stream->Write(proxy_msg)) {
-                        printf("Failed to send PUT_STATE_REQUEST to chaincode_wrapper\n");
-                        ok = false; goto out;
-                    }
-                    printf("%s PUT_STATE_REQUEST 전송 완료\n", get_timestamp().c_str());
-                    
-                    // Wait for acknowledgement from chaincode_wrapper
-                    ChaincodeWrapperMessage wrapper_msg;
-                    if (!stream->Read(&wrapper_msg)) {
-                        printf("%s chaincode_wrapper로부터 PUT_STATE_RESPONSE 수신 실패\n", get_timestamp().c_str());
-                        ok = false; goto out;
-                    }
-                    printf("%s [PUT_STATE_RESPONSE] chaincode_wrapper로부터 확인 수신\n", get_timestamp().c_str());
-                    std::string put_state_response = wrapper_msg.put_state_response().acknowledgement();
-                    printf("%s [PUT_STATE_RESPONSE] 확인 메시지: '%s' (len=%zu)\n", 
-                           get_timestamp().c_str(), put_state_response.c_str(), put_state_response.length());
-                    
-                    // Write acknowledgement back to shared memory
-                    memset(shared_buf, 0, max_size);
-                    struct acknowledgement *ack = (struct acknowledgement *)shared_buf;
-                    if (put_state_response.length() < ACK_SIZE) {
-                        strncpy(ack->acknowledgement, put_state_response.c_str(), ACK_SIZE - 1);
-                    }
-                    printf("%s [PUT_STATE_RESPONSE] TA 공유 메모리에 쓰기: ack='%s'\n", get_timestamp().c_str(), ack->acknowledgement);
-                    
-                    // Resume WASM execution
-                    printf("%s WASM 실행 재개 (PUT_STATE 응답 후)\n", get_timestamp().c_str());
-                    op.paramTypes = TEEC_PARAM_TYPES(TEEC_NONE, TEEC_VALUE_INOUT, TEEC_MEMREF_TEMP_INOUT, TEEC_MEMREF_TEMP_INOUT);
-                    res = TEEC_InvokeCommand(&ctx.sess, COMMAND_RESUME_WASM, &op, &origin);
-                    if (res != TEEC_SUCCESS) { 
-                        ok = false; goto out; 
-                    }
-                    break;
-                }
-                case ERROR:
-                default:
-                    ok = false;
-                    goto out;
-            }
-        }
-
-    out:
-        free(shared_buf);
-        free(wasm_bytecode);
-        return ok;
     }
 
-private:
-    void initialize_session() {
-        printf("%s InvocationImpl 세션 초기화 시작\n", get_timestamp().c_str());
-        allocate_buffers(&ctx, 5 * 1024);
-        prepare_tee_session(&ctx);
-        configure_heap_size(&ctx, 10 * 1024 * 1024);  // 10MB heap
-        printf("%s InvocationImpl 세션 초기화 완료\n", get_timestamp().c_str());
-    }
-    
-    void cleanup_session() {
-        terminate_tee_session(&ctx);
-        free_buffers(&ctx);
-    }
-    
-    void restart_session() {
-        printf("%s TEE 세션 재시작 (메모리 정리)\n", get_timestamp().c_str());
-        cleanup_session();
-        initialize_session();
-        printf("%s TEE 세션 재시작 완료\n", get_timestamp().c_str());
+    /* 자리가 날 때까지 기다리거나, 과부하면 재시도 시간(retry-after-ms 트레일러)과 함께 바로 거절 */
+    Status admit(ServerContext *context, uint32_t units, const tx_deadline& deadline,
+                 AdmissionControl::Ticket *ticket, bool priority = false)
+    {
+        uint32_t retry_after_ms = 0;
+        switch (admission.admit(units, deadline, ticket, &retry_after_ms, priority)) {
+        case AdmissionControl::ADMITTED:
+            return Status::OK;
+        case AdmissionControl::EXPIRED:
+            return cancelled_status(context, "Cancelled while waiting for admission");
+        case AdmissionControl::REJECTED:
+        default:
+            printf("%s 과부하로 거절 (재시도 권장: %ums 후)\n", get_timestamp().c_str(), retry_after_ms);
+            context->AddTrailingMetadata("retry-after-ms", std::to_string(retry_after_ms));
+            return Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                          "Proxy overloaded, retry after " + std::to_string(retry_after_ms) + " ms");
+        }
     }
 
 public:
-    InvocationImpl() {
-        initialize_session();
-    }
-    
-    ~InvocationImpl() {
-        cleanup_session();
-    }
+    InvocationImpl(ChaincodePools& pools, AdmissionControl& admission, StateCache& cache, ResultCache& result_cache,
+                   const server_options& options, const Warmup& warmup)
+        : pools(pools), admission(admission), cache(cache), result_cache(result_cache), options(options),
+          warmup(warmup) {}
 
     Status TransactionInvocation(ServerContext *context, 
                                 ServerReaderWriter<ChaincodeProxyMessage, ChaincodeWrapperMessage> *stream) override
@@ -403,39 +312,266 @@ public:
             return Status(grpc::StatusCode::UNKNOWN, "Failed to read invocation request");  
         }
 
-        // Extract AOT file, function name and arguments
-        std::string aot_file = wrapper_msg.invocation_request().aot_file();
-        std::string function_name = wrapper_msg.invocation_request().function_name();
-        std::vector<std::string> args;
-        for (int i = 0; i < wrapper_msg.invocation_request().arguments_size(); i++) {
-            args.push_back(wrapper_msg.invocation_request().arguments(i));
-        }
+        // Extract AOT file, function name and arguments (요청 메시지의 문자열을 복사하지 않고 넘겨받는다)
+        InvocationRequest* request = wrapper_msg.mutable_invocation_request();
+        tx_invocation invocation;
+        invocation.aot_file.swap(*request->mutable_aot_file());
+        invocation.function_name.swap(*request->mutable_function_name());
+        invocation.args.resize(request->arguments_size());
+        for (int i = 0; i < request->arguments_size(); i++) invocation.args[i].swap(*request->mutable_arguments(i));
         
         printf("%s AOT File: %s, Function: %s, Args count: %zu\n", 
-               get_timestamp().c_str(), aot_file.c_str(), function_name.c_str(), args.size());
+               get_timestamp().c_str(), invocation.aot_file.c_str(), invocation.function_name.c_str(), invocation.args.size());
 
-        // Execute WASM with gRPC proxy loop
+        // 코어에 고정된 TEE 워커의 TA 슬롯 하나에서 트랜잭션을 실행한다.
+        // GET/PUT 왕복은 이 핸들러 스레드가 기다리므로 그동안 워커는 다른 트랜잭션을 처리한다.
         printf("%s WASM 실행 시작\n", get_timestamp().c_str());
-        bool success = execute_wasm_with_grpc_proxy(aot_file, function_name, args, stream);
+        // 읽기는 상태 캐시를 먼저 보고, 캐시에서 내준 값은 응답 전에 래퍼에 확인받는다
+        StreamStateBackend wrapper_state(stream);
+        CachingStateBackend state(&wrapper_state, &cache);
+        std::string response;
+        tx_usage usage;
+        tx_deadline deadline = deadline_for(context, options.tx_timeout_ms);
+        // 조회(읽기 전용)는 일반 요청보다 앞에 서고 조회 몫의 자리를 쓸 수 있다
+        std::shared_ptr<TeeWorkerPool> pool;
+        Status routed = acquire_pool(request->chaincode_uuid(), &pool);
+        if (!routed.ok()) return routed;
+        bool query = pool->classify(invocation).read_only;
+
+        // 같은 조회의 결과가 캐시에 있거나 실행 중이면 TEE에 들어가지 않고 그 결과를 쓴다.
+        // 그 결과의 read set은 래퍼에 확인받고(Fabric read set에도 남음), 낡았으면 직접 실행한다
+        ResultCache::Lead lead;
+        std::string result_key;
+        if (query && result_cache.enabled()) {
+            result_key = result_cache.key_for(pool->current_module_id(invocation.aot_file), invocation.function_name,
+                                              invocation.args);
+            cached_result cached;
+            if (result_cache.find(result_key, deadline, &cached, &lead)) {
+                std::vector<std::string> stale;
+                if (!cached.reads.empty() && !wrapper_state.validate_reads(cached.reads, &stale)) {
+                    return Status(grpc::StatusCode::UNKNOWN, "Failed to validate cached result");
+                }
+                if (stale.empty()) {
+                    printf("%s 캐시된 조회 결과로 응답\n", get_timestamp().c_str());
+                    return send_invocation_response(stream, cached.response, cached.fuel_used);
+                }
+                cache.invalidate(stale);
+                result_cache.drop(result_key);
+            }
+        }
+
+        AdmissionControl::Ticket ticket;
+        Status admitted = admit(context, 1, deadline, &ticket, query);
+        if (!admitted.ok()) return admitted;
+        bool success = pool->execute(std::move(invocation), &state, &response, deadline, &usage);
         printf("%s WASM 실행 완료 (성공: %s)\n", get_timestamp().c_str(), success ? "true" : "false");
-        
-        // 실행 완료 후 TEE 세션 재시작으로 메모리 정리
-        restart_session();
-        
+        if (usage.metered) {
+            printf("%s 연료 사용량: %llu%s\n", get_timestamp().c_str(), (unsigned long long)usage.fuel_used,
+                   usage.out_of_fuel ? " (한도 초과)" : "");
+        }
+
         if (!success) {
+            if (usage.out_of_fuel) return Status(grpc::StatusCode::RESOURCE_EXHAUSTED, "WASM execution ran out of fuel");
+            if (deadline.expired()) return cancelled_status(context, "WASM execution cancelled");
             return Status(grpc::StatusCode::UNKNOWN, "WASM execution failed");
         }
-        
+
+        if (!state.cached_reads().empty()) {
+            std::vector<std::string> stale;
+            if (!wrapper_state.validate_reads(state.cached_reads(), &stale)) {
+                return Status(grpc::StatusCode::UNKNOWN, "Failed to validate cached reads");
+            }
+            if (!stale.empty()) {
+                // 캐시가 커밋을 놓쳤다: 그 키를 지우고 클라이언트가 다시 시도하게 한다
+                cache.invalidate(stale);
+                proxy_metrics().add("state_cache_stale_aborts", 1);
+                printf("%s 캐시된 읽기가 낡음 (키 %zu개), 트랜잭션 중단\n", get_timestamp().c_str(), stale.size());
+                return Status(grpc::StatusCode::ABORTED, "Stale cached read of key '" + stale[0] + "', retry");
+            }
+        }
+
+        // 범위/이력 조회 결과는 키별 버전으로 다시 확인할 수 없으므로 캐시하지 않는다
+        if (lead.leading() && !state.wrote() && !state.scanned()) {
+            cached_result result;
+            result.response = response;
+            result.fuel_used = usage.fuel_used;
+            result.reads = state.reads();
+            lead.publish(result);
+        }
+
+        return send_invocation_response(stream, response, usage.fuel_used);
+    }
+
+    Status ExecuteBatch(ServerContext *context,
+                        ServerReaderWriter<BatchProxyMessage, BatchWrapperMessage> *stream) override
+    {
+        BatchWrapperMessage wrapper_msg;
+        if (!stream->Read(&wrapper_msg) || !wrapper_msg.has_batch_request()) {
+            return Status(grpc::StatusCode::UNKNOWN, "Failed to read batch request");
+        }
+
+        const invocation::BatchRequest& request = wrapper_msg.batch_request();
+        std::vector<tx_invocation> invocations(request.invocations_size());
+        for (int i = 0; i < request.invocations_size(); i++) {
+            InvocationRequest* in = wrapper_msg.mutable_batch_request()->mutable_invocations(i);
+            invocations[i].aot_file.swap(*in->mutable_aot_file());
+            invocations[i].function_name.swap(*in->mutable_function_name());
+            invocations[i].args.resize(in->arguments_size());
+            for (int k = 0; k < in->arguments_size(); k++) invocations[i].args[k].swap(*in->mutable_arguments(k));
+            if (in->chaincode_uuid() != request.invocations(0).chaincode_uuid()) {
+                return Status(grpc::StatusCode::INVALID_ARGUMENT, "All invocations of a batch must use one chaincode_uuid");
+            }
+        }
+        printf("%s 배치 요청 수신: 트랜잭션 %zu개\n", get_timestamp().c_str(), invocations.size());
+        std::shared_ptr<TeeWorkerPool> pool;
+        Status routed = acquire_pool(invocations.empty() ? std::string() : request.invocations(0).chaincode_uuid(), &pool);
+        if (!routed.ok()) return routed;
+
+        // 같은 모듈끼리 묶어 TEE 진입 한 번에 여러 트랜잭션을 실행하고, 읽기는 라운드마다 한 번에 묻는다.
+        // 캐시 적중은 응답 전에 래퍼에 확인받는다 (캐시의 버전이 낡았으면 그 버전이 read set에 그대로
+        // 들어가 클라이언트의 MVCC 검증으로는 잡히지 않는다)
+        BatchStreamStateBackend wrapper_state(stream);
+        CachingStateBackend state(&wrapper_state, &cache);
+        std::vector<batch_result> results;
+        tx_deadline deadline = deadline_for(context, options.tx_timeout_ms);
+        AdmissionControl::Ticket ticket;
+        Status admitted = admit(context, (uint32_t)invocations.size(), deadline, &ticket);
+        if (!admitted.ok()) return admitted;
+        if (!pool->execute_batch(invocations, &state, &results, deadline)) {
+            if (deadline.expired()) return cancelled_status(context, "Batch execution cancelled");
+            return Status(grpc::StatusCode::UNKNOWN, "Batch execution failed");
+        }
+
+        if (!state.cached_reads().empty()) {
+            std::vector<std::string> stale;
+            if (!wrapper_state.validate_reads(state.cached_reads(), &stale)) {
+                return Status(grpc::StatusCode::UNKNOWN, "Failed to validate cached reads");
+            }
+            if (!stale.empty()) {
+                // 캐시가 커밋을 놓쳤다: 그 키를 지우고 클라이언트가 배치를 다시 보내게 한다
+                cache.invalidate(stale);
+                proxy_metrics().add("state_cache_stale_aborts", 1);
+                printf("%s 배치의 캐시된 읽기가 낡음 (키 %zu개), 배치 중단\n", get_timestamp().c_str(), stale.size());
+                return Status(grpc::StatusCode::ABORTED, "Stale cached read of key '" + stale[0] + "', retry");
+            }
+        }
+
+        BatchProxyMessage proxy_msg;
+        BatchResponse* response = proxy_msg.mutable_batch_response();
+        size_t succeeded = 0;
+        std::vector<std::string> written;
+        for (size_t i = 0; i < results.size(); i++) {
+            for (size_t k = 0; results[i].ok && k < results[i].write_set.size(); k++) {
+                written.push_back(results[i].write_set[k].first);
+            }
+            TransactionResult* result = response->add_results();
+            result->set_ok(results[i].ok);
+            result->set_execution_response(results[i].response);
+            add_key_values(results[i].read_set, result->mutable_read_set());
+            add_key_values(results[i].write_set, result->mutable_write_set());
+            for (size_t k = 0; k < results[i].read_versions.size() && k < results[i].read_set.size(); k++) {
+                result->mutable_read_set((int)k)->set_version(results[i].read_versions[k]);
+            }
+            result->set_executions(results[i].executions);
+            result->set_fuel_used(results[i].usage.fuel_used);
+            if (results[i].ok) succeeded++;
+        }
+        printf("%s 배치 실행 완료 (성공 %zu / %zu)\n", get_timestamp().c_str(), succeeded, results.size());
+        // 클라이언트가 커밋할 쓰기: 곧 바뀔 키는 미리 지운다
+        cache.invalidate(written);
+        if (!stream->Write(proxy_msg)) {
+            return Status(grpc::StatusCode::UNKNOWN, "Failed to send batch response");
+        }
+        return Status::OK;
+    }
+
+    Status GetMetrics(ServerContext *context, const MetricsRequest *request,
+                      MetricsResponse *response) override
+    {
+        (void)context;
+        (void)request;
+        std::map<std::string, double> values = proxy_metrics().snapshot();
+        response->mutable_values()->insert(values.begin(), values.end());
+        return Status::OK;
+    }
+
+    Status NotifyCommit(ServerContext *context, const CommitNotification *request, CommitAck *response) override
+    {
+        (void)context;
+        size_t removed = request->flush() ? cache.clear()
+                                          : cache.invalidate(std::vector<std::string>(request->keys().begin(),
+                                                                                      request->keys().end()));
+        proxy_metrics().set("state_cache_committed_block", (double)request->block_number());
+        response->set_invalidated(removed);
+        return Status::OK;
+    }
+
+    /* 포트는 예열이 끝난 뒤에 열리므로 응답할 수 있으면 준비된 것이다 */
+    Status Health(ServerContext *context, const HealthRequest *request, HealthResponse *response) override
+    {
+        (void)context;
+        (void)request;
+        const std::vector<warmup_result>& results = warmup.results();
+        for (size_t i = 0; i < results.size(); i++) {
+            ModuleHealth* module = response->add_modules();
+            module->set_aot_file(results[i].entry.aot_file);
+            module->set_module_id(results[i].module_id);
+            module->set_workers((uint32_t)results[i].workers);
+            module->set_instances_ready(results[i].ready);
+            module->set_warmed(results[i].ok);
+            module->set_chaincode_uuid(results[i].entry.chaincode_uuid);
+            // 예열한 풀은 닫히지 않으므로 다시 빌려도 TA를 새로 열지 않는다
+            std::shared_ptr<TeeWorkerPool> pool;
+            if (results[i].ok && pools.acquire(results[i].entry.chaincode_uuid, &pool) == ChaincodePools::OK) {
+                module->set_current_module_id(pool->current_module_id(results[i].entry.aot_file));
+            }
+        }
+        response->set_ready(true);
+        response->set_status(warmup.ok() ? "serving" : "degraded");
         return Status::OK;
     }
 };
 
-static void run_server()
+static void run_server(const server_options& options)
 {
 	printf("%s gRPC 서버 설정 시작\n", get_timestamp().c_str());
+	/* .wasm 모듈은 TA의 인터프리터로 바로 실행하고, 이 컴파일러가 만든 AOT로 나중에 바꾼다 */
+	aot_compiler().set_wamrc(options.wamrc);
+	/* TEE 세션은 코어별 워커가 하나씩 소유 */
+	TeeWorkerPool pool(options.workers, TA_HEAP_SIZE, false, options.batch_window_us, options.fuel_limit,
+	                   options.sched);
+
+	/* 동시 실행 한도는 기본으로 TA에 상주할 수 있는 트랜잭션 수 (그 이상은 TEE 앞에서 줄만 선다) */
+	uint32_t max_inflight = options.max_inflight ? options.max_inflight : (uint32_t)pool.size() * TA_TX_SLOTS;
+	uint32_t max_queued = options.max_queued >= 0 ? (uint32_t)options.max_queued : max_inflight * DEFAULT_QUEUE_FACTOR;
+	AdmissionControl admission(max_inflight, max_queued, options.max_queue_wait_ms, options.sched.query_lane);
+	printf("%s 수락 제어: 동시 실행 %u, 대기 큐 %u, 예상 대기 한도 %ums\n", get_timestamp().c_str(),
+	       max_inflight, max_queued, options.max_queue_wait_ms);
+
 	/* create server, add listening port and register service */
 	std::string server_address("0.0.0.0:50051");
-	InvocationImpl service;
+	/* chaincode_uuid를 보낸 체인코드는 처음 호출될 때 그 UUID의 TA로 따로 풀을 연다 */
+	chaincode_pool_options chaincode = options.chaincode;
+	if (!chaincode.heap_size) chaincode.heap_size = TA_HEAP_SIZE;
+	ChaincodePools pools(pool, chaincode, options.batch_window_us, options.fuel_limit, options.sched);
+	StateCache cache(options.state_cache_entries, STATE_CACHE_MAX_VALUE_SIZE);
+	printf("%s 상태 캐시: %zu개%s\n", get_timestamp().c_str(), options.state_cache_entries,
+	       options.state_cache_entries ? " (래퍼가 버전을 주는 값만)" : " (끔)");
+	ResultCache result_cache(options.result_cache_entries, RESULT_CACHE_MAX_RESPONSE_SIZE, &cache);
+	if (options.result_cache_entries) {
+		printf("%s 조회 결과 캐시: %zu개\n", get_timestamp().c_str(), options.result_cache_entries);
+	}
+
+	/* 모듈 로드와 인스턴스화를 끝낸 뒤에야 포트를 열어 첫 트래픽부터 콜드 스타트가 없게 한다 */
+	Warmup warmup;
+	std::vector<warmup_entry> warm_entries;
+	if (Warmup::read_manifest(options.warmup_manifest, options.warm_instances, &warm_entries)) {
+		printf("%s 예열 시작: %s (모듈 %zu개)\n", get_timestamp().c_str(), options.warmup_manifest.c_str(),
+		       warm_entries.size());
+		warmup.run(pools, warm_entries);
+	}
+
+	InvocationImpl service(pools, admission, cache, result_cache, options, warmup);
 	ServerBuilder builder;
 	builder.AddListeningPort(server_address, grpc::InsecureServerCredentials());
 	builder.RegisterService(&service);
@@ -452,6 +588,680 @@ static void run_server()
 	server->Wait();
 }
 
+/*
+ * 모듈 로드 벤치마크: 기존 경로(malloc + TEEC 임시 버퍼)와 공유 메모리 경로를
+ * 각 AOT 파일(일반 / XIP)에 대해 콜드 로드(LOAD_FLAG_RELOAD)로 반복 측정한다.
+ * 보안 메모리 최고 사용량은 TA가 세션 시작부터 재므로 모듈마다 새 세션(TA 인스턴스)을 연다.
+ * 서명 없는 이미지를 직접 로드하므로 TA를 UNSIGNED_MODULES=1로 빌드해야 한다.
+ *   --bench-load [-n 반복횟수] <aot_file> [<aot_file> ...]
+ */
+static TEEC_Result bench_load_once(tee_ctx* ctx, const std::string& path, bool use_shm, uint32_t flags,
+                                   double* elapsed_ms, struct module_load_stats* stats)
+{
+    TEEC_Operation op;
+    TEEC_SharedMemory shm;
+    uint32_t origin;
+    unsigned char* bytecode = NULL;
+    long length;
+
+    auto start = std::chrono::steady_clock::now();
+    memset(&op, 0, sizeof(op));
+    if (use_shm) {
+        length = read_module_into_shm(ctx, path, &shm);
+        if (length < 0) return TEEC_ERROR_BAD_PARAMETERS;
+        op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_PARTIAL_INPUT, TEEC_VALUE_INPUT, TEEC_MEMREF_TEMP_OUTPUT, TEEC_NONE);
+        op.params[0].memref.parent = &shm;
+        op.params[0].memref.offset = 0;
+        op.params[0].memref.size = length;
+    } else {
+        FILE* f = fopen(path.c_str(), "rb");
+        if (!f) {
+            printf("%s Error: AOT 파일 열기 실패: %s\n", get_timestamp().c_str(), path.c_str());
+            return TEEC_ERROR_ITEM_NOT_FOUND;
+        }
+        fseek(f, 0, SEEK_END);
+        length = ftell(f);
+        rewind(f);
+        if (length <= 0) {
+            printf("%s Error: 빈 모듈 파일: %s\n", get_timestamp().c_str(), path.c_str());
+            fclose(f);
+            return TEEC_ERROR_BAD_PARAMETERS;
+        }
+        bytecode = (unsigned char*)malloc(length);
+        if (!bytecode || fread(bytecode, 1, length, f) != (size_t)length) {
+            fclose(f);
+            free(bytecode);
+            return TEEC_ERROR_GENERIC;
+        }
+        fclose(f);
+        op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT, TEEC_VALUE_INPUT, TEEC_MEMREF_TEMP_OUTPUT, TEEC_NONE);
+        op.params[0].tmpref.buffer = bytecode;
+        op.params[0].tmpref.size = length;
+    }
+    op.params[1].value.a = flags;
+    op.params[2].tmpref.buffer = ctx->benchmark_buffer;
+    op.params[2].tmpref.size = ctx->benchmark_buffer_size;
+
+    TEEC_Result res = TEEC_InvokeCommand(&ctx->sess, COMMAND_LOAD_MODULE, &op, &origin);
+    auto end = std::chrono::steady_clock::now();
+
+    if (use_shm) TEEC_ReleaseSharedMemory(&shm);
+    free(bytecode);
+    if (res == TEEC_ERROR_BUSY) {
+        printf("%s 실행 중인 인스턴스가 있어 콜드 로드할 수 없음: %s\n", get_timestamp().c_str(), path.c_str());
+        return res;
+    }
+    if (res == TEEC_ERROR_ACCESS_DENIED) {
+        printf("%s 서명 없는 이미지 로드가 꺼진 TA: UNSIGNED_MODULES=1로 빌드하세요\n", get_timestamp().c_str());
+        return res;
+    }
+    if (res != TEEC_SUCCESS) {
+        printf("%s 모듈 로드 실패: %s res=0x%x origin=0x%x\n", get_timestamp().c_str(), path.c_str(), res, origin);
+        return res;
+    }
+    memcpy(stats, ctx->benchmark_buffer, sizeof(*stats));
+    *elapsed_ms = std::chrono::duration<double, std::milli>(end - start).count();
+    return TEEC_SUCCESS;
+}
+
+/*
+ * 배포 시점 설치: 지정한 AOT 파일들을 TA 보안 저장소에 저장한다.
+ * 설치된 모듈은 프록시/TA 재시작 후에도 남으며 호출 시에는 id만 전달된다.
+ * 프록시가 찾는 것과 같은 버전이 붙은 id(<aot_file>@<버전>)로 설치하며, TA가 <aot_file>.sig 서명을 확인한다.
+ * 다른 이미지로 이미 설치된 id는 --replace(서명도 REPLACE=1로 만든 것)로만 바꾼다.
+ *   --deploy [--replace] <aot_file> [<aot_file> ...]
+ */
+static int run_deploy(int argc, char *argv[])
+{
+    bool replace = argc > 2 && strcmp(argv[2], "--replace") == 0;
+    int first = replace ? 3 : 2;
+    if (argc <= first) {
+        printf("사용법: %s --deploy [--replace] <aot_file> [<aot_file> ...]\n", argv[0]);
+        return 1;
+    }
+
+    tee_ctx ctx = tee_ctx();
+    allocate_buffers(&ctx, 5 * 1024);
+    prepare_tee_session(&ctx);
+    configure_heap_size(&ctx, TA_HEAP_SIZE);
+
+    int failed = 0;
+    for (int i = first; i < argc; i++) {
+        std::string module_id = versioned_module_id(argv[i], read_module_version(argv[i]));
+        if (install_module(&ctx, module_id, std::string(), std::string(), replace) != TEEC_SUCCESS) failed++;
+    }
+
+    terminate_tee_session(&ctx);
+    free_buffers(&ctx);
+    return failed ? 1 : 0;
+}
+
+/*
+ * 벤치마크 전 모듈 배포: 서버의 예열 목록과 같이 서명을 확인받아 설치하고 모든 TA 인스턴스에 로드한다.
+ * *module_id는 워커에서 직접 실행할 때 쓰는 (버전이 붙은) 모듈 id
+ */
+static bool deploy_for_bench(TeeWorkerPool& pool, const std::string& aot_file, std::string* module_id)
+{
+    uint32_t ready = 0;
+    if (pool.warm_module(aot_file, 1, module_id, &ready)) return true;
+    printf("%s 모듈 배포 실패: %s (<aot_file>.sig 서명과 TA 공개 키 확인)\n", get_timestamp().c_str(), aot_file.c_str());
+    return false;
+}
+
+static int run_load_benchmark(int argc, char *argv[])
+{
+    int iterations = 20;
+    std::vector<std::string> files;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.empty() || iterations <= 0) {
+        printf("사용법: %s --bench-load [-n 반복횟수] <aot_file> [<aot_file> ...]\n", argv[0]);
+        return 1;
+    }
+
+    printf("\n%-32s %-10s %10s %10s %10s %10s %4s %12s %12s\n",
+           "module", "transfer", "avg(ms)", "min(ms)", "max(ms)", "ta(ms)", "xip", "copied(B)", "peak(KB)");
+    int failed = 0;
+    for (size_t f = 0; f < files.size(); f++) {
+        std::string path = "./chaincode/" + files[f];
+        tee_ctx ctx = tee_ctx();
+        allocate_buffers(&ctx, 5 * 1024);
+        prepare_tee_session(&ctx);
+        configure_heap_size(&ctx, TA_HEAP_SIZE);
+
+        for (int mode = 0; mode < 2; mode++) {
+            bool use_shm = (mode == 1);
+            double total = 0, min_ms = 1e9, max_ms = 0, ta_total = 0;
+            uint32_t peak = 0;
+            struct module_load_stats stats;
+            memset(&stats, 0, sizeof(stats));
+            int done = 0;
+            for (int i = 0; i < iterations; i++) {
+                double ms;
+                if (bench_load_once(&ctx, path, use_shm, LOAD_FLAG_RELOAD, &ms, &stats) != TEEC_SUCCESS) {
+                    failed++;
+                    break;
+                }
+                total += ms;
+                ta_total += stats.load_time_ms;
+                if (ms < min_ms) min_ms = ms;
+                if (ms > max_ms) max_ms = ms;
+                if (stats.heap_peak_bytes > peak) peak = stats.heap_peak_bytes;
+                done++;
+            }
+            if (!done) continue;
+            printf("%-32s %-10s %10.2f %10.2f %10.2f %10.2f %4u %12u %12.1f\n",
+                   files[f].c_str(), use_shm ? "shm" : "temp-copy", total / done, min_ms, max_ms,
+                   ta_total / done, stats.xip, stats.copied_bytes, peak / 1024.0);
+        }
+
+        // 캐시 적중 시(재배치 없이 재사용) 비용
+        double ms;
+        struct module_load_stats stats;
+        if (bench_load_once(&ctx, path, true, 0, &ms, &stats) == TEEC_SUCCESS) {
+            printf("%-32s %-10s %10.2f %10s %10s %10s %4u %12u %12.1f\n",
+                   files[f].c_str(), "cache-hit", ms, "-", "-", "-", stats.xip, stats.copied_bytes,
+                   stats.heap_peak_bytes / 1024.0);
+        }
+
+        terminate_tee_session(&ctx);
+        free_buffers(&ctx);
+    }
+    printf("\n");
+    return failed ? 1 : 0;
+}
+
+/* 벤치마크용 상태 저장소: 프로세스 메모리의 키-값 맵 (delay_ms로 래퍼 왕복 지연 흉내) */
+class MemoryStateBackend : public StateBackend {
+public:
+    explicit MemoryStateBackend(int delay_ms = 0) : delay_ms_(delay_ms), round_trips_(0) {}
+
+    bool get_state(const std::string& key, std::string* value) override {
+        simulate_round_trip();
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::map<std::string, std::string>::const_iterator it = state_.find(key);
+        value->assign(it != state_.end() ? it->second : "");
+        return true;
+    }
+
+    bool put_state(const std::string& key, const std::string& value, std::string* ack) override {
+        simulate_round_trip();
+        std::lock_guard<std::mutex> lock(mutex_);
+        state_[key] = value;
+        ack->assign("OK");
+        return true;
+    }
+
+    bool get_states(const std::vector<std::string>& keys, std::vector<std::string>* values,
+                    std::vector<std::string>* versions = NULL) override {
+        simulate_round_trip();
+        std::lock_guard<std::mutex> lock(mutex_);
+        values->assign(keys.size(), std::string());
+        if (versions) versions->assign(keys.size(), std::string());
+        for (size_t i = 0; i < keys.size(); i++) {
+            std::map<std::string, std::string>::const_iterator it = state_.find(keys[i]);
+            if (it != state_.end()) (*values)[i] = it->second;
+        }
+        return true;
+    }
+
+    /* 배치 결과의 write set을 커밋한다 (요청 순서로 적용하면 직렬 실행과 같은 상태) */
+    void apply(const kv_list& writes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < writes.size(); i++) state_[writes[i].first] = writes[i].second;
+    }
+
+    long round_trips() const { return round_trips_; }
+
+private:
+    void simulate_round_trip() {
+        round_trips_++;
+        if (delay_ms_ > 0) std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms_));
+    }
+
+    int delay_ms_;
+    std::atomic<long> round_trips_;
+    std::mutex mutex_;
+    std::map<std::string, std::string> state_;
+};
+
+/*
+ * 멀티코어 확장성 벤치마크: 워커 수를 1..W로 늘려가며 같은 트랜잭션 N개의 처리량을 잰다.
+ * 각 측정 전 모든 워커(TA 인스턴스)에서 한 번씩 실행해 모듈 캐시를 채운다.
+ * -d는 GET/PUT마다 래퍼 왕복 지연(ms)을 넣어, 슬롯 인터리빙이 지연을 얼마나 숨기는지 본다.
+ * -c는 마이크로 배칭 창 상한(us)으로, 측정마다 TEE 진입당 단계 수와 창 때문에 더해진 지연을 함께 보인다.
+ *   --bench-scale [-n 트랜잭션수] [-w 최대워커] [-d 지연ms] [-c 창us] <aot_file> <function> [args...]
+ */
+static int run_scale_benchmark(int argc, char *argv[])
+{
+    int total = 200;
+    int max_workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int delay_ms = 0;
+    int window_us = TeeWorkerPool::DEFAULT_BATCH_WINDOW_US;
+    std::vector<std::string> positional;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            total = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            max_workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            delay_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            window_us = atoi(argv[++i]);
+        } else {
+            positional.push_back(argv[i]);
+        }
+    }
+    if (positional.size() < 2 || total <= 0 || max_workers <= 0 || delay_ms < 0 || window_us < 0) {
+        printf("사용법: %s --bench-scale [-n 트랜잭션수] [-w 최대워커] [-d 지연ms] [-c 창us] <aot_file> <function> [args...]\n", argv[0]);
+        return 1;
+    }
+    const std::string aot_file = positional[0];
+    const std::string function_name = positional[1];
+    const std::vector<std::string> args(positional.begin() + 2, positional.end());
+
+    printf("\n%-8s %10s %12s %10s %10s %8s %11s %6s %10s\n", "workers", "tx", "elapsed(ms)", "tx/s",
+           "speedup", "eff", "steps/entry", "fill", "added(us)");
+    double base_tps = 0;
+    for (int workers = 1; workers <= max_workers; workers++) {
+        MemoryStateBackend state(delay_ms);
+        TeeWorkerPool pool(workers, TA_HEAP_SIZE, true, (uint32_t)window_us);
+        std::string module_id;
+        if (!deploy_for_bench(pool, aot_file, &module_id)) return 1;
+        if (!pool.run_on_each([&](tee_ctx* ctx) {
+                std::string response;
+                return execute_transaction(ctx, module_id, function_name, args, &state, &response);
+            })) {
+            printf("%s 예열 트랜잭션 실패: %s %s\n", get_timestamp().c_str(), aot_file.c_str(), function_name.c_str());
+            return 1;
+        }
+
+        // 모든 TA 슬롯이 찰 만큼 클라이언트를 두어 호스트콜 대기 중에도 워커가 놀지 않게 한다
+        std::atomic<int> next(0), failed(0);
+        std::vector<std::thread> clients;
+        std::map<std::string, double> before = proxy_metrics().snapshot();
+        auto start = std::chrono::steady_clock::now();
+        for (int c = 0; c < workers * TA_TX_SLOTS; c++) {
+            clients.push_back(std::thread([&] {
+                while (next.fetch_add(1) < total) {
+                    std::string response;
+                    if (!pool.execute(aot_file, function_name, args, &state, &response)) failed++;
+                }
+            }));
+        }
+        for (size_t c = 0; c < clients.size(); c++) clients[c].join();
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::map<std::string, double> after = proxy_metrics().snapshot();
+        double entries = after["microbatch_entries"] - before["microbatch_entries"];
+        double steps = after["microbatch_steps"] - before["microbatch_steps"];
+        double capacity = after["microbatch_capacity"] - before["microbatch_capacity"];
+        double added_us = after["microbatch_added_latency_us"] - before["microbatch_added_latency_us"];
+
+        double tps = total * 1000.0 / elapsed;
+        if (workers == 1) base_tps = tps;
+        printf("%-8d %10d %12.1f %10.1f %9.2fx %7.0f%% %11.2f %5.0f%% %10.1f%s\n", workers, total, elapsed, tps,
+               tps / base_tps, 100.0 * tps / (base_tps * workers),
+               entries > 0 ? steps / entries : 0, capacity > 0 ? 100.0 * steps / capacity : 0,
+               steps > 0 ? added_us / steps : 0,
+               failed ? " (실패 포함)" : "");
+    }
+    printf("\n");
+    return 0;
+}
+
+/*
+ * 배치 실행 벤치마크: 같은 트랜잭션 N개를 트랜잭션 단위 실행(execute, 슬롯 인터리빙)과
+ * B개씩 묶은 배치 실행(execute_batch)으로 각각 처리해 처리량과 상태 저장소 왕복 수를 비교한다.
+ * 같은 키를 쓰는 트랜잭션(예: add 같은 사람)이면 배치 안 충돌로 다시 실행된 횟수가 늘어난다.
+ *   --bench-batch [-n 트랜잭션수] [-b 배치크기] [-w 워커] [-d 지연ms] <aot_file> <function> [args...]
+ */
+static int run_batch_benchmark(int argc, char *argv[])
+{
+    int total = 256;
+    int batch = 0;
+    int workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int delay_ms = 0;
+    std::vector<std::string> positional;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            total = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            batch = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            delay_ms = atoi(argv[++i]);
+        } else {
+            positional.push_back(argv[i]);
+        }
+    }
+    if (batch <= 0) batch = workers * BATCH_MAX_TX;  // 모든 워커가 한 묶음씩 받는 크기
+    if (positional.size() < 2 || total <= 0 || workers <= 0 || delay_ms < 0) {
+        printf("사용법: %s --bench-batch [-n 트랜잭션수] [-b 배치크기] [-w 워커] [-d 지연ms] <aot_file> <function> [args...]\n", argv[0]);
+        return 1;
+    }
+    tx_invocation inv;
+    inv.aot_file = positional[0];
+    inv.function_name = positional[1];
+    inv.args.assign(positional.begin() + 2, positional.end());
+
+    TeeWorkerPool pool(workers, TA_HEAP_SIZE, true);
+    {
+        MemoryStateBackend warmup;
+        std::string module_id;
+        if (!deploy_for_bench(pool, inv.aot_file, &module_id)) return 1;
+        if (!pool.run_on_each([&](tee_ctx* ctx) {
+                std::string response;
+                return execute_transaction(ctx, module_id, inv.function_name, inv.args, &warmup, &response);
+            })) {
+            printf("%s 예열 트랜잭션 실패: %s %s\n", get_timestamp().c_str(), inv.aot_file.c_str(), inv.function_name.c_str());
+            return 1;
+        }
+    }
+
+    printf("\n%-12s %8s %12s %10s %12s %8s %8s\n", "mode", "tx", "elapsed(ms)", "tx/s", "round-trips", "failed", "re-exec");
+
+    // 1) 트랜잭션 단위: 모든 TA 슬롯이 찰 만큼 클라이언트를 둔다
+    {
+        MemoryStateBackend state(delay_ms);
+        std::atomic<int> next(0), failed(0);
+        std::vector<std::thread> clients;
+        auto start = std::chrono::steady_clock::now();
+        for (int c = 0; c < workers * TA_TX_SLOTS; c++) {
+            clients.push_back(std::thread([&] {
+                while (next.fetch_add(1) < total) {
+                    std::string response;
+                    if (!pool.execute(inv.aot_file, inv.function_name, inv.args, &state, &response)) failed++;
+                }
+            }));
+        }
+        for (size_t c = 0; c < clients.size(); c++) clients[c].join();
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        printf("%-12s %8d %12.1f %10.1f %12ld %8d %8s\n", "per-tx", total, elapsed, total * 1000.0 / elapsed,
+               state.round_trips(), failed.load(), "-");
+    }
+
+    // 2) 배치: B개씩 execute_batch (묶음은 워커에 나눠 동시에 실행).
+    //    결과는 요청 순서의 직렬 실행과 같으므로 write set을 순서대로 커밋한다
+    {
+        MemoryStateBackend state(delay_ms);
+        int failed = 0;
+        long reexecuted = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int done = 0; done < total; done += batch) {
+            std::vector<tx_invocation> invocations(std::min(batch, total - done), inv);
+            std::vector<batch_result> results;
+            if (!pool.execute_batch(invocations, &state, &results)) {
+                failed += (int)invocations.size();
+                continue;
+            }
+            for (size_t i = 0; i < results.size(); i++) {
+                if (!results[i].ok) failed++;
+                else state.apply(results[i].write_set);
+                reexecuted += results[i].executions - 1;
+            }
+        }
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        char mode[32];
+        snprintf(mode, sizeof(mode), "batch(%d)", batch);
+        printf("%-12s %8d %12.1f %10.1f %12ld %8d %8ld\n", mode, total, elapsed, total * 1000.0 / elapsed,
+               state.round_trips(), failed, reexecuted);
+    }
+    printf("\n");
+    return 0;
+}
+
+/*
+ * REE 실행 모드 벤치마크: 같은 트랜잭션 N개를 TA(워커 1개)와 REE 런타임에서 차례로 실행해
+ * 트랜잭션 지연(평균/p50/p99)과 처리량을 비교한다. manifest의 "ree" 줄과 상관없이 두 경로를 모두 잰다.
+ *   --bench-ree [-n 트랜잭션수] [-d 지연ms] <aot_file> <function> [args...]
+ */
+static int run_ree_benchmark(int argc, char *argv[])
+{
+    int total = 500;
+    int delay_ms = 0;
+    std::vector<std::string> positional;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            total = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            delay_ms = atoi(argv[++i]);
+        } else {
+            positional.push_back(argv[i]);
+        }
+    }
+    if (positional.size() < 2 || total <= 0 || delay_ms < 0) {
+        printf("사용법: %s --bench-ree [-n 트랜잭션수] [-d 지연ms] <aot_file> <function> [args...]\n", argv[0]);
+        return 1;
+    }
+    if (!ReeRuntime::available()) {
+        printf("%s REE 런타임 없이 빌드됨: make REE_WASM=1 로 다시 빌드하세요\n", get_timestamp().c_str());
+        return 1;
+    }
+    tx_invocation inv;
+    inv.aot_file = positional[0];
+    inv.function_name = positional[1];
+    inv.args.assign(positional.begin() + 2, positional.end());
+    inv.module_id = inv.aot_file;
+
+    TeeWorkerPool pool(1, TA_HEAP_SIZE, true);
+    std::string module_id;
+    if (!deploy_for_bench(pool, inv.aot_file, &module_id)) return 1;
+    printf("\n%-6s %8s %12s %10s %10s %10s %10s %8s\n", "mode", "tx", "elapsed(ms)", "tx/s", "avg(us)", "p50(us)",
+           "p99(us)", "failed");
+    for (int mode = 0; mode < 2; mode++) {
+        MemoryStateBackend state(delay_ms);
+        std::function<bool(std::string*)> run_once;
+        if (mode == 0) {
+            run_once = [&](std::string* response) {
+                return pool.run([&](tee_ctx* ctx) {
+                    return execute_transaction(ctx, module_id, inv.function_name, inv.args, &state, response);
+                });
+            };
+        } else {
+            run_once = [&](std::string* response) {
+                return ree_runtime().execute(inv, &state, response, tx_deadline(), 0, NULL);
+            };
+        }
+        std::string response;
+        if (!run_once(&response)) {  // 예열: 모듈 로드는 재지 않는다
+            printf("%s 예열 트랜잭션 실패 (%s): %s %s\n", get_timestamp().c_str(), mode == 0 ? "tee" : "ree",
+                   inv.aot_file.c_str(), inv.function_name.c_str());
+            return 1;
+        }
+
+        std::vector<double> latencies;
+        int failed = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < total; i++) {
+            auto t0 = std::chrono::steady_clock::now();
+            if (!run_once(&response)) failed++;
+            latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count());
+        }
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::sort(latencies.begin(), latencies.end());
+        double sum = 0;
+        for (size_t i = 0; i < latencies.size(); i++) sum += latencies[i];
+        printf("%-6s %8d %12.1f %10.1f %10.1f %10.1f %10.1f %8d\n", mode == 0 ? "tee" : "ree", total, elapsed,
+               total * 1000.0 / elapsed, sum / total, latencies[latencies.size() / 2],
+               latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)], failed);
+    }
+    printf("\n");
+    return 0;
+}
+
+/* 부하 파일: 줄마다 "<function> [args...]" ('#'으로 시작하는 줄과 빈 줄은 건너뜀) */
+static bool read_workload(const std::string& path, std::vector<tx_invocation>* workload)
+{
+    std::ifstream in(path.c_str());
+    if (!in) {
+        printf("%s 부하 파일 열기 실패: %s\n", get_timestamp().c_str(), path.c_str());
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream words(line);
+        tx_invocation inv;
+        if (!(words >> inv.function_name) || inv.function_name[0] == '#') continue;
+        std::string arg;
+        while (words >> arg) inv.args.push_back(arg);
+        workload->push_back(inv);
+    }
+    if (workload->empty()) printf("%s 부하 파일에 호출이 없음: %s\n", get_timestamp().c_str(), path.c_str());
+    return !workload->empty();
+}
+
+/* 부하를 rounds번 돌린다: 모든 TA 슬롯이 찰 만큼 클라이언트를 둔다. 트랜잭션 지연 합계는 *latency_us */
+static int run_workload(TeeWorkerPool& pool, StateBackend* state, const std::string& aot_file,
+                        const std::vector<tx_invocation>& workload, int rounds, double* latency_us)
+{
+    const int total = rounds * (int)workload.size();
+    std::atomic<int> next(0), failed(0);
+    std::mutex mutex;
+    double latency = 0;
+    std::vector<std::thread> clients;
+    for (int c = 0; c < pool.size() * TA_TX_SLOTS; c++) {
+        clients.push_back(std::thread([&] {
+            double mine = 0;
+            for (int i = next.fetch_add(1); i < total; i = next.fetch_add(1)) {
+                const tx_invocation& inv = workload[i % workload.size()];
+                std::string response;
+                auto t0 = std::chrono::steady_clock::now();
+                if (!pool.execute(aot_file, inv.function_name, inv.args, state, &response)) failed++;
+                mine += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            latency += mine;
+        }));
+    }
+    for (size_t c = 0; c < clients.size(); c++) clients[c].join();
+    if (latency_us) *latency_us = latency;
+    return failed.load();
+}
+
+/*
+ * PGO 프로파일 수집: wamrc --enable-llvm-pgo로 만든 계측 모듈에 부하를 N번 돌린 뒤, 워커(TA 인스턴스)마다
+ * 쌓인 카운터를 ./chaincode/<aot_file>.w<워커>.profraw 로 내보낸다. 체인코드 Makefile의 pgo 타겟이
+ * llvm-profdata로 합쳐 wamrc --use-prof-file 로 다시 컴파일한다. TA는 PGO=1로 빌드해야 한다.
+ *   --pgo-collect [-n 반복] [-w 워커] <계측 aot_file> <부하 파일>
+ */
+static int run_pgo_collect(int argc, char *argv[])
+{
+    int rounds = 100;
+    int workers = 1;
+    std::vector<std::string> positional;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+        } else {
+            positional.push_back(argv[i]);
+        }
+    }
+    std::vector<tx_invocation> workload;
+    if (positional.size() != 2 || rounds <= 0 || workers <= 0) {
+        printf("사용법: %s --pgo-collect [-n 반복] [-w 워커] <계측 aot_file> <부하 파일>\n", argv[0]);
+        return 1;
+    }
+    if (!read_workload(positional[1], &workload)) return 1;
+    const std::string aot_file = positional[0];
+
+    TeeWorkerPool pool(workers, TA_HEAP_SIZE, true);
+    std::string deployed;
+    if (!deploy_for_bench(pool, aot_file, &deployed)) return 1;
+    MemoryStateBackend state;
+    auto start = std::chrono::steady_clock::now();
+    int failed = run_workload(pool, &state, aot_file, workload, rounds, NULL);
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("%s 부하 실행: %d회 x %zu호출 (%.1fms, 실패 %d)\n", get_timestamp().c_str(), rounds, workload.size(),
+           elapsed, failed);
+
+    const std::string module_id = pool.current_module_id(aot_file);
+    std::atomic<int> index(0), written(0);
+    pool.run_on_each([&](tee_ctx* ctx) {
+        std::vector<uint8_t> profile;
+        if (dump_module_profile(ctx, module_id, &profile) != TEEC_SUCCESS) return false;
+        char path[256];
+        snprintf(path, sizeof(path), "./chaincode/%s.w%d.profraw", aot_file.c_str(), index.fetch_add(1));
+        FILE* f = fopen(path, "wb");
+        bool ok = f && fwrite(&profile[0], 1, profile.size(), f) == profile.size();
+        if (f) fclose(f);
+        if (ok) {
+            written++;
+            printf("%s PGO 프로파일 저장: %s (%zu Bytes)\n", get_timestamp().c_str(), path, profile.size());
+        }
+        return ok;
+    });
+    if (!written) {
+        printf("%s 저장한 프로파일 없음 (계측 모듈/PGO=1 TA인지 확인)\n", get_timestamp().c_str());
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * PGO 전후 비교: 같은 부하를 모듈마다(예: coffee_chaincode.aot coffee_chaincode_pgo.aot) 한 번 예열로 돌린 뒤
+ * N번 돌려 처리량과 평균 지연을 재고, 첫 모듈 대비 속도 향상을 보인다.
+ *   --bench-pgo [-n 반복] [-w 워커] <부하 파일> <aot_file> [<aot_file> ...]
+ */
+static int run_pgo_benchmark(int argc, char *argv[])
+{
+    int rounds = 100;
+    int workers = 1;
+    std::vector<std::string> positional;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+        } else {
+            positional.push_back(argv[i]);
+        }
+    }
+    std::vector<tx_invocation> workload;
+    if (positional.size() < 2 || rounds <= 0 || workers <= 0) {
+        printf("사용법: %s --bench-pgo [-n 반복] [-w 워커] <부하 파일> <aot_file> [<aot_file> ...]\n", argv[0]);
+        return 1;
+    }
+    if (!read_workload(positional[0], &workload)) return 1;
+
+    TeeWorkerPool pool(workers, TA_HEAP_SIZE, true);
+    printf("\n%-36s %8s %12s %10s %10s %8s %8s\n", "module", "tx", "elapsed(ms)", "tx/s", "avg(us)", "speedup",
+           "failed");
+    double base_tps = 0;
+    for (size_t m = 1; m < positional.size(); m++) {
+        const std::string& aot_file = positional[m];
+        {
+            std::string deployed;
+            MemoryStateBackend warmup;
+            if (!deploy_for_bench(pool, aot_file, &deployed)) continue;
+            if (run_workload(pool, &warmup, aot_file, workload, 1, NULL) == (int)workload.size()) {
+                printf("%s 예열 실패: %s\n", get_timestamp().c_str(), aot_file.c_str());
+                continue;
+            }
+        }
+        MemoryStateBackend state;
+        double latency_us = 0;
+        const int total = rounds * (int)workload.size();
+        auto start = std::chrono::steady_clock::now();
+        int failed = run_workload(pool, &state, aot_file, workload, rounds, &latency_us);
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        double tps = total * 1000.0 / elapsed;
+        if (base_tps == 0) base_tps = tps;
+        printf("%-36s %8d %12.1f %10.1f %10.1f %7.2fx %8d\n", aot_file.c_str(), total, elapsed, tps,
+               latency_us / total, tps / base_tps, failed);
+    }
+    printf("\n");
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     if (argc > 1 && strcmp(argv[1], "--help") == 0) {
@@ -461,10 +1271,154 @@ int main(int argc, char *argv[])
         printf("  - 포트 50051에서 chaincode_wrapper 요청 대기\n");
         printf("  - WASM/AOT 파일을 OP-TEE에서 실행\n");
         printf("  - GET_STATE/PUT_STATE 요청을 chaincode_wrapper로 전달\n");
+        printf("  - ExecuteBatch: 여러 호출을 묶어 실행, 읽기는 라운드마다 한 번에 요청\n");
+        printf("  - GetMetrics: 마이크로 배칭 창/채움 비율/추가 지연 등 프록시 지표\n");
+        printf("  - Health: 예열 결과와 준비 상태 (포트는 예열이 끝난 뒤에 연다)\n");
+        printf("\n");
+        printf("배포:\n");
+        printf("  --deploy [--replace] <aot_file>... ./chaincode/의 모듈을 TA 보안 저장소에 설치\n");
+        printf("                                     (TA가 <aot_file>.sig 서명을 확인, 프록시는 직접 설치하지 않음;\n");
+        printf("                                      이미 다른 이미지로 설치된 id는 --replace와 REPLACE=1 서명으로만 교체)\n");
+        printf("\n");
+        printf("벤치마크:\n");
+        printf("  --bench-load [-n N] <aot_file>...  모듈 콜드 로드 시간/보안 메모리 최고치 비교 (temp-copy / shm / XIP)\n");
+        printf("                                     (서명 없는 이미지 로드: UNSIGNED_MODULES=1로 빌드한 TA 필요)\n");
+        printf("  --bench-scale [-n N] [-w W] [-d MS] [-c US] <aot_file> <function> [args...]\n");
+        printf("                                     워커 1..W개로 트랜잭션 처리량 확장성 측정\n");
+        printf("                                     (-d: GET/PUT마다 래퍼 왕복 지연 MS 흉내,\n");
+        printf("                                      -c: 마이크로 배칭 창 상한 US)\n");
+        printf("  --bench-batch [-n N] [-b B] [-w W] [-d MS] <aot_file> <function> [args...]\n");
+        printf("                                     트랜잭션 단위 실행과 B개씩 배치 실행 비교\n");
+        printf("  --bench-ree [-n N] [-d MS] <aot_file> <function> [args...]\n");
+        printf("                                     TA 실행과 REE 실행 모드의 지연/처리량 비교 (REE_WASM 빌드)\n");
+        printf("  --pgo-collect [-n N] [-w W] <aot_file> <workload>\n");
+        printf("                                     계측(--enable-llvm-pgo) 모듈에 부하를 N번 돌리고\n");
+        printf("                                     ./chaincode/<aot_file>.w<워커>.profraw 로 카운터 저장 (PGO=1 TA)\n");
+        printf("  --bench-pgo [-n N] [-w W] <workload> <aot_file>...\n");
+        printf("                                     같은 부하로 모듈들(PGO 전/후)의 처리량과 속도 향상 비교\n");
+        printf("\n");
+        printf("옵션:\n");
+        printf("  --workers N                        TEE 워커(코어 고정 세션) 수 (기본: 온라인 코어 수)\n");
+        printf("  --tx-timeout MS                    트랜잭션 마감 (기본: %u, 0: 클라이언트 deadline만 사용)\n",
+               DEFAULT_TX_TIMEOUT_MS);
+        printf("                                     마감이 지나거나 클라이언트가 취소하면 TEE 안에서 중단\n");
+        printf("  --batch-window US                  동시 트랜잭션 단계를 TEE 진입 한 번에 묶는 창 상한\n");
+        printf("                                     (기본: %u, 0: 이미 쌓인 단계만 묶음)\n",
+               TeeWorkerPool::DEFAULT_BATCH_WINDOW_US);
+        printf("  --fuel-limit N                     연료 계량 모듈(make coffee-fuel)의 트랜잭션당 wasm 명령 수 한도\n");
+        printf("                                     (기본: 0 = 없음, 넘으면 RESOURCE_EXHAUSTED)\n");
+        printf("  --max-inflight N                   동시에 실행하는 트랜잭션 수 (기본: 워커 수 × %d)\n", TA_TX_SLOTS);
+        printf("  --max-queued N                     자리를 기다릴 수 있는 트랜잭션 수 (기본: 동시 실행 × %u)\n",
+               DEFAULT_QUEUE_FACTOR);
+        printf("  --max-queue-wait MS                예상 대기가 이보다 길면 바로 거절 (기본: %u, 0: 끔)\n",
+               DEFAULT_MAX_QUEUE_WAIT_MS);
+        printf("                                     거절은 RESOURCE_EXHAUSTED + retry-after-ms 트레일러\n");
+        printf("  --state-cache N                    트랜잭션 사이 상태 캐시 키 수 (기본: %zu, 0: 끔)\n",
+               DEFAULT_STATE_CACHE_ENTRIES);
+        printf("                                     블록 커밋은 NotifyCommit RPC로 알려 무효화\n");
+        printf("  --result-cache N                   읽기 전용 호출의 결과 캐시 크기 (기본: 0 = 끔)\n");
+        printf("                                     read set 버전이 그대로면 TEE에 들어가지 않고 응답, 같은 호출은 한 번만 실행\n");
+        printf("  --query-lane N                     조회(읽기 전용)만 쓸 수 있는 슬롯 수 (기본: 1)\n");
+        printf("  --weight AOT=W                     체인코드(aot_file)별 공정 큐 가중치 (기본: 1, 반복 가능)\n");
+        printf("  --read-only-prefixes P1,P2,...     읽기 전용으로 보는 함수 이름 접두사 (기본: query,get,read)\n");
+        printf("                                     ./chaincode/<aot>.manifest 의 read-only/read-write 줄이 우선\n");
+        printf("  --chaincode-workers N              chaincode_uuid별 TA 풀의 워커 수 (기본: 1)\n");
+        printf("  --chaincode-heap BYTES             chaincode_uuid별 TA 인스턴스의 heap 크기 (기본: %u)\n", TA_HEAP_SIZE);
+        printf("  --chaincode-idle S                 이 시간 동안 쓰이지 않은 체인코드 TA 풀을 닫음 (기본: 300, 0: 끔)\n");
+        printf("  --max-chaincode-tas N              동시에 열어 두는 체인코드 TA 풀 수 (기본: 8)\n");
+        printf("  --warmup FILE                      포트를 열기 전에 예열할 모듈 목록 (기본: %s)\n",
+               DEFAULT_WARMUP_MANIFEST);
+        printf("                                     줄마다 <aot_file> [instances=N] [uuid=<32자리 hex>]\n");
+        printf("  --warm-instances N                 instances=가 없는 모듈의 워커당 미리 만들 인스턴스 수 (기본: 1)\n");
+        printf("  --wamrc PATH                       .wasm 모듈의 백그라운드 AOT 컴파일러 (기본: PATH의 %s)\n", DEFAULT_WAMRC);
+        printf("                                     컴파일 전에는 TA의 인터프리터로 실행, 결과는 %s\n", AOT_CACHE_DIR);
         printf("\n");
         return 0;
     }
 
+    if (argc > 1 && strcmp(argv[1], "--deploy") == 0) {
+        return run_deploy(argc, argv);
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--bench-load") == 0) {
+        return run_load_benchmark(argc, argv);
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--bench-scale") == 0) {
+        return run_scale_benchmark(argc, argv);
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--bench-batch") == 0) {
+        return run_batch_benchmark(argc, argv);
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--bench-ree") == 0) {
+        return run_ree_benchmark(argc, argv);
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--pgo-collect") == 0) {
+        return run_pgo_collect(argc, argv);
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--bench-pgo") == 0) {
+        return run_pgo_benchmark(argc, argv);
+    }
+
+    server_options options;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            options.workers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--tx-timeout") == 0 && i + 1 < argc) {
+            options.tx_timeout_ms = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--batch-window") == 0 && i + 1 < argc) {
+            options.batch_window_us = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--fuel-limit") == 0 && i + 1 < argc) {
+            options.fuel_limit = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--max-inflight") == 0 && i + 1 < argc) {
+            options.max_inflight = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-queued") == 0 && i + 1 < argc) {
+            options.max_queued = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-queue-wait") == 0 && i + 1 < argc) {
+            options.max_queue_wait_ms = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--chaincode-workers") == 0 && i + 1 < argc) {
+            options.chaincode.workers = std::max(atoi(argv[++i]), 1);
+        } else if (strcmp(argv[i], "--chaincode-heap") == 0 && i + 1 < argc) {
+            options.chaincode.heap_size = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--chaincode-idle") == 0 && i + 1 < argc) {
+            options.chaincode.idle_timeout_s = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-chaincode-tas") == 0 && i + 1 < argc) {
+            options.chaincode.max_pools = (uint32_t)std::max(atoi(argv[++i]), 1);
+        } else if (strcmp(argv[i], "--state-cache") == 0 && i + 1 < argc) {
+            options.state_cache_entries = (size_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--result-cache") == 0 && i + 1 < argc) {
+            options.result_cache_entries = (size_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            options.warmup_manifest = argv[++i];
+        } else if (strcmp(argv[i], "--warm-instances") == 0 && i + 1 < argc) {
+            options.warm_instances = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--wamrc") == 0 && i + 1 < argc) {
+            options.wamrc = argv[++i];
+        } else if (strcmp(argv[i], "--query-lane") == 0 && i + 1 < argc) {
+            options.sched.query_lane = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--weight") == 0 && i + 1 < argc) {
+            std::string spec = argv[++i];
+            size_t eq = spec.rfind('=');
+            int weight = eq == std::string::npos ? 0 : atoi(spec.c_str() + eq + 1);
+            if (weight <= 0) {
+                printf("잘못된 --weight 값 (AOT=W, W >= 1): %s\n", spec.c_str());
+                return 1;
+            }
+            options.sched.weights[spec.substr(0, eq)] = (uint32_t)weight;
+        } else if (strcmp(argv[i], "--read-only-prefixes") == 0 && i + 1 < argc) {
+            std::stringstream list(argv[++i]);
+            std::string prefix;
+            options.sched.read_only_prefixes.clear();
+            while (std::getline(list, prefix, ',')) {
+                if (!prefix.empty()) options.sched.read_only_prefixes.push_back(prefix);
+            }
+        }
+    }
+
     printf("%s Chaincode Proxy 시작 (gRPC + WASM)\n", get_timestamp().c_str());
     printf("%s    gRPC 서버 모드\n", get_timestamp().c_str());
     printf("%s    OP-TEE WASM 실행 준비\n", get_timestamp().c_str());
@@ -474,7 +1428,7 @@ int main(int argc, char *argv[])
 	signal(SIGINT, cleanup);
 	
 	/* start the gRPC server stream */
-	run_server();
+	run_server(options);
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,240 @@
+#include <stdio.h>
+
+#include <atomic>
+
+#include "aot_compiler.h"
+#include "chaincode_tee_ree_communication.h"
+#include "module_registry.h"
+#include "proxy_metrics.h"
+#include "tee_worker_pool.h"
+
+/* 모듈 파일이 바뀌었는지 다시 확인하는 간격 */
+static const std::chrono::seconds RECHECK_INTERVAL(1);
+/* 준비에 실패한 버전을 다시 시도하기까지의 간격 (.sha256과 모듈 파일이 잠깐 어긋난 경우 등) */
+static const std::chrono::seconds RETRY_INTERVAL(30);
+/* 교체된 버전을 지워도 되는지 확인하는 간격 */
+static const std::chrono::seconds RECLAIM_INTERVAL(1);
+
+ModuleRegistry::ModuleRegistry(TeeWorkerPool& pool)
+    : pool_(pool), stopping_(false)
+{
+    loader_ = std::thread(&ModuleRegistry::loader_main, this);
+}
+
+ModuleRegistry::~ModuleRegistry()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (loader_.joinable()) loader_.join();
+}
+
+module_lease ModuleRegistry::acquire(const std::string& aot_file)
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex_);
+    Module& m = modules_[aot_file];
+    if (m.current && now - m.checked < RECHECK_INTERVAL) return m.current;
+    m.checked = now;
+    lock.unlock();
+
+    std::string version = read_module_version(aot_file);
+
+    lock.lock();
+    // 버전을 붙일 수 없는 모듈은 aot_file id 그대로 쓴다 (교체하지 않음)
+    std::string module_id = versioned_module_id(aot_file, version);
+    if (module_id == aot_file) return m.current;
+    if (!m.current) {
+        // 처음 보는 모듈: 이 버전으로 시작한다 (--deploy나 예열 목록으로 설치돼 있어야 한다)
+        module_version* first = new module_version();
+        first->aot_file = aot_file;
+        first->version = version;
+        first->module_id = module_id;
+        m.current.reset(first);
+        printf("%s 모듈 버전: %s\n", get_timestamp().c_str(), module_id.c_str());
+        // .wasm은 인터프리터로 바로 실행하고 AOT 컴파일은 지금 시작한다 (교체는 tier_up)
+        std::string image;
+        if (is_tiered_module(aot_file)) aot_compiler().poll(aot_file, version, &image);
+    } else if (version != m.current->version && version != m.pending &&
+               (version != m.failed || now - m.failed_at >= RETRY_INTERVAL)) {
+        // 새 버전은 백그라운드에서 준비하고, 준비되기 전까지는 지금 버전으로 실행한다
+        module_version next;
+        next.aot_file = aot_file;
+        next.version = version;
+        next.module_id = module_id;
+        m.pending = version;
+        reloads_.push_back(next);
+        cv_.notify_all();
+    }
+    return m.current;
+}
+
+void ModuleRegistry::loader_main()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        cv_.wait_for(lock, RECLAIM_INTERVAL, [this] { return stopping_ || !reloads_.empty(); });
+        if (stopping_) return;
+        reclaim(lock);
+        tier_up();
+        if (reloads_.empty()) continue;
+
+        module_version next = reloads_.front();
+        reloads_.pop_front();
+        const bool tier = !next.image.empty();
+        // 그 사이 새 버전으로 바뀌었으면 이전 버전의 컴파일 결과는 쓰지 않는다
+        if (tier && (!modules_[next.aot_file].current || modules_[next.aot_file].current->version != next.version)) {
+            continue;
+        }
+        uint32_t instances = modules_[next.aot_file].instances;
+        lock.unlock();
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool ok = prepare(next, instances);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        lock.lock();
+        Module& m = modules_[next.aot_file];
+        if (tier) {
+            if (!ok || !m.current || m.current->version != next.version) {
+                // 준비 실패(인터프리터로 계속) 또는 그 사이 새 버전이 들어옴: 설치한 AOT는 지운다
+                if (!ok) proxy_metrics().add("aot_tier_failures", 1);
+                printf("%s AOT 계층 %s: %s\n", get_timestamp().c_str(), ok ? "사용 안 함 (새 버전)" : "준비 실패, 인터프리터로 계속",
+                       next.module_id.c_str());
+                retired_.push_back(module_lease(new module_version(next)));
+                continue;
+            }
+            retired_.push_back(m.current);
+            m.current.reset(new module_version(next));
+            proxy_metrics().add("aot_tier_swaps", 1);
+            proxy_metrics().add("module_prepare_ms", ms);
+            printf("%s AOT 계층으로 교체: %s (준비 %.1fms)\n", get_timestamp().c_str(), next.module_id.c_str(), ms);
+            continue;
+        }
+        if (m.pending == next.version) m.pending.clear();
+        if (!ok) {
+            m.failed = next.version;
+            m.failed_at = std::chrono::steady_clock::now();
+            proxy_metrics().add("module_reload_failures", 1);
+            printf("%s 모듈 새 버전 준비 실패, 이전 버전 유지: %s\n", get_timestamp().c_str(), next.module_id.c_str());
+            continue;
+        }
+        // 이후 acquire는 새 버전을 받는다. 이전 버전을 잡은 호출은 그 버전으로 끝까지 실행한다
+        if (m.current) retired_.push_back(m.current);
+        m.current.reset(new module_version(next));
+        m.failed.clear();
+        m.tiering = false;
+        proxy_metrics().add("module_swaps", 1);
+        proxy_metrics().add("module_prepare_ms", ms);
+        printf("%s 모듈 버전 교체: %s (준비 %.1fms)\n", get_timestamp().c_str(), next.module_id.c_str(), ms);
+    }
+}
+
+bool ModuleRegistry::prepare(const module_version& next, uint32_t instances)
+{
+    printf("%s 모듈 새 버전 준비: %s\n", get_timestamp().c_str(), next.module_id.c_str());
+    // 보안 저장소는 TA 인스턴스들이 함께 쓰므로 설치는 한 세션에서 한 번만.
+    // AOT 계층 이미지는 체인코드 Makefile이 만들어 서명해 둔 <x.wasm>.aot.sig로 확인된다
+    // (이 호스트에서 컴파일한 이미지가 서명한 이미지와 다르면 TA가 거절하고 인터프리터로 계속한다)
+    std::string signature;
+    if (!next.image.empty()) signature = "./chaincode/" + next.aot_file + AOT_TIER_SUFFIX + ".sig";
+    TEEC_Result installed = TEEC_SUCCESS;
+    if (!pool_.run([&next, &signature, &installed](tee_ctx* ctx) {
+            installed = install_module(ctx, next.module_id, next.image, signature);
+            return installed == TEEC_SUCCESS;
+        })) {
+        if (!next.image.empty() && installed == TEEC_ERROR_SECURITY) {
+            printf("%s Error: AOT 계층 서명 확인 실패: %s (이미지 %s, 서명 %s). 체인코드 Makefile이 만든 %s%s를 "
+                   "./chaincode/에 함께 두세요\n", get_timestamp().c_str(), next.module_id.c_str(), next.image.c_str(),
+                   signature.c_str(), next.aot_file.c_str(), AOT_TIER_SUFFIX);
+        }
+        return false;
+    }
+    // 재배치까지 끝내 두면 새 버전의 첫 트랜잭션은 어느 워커에서든 인스턴스화만 한다
+    return pool_.run_on_each([&next, instances](tee_ctx* ctx) {
+        return preload_module(ctx, next.module_id, instances) == TEEC_SUCCESS;
+    });
+}
+
+bool ModuleRegistry::warm(const std::string& aot_file, uint32_t instances, std::string* module_id, uint32_t* ready)
+{
+    module_lease current = acquire(aot_file);
+    const std::string id = current ? current->module_id : aot_file;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        modules_[aot_file].instances = instances;
+    }
+    *module_id = id;
+    *ready = 0;
+
+    std::atomic<uint32_t> total(0);
+    TeeWorkerPool::Job preload = [&id, instances, &total](tee_ctx* ctx) {
+        uint32_t n = 0;
+        TEEC_Result res = preload_module(ctx, id, instances, &n);
+        total += n;
+        return res == TEEC_SUCCESS;
+    };
+    if (!pool_.run_on_each(preload)) {
+        // 아직 설치되지 않은 버전: 서명을 확인받아 한 번 설치하고 다시 로드한다 (이미 로드된 인스턴스는 그대로)
+        total = 0;
+        if (!pool_.run([&id](tee_ctx* ctx) { return install_module(ctx, id) == TEEC_SUCCESS; }) ||
+            !pool_.run_on_each(preload)) {
+            return false;
+        }
+    }
+    *ready = total;
+    return true;
+}
+
+void ModuleRegistry::tier_up()
+{
+    for (std::map<std::string, Module>::iterator it = modules_.begin(); it != modules_.end(); ++it) {
+        Module& m = it->second;
+        if (!m.current || !m.current->image.empty() || m.tiering || !is_tiered_module(it->first)) continue;
+        std::string image;
+        AotCompiler::status status = aot_compiler().poll(it->first, m.current->version, &image);
+        if (status == AotCompiler::PENDING) continue;
+        // 실패한 버전은 인터프리터로 계속 실행한다 (파일이 바뀌면 새 버전으로 다시 시도)
+        m.tiering = true;
+        module_version next = *m.current;
+        next.module_id += AOT_TIER_SUFFIX;
+        next.image = image;
+        if (status == AotCompiler::READY && next.module_id.length() < MODULE_ID_SIZE) reloads_.push_back(next);
+    }
+}
+
+void ModuleRegistry::reclaim(std::unique_lock<std::mutex>& lock)
+{
+    std::vector<module_lease> unused;
+    for (size_t i = 0; i < retired_.size();) {
+        if (retired_[i].use_count() == 1) {
+            unused.push_back(retired_[i]);
+            retired_.erase(retired_.begin() + i);
+        } else {
+            i++;
+        }
+    }
+    if (unused.empty()) return;
+
+    lock.unlock();
+    std::vector<module_lease> busy;
+    for (size_t i = 0; i < unused.size(); i++) {
+        const std::string& module_id = unused[i]->module_id;
+        TEEC_Result res = TEEC_ERROR_GENERIC;
+        pool_.run([&module_id, &res](tee_ctx* ctx) {
+            res = remove_module(ctx, module_id);
+            return res == TEEC_SUCCESS;
+        });
+        if (res == TEEC_SUCCESS || res == TEEC_ERROR_ITEM_NOT_FOUND) {
+            proxy_metrics().add("module_versions_reclaimed", 1);
+            printf("%s 이전 모듈 버전 삭제: %s\n", get_timestamp().c_str(), module_id.c_str());
+        } else if (res == TEEC_ERROR_ACCESS_CONFLICT) {
+            // 다른 TA 인스턴스가 아직 읽는 중이면 다음에 다시 지운다
+            busy.push_back(unused[i]);
+        }
+    }
+    lock.lock();
+    retired_.insert(retired_.end(), busy.begin(), busy.end());
+}
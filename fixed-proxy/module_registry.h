@@ -0,0 +1,81 @@
+#ifndef MODULE_REGISTRY_H
+#define MODULE_REGISTRY_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class TeeWorkerPool;
+
+/* TA에 설치되는 모듈 버전 하나 */
+struct module_version {
+    std::string aot_file;
+    std::string version;    /* read_module_version() */
+    std::string module_id;  /* TA 모듈 id: <aot_file>@<version>, AOT 계층이면 AOT_TIER_SUFFIX가 붙는다 */
+    std::string image;      /* AOT 계층: 설치할 컴파일 결과 ("": ./chaincode/<aot_file>) */
+};
+/* 트랜잭션은 실행하는 동안 자기 버전을 이것으로 잡고 있는다 */
+typedef std::shared_ptr<const module_version> module_lease;
+
+/*
+ * 워커 풀(= 한 TA의 보안 저장소와 인스턴스들)의 체인코드 모듈 버전.
+ * 호출마다 acquire()로 aot_file의 현재 버전을 잡고, 그 버전의 모듈 id로 TA에서 실행한다.
+ * ./chaincode/<aot_file>(.sha256)이 바뀐 것을 보면 새 버전을 백그라운드 스레드가 설치(TA가 서명 확인)하고
+ * 모든 TA 인스턴스에 미리 로드한 뒤에야 현재 버전으로 바꾼다. 그동안의 호출과 이미 실행 중인
+ * 트랜잭션은 이전 버전으로 실행하므로 교체 때 트래픽을 멈추지 않고 콜드 스타트도 없다.
+ * 교체된 버전은 그 버전을 잡은 마지막 호출이 끝나면 TA 보안 저장소에서 지운다.
+ * .wasm 모듈(계층 실행)은 바이트코드 그대로 TA의 인터프리터로 먼저 실행하고, AotCompiler가 같은
+ * 버전을 컴파일해 두면 그 AOT를 같은 방식으로 준비해 교체한다 (버전은 그대로, id만 바뀜).
+ */
+class ModuleRegistry {
+public:
+    explicit ModuleRegistry(TeeWorkerPool& pool);
+    /* 진행 중인 준비가 끝나기를 기다린다 (워커 풀보다 먼저 정리해야 한다) */
+    ~ModuleRegistry();
+
+    /* aot_file의 현재 버전. 파일이 없으면 NULL (설치된 aot_file id를 그대로 쓴다) */
+    module_lease acquire(const std::string& aot_file);
+    /*
+     * 트래픽을 받기 전 예열: aot_file의 현재 버전을 (설치되지 않았으면 설치하고) 모든 TA 인스턴스에
+     * 로드한 뒤 인스턴스마다 instances개를 미리 인스턴스화해 둔다. 이후 교체되는 새 버전도 같은 수만큼
+     * 준비한다. *module_id에 예열한 모듈 id, *ready에 모든 TA 인스턴스에 준비된 인스턴스 수
+     */
+    bool warm(const std::string& aot_file, uint32_t instances, std::string* module_id, uint32_t* ready);
+
+private:
+    struct Module {
+        module_lease current;
+        std::string pending;    /* 준비 중인 버전 */
+        std::string failed;     /* 준비에 실패한 버전 (RETRY_INTERVAL 동안 다시 시도하지 않음) */
+        std::chrono::steady_clock::time_point failed_at;
+        std::chrono::steady_clock::time_point checked;
+        uint32_t instances;     /* warm(): TA 인스턴스마다 미리 만들어 둘 인스턴스 수 */
+        bool tiering;           /* 지금 버전의 AOT 교체를 큐에 넣었거나 컴파일이 실패함 */
+        Module() : instances(0), tiering(false) {}
+    };
+
+    void loader_main();
+    /* 새 버전을 보안 저장소에 한 번 설치하고 모든 TA 인스턴스에 미리 로드한다 */
+    bool prepare(const module_version& next, uint32_t instances);
+    /* 교체된 버전 중 잡은 호출이 없는 것을 TA에서 지운다 */
+    void reclaim(std::unique_lock<std::mutex>& lock);
+    /* 인터프리터로 실행 중인 .wasm 버전 중 AOT 컴파일이 끝난 것을 교체 큐에 넣는다 */
+    void tier_up();
+
+    TeeWorkerPool& pool_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::map<std::string, Module> modules_;     /* aot_file → 버전 */
+    std::deque<module_version> reloads_;        /* 준비할 새 버전 */
+    std::vector<module_lease> retired_;         /* 교체된 버전 (여기만 잡고 있으면 지운다) */
+    bool stopping_;
+    std::thread loader_;
+};
+
+#endif /* MODULE_REGISTRY_H */
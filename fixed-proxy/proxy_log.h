@@ -0,0 +1,15 @@
+#ifndef PROXY_LOG_H
+#define PROXY_LOG_H
+
+#include <chrono>
+#include <string>
+
+/* Time measurement utility */
+static inline std::string get_timestamp() {
+    auto now = std::chrono::steady_clock::now();
+    auto duration = now.time_since_epoch();
+    auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+    return "[" + std::to_string(millis) + "ms]";
+}
+
+#endif /* PROXY_LOG_H */
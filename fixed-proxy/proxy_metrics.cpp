@@ -0,0 +1,98 @@
+#include "proxy_metrics.h"
+
+#include <utility>
+#include <vector>
+
+/* snapshot()에서 계산하는 비율 지표: name = numerator / denominator */
+static const struct {
+    const char* name;
+    const char* numerator;
+    const char* denominator;
+} derived_metrics[] = {
+    /* 마이크로 배치: TEE 진입 한 번에 실린 단계 수 / 실을 수 있던 수 */
+    { "microbatch_fill_ratio", "microbatch_steps", "microbatch_capacity" },
+    /* 마이크로 배치: 단계가 큐에 들어간 뒤 TEE에 들어가기까지 기다린 평균 시간 */
+    { "microbatch_added_latency_us_avg", "microbatch_added_latency_us", "microbatch_steps" },
+    { "microbatch_steps_per_entry", "microbatch_steps", "microbatch_entries" },
+    /* 연료 계량: 트랜잭션(함수)당 평균 wasm 명령 수 */
+    { "fuel_used_avg", "fuel_used", "fuel_metered_tx" },
+    /* 수락 제어: 받아들인 요청이 자리를 기다린 평균 시간 */
+    { "admission_wait_us_avg", "admission_wait_us", "admission_admitted" },
+    /* 스케줄링: 차선(class=read-only/read-write)별로 공유 큐에서 워커에 배정되기까지 기다린 평균 시간 */
+    { "sched_wait_us_avg", "sched_wait_us", "sched_dispatched" },
+    /* 상태 캐시: 캐시에서 바로 내준 읽기 비율 */
+    { "state_cache_hit_ratio", "state_cache_hits", "state_cache_lookups" },
+    { "result_cache_hit_ratio", "result_cache_hits", "result_cache_lookups" },
+    /* 반복자: TEE에 넘긴 페이지당 래퍼 왕복 수 (미리 읽기가 앞서면 1보다 작다) */
+    { "iterator_fetches_per_page", "iterator_fetches", "iterator_pages" },
+    /* 계층 실행: .wasm 한 버전을 AOT로 컴파일하는 데 걸린 평균 시간 */
+    { "aot_compile_ms_avg", "aot_compile_ms", "aot_compiles" },
+};
+
+void ProxyMetrics::add(const std::string& name, double delta)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    values_[name] += delta;
+}
+
+void ProxyMetrics::set(const std::string& name, double value)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    values_[name] = value;
+}
+
+ProxyMetrics::metric ProxyMetrics::find(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return &values_[name];
+}
+
+void ProxyMetrics::add(metric m, double delta)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    *m += delta;
+}
+
+void ProxyMetrics::set(metric m, double value)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    *m = value;
+}
+
+void ProxyMetrics::max(const std::string& name, double value)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<std::string, double>::iterator it = values_.find(name);
+    if (it == values_.end() || it->second < value) values_[name] = value;
+}
+
+std::map<std::string, double> ProxyMetrics::snapshot()
+{
+    std::map<std::string, double> out;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out = values_;
+    }
+    for (size_t i = 0; i < sizeof(derived_metrics) / sizeof(derived_metrics[0]); i++) {
+        // 라벨 없는 이름과 "이름{...}" 모두: 분모도 같은 라벨을 가진 것을 쓴다
+        std::string numerator = derived_metrics[i].numerator;
+        std::vector<std::pair<std::string, double> > derived;
+        for (std::map<std::string, double>::const_iterator num = out.lower_bound(numerator);
+             num != out.end() && num->first.compare(0, numerator.size(), numerator) == 0; ++num) {
+            std::string labels = num->first.substr(numerator.size());
+            if (!labels.empty() && labels[0] != '{') continue;
+            std::map<std::string, double>::const_iterator den = out.find(derived_metrics[i].denominator + labels);
+            if (den != out.end() && den->second > 0) {
+                derived.push_back(std::make_pair(derived_metrics[i].name + labels, num->second / den->second));
+            }
+        }
+        for (size_t j = 0; j < derived.size(); j++) out[derived[j].first] = derived[j].second;
+    }
+    return out;
+}
+
+ProxyMetrics& proxy_metrics()
+{
+    static ProxyMetrics metrics;
+    return metrics;
+}
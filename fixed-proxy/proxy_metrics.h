@@ -0,0 +1,37 @@
+#ifndef PROXY_METRICS_H
+#define PROXY_METRICS_H
+
+#include <map>
+#include <mutex>
+#include <string>
+
+/*
+ * 프록시 지표: 이름 → 값. 카운터는 add, 게이지는 set, 최댓값은 max로 갱신하고
+ * GetMetrics RPC와 벤치마크가 snapshot()으로 읽는다.
+ * snapshot()은 카운터 비율(평균, 채움 비율 등)도 함께 계산해 넣는다.
+ * 이름 뒤의 {라벨}은 그대로 이어받는다 (예: fuel_used{function=f} → fuel_used_avg{function=f}).
+ */
+class ProxyMetrics {
+public:
+    void add(const std::string& name, double delta);
+    void set(const std::string& name, double value);
+    void max(const std::string& name, double value);
+    std::map<std::string, double> snapshot();
+
+    /*
+     * 트랜잭션 경로에서 자주 갱신하는 지표는 이름을 한 번만 찾아 둔 자리로 갱신한다
+     * (갱신마다 이름 문자열을 만들지 않게). 자리는 지워지지 않으므로 계속 쓸 수 있다
+     */
+    typedef double* metric;
+    metric find(const std::string& name);
+    void add(metric m, double delta);
+    void set(metric m, double value);
+
+private:
+    std::mutex mutex_;
+    std::map<std::string, double> values_;
+};
+
+ProxyMetrics& proxy_metrics();
+
+#endif /* PROXY_METRICS_H */
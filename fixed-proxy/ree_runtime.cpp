@@ -0,0 +1,543 @@
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include <wamr_ta.h>
+
+#include "chaincode_tee_ree_communication.h"
+#include "proxy_metrics.h"
+#include "ree_runtime.h"
+#include "state_iterators.h"
+
+#ifdef REE_WASM
+#include "wasm_export.h"
+#endif
+
+ReeRuntime& ree_runtime()
+{
+    static ReeRuntime runtime;
+    return runtime;
+}
+
+#ifndef REE_WASM
+
+struct ReeRuntime::module {
+};
+
+ReeRuntime::ReeRuntime() : ready_(false) {}
+ReeRuntime::~ReeRuntime() {}
+
+bool ReeRuntime::available()
+{
+    return false;
+}
+
+std::shared_ptr<ReeRuntime::module> ReeRuntime::load(const tx_invocation&)
+{
+    return std::shared_ptr<module>();
+}
+
+bool ReeRuntime::execute(const tx_invocation& invocation, StateBackend*, std::string*, const tx_deadline&,
+                         uint64_t, tx_usage*)
+{
+    printf("%s ❌ REE 런타임 없이 빌드됨 (make REE_WASM=1): %s\n", get_timestamp().c_str(), invocation.aot_file.c_str());
+    return false;
+}
+
+#else
+
+/* TA(TA_InstantiateWamrModule, call_step)와 같은 크기 */
+static const uint32_t INSTANCE_STACK_SIZE = 256 * 1024;
+static const uint32_t INSTANCE_HEAP_SIZE = 64 * 1024;
+static const uint32_t EXEC_STACK_SIZE = 256 * 1024;
+
+/* 인스턴스 하나의 호출 상태 (TA의 chaincode_tx_ctx에 해당) */
+struct ree_tx {
+    ree_tx()
+        : pending_type(0), out_offset(0), out_len(0), iter_kind(0), iter_id(0), has_response(false),
+          deadline(NULL), deadline_checks(0), fuel_limit(0), fuel_granted(0), fuel_left(0),
+          metered(false), out_of_fuel(false) {}
+    struct arguments args;
+    uint32_t pending_type;  /* 네이티브가 남긴 호스트콜 (0: 없음) */
+    std::string key;
+    std::string value;
+    std::string iter_end;
+    uint32_t out_offset;    /* GET 값/반복자 페이지를 받을 WASM 버퍼 */
+    int out_len;
+    uint32_t iter_kind;
+    uint32_t iter_id;
+    std::string response;
+    bool has_response;
+    const tx_deadline* deadline;
+    uint32_t deadline_checks;
+    uint64_t fuel_limit;
+    uint64_t fuel_granted;
+    int64_t fuel_left;
+    bool metered;
+    bool out_of_fuel;
+};
+
+struct ReeRuntime::module {
+    module() : wasm(NULL) {}
+    ~module() {
+        if (wasm) wasm_runtime_unload(wasm);
+    }
+    std::string module_id;
+    std::vector<uint8_t> image;     /* AOT 모듈은 로드한 뒤에도 이 버퍼를 가리킨다 */
+    wasm_module_t wasm;
+};
+
+/* WAMR는 런타임을 쓰는 스레드마다 스레드 환경(신호 처리 등)을 요구한다 (gRPC 스레드도) */
+struct ree_thread_env {
+    ree_thread_env() : ok(wasm_runtime_init_thread_env()) {}
+    ~ree_thread_env() {
+        if (ok) wasm_runtime_destroy_thread_env();
+    }
+    bool ok;
+};
+
+static ree_tx* tx_of(wasm_exec_env_t exec_env)
+{
+    return (ree_tx*)wasm_runtime_get_custom_data(wasm_runtime_get_module_inst(exec_env));
+}
+
+static void* to_native(wasm_module_inst_t inst, uint32_t app_offset, uint32_t size)
+{
+    if (size && !wasm_runtime_validate_app_addr(inst, app_offset, size)) return NULL;
+    return wasm_runtime_addr_app_to_native(inst, app_offset);
+}
+
+/* 최대 limit 바이트까지의 문자열을 잘라 담는다 (TA의 KEY_SIZE/VAL_SIZE와 같게) */
+static std::string clipped(const char* s, int len, int limit)
+{
+    if (!s || len <= 0) return std::string();
+    return std::string(s, (size_t)std::min(len, limit));
+}
+
+/* 마감/취소 확인: TA와 같이 상태 접근과 로그는 매번, 메모리 함수는 64번에 한 번 */
+static bool terminate_if_expired(wasm_exec_env_t exec_env, bool every_call)
+{
+    ree_tx* tx = tx_of(exec_env);
+    if (!tx || !tx->deadline) return false;
+    if (!every_call && (++tx->deadline_checks & 63)) return false;
+    if (!tx->deadline->expired()) return false;
+    wasm_runtime_terminate(wasm_runtime_get_module_inst(exec_env));
+    return true;
+}
+
+/* 아래 네이티브들은 wrapper_ta/ta/chaincode_native_functions.c 와 같은 ABI, 같은 의미다 */
+
+static int64_t cc_fuel_native(wasm_exec_env_t exec_env, int64_t left)
+{
+    ree_tx* tx = tx_of(exec_env);
+    uint64_t grant = FUEL_REFILL;
+
+    if (!tx) return left + FUEL_REFILL;
+    tx->fuel_left = left;
+    if (terminate_if_expired(exec_env, true)) return left;
+    if (tx->fuel_limit) {
+        if (tx->fuel_granted >= tx->fuel_limit) {
+            tx->out_of_fuel = true;
+            wasm_runtime_set_exception(wasm_runtime_get_module_inst(exec_env), "out of fuel");
+            return left;
+        }
+        grant = std::min(grant, tx->fuel_limit - tx->fuel_granted);
+    }
+    tx->fuel_granted += grant;
+    tx->fuel_left = left + (int64_t)grant;
+    return tx->fuel_left;
+}
+
+/* args.arguments[i]를 out에 NUL 종단으로 복사하고 길이를 돌려준다 */
+static int copy_argument(wasm_exec_env_t exec_env, int i, uint32_t out_ptr, int out_len)
+{
+    wasm_module_inst_t inst = wasm_runtime_get_module_inst(exec_env);
+    char* out = (char*)to_native(inst, out_ptr, (uint32_t)out_len);
+    ree_tx* tx = tx_of(exec_env);
+    if (!out || out_len <= 0 || !tx) return 0;
+
+    const char* arg = i >= 0 && i < ARGS_NUMBER ? tx->args.arguments[i] : "";
+    size_t len = strnlen(arg, std::min((size_t)out_len - 1, (size_t)ARG_SIZE));
+    memset(out, 0, (size_t)out_len);
+    memcpy(out, arg, len);
+    return (int)len;
+}
+
+static int cc_get_function_native(wasm_exec_env_t exec_env, uint32_t out_ptr, int out_len)
+{
+    return copy_argument(exec_env, 0, out_ptr, out_len);
+}
+
+static int cc_get_arg_native(wasm_exec_env_t exec_env, int idx, uint32_t out_ptr, int out_len)
+{
+    if (terminate_if_expired(exec_env, true)) return 0;
+    // arguments[0]는 function, 그 뒤가 args
+    return copy_argument(exec_env, idx >= 0 && idx < ARGS_NUMBER - 1 ? idx + 1 : -1, out_ptr, out_len);
+}
+
+static int cc_get_state_native(wasm_exec_env_t exec_env, uint32_t key_ptr, int key_len, uint32_t out_ptr, int out_len)
+{
+    if (terminate_if_expired(exec_env, true)) return 0;
+    wasm_module_inst_t inst = wasm_runtime_get_module_inst(exec_env);
+    const char* out = (const char*)to_native(inst, out_ptr, (uint32_t)out_len);
+    const char* key = (const char*)to_native(inst, key_ptr, (uint32_t)(key_len > 0 ? key_len : 0));
+    ree_tx* tx = tx_of(exec_env);
+    if (!out || out_len <= 0 || !tx) return 0;
+
+    tx->key = clipped(key, key_len, KEY_SIZE - 1);
+    tx->pending_type = GET_STATE_REQUEST;
+    tx->out_offset = out_ptr;
+    tx->out_len = out_len;
+    return (int)tx->key.size();
+}
+
+static int cc_put_state_native(wasm_exec_env_t exec_env, uint32_t key_ptr, int key_len, uint32_t val_ptr, int val_len)
+{
+    if (terminate_if_expired(exec_env, true)) return -1;
+    wasm_module_inst_t inst = wasm_runtime_get_module_inst(exec_env);
+    const char* key = (const char*)to_native(inst, key_ptr, (uint32_t)(key_len > 0 ? key_len : 0));
+    const char* val = (const char*)to_native(inst, val_ptr, (uint32_t)(val_len > 0 ? val_len : 0));
+    ree_tx* tx = tx_of(exec_env);
+    if (!tx) return -1;
+
+    tx->key = clipped(key, key_len, KEY_SIZE - 1);
+    tx->value = clipped(val, val_len, VAL_SIZE - 1);
+    tx->pending_type = PUT_STATE_REQUEST;
+    tx->out_offset = 0;
+    tx->out_len = 0;
+    return -1;
+}
+
+static bool request_page(wasm_module_inst_t inst, ree_tx* tx, uint32_t out_ptr, int out_len)
+{
+    if (out_len <= (int)sizeof(struct iter_page_header) || !to_native(inst, out_ptr, (uint32_t)out_len)) return false;
+    tx->out_offset = out_ptr;
+    tx->out_len = out_len;
+    return true;
+}
+
+static int cc_iter_open_native(wasm_exec_env_t exec_env, int kind, uint32_t a_ptr, int a_len, uint32_t b_ptr,
+                               int b_len, uint32_t out_ptr, int out_len)
+{
+    if (terminate_if_expired(exec_env, true)) return -1;
+    wasm_module_inst_t inst = wasm_runtime_get_module_inst(exec_env);
+    const char* a = (const char*)to_native(inst, a_ptr, (uint32_t)(a_len > 0 ? a_len : 0));
+    const char* b = (const char*)to_native(inst, b_ptr, (uint32_t)(b_len > 0 ? b_len : 0));
+    ree_tx* tx = tx_of(exec_env);
+    if (!tx || (a_len > 0 && !a) || (b_len > 0 && !b) || kind < ITER_RANGE || kind > ITER_HISTORY ||
+        !request_page(inst, tx, out_ptr, out_len)) {
+        return -1;
+    }
+    tx->key = clipped(a, a_len, KEY_SIZE - 1);
+    tx->iter_end = clipped(b, b_len, KEY_SIZE - 1);
+    tx->iter_kind = (uint32_t)kind;
+    tx->iter_id = 0;
+    tx->pending_type = ITER_OPEN_REQUEST;
+    return 0;
+}
+
+static int cc_iter_next_native(wasm_exec_env_t exec_env, int iter_id, uint32_t out_ptr, int out_len)
+{
+    if (terminate_if_expired(exec_env, true)) return -1;
+    ree_tx* tx = tx_of(exec_env);
+    if (!tx || !request_page(wasm_runtime_get_module_inst(exec_env), tx, out_ptr, out_len)) return -1;
+    tx->iter_id = (uint32_t)iter_id;
+    tx->pending_type = ITER_NEXT_REQUEST;
+    return 0;
+}
+
+/* 반복자는 호출이 끝날 때 래퍼가 닫는다 */
+static int cc_iter_close_native(wasm_exec_env_t, int)
+{
+    return 0;
+}
+
+static int cc_return_response_native(wasm_exec_env_t exec_env, uint32_t msg_ptr, int msg_len)
+{
+    wasm_module_inst_t inst = wasm_runtime_get_module_inst(exec_env);
+    const char* msg = (const char*)to_native(inst, msg_ptr, (uint32_t)(msg_len > 0 ? msg_len : 0));
+    ree_tx* tx = tx_of(exec_env);
+    if (!tx) return 0;
+
+    tx->response = clipped(msg, msg_len, (int)RESPONSE_SIZE - 1);
+    tx->response.resize(strnlen(tx->response.c_str(), tx->response.size()));
+    tx->has_response = true;
+    return (int)std::min(std::max(msg_len, 0), (int)RESPONSE_SIZE - 1);
+}
+
+/* 프록시 로그로 바로 쓴다 (TA 경로의 로그 링과 같은 줄 형식) */
+static int cc_log_native(wasm_exec_env_t exec_env, uint32_t msg_ptr, int msg_len)
+{
+    if (terminate_if_expired(exec_env, true)) return 0;
+    const char* msg = (const char*)to_native(wasm_runtime_get_module_inst(exec_env), msg_ptr,
+                                             (uint32_t)(msg_len > 0 ? msg_len : 0));
+    if (!msg || msg_len <= 0) return 0;
+    int n = std::min(msg_len, LOG_RECORD_MAX);
+    printf("%s [chaincode] ree msg=\"%.*s\"\n", get_timestamp().c_str(), n, msg);
+    return n;
+}
+
+static int debug_log_native(wasm_exec_env_t exec_env, int)
+{
+    terminate_if_expired(exec_env, true);
+    return 0;
+}
+
+static uint32_t env_memset_native(wasm_exec_env_t exec_env, uint32_t dst_ptr, int c, uint32_t n)
+{
+    if (terminate_if_expired(exec_env, false)) return 0;
+    void* dst = to_native(wasm_runtime_get_module_inst(exec_env), dst_ptr, n);
+    if (!dst && n) return 0;
+    if (n) memset(dst, (uint8_t)c, n);
+    return dst_ptr;
+}
+
+static uint32_t env_memmove_native(wasm_exec_env_t exec_env, uint32_t dst_ptr, uint32_t src_ptr, uint32_t n)
+{
+    if (terminate_if_expired(exec_env, false)) return 0;
+    wasm_module_inst_t inst = wasm_runtime_get_module_inst(exec_env);
+    void* dst = to_native(inst, dst_ptr, n);
+    void* src = to_native(inst, src_ptr, n);
+    if ((!dst || !src) && n) return 0;
+    if (n) memmove(dst, src, n);
+    return dst_ptr;
+}
+
+static NativeSymbol ree_native_symbols[] = {
+    { "cc_get_function",    (void*)cc_get_function_native,    "(ii)i",      NULL },
+    { "cc_get_arg",         (void*)cc_get_arg_native,         "(iii)i",     NULL },
+    { "cc_get_state",       (void*)cc_get_state_native,       "(iiii)i",    NULL },
+    { "cc_put_state",       (void*)cc_put_state_native,       "(iiii)i",    NULL },
+    { "cc_iter_open",       (void*)cc_iter_open_native,       "(iiiiiii)i", NULL },
+    { "cc_iter_next",       (void*)cc_iter_next_native,       "(iii)i",     NULL },
+    { "cc_iter_close",      (void*)cc_iter_close_native,      "(i)i",       NULL },
+    { "cc_return_response", (void*)cc_return_response_native, "(ii)i",      NULL },
+    { "cc_log",             (void*)cc_log_native,             "(ii)i",      NULL },
+    { "debug_log",          (void*)debug_log_native,          "(i)i",       NULL },
+    { "memset",             (void*)env_memset_native,         "(iii)i",     NULL },
+    { "memcpy",             (void*)env_memmove_native,        "(iii)i",     NULL },
+    { "memmove",            (void*)env_memmove_native,        "(iii)i",     NULL },
+    { "cc_fuel",            (void*)cc_fuel_native,            "(I)I",       NULL },
+};
+
+ReeRuntime::ReeRuntime() : ready_(false)
+{
+    RuntimeInitArgs init_args;
+    memset(&init_args, 0, sizeof(init_args));
+    init_args.mem_alloc_type = Alloc_With_System_Allocator;
+    init_args.native_module_name = "env";
+    init_args.native_symbols = ree_native_symbols;
+    init_args.n_native_symbols = sizeof(ree_native_symbols) / sizeof(ree_native_symbols[0]);
+    ready_ = wasm_runtime_full_init(&init_args);
+    if (!ready_) printf("%s ❌ REE WAMR 런타임 초기화 실패\n", get_timestamp().c_str());
+}
+
+ReeRuntime::~ReeRuntime()
+{
+    modules_.clear();
+    if (ready_) wasm_runtime_destroy();
+}
+
+bool ReeRuntime::available()
+{
+    return true;
+}
+
+std::shared_ptr<ReeRuntime::module> ReeRuntime::load(const tx_invocation& invocation)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<std::string, std::shared_ptr<module> >::iterator it = modules_.find(invocation.aot_file);
+    if (it != modules_.end() && it->second->module_id == invocation.ta_module_id()) return it->second;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::shared_ptr<module> m(new module());
+    m->module_id = invocation.ta_module_id();
+    std::ifstream file(("./chaincode/" + invocation.aot_file).c_str(), std::ios::binary);
+    m->image.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (m->image.empty()) {
+        printf("%s ❌ REE 모듈 파일을 읽을 수 없음: %s\n", get_timestamp().c_str(), invocation.aot_file.c_str());
+        return std::shared_ptr<module>();
+    }
+    char error[128];
+    m->wasm = wasm_runtime_load(m->image.data(), (uint32_t)m->image.size(), error, sizeof(error));
+    if (!m->wasm) {
+        printf("%s ❌ REE 모듈 로드 실패: %s (%s)\n", get_timestamp().c_str(), m->module_id.c_str(), error);
+        return std::shared_ptr<module>();
+    }
+    // WASI 인자는 모듈에 붙으므로 인스턴스화가 동시에 일어나기 전에 한 번만 정한다
+    static char empty_arg[] = "";
+    char* argv[] = { empty_arg };
+    wasm_runtime_set_wasi_args(m->wasm, NULL, 0, NULL, 0, NULL, 0, argv, 1);
+
+    // 이전 버전은 그 버전을 실행 중인 호출이 끝나면(마지막 참조가 사라지면) 내려간다
+    modules_[invocation.aot_file] = m;
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("%s REE 모듈 로드: %s (%zu bytes, %.1fms)\n", get_timestamp().c_str(), m->module_id.c_str(),
+           m->image.size(), ms);
+    return m;
+}
+
+/* TA의 call_step과 같이 한 단계를 실행한다 (의도적인 경계/널 예외는 성공으로 본다) */
+static bool call_step(wasm_module_inst_t inst, wasm_exec_env_t env, const char* name)
+{
+    wasm_function_inst_t fn = wasm_runtime_lookup_function(inst, name, NULL);
+    if (!fn) {
+        printf("%s ❌ REE step 함수 없음: %s\n", get_timestamp().c_str(), name);
+        return false;
+    }
+    wasm_runtime_clear_exception(inst);
+    bool ok = wasm_runtime_call_wasm(env, fn, 0, NULL);
+    const char* ex = wasm_runtime_get_exception(inst);
+    if (ex) {
+        if (strstr(ex, "out of bounds") || strstr(ex, "null pointer")) ok = true;
+        wasm_runtime_clear_exception(inst);
+    }
+    return ok;
+}
+
+/* 네이티브가 남긴 호스트콜을 상태 저장소에 바로 묻고 WASM 버퍼에 답을 넣는다 */
+static bool answer_pending(wasm_module_inst_t inst, ree_tx* tx, StateBackend* state, StateIterators* iterators)
+{
+    uint32_t type = tx->pending_type;
+    tx->pending_type = 0;
+    switch (type) {
+    case GET_STATE_REQUEST: {
+        std::string value;
+        if (!state->get_state(tx->key, &value)) return false;
+        size_t len = strnlen(value.c_str(), std::min((size_t)tx->out_len - 1, (size_t)VAL_SIZE - 1));
+        char* out = (char*)to_native(inst, tx->out_offset, (uint32_t)tx->out_len);
+        if (out && len > 0) {
+            memset(out, 0, (size_t)tx->out_len);
+            memcpy(out, value.data(), len);
+        }
+        return true;
+    }
+    case PUT_STATE_REQUEST: {
+        std::string ack;
+        return state->put_state(tx->key, tx->value, &ack);
+    }
+    case ITER_OPEN_REQUEST:
+    case ITER_NEXT_REQUEST: {
+        tx_step step;
+        step.type = type;
+        step.key = tx->key;
+        step.end_key = tx->iter_end;
+        step.iter_kind = tx->iter_kind;
+        step.iter_id = tx->iter_id;
+        step.max_bytes = std::min((uint32_t)tx->out_len - (uint32_t)sizeof(struct iter_page_header),
+                                  (uint32_t)ITER_PAGE_BYTES);
+        std::string page;
+        struct iter_page_header header;
+        if (!iterators->answer(step, &page) || page.size() < sizeof(header)) return false;
+        memcpy(&header, page.data(), sizeof(header));
+        if (header.used > page.size() - sizeof(header) || header.used > step.max_bytes) return false;
+        uint8_t* out = (uint8_t*)to_native(inst, tx->out_offset, (uint32_t)tx->out_len);
+        if (!out) return false;
+        memcpy(out, page.data(), sizeof(header) + header.used);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+/* 정상 종료면 마지막 충전 이후의 소비까지 WASM 전역에서 읽는다 (TA의 invocation_fuel_used) */
+static uint64_t fuel_used(wasm_module_inst_t inst, const ree_tx& tx, bool stopped)
+{
+    int64_t left = tx.fuel_left;
+    if (!stopped) {
+        wasm_function_inst_t fn = wasm_runtime_lookup_function(inst, FUEL_LEFT_EXPORT, NULL);
+        wasm_exec_env_t env = wasm_runtime_create_exec_env(inst, 4 * 1024);
+        uint32_t argv[2] = { 0, 0 };
+        if (fn && env && wasm_runtime_call_wasm(env, fn, 0, argv)) {
+            memcpy(&left, argv, sizeof(left));
+        } else {
+            wasm_runtime_clear_exception(inst);
+        }
+        if (env) wasm_runtime_destroy_exec_env(env);
+    }
+    return (int64_t)tx.fuel_granted > left ? (uint64_t)((int64_t)tx.fuel_granted - left) : 0;
+}
+
+bool ReeRuntime::execute(const tx_invocation& invocation, StateBackend* state, std::string* response,
+                         const tx_deadline& deadline, uint64_t fuel_limit, tx_usage* usage)
+{
+    static thread_local ree_thread_env thread_env;
+    if (!ready_ || !thread_env.ok) return false;
+    std::shared_ptr<module> m = load(invocation);
+    if (!m) return false;
+
+    char error[128];
+    wasm_module_inst_t inst = wasm_runtime_instantiate(m->wasm, INSTANCE_STACK_SIZE, INSTANCE_HEAP_SIZE,
+                                                       error, sizeof(error));
+    if (!inst) {
+        printf("%s ❌ REE 인스턴스화 실패: %s (%s)\n", get_timestamp().c_str(), m->module_id.c_str(), error);
+        return false;
+    }
+    wasm_exec_env_t env = wasm_runtime_create_exec_env(inst, EXEC_STACK_SIZE);
+    if (!env) {
+        wasm_runtime_deinstantiate(inst);
+        return false;
+    }
+
+    ree_tx tx;
+    pack_arguments(invocation.function_name, invocation.args, &tx.args);
+    tx.deadline = &deadline;
+    tx.fuel_limit = fuel_limit;
+    tx.metered = wasm_runtime_lookup_function(inst, FUEL_LEFT_EXPORT, NULL) != NULL;
+    wasm_runtime_set_custom_data(inst, &tx);
+    proxy_metrics().add("ree_tx", 1);
+
+    // TA와 같은 흐름: step_init 뒤에 step_resume을 호스트콜이 남지 않을 때까지
+    StateIterators iterators(state);
+    bool ok = call_step(inst, env, "step_init");
+    bool init_failed = !ok;
+    bool host_failed = false;
+    while (ok) {
+        ok = call_step(inst, env, "step_resume");
+        if (!ok || !tx.pending_type) break;
+        proxy_metrics().add("ree_host_calls", 1);
+        if (!answer_pending(inst, &tx, state, &iterators)) {
+            printf("%s ❌ REE 호스트콜 응답 실패: %s\n", get_timestamp().c_str(), invocation.function_name.c_str());
+            host_failed = true;
+            break;
+        }
+        if (deadline.expired()) ok = false;
+    }
+
+    bool cancelled = deadline.expired();
+    tx_usage result;
+    result.metered = tx.metered;
+    result.out_of_fuel = tx.out_of_fuel;
+    if (tx.metered) result.fuel_used = fuel_used(inst, tx, !ok || host_failed);
+
+    wasm_runtime_set_custom_data(inst, NULL);
+    wasm_runtime_destroy_exec_env(env);
+    wasm_runtime_deinstantiate(inst);
+
+    if (host_failed || (!ok && cancelled)) {
+        if (cancelled) proxy_metrics().add("tx_cancelled", 1);
+        return false;
+    }
+    if (init_failed && !tx.out_of_fuel) {
+        printf("%s ❌ REE step_init 실패: %s\n", get_timestamp().c_str(), invocation.function_name.c_str());
+        return false;
+    }
+    if (!ok && !tx.out_of_fuel) {
+        // step_resume 실패는 TA처럼 체인코드의 실패 응답으로 돌려준다
+        response->assign("RUNTIME_ERROR");
+    } else if (!ok) {
+        response->assign("OUT_OF_FUEL");
+    } else if (tx.has_response) {
+        response->assign(tx.response.empty() ? "EMPTY_RESPONSE" : tx.response);
+    } else {
+        response->assign("NO_RESPONSE");
+    }
+    if (usage) *usage = result;
+    return true;
+}
+
+#endif /* REE_WASM */
@@ -0,0 +1,49 @@
+#ifndef REE_RUNTIME_H
+#define REE_RUNTIME_H
+
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "tee_session.h"
+
+/*
+ * 기밀성이 필요 없는 체인코드 함수를 TEE 밖(REE)에서 실행하는 WAMR 런타임.
+ * ./chaincode/<aot_file>.manifest 의 "ree <함수>..." 줄(또는 "ree *")로 고른 호출만 여기로 온다.
+ * TA와 같은 네이티브 ABI(env.cc_get_state, cc_put_state, cc_iter_*, cc_fuel ...)와 같은 step_init /
+ * step_resume 흐름으로 실행하므로 체인코드는 그대로다. 호스트콜은 월드 스위치 없이 gRPC 스트림으로
+ * 바로 나가고, TEE 세션 슬롯과 TA heap을 쓰지 않는다.
+ * 리눅스용 WAMR(libvmlib.a)을 함께 링크한 빌드(make REE_WASM=1)에서만 쓸 수 있고, 아니면
+ * available()이 거짓이라 manifest와 상관없이 모든 호출을 TA에서 실행한다.
+ */
+class ReeRuntime {
+public:
+    ReeRuntime();
+    ~ReeRuntime();
+
+    /* 이 빌드에 REE 런타임이 있는지 */
+    static bool available();
+
+    /*
+     * invocation을 REE에서 실행한다 (TeeWorkerPool::execute와 같은 의미의 결과).
+     * fuel_limit: 계량 모듈의 트랜잭션당 연료 한도 (0이면 없음)
+     */
+    bool execute(const tx_invocation& invocation, StateBackend* state, std::string* response,
+                 const tx_deadline& deadline, uint64_t fuel_limit, tx_usage* usage);
+
+private:
+    struct module;
+    /* invocation의 모듈 버전을 로드해 둔 것 (같은 aot_file의 이전 버전은 쓰는 호출이 끝나면 내린다) */
+    std::shared_ptr<module> load(const tx_invocation& invocation);
+
+    bool ready_;
+    std::mutex mutex_;
+    std::map<std::string, std::shared_ptr<module> > modules_;   /* aot_file → 로드한 버전 */
+};
+
+/* 프로세스에 하나 (WAMR 런타임은 전역) */
+ReeRuntime& ree_runtime();
+
+#endif /* REE_RUNTIME_H */
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <algorithm>
+
+#include "proxy_metrics.h"
+#include "result_cache.h"
+
+/* 결과를 기다리는 동안 클라이언트 취소를 확인하는 간격 */
+static const std::chrono::milliseconds CANCEL_POLL(50);
+
+ResultCache::ResultCache(size_t max_entries, size_t max_response_size, StateCache* state)
+    : max_entries_(max_entries), max_response_size_(max_response_size), state_(state)
+{
+}
+
+ResultCache::Lead::~Lead()
+{
+    if (owner_) owner_->finish(key_, NULL);
+}
+
+void ResultCache::Lead::publish(const cached_result& result)
+{
+    if (!owner_) return;
+    owner_->finish(key_, &result);
+    owner_ = NULL;
+}
+
+std::string ResultCache::key_for(const std::string& module_id, const std::string& function_name,
+                                 const std::vector<std::string>& args)
+{
+    // 길이를 앞에 붙여 인자 경계가 모호하지 않게 한다
+    std::string key = module_id + "|" + function_name;
+    for (size_t i = 0; i < args.size(); i++) key += "|" + std::to_string(args[i].size()) + ":" + args[i];
+    return key;
+}
+
+/* 상태 캐시가 아는 버전과 모두 맞는지 (상태 캐시에 없는 키는 래퍼 확인에 맡긴다) */
+bool ResultCache::current_locked(const cached_result& result)
+{
+    for (std::map<std::string, std::string>::const_iterator it = result.reads.begin(); it != result.reads.end(); ++it) {
+        std::string version;
+        if (it->second.empty()) return false;
+        if (state_->peek_version(it->first, &version) && version != it->second) return false;
+    }
+    return true;
+}
+
+bool ResultCache::find(const std::string& key, const tx_deadline& deadline, cached_result* result, Lead* lead)
+{
+    if (!enabled()) return false;
+    ProxyMetrics& m = proxy_metrics();
+    m.add("result_cache_lookups", 1);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::unordered_map<std::string, Lru::iterator>::iterator it = index_.find(key);
+    if (it != index_.end()) {
+        if (current_locked(it->second->result)) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            *result = it->second->result;
+            m.add("result_cache_hits", 1);
+            return true;
+        }
+        lru_.erase(it->second);
+        index_.erase(it);
+        m.add("result_cache_invalidations", 1);
+        m.set("result_cache_entries", index_.size());
+    }
+
+    std::map<std::string, std::shared_ptr<Flight> >::iterator flight = flights_.find(key);
+    if (flight != flights_.end()) {
+        // 같은 호출이 실행 중: 그 결과를 기다린다
+        std::shared_ptr<Flight> f = flight->second;
+        m.add("result_cache_waits", 1);
+        while (!f->done) {
+            if (deadline.expired()) return false;
+            cv_.wait_until(lock, std::min(deadline.at, std::chrono::steady_clock::now() + CANCEL_POLL));
+        }
+        if (!f->ok) return false;
+        *result = f->result;
+        m.add("result_cache_shared", 1);
+        return true;
+    }
+
+    flights_[key] = std::make_shared<Flight>();
+    lead->owner_ = this;
+    lead->key_ = key;
+    m.add("result_cache_misses", 1);
+    return false;
+}
+
+void ResultCache::finish(const std::string& key, const cached_result* result)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::map<std::string, std::shared_ptr<Flight> >::iterator flight = flights_.find(key);
+        if (flight != flights_.end()) {
+            flight->second->done = true;
+            flight->second->ok = result != NULL;
+            if (result) flight->second->result = *result;
+            flights_.erase(flight);
+        }
+
+        // 버전을 모르는 읽기가 있으면 나중에 확인할 수 없으므로 기다리던 호출에만 넘기고 캐시하지 않는다
+        bool cacheable = result && result->response.size() <= max_response_size_ && current_locked(*result);
+        if (cacheable) {
+            std::unordered_map<std::string, Lru::iterator>::iterator it = index_.find(key);
+            if (it != index_.end()) {
+                lru_.erase(it->second);
+                index_.erase(it);
+            }
+            Entry e;
+            e.key = key;
+            e.result = *result;
+            lru_.push_front(e);
+            index_[key] = lru_.begin();
+            while (index_.size() > max_entries_) {
+                index_.erase(lru_.back().key);
+                lru_.pop_back();
+            }
+            proxy_metrics().set("result_cache_entries", index_.size());
+        }
+    }
+    cv_.notify_all();
+}
+
+void ResultCache::drop(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unordered_map<std::string, Lru::iterator>::iterator it = index_.find(key);
+    if (it == index_.end()) return;
+    lru_.erase(it->second);
+    index_.erase(it);
+    proxy_metrics().add("result_cache_invalidations", 1);
+    proxy_metrics().set("result_cache_entries", index_.size());
+}
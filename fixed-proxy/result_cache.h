@@ -0,0 +1,90 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "state_cache.h"
+#include "tee_session.h"
+
+/* 읽기 전용 호출 한 번의 결과와 그때 읽은 키의 버전 */
+struct cached_result {
+    cached_result() : fuel_used(0) {}
+    std::string response;
+    uint64_t fuel_used;
+    std::map<std::string, std::string> reads;   /* 키 → 버전 */
+};
+
+/*
+ * 조회 결과 캐시: (모듈 버전, 함수, 인자) → 응답과 read set(버전 포함).
+ * 상태 캐시가 아는 버전과 어긋난 항목은 쓰지 않는다. 쓸 수 있는 항목도 돌려주기 전에
+ * 호출한 쪽이 래퍼에 read set을 확인받으므로(ValidateReadsRequest) 낡은 응답은 나가지 않는다.
+ * 같은 호출이 동시에 들어오면 하나(lead)만 TEE에서 실행하고 나머지는 그 결과를 기다려 쓴다.
+ * 모듈 버전은 워커 풀이 새 호출에 쓰는 모듈 id(TeeWorkerPool::current_module_id)다.
+ */
+class ResultCache {
+public:
+    /* find가 실행을 맡긴 호출. 결과를 publish하지 않고 사라지면 기다리던 호출은 직접 실행한다 */
+    class Lead {
+    public:
+        Lead() : owner_(NULL) {}
+        ~Lead();
+        bool leading() const { return owner_ != NULL; }
+        void publish(const cached_result& result);
+    private:
+        friend class ResultCache;
+        Lead(const Lead&);
+        Lead& operator=(const Lead&);
+        ResultCache* owner_;
+        std::string key_;
+    };
+
+    ResultCache(size_t max_entries, size_t max_response_size, StateCache* state);
+
+    bool enabled() const { return max_entries_ > 0; }
+    std::string key_for(const std::string& module_id, const std::string& function_name,
+                        const std::vector<std::string>& args);
+    /*
+     * 캐시에 있거나 같은 호출을 실행 중인 곳의 결과를 받으면 true.
+     * 아니면 false이고, 실행 중인 곳이 없었으면 lead가 이 호출을 맡는다
+     */
+    bool find(const std::string& key, const tx_deadline& deadline, cached_result* result, Lead* lead);
+    /* 래퍼 확인에서 낡은 것으로 드러난 항목을 지운다 */
+    void drop(const std::string& key);
+
+private:
+    struct Flight {
+        Flight() : done(false), ok(false) {}
+        bool done;
+        bool ok;
+        cached_result result;
+    };
+    struct Entry {
+        std::string key;
+        cached_result result;
+    };
+    typedef std::list<Entry> Lru;
+
+    bool current_locked(const cached_result& result);
+    void finish(const std::string& key, const cached_result* result);
+
+    const size_t max_entries_;
+    const size_t max_response_size_;
+    StateCache* state_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    Lru lru_;   /* 앞이 최근 */
+    std::unordered_map<std::string, Lru::iterator> index_;
+    std::map<std::string, std::shared_ptr<Flight> > flights_;
+};
+
+#endif /* RESULT_CACHE_H */
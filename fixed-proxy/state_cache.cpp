@@ -0,0 +1,264 @@
+#include "proxy_metrics.h"
+#include "state_cache.h"
+
+StateCache::StateCache(size_t max_entries, size_t max_value_size)
+    : max_entries_(max_entries), max_value_size_(max_value_size)
+{
+    for (size_t i = 0; i < STAMP_STRIPES; i++) stamps_[i] = 0;
+}
+
+void StateCache::publish_locked()
+{
+    proxy_metrics().set("state_cache_entries", index_.size());
+}
+
+bool StateCache::lookup(const std::string& key, std::string* value, std::string* version)
+{
+    if (!enabled()) return false;
+    ProxyMetrics& m = proxy_metrics();
+    static const ProxyMetrics::metric lookups = m.find("state_cache_lookups");
+    static const ProxyMetrics::metric hits = m.find("state_cache_hits");
+    m.add(lookups, 1);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unordered_map<std::string, Lru::iterator>::iterator it = index_.find(key);
+    if (it == index_.end()) return false;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    *value = it->second->value;
+    *version = it->second->version;
+    m.add(hits, 1);
+    return true;
+}
+
+bool StateCache::peek_version(const std::string& key, std::string* version)
+{
+    if (!enabled()) return false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unordered_map<std::string, Lru::iterator>::iterator it = index_.find(key);
+    if (it == index_.end()) return false;
+    *version = it->second->version;
+    return true;
+}
+
+uint64_t StateCache::stamp(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stripe(key);
+}
+
+void StateCache::insert(const std::string& key, const std::string& value, const std::string& version, uint64_t stamp)
+{
+    // 버전이 없으면 나중에 확인할 수 없으므로 캐시하지 않는다
+    if (!enabled() || version.empty() || value.size() > max_value_size_) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stripe(key) != stamp) return;
+    std::unordered_map<std::string, Lru::iterator>::iterator it = index_.find(key);
+    if (it != index_.end()) {
+        it->second->value = value;
+        it->second->version = version;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return;
+    }
+    Entry e;
+    e.key = key;
+    e.value = value;
+    e.version = version;
+    lru_.push_front(e);
+    index_[key] = lru_.begin();
+    while (index_.size() > max_entries_) {
+        index_.erase(lru_.back().key);
+        lru_.pop_back();
+    }
+    publish_locked();
+}
+
+/* 무효화 횟수를 올리고 있으면 지운다 (mutex_ 보유 상태에서 호출) */
+bool StateCache::remove_locked(const std::string& key)
+{
+    stripe(key)++;
+    std::unordered_map<std::string, Lru::iterator>::iterator it = index_.find(key);
+    if (it == index_.end()) return false;
+    lru_.erase(it->second);
+    index_.erase(it);
+    return true;
+}
+
+size_t StateCache::invalidate(const std::vector<std::string>& keys)
+{
+    if (!enabled()) return 0;
+    size_t removed = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (remove_locked(keys[i])) removed++;
+        }
+        publish_locked();
+    }
+    proxy_metrics().add("state_cache_invalidations", removed);
+    return removed;
+}
+
+size_t StateCache::invalidate(const std::string& key)
+{
+    if (!enabled()) return 0;
+    size_t removed = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (remove_locked(key)) removed++;
+        publish_locked();
+    }
+    static const ProxyMetrics::metric invalidations = proxy_metrics().find("state_cache_invalidations");
+    proxy_metrics().add(invalidations, removed);
+    return removed;
+}
+
+size_t StateCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t removed = index_.size();
+    for (size_t i = 0; i < STAMP_STRIPES; i++) stamps_[i]++;
+    lru_.clear();
+    index_.clear();
+    publish_locked();
+    proxy_metrics().add("state_cache_invalidations", removed);
+    return removed;
+}
+
+void ReadSet::record(const std::string& key, const std::string& version)
+{
+    for (size_t i = 0; i < size_; i++) {
+        if (entries_[i].first != key) continue;
+        // 같은 키를 서로 다른 버전으로 읽었다면 하나는 반드시 낡았다: 확인이 실패하게 비운다
+        if (entries_[i].second != version) entries_[i].second.clear();
+        return;
+    }
+    if (size_ == entries_.size()) {
+        entries_.push_back(std::make_pair(key, version));
+    } else {
+        entries_[size_].first.assign(key);
+        entries_[size_].second.assign(version);
+    }
+    size_++;
+}
+
+std::map<std::string, std::string> ReadSet::to_map() const
+{
+    std::map<std::string, std::string> out;
+    for (size_t i = 0; i < size_; i++) out[entries_[i].first] = entries_[i].second;
+    return out;
+}
+
+CachingStateBackend::Scratch& CachingStateBackend::thread_scratch()
+{
+    static thread_local Scratch scratch;
+    return scratch;
+}
+
+bool& CachingStateBackend::thread_scratch_in_use()
+{
+    static thread_local bool in_use = false;
+    return in_use;
+}
+
+CachingStateBackend::CachingStateBackend(StateBackend* base, StateCache* cache)
+    : base_(base), cache_(cache), scratch_(&own_), borrowed_(false), wrote_(false), scanned_(false)
+{
+    // 핸들러 스레드는 트랜잭션을 차례로 처리하므로 앞 트랜잭션의 자리를 그대로 이어 쓴다
+    if (!thread_scratch_in_use()) {
+        thread_scratch_in_use() = true;
+        borrowed_ = true;
+        scratch_ = &thread_scratch();
+        scratch_->cached_reads.clear();
+        scratch_->reads.clear();
+    }
+}
+
+CachingStateBackend::~CachingStateBackend()
+{
+    if (borrowed_) thread_scratch_in_use() = false;
+}
+
+bool CachingStateBackend::get_state(const std::string& key, std::string* value)
+{
+    std::string version;
+    return get_versioned(key, value, &version);
+}
+
+/* 호스트콜 하나의 읽기: get_states와 같은 처리를 임시 벡터 없이 호출한 쪽 버퍼로 바로 한다 */
+bool CachingStateBackend::get_versioned(const std::string& key, std::string* value, std::string* version)
+{
+    if (cache_->lookup(key, value, version)) {
+        scratch_->cached_reads.record(key, *version);
+        scratch_->reads.record(key, *version);
+        return true;
+    }
+    uint64_t stamp = cache_->enabled() ? cache_->stamp(key) : 0;
+    if (!base_->get_versioned(key, value, version)) return false;
+    scratch_->reads.record(key, *version);
+    cache_->insert(key, *value, *version, stamp);
+    return true;
+}
+
+bool CachingStateBackend::get_state_into(const std::string& key, char* buf, size_t size, size_t* length,
+                                         std::string* version)
+{
+    std::string& read_version = scratch_->version;
+    if (cache_->enabled()) {
+        // 캐시에 넣을 값이 필요하므로 받아 두는 자리를 거친다
+        std::string& value = scratch_->value;
+        if (!get_versioned(key, &value, &read_version)) return false;
+        *length = value.length();
+        if (value.length() < size) value.copy(buf, value.length());
+    } else {
+        if (!base_->get_state_into(key, buf, size, length, &read_version)) return false;
+        scratch_->reads.record(key, read_version);
+    }
+    if (version) version->assign(read_version);
+    return true;
+}
+
+bool CachingStateBackend::put_state(const std::string& key, const std::string& value, std::string* ack)
+{
+    // 커밋될지 모르는 값이므로 캐시에 넣지 않고 옛 값만 지운다
+    // (앞서 캐시에서 읽었다면 cached_reads에 그대로 남아 응답 전에 확인받는다)
+    cache_->invalidate(key);
+    wrote_ = true;
+    return base_->put_state(key, value, ack);
+}
+
+bool CachingStateBackend::get_states(const std::vector<std::string>& keys, std::vector<std::string>* values,
+                                     std::vector<std::string>* versions)
+{
+    values->assign(keys.size(), std::string());
+    if (versions) versions->assign(keys.size(), std::string());
+
+    std::vector<std::string> missing;
+    std::vector<size_t> missing_index;
+    std::vector<uint64_t> stamps;
+    for (size_t i = 0; i < keys.size(); i++) {
+        std::string version;
+        if (cache_->lookup(keys[i], &(*values)[i], &version)) {
+            scratch_->cached_reads.record(keys[i], version);
+            scratch_->reads.record(keys[i], version);
+            if (versions) (*versions)[i] = version;
+            continue;
+        }
+        missing.push_back(keys[i]);
+        missing_index.push_back(i);
+        stamps.push_back(cache_->stamp(keys[i]));
+    }
+    if (missing.empty()) return true;
+
+    std::vector<std::string> fetched, fetched_versions;
+    if (!base_->get_states(missing, &fetched, &fetched_versions) || fetched.size() != missing.size()) return false;
+    fetched_versions.resize(missing.size());
+    for (size_t j = 0; j < missing.size(); j++) {
+        size_t i = missing_index[j];
+        (*values)[i] = fetched[j];
+        if (versions) (*versions)[i] = fetched_versions[j];
+        scratch_->reads.record(missing[j], fetched_versions[j]);
+        cache_->insert(missing[j], fetched[j], fetched_versions[j], stamps[j]);
+    }
+    return true;
+}
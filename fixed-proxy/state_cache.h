@@ -0,0 +1,138 @@
+#ifndef STATE_CACHE_H
+#define STATE_CACHE_H
+
+#include <stdint.h>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tee_session.h"
+
+/*
+ * 트랜잭션 사이에 재사용하는 상태 캐시: 키 → (값, 버전), 최근에 쓴 순서로 max_entries개.
+ * 버전은 래퍼가 값과 함께 알려준 것만 캐시한다 (버전을 주지 않는 래퍼와는 캐시가 꺼진 것과 같다).
+ * 무효화: 프록시를 지나는 쓰기(PUT, 배치 write set)와 NotifyCommit RPC(블록에서 바뀐 키).
+ *
+ * 캐시 적중은 래퍼 왕복 없이 TEE에 바로 넘기지만 오래된 값으로 끝나지 않는다.
+ * 트랜잭션 경로와 배치 경로 모두 응답 전에 적중한 (키, 버전)을 한 번에 래퍼에 보내 확인하고
+ * (래퍼는 이때 GetState를 불러 Fabric read set에도 남긴다), 어긋나면 ABORTED로 돌려준다.
+ * 낡은 버전은 read set에도 그대로 실리므로 클라이언트의 MVCC 검증에 맡길 수 없다.
+ */
+class StateCache {
+public:
+    StateCache(size_t max_entries, size_t max_value_size);
+
+    bool enabled() const { return max_entries_ > 0; }
+    bool lookup(const std::string& key, std::string* value, std::string* version);
+    /* 캐시에 있는 버전만 본다 (적중 통계/LRU 순서는 그대로) */
+    bool peek_version(const std::string& key, std::string* version);
+    /* 읽기 전에 받아 둔 stamp 이후 이 키가 무효화됐으면 넣지 않는다 (늦게 도착한 옛 값) */
+    uint64_t stamp(const std::string& key);
+    void insert(const std::string& key, const std::string& value, const std::string& version, uint64_t stamp);
+    size_t invalidate(const std::vector<std::string>& keys);
+    /* 키 하나 (PUT 호스트콜: 임시 벡터를 만들지 않는다) */
+    size_t invalidate(const std::string& key);
+    size_t clear();
+
+private:
+    struct Entry {
+        std::string key;
+        std::string value;
+        std::string version;
+    };
+    typedef std::list<Entry> Lru;
+
+    /* 키별 무효화 횟수 대신 해시 구간마다 센다 (메모리 고정, 충돌은 캐시를 덜 채울 뿐) */
+    static const size_t STAMP_STRIPES = 256;
+
+    uint64_t& stripe(const std::string& key) { return stamps_[std::hash<std::string>()(key) % STAMP_STRIPES]; }
+    bool remove_locked(const std::string& key);
+    void publish_locked();
+
+    const size_t max_entries_;
+    const size_t max_value_size_;
+    std::mutex mutex_;
+    Lru lru_;   /* 앞이 최근 */
+    std::unordered_map<std::string, Lru::iterator> index_;
+    uint64_t stamps_[STAMP_STRIPES];
+};
+
+/*
+ * 트랜잭션이 읽은 (키, 버전). 같은 키를 서로 다른 버전으로 읽었으면 버전을 비운다.
+ * clear()는 항목 수만 되돌려 다음 트랜잭션이 키/버전 문자열의 용량을 그대로 다시 쓰므로
+ * 읽기를 기록해도 호스트콜마다 힙 할당이 없다. 트랜잭션의 읽기는 많지 않아 차례로 찾는다
+ */
+class ReadSet {
+public:
+    ReadSet() : size_(0) {}
+
+    void clear() { size_ = 0; }
+    bool empty() const { return size_ == 0; }
+    void record(const std::string& key, const std::string& version);
+    /* 키 → 버전 (버전을 모르거나 서로 다른 버전으로 읽었으면 빈 문자열) */
+    std::map<std::string, std::string> to_map() const;
+
+private:
+    std::vector<std::pair<std::string, std::string> > entries_;
+    size_t size_;
+};
+
+/*
+ * base(래퍼로 가는 상태) 앞에 StateCache를 둔다. 적중한 읽기는 (키, 버전)을 cached_reads에
+ * 남겨 트랜잭션이 끝난 뒤 래퍼에 확인받게 한다. 쓰기는 캐시에서 그 키를 지우고 그대로 넘긴다.
+ */
+class CachingStateBackend : public StateBackend {
+public:
+    CachingStateBackend(StateBackend* base, StateCache* cache);
+    ~CachingStateBackend();
+
+    bool get_state(const std::string& key, std::string* value) override;
+    /* 값은 캐시 또는 base에서 buf로 바로 복사한다 (호스트콜 경로) */
+    bool get_state_into(const std::string& key, char* buf, size_t size, size_t* length,
+                        std::string* version = NULL) override;
+    bool put_state(const std::string& key, const std::string& value, std::string* ack) override;
+    bool get_versioned(const std::string& key, std::string* value, std::string* version) override;
+    bool get_states(const std::vector<std::string>& keys, std::vector<std::string>* values,
+                    std::vector<std::string>* versions = NULL) override;
+    /* 반복자는 캐시를 거치지 않는다 (범위의 키 목록은 키별 버전으로 확인할 수 없음) */
+    bool open_iterator(uint32_t id, const iterator_query& query, uint32_t page_size, state_page* page) override {
+        scanned_ = true;
+        return base_->open_iterator(id, query, page_size, page);
+    }
+    bool next_page(uint32_t id, uint32_t page_size, state_page* page) override {
+        return base_->next_page(id, page_size, page);
+    }
+
+    /* 캐시에서 내준 읽기 (키 → 버전) */
+    std::map<std::string, std::string> cached_reads() const { return scratch_->cached_reads.to_map(); }
+    /* 모든 읽기 (키 → 버전, 버전을 모르거나 서로 다른 버전으로 읽었으면 빈 문자열) */
+    std::map<std::string, std::string> reads() const { return scratch_->reads.to_map(); }
+    bool wrote() const { return wrote_; }
+    /* 범위/이력 조회를 했음 (reads()에 없는 읽기가 있다) */
+    bool scanned() const { return scanned_; }
+
+private:
+    /* 읽기 기록과 get_state_into가 값/버전을 받아 두는 자리 */
+    struct Scratch {
+        ReadSet cached_reads;
+        ReadSet reads;
+        std::string value;
+        std::string version;
+    };
+    static Scratch& thread_scratch();
+    static bool& thread_scratch_in_use();
+
+    StateBackend* base_;
+    StateCache* cache_;
+    /* 보통 이 스레드의 앞 트랜잭션이 쓴 자리를 용량째 빌리고, 이미 쓰이고 있으면 own_ */
+    Scratch* scratch_;
+    Scratch own_;
+    bool borrowed_;
+    bool wrote_;
+    bool scanned_;
+};
+
+#endif /* STATE_CACHE_H */
@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include "chaincode_tee_ree_communication.h"
+
+#include "proxy_metrics.h"
+#include "state_iterators.h"
+
+/* 페이지 레코드의 길이 필드: 리틀 엔디언 u32 */
+static uint8_t* put_u32(uint8_t* out, uint32_t v)
+{
+    out[0] = (uint8_t)(v & 0xff);
+    out[1] = (uint8_t)((v >> 8) & 0xff);
+    out[2] = (uint8_t)((v >> 16) & 0xff);
+    out[3] = (uint8_t)((v >> 24) & 0xff);
+    return out + 4;
+}
+
+bool StateIterators::answer(const tx_step& step, struct iter_reply* page)
+{
+    if (step.type == ITER_OPEN_REQUEST) {
+        iterator_query query;
+        query.kind = step.iter_kind;
+        query.start_key = step.key;
+        if (query.kind == ITER_PARTIAL_COMPOSITE) {
+            // 속성들은 ITER_ATTR_SEPARATOR로 이어져 온다
+            size_t from = 0;
+            while (from < step.end_key.size()) {
+                size_t sep = step.end_key.find(ITER_ATTR_SEPARATOR, from);
+                if (sep == std::string::npos) sep = step.end_key.size();
+                query.attributes.push_back(step.end_key.substr(from, sep - from));
+                from = sep + 1;
+            }
+        } else if (query.kind == ITER_RANGE) {
+            query.end_key = step.end_key;
+        }
+
+        uint32_t id = ++next_id_;
+        state_page first;
+        if (!state_->open_iterator(id, query, fetch_size_, &first)) return false;
+        proxy_metrics().add("iterator_fetches", 1);
+        proxy_metrics().add("iterator_entries", first.entries.size());
+        cursor& c = open_[id];
+        c.buffered.assign(first.entries.begin(), first.entries.end());
+        c.more = first.has_more;
+        return pack(id, step.max_bytes, page);
+    }
+
+    if (step.type == ITER_NEXT_REQUEST) {
+        if (!open_.count(step.iter_id)) {
+            printf("%s 열려 있지 않은 반복자: %u\n", get_timestamp().c_str(), step.iter_id);
+            return false;
+        }
+        return pack(step.iter_id, step.max_bytes, page);
+    }
+    return false;
+}
+
+bool StateIterators::fetch(uint32_t id, cursor* c)
+{
+    state_page next;
+    if (!state_->next_page(id, fetch_size_, &next)) return false;
+    proxy_metrics().add("iterator_fetches", 1);
+    proxy_metrics().add("iterator_entries", next.entries.size());
+    c->buffered.insert(c->buffered.end(), next.entries.begin(), next.entries.end());
+    c->more = next.has_more && !next.entries.empty();   /* 빈 페이지로 계속 돌지 않게 */
+    return true;
+}
+
+void StateIterators::prefetch()
+{
+    for (std::map<uint32_t, cursor>::iterator it = open_.begin(); it != open_.end(); ++it) {
+        cursor& c = it->second;
+        // 실패하면 다음 answer가 다시 읽으면서 실패를 돌려준다
+        if (c.more && c.buffered.size() < fetch_size_ / 2) fetch(it->first, &c);
+    }
+}
+
+/* 받아 둔 항목을 max_bytes 안에서 [u32 klen][key][u32 vlen][value]로 page->data에 잇는다. 끝났으면 반복자를 잊는다 */
+bool StateIterators::pack(uint32_t id, uint32_t max_bytes, struct iter_reply* page)
+{
+    cursor& c = open_[id];
+    uint8_t* out = page->data;
+    size_t used = 0;
+    uint32_t count = 0;
+    max_bytes = std::min(max_bytes, (uint32_t)ITER_PAGE_BYTES);
+    for (;;) {
+        if (c.buffered.empty()) {
+            if (!c.more) break;
+            if (!fetch(id, &c)) return false;
+            continue;
+        }
+        const std::pair<std::string, std::string>& kv = c.buffered.front();
+        size_t size = 8 + kv.first.size() + kv.second.size();
+        if (used + size > max_bytes) {
+            if (count == 0) {
+                printf("%s 반복자 항목이 페이지보다 큼: key='%s' (%zu bytes, 페이지 %u bytes)\n",
+                       get_timestamp().c_str(), kv.first.c_str(), size, max_bytes);
+                return false;
+            }
+            break;
+        }
+        out = put_u32(out, (uint32_t)kv.first.size());
+        memcpy(out, kv.first.data(), kv.first.size());
+        out += kv.first.size();
+        out = put_u32(out, (uint32_t)kv.second.size());
+        memcpy(out, kv.second.data(), kv.second.size());
+        out += kv.second.size();
+        used += size;
+        c.buffered.pop_front();
+        count++;
+    }
+
+    struct iter_page_header* header = &page->header;
+    memset(header, 0, sizeof(*header));
+    header->iter_id = id;
+    header->count = count;
+    header->has_more = !c.buffered.empty() || c.more;
+    header->used = (uint32_t)used;
+    if (!header->has_more) open_.erase(id);
+
+    proxy_metrics().add("iterator_pages", 1);
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef STATE_ITERATORS_H
+#define STATE_ITERATORS_H
+
+#include <stdint.h>
+#include <deque>
+#include <map>
+#include <string>
+
+#include "tee_session.h"
+
+struct iter_reply;
+
+/*
+ * 트랜잭션 하나가 연 범위/부분 복합 키/이력 반복자들. 래퍼에서는 fetch_size개씩 받아 두고
+ * TA에는 WASM 버퍼에 맞게 max_bytes 이하의 페이지(struct iter_reply)로 잘라 넘긴다.
+ * prefetch()는 TA가 앞 페이지를 처리하는 동안 다음 묶음을 미리 받아 둔다.
+ * 반복자 번호는 이 트랜잭션 안에서만 쓰이고, 남은 반복자는 래퍼가 호출이 끝날 때 닫는다.
+ */
+class StateIterators {
+public:
+    static const uint32_t DEFAULT_FETCH_SIZE = 100;
+
+    explicit StateIterators(StateBackend* state, uint32_t fetch_size = DEFAULT_FETCH_SIZE)
+        : state_(state), fetch_size_(fetch_size), next_id_(0) {}
+
+    /* ITER_OPEN_REQUEST / ITER_NEXT_REQUEST에 대한 페이지를 page(슬롯 메일박스)에 쓴다 (상태를 못 읽으면 false) */
+    bool answer(const tx_step& step, struct iter_reply* page);
+    /* 받아 둔 것이 적은 반복자의 다음 묶음을 읽는다 (TEE 실행과 겹쳐 부른다) */
+    void prefetch();
+
+private:
+    struct cursor {
+        cursor() : more(false) {}
+        std::deque<std::pair<std::string, std::string> > buffered;
+        bool more;      /* 래퍼에 아직 남은 항목이 있음 */
+    };
+
+    bool fetch(uint32_t id, cursor* c);
+    bool pack(uint32_t id, uint32_t max_bytes, struct iter_reply* page);
+
+    StateBackend* state_;
+    const uint32_t fetch_size_;
+    uint32_t next_id_;
+    std::map<uint32_t, cursor> open_;
+};
+
+#endif /* STATE_ITERATORS_H */
@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "stream_state.h"
+
+using invocation::ChaincodeProxyMessage;
+using invocation::ChaincodeWrapperMessage;
+using invocation::GetStateRequest;
+using invocation::GetStateResponse;
+using invocation::IteratorPage;
+using invocation::KeyValue;
+using invocation::NextPageRequest;
+using invocation::OpenIteratorRequest;
+using invocation::PutStateRequest;
+using invocation::ValidateReadsRequest;
+using invocation::ValidateReadsResponse;
+
+StreamStateBackend::StreamStateBackend(TransactionStream* stream)
+    : stream_(stream), arena_(arena_options(arena_block_, sizeof(arena_block_))),
+      get_msg_(google::protobuf::Arena::CreateMessage<ChaincodeProxyMessage>(&arena_)),
+      put_msg_(google::protobuf::Arena::CreateMessage<ChaincodeProxyMessage>(&arena_)),
+      get_reply_(google::protobuf::Arena::CreateMessage<ChaincodeWrapperMessage>(&arena_)),
+      put_reply_(google::protobuf::Arena::CreateMessage<ChaincodeWrapperMessage>(&arena_)),
+      iter_msg_(google::protobuf::Arena::CreateMessage<ChaincodeProxyMessage>(&arena_)),
+      next_msg_(google::protobuf::Arena::CreateMessage<ChaincodeProxyMessage>(&arena_)),
+      page_reply_(google::protobuf::Arena::CreateMessage<ChaincodeWrapperMessage>(&arena_))
+{
+    // oneof를 미리 정해 두면 이후 호출은 필드 값만 바꾼다
+    get_msg_->mutable_get_state_request();
+    put_msg_->mutable_put_state_request();
+    iter_msg_->mutable_open_iterator_request();
+    next_msg_->mutable_next_page_request();
+}
+
+google::protobuf::ArenaOptions StreamStateBackend::arena_options(char* block, size_t size)
+{
+    google::protobuf::ArenaOptions options;
+    options.initial_block = block;
+    options.initial_block_size = size;
+    return options;
+}
+
+bool StreamStateBackend::get_state(const std::string& key, std::string* value)
+{
+    std::string version;
+    return get_versioned(key, value, &version);
+}
+
+bool StreamStateBackend::get_versioned(const std::string& key, std::string* value, std::string* version)
+{
+    const GetStateResponse* response = request_state(key);
+    if (!response) return false;
+    value->assign(response->value());
+    version->assign(response->version());
+    return true;
+}
+
+bool StreamStateBackend::get_state_into(const std::string& key, char* buf, size_t size, size_t* length,
+                                        std::string* version)
+{
+    const GetStateResponse* response = request_state(key);
+    if (!response) return false;
+    *length = response->value().length();
+    if (*length < size) memcpy(buf, response->value().data(), *length);
+    if (version) version->assign(response->version());
+    return true;
+}
+
+bool StreamStateBackend::get_states(const std::vector<std::string>& keys, std::vector<std::string>* values,
+                                    std::vector<std::string>* versions)
+{
+    values->assign(keys.size(), std::string());
+    if (versions) versions->assign(keys.size(), std::string());
+    std::string version;
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (!get_versioned(keys[i], &(*values)[i], &version)) return false;
+        if (versions) (*versions)[i] = version;
+    }
+    return true;
+}
+
+bool StreamStateBackend::validate_reads(const std::map<std::string, std::string>& reads,
+                                        std::vector<std::string>* stale)
+{
+    ChaincodeProxyMessage proxy_msg;
+    ValidateReadsRequest* request = proxy_msg.mutable_validate_reads_request();
+    for (std::map<std::string, std::string>::const_iterator it = reads.begin(); it != reads.end(); ++it) {
+        KeyValue* kv = request->add_reads();
+        kv->set_key(it->first);
+        kv->set_version(it->second);
+    }
+    if (!stream_->Write(proxy_msg)) {
+        printf("Failed to send VALIDATE_READS_REQUEST to chaincode_wrapper\n");
+        return false;
+    }
+
+    ChaincodeWrapperMessage wrapper_msg;
+    if (!stream_->Read(&wrapper_msg) || !wrapper_msg.has_validate_reads_response()) return false;
+    const ValidateReadsResponse& response = wrapper_msg.validate_reads_response();
+    stale->assign(response.stale_keys().begin(), response.stale_keys().end());
+    return true;
+}
+
+bool StreamStateBackend::put_state(const std::string& key, const std::string& value, std::string* ack)
+{
+    // Forward PUT_STATE to chaincode_wrapper
+    PutStateRequest* request = put_msg_->mutable_put_state_request();
+    request->set_key(key);
+    request->set_value(value);
+    if (!stream_->Write(*put_msg_)) {
+        printf("Failed to send PUT_STATE_REQUEST to chaincode_wrapper\n");
+        return false;
+    }
+
+    // Wait for acknowledgement from chaincode_wrapper
+    if (!stream_->Read(put_reply_)) return false;
+    ack->assign(put_reply_->put_state_response().acknowledgement());
+    return true;
+}
+
+bool StreamStateBackend::open_iterator(uint32_t id, const iterator_query& query, uint32_t page_size,
+                                       state_page* page)
+{
+    OpenIteratorRequest* request = iter_msg_->mutable_open_iterator_request();
+    request->set_iterator_id(id);
+    request->set_kind((OpenIteratorRequest::Kind)query.kind);
+    request->set_start_key(query.start_key);
+    request->set_end_key(query.end_key);
+    request->clear_attributes();
+    for (size_t i = 0; i < query.attributes.size(); i++) request->add_attributes(query.attributes[i]);
+    request->set_page_size(page_size);
+    if (!stream_->Write(*iter_msg_)) {
+        printf("Failed to send OPEN_ITERATOR_REQUEST to chaincode_wrapper\n");
+        return false;
+    }
+    return read_page(id, page);
+}
+
+bool StreamStateBackend::next_page(uint32_t id, uint32_t page_size, state_page* page)
+{
+    NextPageRequest* request = next_msg_->mutable_next_page_request();
+    request->set_iterator_id(id);
+    request->set_page_size(page_size);
+    if (!stream_->Write(*next_msg_)) {
+        printf("Failed to send NEXT_PAGE_REQUEST to chaincode_wrapper\n");
+        return false;
+    }
+    return read_page(id, page);
+}
+
+const GetStateResponse* StreamStateBackend::request_state(const std::string& key)
+{
+    // Forward GET_STATE to chaincode_wrapper
+    get_msg_->mutable_get_state_request()->set_key(key);
+    if (!stream_->Write(*get_msg_)) {
+        printf("Failed to send GET_STATE_REQUEST to chaincode_wrapper\n");
+        return NULL;
+    }
+
+    // Wait for response from chaincode_wrapper
+    if (!stream_->Read(get_reply_)) return NULL;
+    return &get_reply_->get_state_response();
+}
+
+bool StreamStateBackend::read_page(uint32_t id, state_page* page)
+{
+    if (!stream_->Read(page_reply_) || !page_reply_->has_iterator_page()) return false;
+    const IteratorPage& reply = page_reply_->iterator_page();
+    if (reply.iterator_id() != id) return false;
+    page->entries.clear();
+    for (int i = 0; i < reply.entries_size(); i++)
+        page->entries.push_back(std::make_pair(reply.entries(i).key(), reply.entries(i).value()));
+    page->has_more = reply.has_more();
+    return true;
+}
@@ -0,0 +1,65 @@
+#ifndef STREAM_STATE_H
+#define STREAM_STATE_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <grpcpp/grpcpp.h>
+#include "invocation.grpc.pb.h"
+
+#include "tee_session.h"
+
+/* Execute RPC의 양방향 스트림 (테스트는 루프백으로 바꿔 끼운다) */
+typedef grpc::ServerReaderWriterInterface<invocation::ChaincodeProxyMessage, invocation::ChaincodeWrapperMessage>
+    TransactionStream;
+
+/*
+ * GET/PUT 호스트콜을 chaincode_wrapper 스트림으로 전달.
+ * 트랜잭션(스트림)마다 Arena 하나에 요청/응답 메시지를 호스트콜 종류별로 한 번만 만들어 재사용한다.
+ * oneof는 종류가 바뀔 때마다 하위 메시지를 새로 만들므로 요청은 종류별로 따로 두고 필드 값만 바꾼다.
+ * 응답은 gRPC가 Clear 후 같은 메시지에 파싱하므로 하위 메시지와 값은 Arena에 다시 만들어진다
+ * (호스트콜이 많아 첫 블록을 다 쓰면 Arena가 블록을 더 잡는다). GET 값은 get_state_into로 TA 메일박스에
+ * 바로 복사한다. 호스트콜마다 힙 할당이 없는지는 test/hostcall_alloc_test.cpp가 확인한다.
+ */
+class StreamStateBackend : public StateBackend {
+public:
+    explicit StreamStateBackend(TransactionStream* stream);
+
+    bool get_state(const std::string& key, std::string* value) override;
+    bool get_versioned(const std::string& key, std::string* value, std::string* version) override;
+    /* 값은 파싱된 응답에서 호출한 쪽 버퍼(TA 메일박스)로 바로 복사한다 */
+    bool get_state_into(const std::string& key, char* buf, size_t size, size_t* length,
+                        std::string* version = NULL) override;
+    /* 키마다 GET_STATE를 보내고 래퍼가 알려준 버전도 담는다 (상태 캐시용) */
+    bool get_states(const std::vector<std::string>& keys, std::vector<std::string>* values,
+                    std::vector<std::string>* versions = NULL) override;
+    /* 캐시에서 내준 읽기를 래퍼에 한 번에 확인받는다. stale에 버전이 달라진 키 */
+    bool validate_reads(const std::map<std::string, std::string>& reads, std::vector<std::string>* stale);
+    bool put_state(const std::string& key, const std::string& value, std::string* ack) override;
+    bool open_iterator(uint32_t id, const iterator_query& query, uint32_t page_size, state_page* page) override;
+    bool next_page(uint32_t id, uint32_t page_size, state_page* page) override;
+
+private:
+    /* 트랜잭션 대부분의 메시지가 들어가는 첫 블록은 스택(이 객체)에 둔다 */
+    static const size_t ARENA_INITIAL_BLOCK = 4096;
+
+    static google::protobuf::ArenaOptions arena_options(char* block, size_t size);
+
+    /* GET_STATE를 보내고 응답을 기다린다 (응답은 다음 GET까지 get_reply_에 남는다) */
+    const invocation::GetStateResponse* request_state(const std::string& key);
+    bool read_page(uint32_t id, state_page* page);
+
+    TransactionStream* stream_;
+    char arena_block_[ARENA_INITIAL_BLOCK];
+    google::protobuf::Arena arena_;
+    invocation::ChaincodeProxyMessage* get_msg_;
+    invocation::ChaincodeProxyMessage* put_msg_;
+    invocation::ChaincodeWrapperMessage* get_reply_;
+    invocation::ChaincodeWrapperMessage* put_reply_;
+    invocation::ChaincodeProxyMessage* iter_msg_;
+    invocation::ChaincodeProxyMessage* next_msg_;
+    invocation::ChaincodeWrapperMessage* page_reply_;
+};
+
+#endif /* STREAM_STATE_H */
@@ -0,0 +1,1267 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// GlobalPlatfrom TA
+#include <wamr_ta.h>
+#include "chaincode_tee_ree_communication.h"
+
+#include "log_drain.h"
+#include "proxy_metrics.h"
+#include "state_iterators.h"
+#include "tee_session.h"
+
+/* 트랜잭션 단위 상세 로그 (벤치마크에서는 ctx->quiet로 끈다) */
+#define TX_LOG(ctx, ...) do { if (!(ctx)->quiet) printf(__VA_ARGS__); } while (0)
+
+/*
+ * step_buffer 배치: 슬롯 칸 TA_TX_SLOTS개(ITER 페이지까지 들어가는 크기) 뒤에 워커 칸 하나.
+ * 워커 칸은 워커 스레드만 쓰며 시작 메일박스 또는 COMMAND_MULTI_STEP 레코드 배열이 된다
+ */
+#define STEP_SLOT_BYTES (sizeof(struct iter_reply) > sizeof(union step_mailbox) ? \
+                         sizeof(struct iter_reply) : sizeof(union step_mailbox))
+#define STEP_WORKER_BYTES (TA_TX_SLOTS * sizeof(struct step_record) > sizeof(union step_mailbox) ? \
+                           TA_TX_SLOTS * sizeof(struct step_record) : sizeof(union step_mailbox))
+static const size_t STEP_SLOT_SIZE = (STEP_SLOT_BYTES + 63) & ~(size_t)63;
+static const size_t STEP_WORKER_OFFSET = TA_TX_SLOTS * STEP_SLOT_SIZE;
+
+static step_mailbox* slot_mailbox(tee_ctx* ctx, uint32_t slot)
+{
+    return (step_mailbox*)(ctx->step_buffer + slot * STEP_SLOT_SIZE);
+}
+
+/*
+ * 세션의 체인코드 로그 링을 공유 메모리로 잡아 수집 스레드에 넘긴다. 실행 명령의 params[3]가
+ * 이 메모리를 가리키므로 TA는 TEE를 나가지 않고 로그를 쓴다. 실패하면 링 없이 output_buffer를 쓴다
+ */
+static void open_log_ring(tee_ctx* ctx, const TEEC_UUID& uuid)
+{
+	ctx->has_log_shm = false;
+	memset(&ctx->log_shm, 0, sizeof(ctx->log_shm));
+	ctx->log_shm.size = sizeof(struct log_ring) + LOG_STDOUT_SIZE;
+	ctx->log_shm.flags = TEEC_MEM_INPUT | TEEC_MEM_OUTPUT;
+	TEEC_Result res = TEEC_AllocateSharedMemory(&ctx->ctx, &ctx->log_shm);
+	if (res != TEEC_SUCCESS) {
+		printf("%s 로그 링 할당 실패, 체인코드 로그 없이 진행 res=0x%x\n", get_timestamp().c_str(), res);
+		return;
+	}
+	memset(ctx->log_shm.buffer, 0, ctx->log_shm.size);
+	struct log_ring* ring = (struct log_ring*)ctx->log_shm.buffer;
+	ring->magic = LOG_RING_MAGIC;
+	ctx->has_log_shm = true;
+	chaincode_log_drain().add(ring, uuid_to_string(uuid));
+}
+
+/*
+ * 단계 메일박스(step_buffer)를 이 세션의 공유 메모리로 등록한다. 실행 명령의 params[2]가 그 안을
+ * 가리키므로 호출마다 클라이언트 라이브러리가 임시 공유 메모리를 잡아 복사하지 않는다.
+ * 실패하면 TEMP memref로 넘긴다
+ */
+static void register_step_buffer(tee_ctx* ctx)
+{
+	ctx->has_step_shm = false;
+	if (!ctx->step_buffer) return;
+	memset(&ctx->step_shm, 0, sizeof(ctx->step_shm));
+	ctx->step_shm.buffer = ctx->step_buffer;
+	ctx->step_shm.size = ctx->step_buffer_size;
+	ctx->step_shm.flags = TEEC_MEM_INPUT | TEEC_MEM_OUTPUT;
+	TEEC_Result res = TEEC_RegisterSharedMemory(&ctx->ctx, &ctx->step_shm);
+	if (res != TEEC_SUCCESS) {
+		printf("%s 단계 메일박스 등록 실패, 임시 메모리로 진행 res=0x%x\n", get_timestamp().c_str(), res);
+		return;
+	}
+	ctx->has_step_shm = true;
+}
+
+TEEC_Result open_tee_session(tee_ctx* ctx, const TEEC_UUID& uuid)
+{
+	uint32_t origin;
+	TEEC_Result res;
+
+	/* Initialize a context connecting us to the TEE */
+	printf("%s TEE context 초기화 시작\n", get_timestamp().c_str());
+	res = TEEC_InitializeContext(NULL, &ctx->ctx);
+	if (res != TEEC_SUCCESS) {
+		fprintf(stderr, "TEEC_InitializeContext failed with code 0x%x\n", res);
+		return res;
+	}
+	printf("%s TEE context 초기화 완료\n", get_timestamp().c_str());
+
+	/* Open a session with the TA */
+	printf("%s TEE session 오픈 시작 (TA %s)\n", get_timestamp().c_str(), uuid_to_string(uuid).c_str());
+	res = TEEC_OpenSession(&ctx->ctx, &ctx->sess, &uuid,
+			       TEEC_LOGIN_PUBLIC, NULL, NULL, &origin);
+	if (res != TEEC_SUCCESS) {
+		fprintf(stderr, "TEEC_OpenSession failed with code 0x%x origin 0x%x\n", res, origin);
+		TEEC_FinalizeContext(&ctx->ctx);
+		return res;
+	}
+	printf("%s TEE session 오픈 완료\n", get_timestamp().c_str());
+	open_log_ring(ctx, uuid);
+	register_step_buffer(ctx);
+	return TEEC_SUCCESS;
+}
+
+void prepare_tee_session(tee_ctx* ctx, const TEEC_UUID* uuid)
+{
+	static const TEEC_UUID default_uuid = TA_WAMR_UUID;
+	if (open_tee_session(ctx, uuid ? *uuid : default_uuid) != TEEC_SUCCESS) exit(1);
+}
+
+bool uuid_from_bytes(const std::string& bytes, TEEC_UUID* uuid)
+{
+	if (bytes.size() != 16) return false;
+	// RFC 4122 바이트 순서 (big-endian). 부호 확장을 피하려고 uint8_t로 읽는다
+	const uint8_t* b = (const uint8_t*)bytes.data();
+	uuid->timeLow = ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+	uuid->timeMid = (uint16_t)((b[4] << 8) | b[5]);
+	uuid->timeHiAndVersion = (uint16_t)((b[6] << 8) | b[7]);
+	memcpy(uuid->clockSeqAndNode, b + 8, 8);
+	return true;
+}
+
+std::string uuid_to_string(const TEEC_UUID& uuid)
+{
+	char s[37];
+	snprintf(s, sizeof(s), "%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+		 uuid.timeLow, uuid.timeMid, uuid.timeHiAndVersion,
+		 uuid.clockSeqAndNode[0], uuid.clockSeqAndNode[1], uuid.clockSeqAndNode[2], uuid.clockSeqAndNode[3],
+		 uuid.clockSeqAndNode[4], uuid.clockSeqAndNode[5], uuid.clockSeqAndNode[6], uuid.clockSeqAndNode[7]);
+	return s;
+}
+
+void configure_heap_size(tee_ctx *ctx, uint32_t size) {
+    TEEC_Operation op;
+	uint32_t origin;
+	TEEC_Result res;
+
+    memset(&op, 0, sizeof(op));
+	op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE, TEEC_NONE, TEEC_NONE);
+	op.params[0].value.a = size;
+
+	printf("%s WaTZ heap 크기 설정 시작 (%u bytes)\n", get_timestamp().c_str(), size);
+	res = TEEC_InvokeCommand(&ctx->sess, COMMAND_CONFIGURE_HEAP, &op, &origin);
+    if (res != TEEC_SUCCESS) {
+        printf("%s WaTZ heap 크기 설정 실패. Error: %x\n", get_timestamp().c_str(), res);
+    } else {
+        printf("%s WaTZ heap 크기 설정 완료\n", get_timestamp().c_str());
+    }
+}
+
+void configure_fuel_limit(tee_ctx *ctx, uint64_t limit)
+{
+    TEEC_Operation op;
+    uint32_t origin;
+
+    memset(&op, 0, sizeof(op));
+    op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE, TEEC_NONE, TEEC_NONE);
+    op.params[0].value.a = (uint32_t)limit;
+    op.params[0].value.b = (uint32_t)(limit >> 32);
+    TEEC_Result res = TEEC_InvokeCommand(&ctx->sess, COMMAND_CONFIGURE_FUEL, &op, &origin);
+    if (res != TEEC_SUCCESS) {
+        printf("%s 연료 한도 설정 실패. Error: %x\n", get_timestamp().c_str(), res);
+    }
+}
+
+void allocate_buffers(tee_ctx* ctx, uint64_t buffers_size) {
+    printf("%s 버퍼 할당 시작 (%lu bytes)\n", get_timestamp().c_str(), buffers_size);
+    // The output buffer is used to capture writes to stdout from the WASM
+    ctx->output_buffer = (uint8_t*)malloc(buffers_size);
+    ctx->output_buffer_size = buffers_size;
+
+    // The benchmark buffer is used to capture benchmark information from the TA
+    ctx->benchmark_buffer = (uint8_t*)malloc(buffers_size);
+    ctx->benchmark_buffer_size = buffers_size;
+
+    // 단계 메일박스는 세션을 열 때마다 등록하고 세션 재시작과 무관하게 free_buffers까지 둔다
+    ctx->step_buffer_size = STEP_WORKER_OFFSET + STEP_WORKER_BYTES;
+    ctx->step_buffer = (uint8_t*)calloc(1, ctx->step_buffer_size);
+    ctx->has_step_shm = false;
+    ctx->quiet = false;
+    ctx->needs_restart = false;
+    ctx->has_batch_shm = false;
+    ctx->has_log_shm = false;
+    printf("%s 버퍼 할당 완료\n", get_timestamp().c_str());
+}
+
+void terminate_tee_session(tee_ctx* ctx)
+{
+	printf("%s TEE 세션 종료 시작\n", get_timestamp().c_str());
+	if (ctx->has_batch_shm) {
+		TEEC_ReleaseSharedMemory(&ctx->batch_shm);
+		ctx->has_batch_shm = false;
+	}
+	if (ctx->has_log_shm) {
+		// 남은 로그를 읽고 수집 스레드에서 뺀 뒤에 해제한다
+		chaincode_log_drain().remove((struct log_ring*)ctx->log_shm.buffer);
+		TEEC_ReleaseSharedMemory(&ctx->log_shm);
+		ctx->has_log_shm = false;
+	}
+	if (ctx->has_step_shm) {
+		TEEC_ReleaseSharedMemory(&ctx->step_shm);
+		ctx->has_step_shm = false;
+	}
+	TEEC_CloseSession(&ctx->sess);
+	TEEC_FinalizeContext(&ctx->ctx);
+	printf("%s TEE 세션 종료 완료\n", get_timestamp().c_str());
+}
+
+void free_buffers(tee_ctx* ctx) {
+    ctx->output_buffer_size = 0;
+    ctx->benchmark_buffer_size = 0;
+    ctx->step_buffer_size = 0;
+    free(ctx->output_buffer);
+    free(ctx->benchmark_buffer);
+    free(ctx->step_buffer);
+    ctx->step_buffer = NULL;
+}
+
+/*
+ * AOT 파일을 TEEC 공유 메모리로 바로 읽는다.
+ * TEEC_MEMREF_TEMP_* 를 쓰면 클라이언트 라이브러리가 한 번 더 복사(bounce)하므로
+ * 디스크 → 공유 메모리 → TA 신뢰 사본 한 번의 복사로 끝나도록 한다.
+ * 반환값은 파일 크기이며, 실패 시 -1 (shm은 호출자가 TEEC_ReleaseSharedMemory로 해제)
+ */
+long read_module_into_shm(tee_ctx* ctx, const std::string& path, TEEC_SharedMemory* shm)
+{
+    FILE* wasm_file = fopen(path.c_str(), "rb");
+    if (!wasm_file) {
+        printf("%s Error: AOT 파일 열기 실패: %s\n", get_timestamp().c_str(), path.c_str());
+        return -1;
+    }
+
+    fseek(wasm_file, 0, SEEK_END);
+    long wasm_file_length = ftell(wasm_file);
+    rewind(wasm_file);
+    if (wasm_file_length <= 0) {
+        printf("%s Error: 빈 모듈 파일: %s\n", get_timestamp().c_str(), path.c_str());
+        fclose(wasm_file);
+        return -1;
+    }
+
+    memset(shm, 0, sizeof(*shm));
+    shm->size = wasm_file_length;
+    shm->flags = TEEC_MEM_INPUT;
+    TEEC_Result res = TEEC_AllocateSharedMemory(&ctx->ctx, shm);
+    if (res != TEEC_SUCCESS) {
+        printf("%s Error: 공유 메모리 할당 실패 (%ld bytes) res=0x%x\n", get_timestamp().c_str(), wasm_file_length, res);
+        fclose(wasm_file);
+        return -1;
+    }
+
+    size_t read = fread(shm->buffer, 1, wasm_file_length, wasm_file);
+    fclose(wasm_file);
+    if ((long)read != wasm_file_length) {
+        printf("%s Error: AOT 파일 읽기 실패: %s\n", get_timestamp().c_str(), path.c_str());
+        TEEC_ReleaseSharedMemory(shm);
+        return -1;
+    }
+    return wasm_file_length;
+}
+
+static bool valid_module_id(const std::string& module_id)
+{
+    if (module_id.empty() || module_id.length() >= MODULE_ID_SIZE) {
+        printf("%s Error: 잘못된 모듈 id: '%s'\n", get_timestamp().c_str(), module_id.c_str());
+        return false;
+    }
+    return true;
+}
+
+/* 체인코드 Makefile(sign_module.sh)이 만든 설치 서명 (RSA, 바이너리) */
+static bool read_signature(const std::string& path, std::vector<uint8_t>* signature)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        printf("%s Error: 모듈 서명 없음: %s (체인코드 Makefile로 서명)\n", get_timestamp().c_str(), path.c_str());
+        return false;
+    }
+    signature->resize(MODULE_SIGNATURE_MAX + 1);
+    size_t n = fread(&(*signature)[0], 1, signature->size(), f);
+    fclose(f);
+    if (n == 0 || n > MODULE_SIGNATURE_MAX) {
+        printf("%s Error: 잘못된 모듈 서명: %s (%zu Bytes)\n", get_timestamp().c_str(), path.c_str(), n);
+        return false;
+    }
+    signature->resize(n);
+    return true;
+}
+
+/* 프록시는 ./chaincode/에서 몰래 설치하지 않는다: 배포는 --deploy나 예열 목록(서명 확인)으로만 */
+static void report_not_installed(const std::string& module_id)
+{
+    printf("%s 설치되지 않은 모듈: %s (--deploy 또는 예열 목록으로 설치)\n", get_timestamp().c_str(), module_id.c_str());
+}
+
+/* 설치 실패 중 운영자가 고쳐야 하는 경우를 알린다 */
+static void report_install_error(const std::string& module_id, TEEC_Result res)
+{
+    if (res == TEEC_ERROR_SECURITY)
+        printf("%s 모듈 서명이 TA의 공개 키와 맞지 않음: %s\n", get_timestamp().c_str(), module_id.c_str());
+    else if (res == TEEC_ERROR_ACCESS_CONFLICT)
+        printf("%s 다른 이미지로 이미 설치된 id: %s (교체하려면 REPLACE=1로 서명하고 --deploy --replace)\n",
+               get_timestamp().c_str(), module_id.c_str());
+    else if (res == TEEC_ERROR_NOT_SUPPORTED)
+        printf("%s TA에 WASM 인터프리터가 없어 .wasm을 실행할 수 없음: %s (TA를 INTERP=1로 빌드하거나 AOT로 배포)\n",
+               get_timestamp().c_str(), module_id.c_str());
+}
+
+/*
+ * 한 번의 공유 메모리 전송으로 보내기에 큰 모듈은 이 크기 단위로 나눠 올린다.
+ * 두 개의 조각 버퍼를 번갈아 써서 TA가 한 조각을 복사하는 동안 다음 조각을 디스크에서 읽는다.
+ */
+static const long MODULE_UPLOAD_CHUNK_SIZE = 256 * 1024;
+
+static TEEC_Result upload_module_chunked(tee_ctx* ctx, const std::string& module_id, const std::string& aot_path,
+                                         const std::vector<uint8_t>& signature, bool replace)
+{
+    TEEC_Operation op;
+    TEEC_SharedMemory chunk_shm[2];
+    uint32_t origin;
+    TEEC_Result res;
+
+    FILE* f = fopen(aot_path.c_str(), "rb");
+    if (!f) {
+        printf("%s Error: AOT 파일 열기 실패: %s\n", get_timestamp().c_str(), aot_path.c_str());
+        return TEEC_ERROR_ITEM_NOT_FOUND;
+    }
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    rewind(f);
+
+    int allocated = 0;
+    for (; allocated < 2; allocated++) {
+        memset(&chunk_shm[allocated], 0, sizeof(TEEC_SharedMemory));
+        chunk_shm[allocated].size = MODULE_UPLOAD_CHUNK_SIZE;
+        chunk_shm[allocated].flags = TEEC_MEM_INPUT;
+        res = TEEC_AllocateSharedMemory(&ctx->ctx, &chunk_shm[allocated]);
+        if (res != TEEC_SUCCESS) {
+            printf("%s Error: 조각 버퍼 할당 실패 res=0x%x\n", get_timestamp().c_str(), res);
+            goto out;
+        }
+    }
+
+    memset(&op, 0, sizeof(op));
+    op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT, TEEC_VALUE_INPUT, TEEC_NONE, TEEC_NONE);
+    op.params[0].tmpref.buffer = (void*)module_id.c_str();
+    op.params[0].tmpref.size = module_id.length();
+    op.params[1].value.a = (uint32_t)length;
+    res = TEEC_InvokeCommand(&ctx->sess, COMMAND_UPLOAD_BEGIN, &op, &origin);
+    if (res != TEEC_SUCCESS) {
+        printf("%s 분할 업로드 시작 실패 res=0x%x origin=0x%x\n", get_timestamp().c_str(), res, origin);
+        goto out;
+    }
+
+    {
+        long offset = 0;
+        int cur = 0;
+        size_t cur_len = fread(chunk_shm[0].buffer, 1, std::min(length, MODULE_UPLOAD_CHUNK_SIZE), f);
+
+        while (offset < length) {
+            long next_offset = offset + (long)cur_len;
+            size_t next_len = 0;
+            if (cur_len == 0) {
+                printf("%s Error: AOT 파일 읽기 실패: %s\n", get_timestamp().c_str(), aot_path.c_str());
+                res = TEEC_ERROR_GENERIC;
+                goto out;
+            }
+
+            // TA가 현재 조각을 복사/해시하는 동안 다음 조각을 다른 버퍼로 읽어 둔다
+            std::thread reader;
+            if (next_offset < length) {
+                void* next_buf = chunk_shm[cur ^ 1].buffer;
+                size_t want = std::min(length - next_offset, MODULE_UPLOAD_CHUNK_SIZE);
+                reader = std::thread([f, next_buf, want, &next_len] {
+                    next_len = fread(next_buf, 1, want, f);
+                });
+            }
+
+            memset(&op, 0, sizeof(op));
+            op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_PARTIAL_INPUT, TEEC_VALUE_INPUT, TEEC_NONE, TEEC_NONE);
+            op.params[0].memref.parent = &chunk_shm[cur];
+            op.params[0].memref.offset = 0;
+            op.params[0].memref.size = cur_len;
+            op.params[1].value.a = (uint32_t)offset;
+            res = TEEC_InvokeCommand(&ctx->sess, COMMAND_UPLOAD_CHUNK, &op, &origin);
+
+            if (reader.joinable()) reader.join();
+            if (res != TEEC_SUCCESS) {
+                printf("%s 조각 전송 실패 (offset %ld) res=0x%x origin=0x%x\n", get_timestamp().c_str(), offset, res, origin);
+                goto out;
+            }
+
+            offset = next_offset;
+            cur_len = next_len;
+            cur ^= 1;
+        }
+    }
+
+    memset(&op, 0, sizeof(op));
+    op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT, TEEC_VALUE_INPUT, TEEC_NONE, TEEC_NONE);
+    op.params[0].tmpref.buffer = (void*)&signature[0];
+    op.params[0].tmpref.size = signature.size();
+    op.params[1].value.a = replace ? INSTALL_FLAG_REPLACE : 0;
+    res = TEEC_InvokeCommand(&ctx->sess, COMMAND_UPLOAD_COMMIT, &op, &origin);
+    if (res != TEEC_SUCCESS) {
+        printf("%s 분할 업로드 커밋 실패 res=0x%x origin=0x%x\n", get_timestamp().c_str(), res, origin);
+        report_install_error(module_id, res);
+    } else {
+        printf("%s 모듈 설치 완료: %s (%ld Bytes, %ld Bytes 단위 분할 전송)\n", get_timestamp().c_str(),
+               module_id.c_str(), length, MODULE_UPLOAD_CHUNK_SIZE);
+    }
+
+out:
+    for (int i = 0; i < allocated; i++) TEEC_ReleaseSharedMemory(&chunk_shm[i]);
+    fclose(f);
+    return res;
+}
+
+std::string read_module_version(const std::string& aot_file)
+{
+    std::string aot_path = "./chaincode/" + aot_file;
+    struct stat st;
+    if (stat(aot_path.c_str(), &st) != 0) return "";
+
+    // .sha256은 버전 이름일 뿐이다. 이미지가 맞는지는 TA가 설치할 때 서명(.sig)으로 확인한다
+    char version[2 * MODULE_HASH_SIZE + 1] = {0};
+    FILE* f = fopen((aot_path + ".sha256").c_str(), "r");
+    if (f) {
+        if (fscanf(f, "%64s", version) != 1) version[0] = 0;
+        fclose(f);
+    }
+    return std::string(version, std::min(strlen(version), (size_t)16));
+}
+
+std::string versioned_module_id(const std::string& aot_file, const std::string& version)
+{
+    std::string module_id = aot_file + "@" + version;
+    return version.empty() || module_id.length() >= MODULE_ID_SIZE ? aot_file : module_id;
+}
+
+/*
+ * ./chaincode/<aot_file>을 TA 보안 저장소에 모듈 id로 설치한다.
+ * TA는 <aot_file>.sig 서명(모듈 id, 이미지 해시, replace)을 빌드할 때 넣은 공개 키로 확인하고,
+ * 다른 이미지로 이미 설치된 id는 replace까지 서명된 경우에만 바꾼다.
+ * 버전이 붙은 id면 파일이 아직 그 버전일 때만 설치한다 (그 사이 바뀌었으면 TEEC_ERROR_BAD_STATE).
+ * image_path로 준 파일은 내용 해시로 이름 붙인 캐시 파일이라 바뀌지 않으므로 버전을 확인하지 않는다.
+ * MODULE_UPLOAD_CHUNK_SIZE 보다 큰 모듈은 분할 업로드(begin/chunk/commit)로 보낸다.
+ */
+TEEC_Result install_module(tee_ctx* ctx, const std::string& module_id, const std::string& image_path,
+                           const std::string& signature_path, bool replace)
+{
+    TEEC_Operation op;
+    TEEC_SharedMemory shm;
+    uint32_t origin;
+    std::vector<uint8_t> signature;
+    size_t at = module_id.find('@');
+    std::string aot_path = image_path.empty() ? "./chaincode/" + module_id.substr(0, at) : image_path;
+
+    if (!valid_module_id(module_id)) return TEEC_ERROR_BAD_PARAMETERS;
+    if (image_path.empty() && at != std::string::npos &&
+        read_module_version(module_id.substr(0, at)) != module_id.substr(at + 1)) {
+        printf("%s 모듈 파일이 그 사이 바뀜, 설치하지 않음: %s\n", get_timestamp().c_str(), module_id.c_str());
+        return TEEC_ERROR_BAD_STATE;
+    }
+
+    if (!read_signature(signature_path.empty() ? aot_path + ".sig" : signature_path, &signature)) {
+        return TEEC_ERROR_SECURITY;
+    }
+
+    printf("%s 모듈 설치 시작: %s\n", get_timestamp().c_str(), aot_path.c_str());
+    FILE* f = fopen(aot_path.c_str(), "rb");
+    if (!f) {
+        printf("%s Error: AOT 파일 열기 실패: %s\n", get_timestamp().c_str(), aot_path.c_str());
+        return TEEC_ERROR_ITEM_NOT_FOUND;
+    }
+    fseek(f, 0, SEEK_END);
+    long file_length = ftell(f);
+    fclose(f);
+    if (file_length > MODULE_UPLOAD_CHUNK_SIZE) {
+        return upload_module_chunked(ctx, module_id, aot_path, signature, replace);
+    }
+
+    long length = read_module_into_shm(ctx, aot_path, &shm);
+    if (length < 0) return TEEC_ERROR_ITEM_NOT_FOUND;
+
+    memset(&op, 0, sizeof(op));
+    op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_PARTIAL_INPUT, TEEC_MEMREF_TEMP_INPUT, TEEC_MEMREF_TEMP_INPUT, TEEC_VALUE_INPUT);
+    op.params[0].memref.parent = &shm;
+    op.params[0].memref.offset = 0;
+    op.params[0].memref.size = length;
+    op.params[1].tmpref.buffer = (void*)module_id.c_str();
+    op.params[1].tmpref.size = module_id.length();
+    op.params[2].tmpref.buffer = &signature[0];
+    op.params[2].tmpref.size = signature.size();
+    op.params[3].value.a = replace ? INSTALL_FLAG_REPLACE : 0;
+
+    TEEC_Result res = TEEC_InvokeCommand(&ctx->sess, COMMAND_INSTALL_MODULE, &op, &origin);
+    TEEC_ReleaseSharedMemory(&shm);
+    if (res != TEEC_SUCCESS) {
+        printf("%s 모듈 설치 실패: %s res=0x%x origin=0x%x\n", get_timestamp().c_str(), module_id.c_str(), res, origin);
+        report_install_error(module_id, res);
+    } else {
+        printf("%s 모듈 설치 완료: %s (%ld Bytes)\n", get_timestamp().c_str(), module_id.c_str(), length);
+    }
+    return res;
+}
+
+/* TA가 응답에 붙인 연료 계량 결과 (flags와 64비트 사용량) */
+static tx_usage read_usage(uint32_t flags, uint32_t lo, uint32_t hi)
+{
+    tx_usage usage;
+    usage.metered = (flags & RESPONSE_FUEL_METERED) != 0;
+    usage.out_of_fuel = (flags & RESPONSE_OUT_OF_FUEL) != 0;
+    usage.fuel_used = ((uint64_t)hi << 32) | lo;
+    return usage;
+}
+
+/* RUN/RESUME 결과(요청 종류, 슬롯, 메일박스)를 tx_step으로 옮긴다 */
+static void read_step(uint32_t type, uint32_t slot, const step_mailbox* mb, tx_step* step)
+{
+    step->type = type;
+    step->slot = slot;
+    step->key.clear();
+    step->value.clear();
+    step->end_key.clear();
+    step->usage = tx_usage();
+    step->iter_kind = 0;
+    step->iter_id = 0;
+    step->max_bytes = 0;
+    switch (step->type) {
+        case INVOCATION_RESPONSE:
+            step->response.assign(mb->resp.execution_response, strnlen(mb->resp.execution_response, RESPONSE_SIZE));
+            step->usage = read_usage(mb->resp.flags, mb->resp.fuel_used_lo, mb->resp.fuel_used_hi);
+            break;
+        case GET_STATE_REQUEST:
+            step->key.assign(mb->kv.key, strnlen(mb->kv.key, KEY_SIZE));
+            break;
+        case PUT_STATE_REQUEST:
+            step->key.assign(mb->kv.key, strnlen(mb->kv.key, KEY_SIZE));
+            step->value.assign(mb->kv.value, strnlen(mb->kv.value, VAL_SIZE));
+            break;
+        case ITER_OPEN_REQUEST:
+        case ITER_NEXT_REQUEST:
+            step->iter_kind = mb->iter.kind;
+            step->iter_id = mb->iter.iter_id;
+            step->max_bytes = std::min(mb->iter.max_bytes, (uint32_t)ITER_PAGE_BYTES);
+            step->key.assign(mb->iter.start, strnlen(mb->iter.start, KEY_SIZE));
+            step->end_key.assign(mb->iter.end, strnlen(mb->iter.end, KEY_SIZE));
+            break;
+    }
+}
+
+static bool is_iter_step(const tx_step& step)
+{
+    return step.type == ITER_OPEN_REQUEST || step.type == ITER_NEXT_REQUEST;
+}
+
+/*
+ * TA가 죽었거나 드라이버와의 통신이 끊긴 경우에만 세션을 다시 열어야 한다.
+ * 취소(TEEC_ERROR_CANCEL)는 TA가 인스턴스만 정리했거나 TA에 들어가기 전에 끝난 것이다
+ */
+static void check_session(tee_ctx* ctx, TEEC_Result res, uint32_t origin)
+{
+    if (res == TEEC_ERROR_CANCEL) return;
+    if (res == TEEC_ERROR_TARGET_DEAD || (res != TEEC_SUCCESS && origin != TEEC_ORIGIN_TRUSTED_APP))
+        ctx->needs_restart = true;
+}
+
+bool tx_deadline::expired() const
+{
+    if (cancelled && cancelled()) return true;
+    return std::chrono::steady_clock::now() >= at;
+}
+
+uint32_t tx_deadline::budget_ms() const
+{
+    if (at == std::chrono::steady_clock::time_point::max()) return 0;
+    long long left = std::chrono::duration_cast<std::chrono::milliseconds>(at - std::chrono::steady_clock::now()).count();
+    if (left < 1) return 1;
+    return left > 0x7fffffff ? 0x7fffffff : (uint32_t)left;
+}
+
+namespace {
+
+/*
+ * TEE 진입 감시: 진입 중인 TEEC_Operation과 거기 실린 트랜잭션들의 마감을 등록해 두고,
+ * 모두 마감이 지나거나 취소되면 TEEC_RequestCancellation을 보낸다. 등록 해제는 같은 mutex를
+ * 잡으므로 취소 요청 중에 op가 사라지지 않는다.
+ * 항목은 진입하는 쪽의 스택에 있고 목록에는 포인터만 둔다 (호스트콜마다 힙 할당이 없다)
+ */
+class CancelWatchdog {
+public:
+    struct Entry {
+        TEEC_Operation* op;
+        const tx_deadline* const* deadlines;
+        size_t count;
+        bool requested;
+    };
+
+    static CancelWatchdog& instance() {
+        // 프로세스가 끝날 때까지 쓰므로 스레드와 함께 해제하지 않는다
+        static CancelWatchdog* watchdog = new CancelWatchdog();
+        return *watchdog;
+    }
+
+    void enter(Entry* e) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            e->requested = false;
+            entries_.push_back(e);
+        }
+        cv_.notify_one();
+    }
+
+    void leave(Entry* e) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.erase(std::find(entries_.begin(), entries_.end(), e));
+    }
+
+private:
+
+    CancelWatchdog() {
+        std::thread(&CancelWatchdog::run, this).detach();
+    }
+
+    void run() {
+        // 클라이언트 취소는 알림이 없으므로 이 간격으로 확인한다
+        const std::chrono::milliseconds poll(20);
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            if (entries_.empty()) {
+                cv_.wait(lock);
+                continue;
+            }
+            std::chrono::steady_clock::time_point wake = std::chrono::steady_clock::now() + poll;
+            for (size_t e = 0; e < entries_.size(); e++) {
+                Entry* it = entries_[e];
+                if (it->requested) continue;
+                bool all_expired = true;
+                std::chrono::steady_clock::time_point last = std::chrono::steady_clock::time_point::min();
+                for (size_t i = 0; i < it->count; i++) {
+                    if (!it->deadlines[i]->expired()) all_expired = false;
+                    last = std::max(last, it->deadlines[i]->at);
+                }
+                if (all_expired) {
+                    TEEC_RequestCancellation(it->op);
+                    it->requested = true;
+                    proxy_metrics().add("tee_cancel_requests", 1);
+                } else {
+                    wake = std::min(wake, last);
+                }
+            }
+            cv_.wait_until(lock, wake);
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<Entry*> entries_;   /* 지운 뒤에도 용량은 남아 다시 잡지 않는다 */
+};
+
+}
+
+/* 마감이 있는 트랜잭션을 실은 TEE 호출은 감시 아래에서 실행한다 (deadlines: count개) */
+static TEEC_Result invoke_with_deadlines(tee_ctx* ctx, uint32_t cmd, TEEC_Operation* op, uint32_t* origin,
+                                         const tx_deadline* const* deadlines, size_t count)
+{
+    bool watched = false;
+    for (size_t i = 0; i < count; i++) {
+        if (deadlines[i]->bounded()) watched = true;
+    }
+    if (!watched) return TEEC_InvokeCommand(&ctx->sess, cmd, op, origin);
+
+    // 모든 트랜잭션에 마감이 있어야 진입 전체를 취소할 수 있다 (마감 없는 것은 끝까지 기다림)
+    for (size_t i = 0; i < count; i++) {
+        if (!deadlines[i]->bounded()) return TEEC_InvokeCommand(&ctx->sess, cmd, op, origin);
+    }
+    op->started = 0;
+    CancelWatchdog::Entry entry;
+    entry.op = op;
+    entry.deadlines = deadlines;
+    entry.count = count;
+    CancelWatchdog::instance().enter(&entry);
+    TEEC_Result res = TEEC_InvokeCommand(&ctx->sess, cmd, op, origin);
+    CancelWatchdog::instance().leave(&entry);
+    return res;
+}
+
+static TEEC_Result invoke_with_deadline(tee_ctx* ctx, uint32_t cmd, TEEC_Operation* op, uint32_t* origin,
+                                        const tx_deadline* deadline)
+{
+    return invoke_with_deadlines(ctx, cmd, op, origin, &deadline, deadline ? 1 : 0);
+}
+
+/* 실행 명령의 params[3]: 로그 링 공유 메모리(있으면) 또는 stdout용 output_buffer. 파라미터 종류를 돌려준다 */
+static uint32_t set_output(tee_ctx* ctx, TEEC_Parameter* param)
+{
+    if (ctx->has_log_shm) {
+        param->memref.parent = &ctx->log_shm;
+        param->memref.offset = 0;
+        param->memref.size = ctx->log_shm.size;
+        return TEEC_MEMREF_PARTIAL_INOUT;
+    }
+    param->tmpref.buffer = ctx->output_buffer;
+    param->tmpref.size = ctx->output_buffer_size;
+    return TEEC_MEMREF_TEMP_INOUT;
+}
+
+/*
+ * 실행 명령의 params[2]: step_buffer의 offset부터 size 바이트. 등록된 공유 메모리면 PARTIAL로 넘겨
+ * 복사 없이 TA가 그대로 보고, 아니면 TEMP memref. 파라미터 종류를 돌려준다
+ */
+static uint32_t set_mailbox(tee_ctx* ctx, TEEC_Parameter* param, size_t offset, size_t size)
+{
+    if (ctx->has_step_shm) {
+        param->memref.parent = &ctx->step_shm;
+        param->memref.offset = offset;
+        param->memref.size = size;
+        return TEEC_MEMREF_PARTIAL_INOUT;
+    }
+    param->tmpref.buffer = ctx->step_buffer + offset;
+    param->tmpref.size = size;
+    return TEEC_MEMREF_TEMP_INOUT;
+}
+
+static void prepare_op(tee_ctx* ctx, TEEC_Operation* op, size_t offset, size_t size)
+{
+    memset(op, 0, sizeof(*op));
+    uint32_t output = set_output(ctx, &op->params[3]);
+    uint32_t mailbox = set_mailbox(ctx, &op->params[2], offset, size);
+    op->paramTypes = TEEC_PARAM_TYPES(TEEC_NONE, TEEC_VALUE_INOUT, mailbox, output);
+}
+
+void pack_arguments(const std::string& function_name, const std::vector<std::string>& args,
+                           struct arguments* out)
+{
+    memset(out, 0, sizeof(*out));
+    strncpy(out->arguments[0], function_name.c_str(), ARG_SIZE - 1);
+    size_t n = std::min(args.size(), (size_t)ARGS_NUMBER - 1);
+    for (size_t i = 0; i < n; i++) {
+        strncpy(out->arguments[i + 1], args[i].c_str(), ARG_SIZE - 1);
+    }
+}
+
+/* 시작 메일박스: arguments와 미리 읽은 (키, 값). 키나 값이 메일박스에 들어가지 않는 항목은 뺀다 */
+static void pack_start(const std::string& function_name, const std::vector<std::string>& args,
+                       const kv_list* prefetched, struct start_request* out)
+{
+    memset(out, 0, sizeof(*out));
+    pack_arguments(function_name, args, &out->args);
+    if (!prefetched) return;
+    for (size_t i = 0; i < prefetched->size() && out->prefetched < PREFETCH_MAX; i++) {
+        const std::string& key = (*prefetched)[i].first;
+        const std::string& value = (*prefetched)[i].second;
+        if (key.empty() || key.length() >= KEY_SIZE || value.length() >= VAL_SIZE) continue;
+        struct key_value* kv = &out->prefetch[out->prefetched++];
+        memcpy(kv->key, key.data(), key.length());
+        memcpy(kv->value, value.data(), value.length());
+    }
+}
+
+TEEC_Result start_transaction(tee_ctx* ctx, const std::string& module_id,
+                              const std::string& function_name,
+                              const std::vector<std::string>& args,
+                              tx_step* step, const tx_deadline* deadline,
+                              const kv_list* prefetched)
+{
+    TEEC_Operation op;
+    uint32_t origin;
+    TEEC_Result res;
+
+    if (!valid_module_id(module_id)) return TEEC_ERROR_BAD_PARAMETERS;
+
+    // 모듈 id와 arguments 전달 - 바이트코드는 TA 보안 저장소에 설치되어 있음.
+    // 시작 메일박스는 워커 칸: 이 세션에서 단계를 실행하는 스레드만 쓴다
+    step_mailbox* mb = (step_mailbox*)(ctx->step_buffer + STEP_WORKER_OFFSET);
+    prepare_op(ctx, &op, STEP_WORKER_OFFSET, sizeof(*mb));
+    op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT, TEEC_VALUE_INOUT, TEEC_PARAM_TYPE_GET(op.paramTypes, 2),
+                                     TEEC_PARAM_TYPE_GET(op.paramTypes, 3));
+    op.params[0].tmpref.buffer = (void*)module_id.c_str();
+    op.params[0].tmpref.size = module_id.length();
+
+    // struct arguments (+ 미리 읽은 상태) 설정
+    memset(mb, 0, sizeof(*mb));
+    pack_start(function_name, args, prefetched, &mb->start);
+
+    TX_LOG(ctx, "%s gRPC arguments 설정:\n", get_timestamp().c_str());
+    TX_LOG(ctx, "   Function (args[0]): '%s'\n", mb->args.arguments[0]);
+    size_t n = std::min(args.size(), (size_t)ARGS_NUMBER - 1);
+    for (size_t i = 0; i < n; i++) {
+        TX_LOG(ctx, "   Arg%zu (args[%zu]): '%s'\n", i, i+1, mb->args.arguments[i + 1]);
+    }
+    for (uint32_t i = 0; i < mb->start.prefetched; i++) {
+        TX_LOG(ctx, "   Prefetch: '%s'\n", mb->start.prefetch[i].key);
+    }
+
+    TX_LOG(ctx, "%s TEE에서 WASM 실행 시작 (모듈 id: %s)...\n", get_timestamp().c_str(), module_id.c_str());
+    op.params[1].value.a = deadline ? deadline->budget_ms() : 0;
+    res = invoke_with_deadline(ctx, COMMAND_RUN_WASM_BY_ID, &op, &origin, deadline);
+    check_session(ctx, res, origin);
+    if (res != TEEC_SUCCESS) {
+        if (res == TEEC_ERROR_ITEM_NOT_FOUND && origin == TEEC_ORIGIN_TRUSTED_APP)
+            report_not_installed(module_id);
+        else if (res == TEEC_ERROR_CANCEL)
+            printf("%s WASM 실행 취소 (마감 초과)\n", get_timestamp().c_str());
+        else if (res != TEEC_ERROR_BUSY)
+            printf("%s WASM 실행 실패! res=0x%x origin=0x%x\n", get_timestamp().c_str(), res, origin);
+        return res;
+    }
+
+    read_step(op.params[1].value.a, op.params[1].value.b, mb, step);
+    return TEEC_SUCCESS;
+}
+
+TEEC_Result resume_transaction(tee_ctx* ctx, tx_step* step, const tx_deadline* deadline)
+{
+    TEEC_Operation op;
+    uint32_t origin;
+
+    // 호스트 응답은 슬롯 메일박스에 이미 있다: 그 칸을 넘기고 멈춰 있던 슬롯을 지정해 재개.
+    // ITER 페이지(struct iter_reply)는 메일박스보다 크므로 칸 전체를 넘긴다
+    if (step->slot >= TA_TX_SLOTS) return TEEC_ERROR_BAD_PARAMETERS;
+    step_mailbox* out = slot_mailbox(ctx, step->slot);
+    prepare_op(ctx, &op, step->slot * STEP_SLOT_SIZE, is_iter_step(*step) ? STEP_SLOT_SIZE : sizeof(*out));
+    op.params[1].value.b = step->slot;
+    TX_LOG(ctx, "%s WASM 실행 재개 (슬롯 %u)\n", get_timestamp().c_str(), step->slot);
+    TEEC_Result res = invoke_with_deadline(ctx, COMMAND_RESUME_WASM, &op, &origin, deadline);
+    check_session(ctx, res, origin);
+    if (res == TEEC_ERROR_CANCEL) {
+        printf("%s WASM 재개 취소 (마감 초과) slot=%u\n", get_timestamp().c_str(), step->slot);
+        return res;
+    }
+    if (res != TEEC_SUCCESS) {
+        printf("%s WASM 재개 실패! slot=%u res=0x%x origin=0x%x\n", get_timestamp().c_str(), step->slot, res, origin);
+        return res;
+    }
+
+    read_step(op.params[1].value.a, op.params[1].value.b, out, step);
+    return TEEC_SUCCESS;
+}
+
+/* 단계 하나를 단건 명령(RUN_WASM_BY_ID / RESUME_WASM)으로 실행 */
+static void run_step(tee_ctx* ctx, step_op* op)
+{
+    if (op->deadline && op->deadline->expired()) {
+        op->result = TEEC_ERROR_CANCEL;
+        return;
+    }
+    if (op->start) {
+        op->result = start_transaction(ctx, op->invocation->ta_module_id(), op->invocation->function_name,
+                                       op->invocation->args, &op->step, op->deadline,
+                                       &op->invocation->prefetched);
+    } else {
+        op->result = resume_transaction(ctx, &op->step, op->deadline);
+    }
+}
+
+void run_steps(tee_ctx* ctx, const std::vector<step_op*>& ops)
+{
+    if (ops.empty()) return;
+    if (ops.size() == 1) {
+        run_step(ctx, ops[0]);
+        return;
+    }
+    if (ops.size() > TA_TX_SLOTS) {
+        // 세션의 슬롯 수보다 많이 묶을 수는 없다 (TeeWorkerPool은 TA_TX_SLOTS개까지만 모은다)
+        for (size_t i = 0; i < ops.size(); i++) ops[i]->result = TEEC_ERROR_BAD_PARAMETERS;
+        return;
+    }
+
+    // 단계마다 레코드 하나를 워커 칸에 쌓는다: START는 모듈 id와 arguments(+ 미리 읽은 상태),
+    // RESUME은 슬롯과 answer_host_call이 슬롯 메일박스에 써 둔 호스트 응답
+    struct step_record* rec = (struct step_record*)(ctx->step_buffer + STEP_WORKER_OFFSET);
+    step_op* sent[TA_TX_SLOTS];
+    step_op* alone[TA_TX_SLOTS];    /* ITER 페이지는 레코드 메일박스에 들어가지 않아 단건으로 재개 */
+    const tx_deadline* deadlines[TA_TX_SLOTS];
+    size_t n_sent = 0, n_alone = 0;
+    tx_deadline unbounded;
+    for (size_t i = 0; i < ops.size(); i++) {
+        step_op* op = ops[i];
+        struct step_record* r = &rec[n_sent];
+        memset(r, 0, sizeof(*r));
+        if (op->deadline && op->deadline->expired()) {
+            // 이미 마감이 지난 단계는 싣지 않는다 (멈춘 슬롯은 호출한 쪽이 회수)
+            op->result = TEEC_ERROR_CANCEL;
+            continue;
+        }
+        if (op->start) {
+            if (!valid_module_id(op->invocation->ta_module_id())) {
+                op->result = TEEC_ERROR_BAD_PARAMETERS;
+                continue;
+            }
+            r->op = STEP_OP_START;
+            r->budget_ms = op->deadline ? op->deadline->budget_ms() : 0;
+            strncpy(r->module_id, op->invocation->ta_module_id().c_str(), MODULE_ID_SIZE - 1);
+            pack_start(op->invocation->function_name, op->invocation->args, &op->invocation->prefetched,
+                       &r->mailbox.start);
+        } else if (is_iter_step(op->step)) {
+            alone[n_alone++] = op;
+            continue;
+        } else if (op->step.slot >= TA_TX_SLOTS) {
+            op->result = TEEC_ERROR_BAD_PARAMETERS;
+            continue;
+        } else {
+            r->op = STEP_OP_RESUME;
+            r->slot = op->step.slot;
+            memcpy(&r->mailbox, slot_mailbox(ctx, op->step.slot), sizeof(r->mailbox));
+        }
+        deadlines[n_sent] = op->deadline ? op->deadline : &unbounded;
+        sent[n_sent++] = op;
+    }
+    // ITER 재개는 슬롯 칸만 쓰므로 워커 칸에 쌓은 레코드와 겹치지 않는다
+    for (size_t i = 0; i < n_alone; i++) run_step(ctx, alone[i]);
+    if (n_sent == 0) return;
+
+    TEEC_Operation top;
+    uint32_t origin;
+    memset(&top, 0, sizeof(top));
+    uint32_t output = set_output(ctx, &top.params[3]);
+    uint32_t mailbox = set_mailbox(ctx, &top.params[2], STEP_WORKER_OFFSET, n_sent * sizeof(struct step_record));
+    top.paramTypes = TEEC_PARAM_TYPES(TEEC_NONE, TEEC_VALUE_INPUT, mailbox, output);
+    top.params[1].value.a = n_sent;
+
+    TX_LOG(ctx, "%s TEE 진입 한 번에 단계 %zu개 실행\n", get_timestamp().c_str(), n_sent);
+    TEEC_Result res = invoke_with_deadlines(ctx, COMMAND_MULTI_STEP, &top, &origin, deadlines, n_sent);
+    check_session(ctx, res, origin);
+    if (res != TEEC_SUCCESS) {
+        printf("%s 다중 단계 실행 실패! steps=%zu res=0x%x origin=0x%x\n", get_timestamp().c_str(),
+               n_sent, res, origin);
+        for (size_t i = 0; i < n_sent; i++) sent[i]->result = res;
+        return;
+    }
+
+    for (size_t i = 0; i < n_sent; i++) {
+        step_op* op = sent[i];
+        op->result = rec[i].result;
+        if (op->result != TEEC_SUCCESS) {
+            if (op->start && op->result == TEEC_ERROR_ITEM_NOT_FOUND)
+                report_not_installed(op->invocation->ta_module_id());
+            else if (op->result != TEEC_ERROR_BUSY && op->result != TEEC_ERROR_CANCEL)
+                printf("%s 다중 단계 중 %s 실패! slot=%u res=0x%x\n", get_timestamp().c_str(),
+                       op->start ? "실행" : "재개", rec[i].slot, op->result);
+            continue;
+        }
+        read_step(rec[i].type, rec[i].slot, &rec[i].mailbox, &op->step);
+    }
+}
+
+TEEC_Result abort_transaction(tee_ctx* ctx, uint32_t slot)
+{
+    TEEC_Operation op;
+    uint32_t origin;
+
+    memset(&op, 0, sizeof(op));
+    op.paramTypes = TEEC_PARAM_TYPES(TEEC_VALUE_INPUT, TEEC_NONE, TEEC_NONE, TEEC_NONE);
+    op.params[0].value.a = slot;
+    TEEC_Result res = TEEC_InvokeCommand(&ctx->sess, COMMAND_ABORT_TX, &op, &origin);
+    check_session(ctx, res, origin);
+    return res;
+}
+
+/* 모듈 id 하나만 넘기는 명령 (COMMAND_PRELOAD_MODULE / COMMAND_REMOVE_MODULE) */
+/* value가 있으면 params[1]로 주고받는다 */
+static TEEC_Result invoke_module_command(tee_ctx* ctx, uint32_t command, const std::string& module_id,
+                                         TEEC_Value* value, uint32_t* origin)
+{
+    TEEC_Operation op;
+
+    *origin = TEEC_ORIGIN_API;
+    if (!valid_module_id(module_id)) return TEEC_ERROR_BAD_PARAMETERS;
+    memset(&op, 0, sizeof(op));
+    op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT, value ? TEEC_VALUE_INOUT : TEEC_NONE,
+                                     TEEC_NONE, TEEC_NONE);
+    op.params[0].tmpref.buffer = (void*)module_id.c_str();
+    op.params[0].tmpref.size = module_id.length();
+    if (value) op.params[1].value = *value;
+    TEEC_Result res = TEEC_InvokeCommand(&ctx->sess, command, &op, origin);
+    check_session(ctx, res, *origin);
+    if (value) *value = op.params[1].value;
+    return res;
+}
+
+TEEC_Result preload_module(tee_ctx* ctx, const std::string& module_id, uint32_t instances, uint32_t* ready)
+{
+    uint32_t origin;
+    TEEC_Value value;
+    value.a = instances;
+    value.b = 0;
+    TEEC_Result res = invoke_module_command(ctx, COMMAND_PRELOAD_MODULE, module_id, &value, &origin);
+    if (res != TEEC_SUCCESS) {
+        printf("%s 모듈 미리 로드 실패: %s res=0x%x origin=0x%x\n", get_timestamp().c_str(), module_id.c_str(), res, origin);
+    }
+    if (ready) *ready = res == TEEC_SUCCESS ? value.b : 0;
+    return res;
+}
+
+TEEC_Result remove_module(tee_ctx* ctx, const std::string& module_id)
+{
+    uint32_t origin;
+    TEEC_Result res = invoke_module_command(ctx, COMMAND_REMOVE_MODULE, module_id, NULL, &origin);
+    // 설치되기 전에 교체된 버전은 지울 것이 없다
+    if (res != TEEC_SUCCESS && res != TEEC_ERROR_ITEM_NOT_FOUND) {
+        printf("%s 모듈 삭제 실패: %s res=0x%x origin=0x%x\n", get_timestamp().c_str(), module_id.c_str(), res, origin);
+    }
+    return res;
+}
+
+TEEC_Result dump_module_profile(tee_ctx* ctx, const std::string& module_id, std::vector<uint8_t>* profile)
+{
+    TEEC_Operation op;
+    uint32_t origin;
+    TEEC_Result res;
+
+    if (!valid_module_id(module_id)) return TEEC_ERROR_BAD_PARAMETERS;
+    // 처음엔 빈 버퍼로 크기를 묻고(TEEC_ERROR_SHORT_BUFFER), 그 크기로 다시 받는다
+    profile->clear();
+    for (int attempt = 0; attempt < 2; attempt++) {
+        memset(&op, 0, sizeof(op));
+        op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT, TEEC_MEMREF_TEMP_OUTPUT, TEEC_NONE, TEEC_NONE);
+        op.params[0].tmpref.buffer = (void*)module_id.c_str();
+        op.params[0].tmpref.size = module_id.length();
+        op.params[1].tmpref.buffer = profile->empty() ? NULL : &(*profile)[0];
+        op.params[1].tmpref.size = profile->size();
+        res = TEEC_InvokeCommand(&ctx->sess, COMMAND_DUMP_PROFILE, &op, &origin);
+        check_session(ctx, res, origin);
+        if (res != TEEC_ERROR_SHORT_BUFFER) break;
+        profile->resize(op.params[1].tmpref.size);
+    }
+    if (res != TEEC_SUCCESS) {
+        printf("%s PGO 프로파일 받기 실패: %s res=0x%x origin=0x%x\n", get_timestamp().c_str(), module_id.c_str(),
+               res, origin);
+        profile->clear();
+        return res;
+    }
+    profile->resize(op.params[1].tmpref.size);
+    return TEEC_SUCCESS;
+}
+
+/*
+ * 배치 메일박스(BATCH_MAILBOX_SIZE)는 크므로 세션마다 공유 메모리를 한 번 잡아 재사용한다.
+ * TEEC_MEMREF_TEMP_* 와 달리 호출마다 bounce 복사가 없다.
+ */
+static TEEC_Result ensure_batch_shm(tee_ctx* ctx)
+{
+    if (ctx->has_batch_shm) return TEEC_SUCCESS;
+
+    memset(&ctx->batch_shm, 0, sizeof(ctx->batch_shm));
+    ctx->batch_shm.size = BATCH_MAILBOX_SIZE;
+    ctx->batch_shm.flags = TEEC_MEM_INPUT | TEEC_MEM_OUTPUT;
+    TEEC_Result res = TEEC_AllocateSharedMemory(&ctx->ctx, &ctx->batch_shm);
+    if (res != TEEC_SUCCESS) {
+        printf("%s Error: 배치 메일박스 할당 실패 (%zu bytes) res=0x%x\n", get_timestamp().c_str(),
+               (size_t)BATCH_MAILBOX_SIZE, res);
+        return res;
+    }
+    ctx->has_batch_shm = true;
+    return TEEC_SUCCESS;
+}
+
+static void prepare_batch_op(tee_ctx* ctx, TEEC_Operation* op)
+{
+    memset(op, 0, sizeof(*op));
+    uint32_t output = set_output(ctx, &op->params[3]);
+    op->paramTypes = TEEC_PARAM_TYPES(TEEC_NONE, TEEC_VALUE_INOUT, TEEC_MEMREF_PARTIAL_INOUT, output);
+    op->params[2].memref.parent = &ctx->batch_shm;
+    op->params[2].memref.offset = 0;
+    op->params[2].memref.size = BATCH_MAILBOX_SIZE;
+}
+
+/* RUN_BATCH / BATCH_STATE 결과 레코드를 batch_step으로 옮긴다 */
+static void read_batch_step(tee_ctx* ctx, const TEEC_Operation* op, batch_step* step)
+{
+    const struct batch_record* rec = (const struct batch_record*)ctx->batch_shm.buffer;
+    size_t n = std::min((size_t)op->params[1].value.b, BATCH_MAILBOX_SIZE / sizeof(*rec));
+
+    step->done = op->params[1].value.a == BATCH_DONE;
+    step->missing.clear();
+    step->results.assign(step->done ? step->count : 0, batch_result());
+    for (size_t i = 0; i < n; i++) {
+        std::string key(rec[i].key, strnlen(rec[i].key, KEY_SIZE));
+        std::string value(rec[i].value, strnlen(rec[i].value, VAL_SIZE));
+        if (!step->done) {
+            step->missing.push_back(key);
+            continue;
+        }
+        if (rec[i].tx >= step->count) continue;
+        batch_result& r = step->results[rec[i].tx];
+        switch (rec[i].type) {
+            case GET_STATE_REQUEST:
+                r.read_set.push_back(std::make_pair(key, value));
+                break;
+            case PUT_STATE_REQUEST:
+                r.write_set.push_back(std::make_pair(key, value));
+                break;
+            case INVOCATION_RESPONSE:
+            case ERROR:
+                r.ok = rec[i].type == INVOCATION_RESPONSE;
+                r.response = value;
+                r.usage = read_usage(rec[i].flags, rec[i].fuel_used_lo, rec[i].fuel_used_hi);
+                break;
+        }
+    }
+}
+
+TEEC_Result start_batch(tee_ctx* ctx, const std::vector<tx_invocation>& invocations, batch_step* step)
+{
+    TEEC_Operation op;
+    uint32_t origin;
+
+    if (invocations.empty() || invocations.size() > BATCH_MAX_TX) return TEEC_ERROR_BAD_PARAMETERS;
+    const std::string& module_id = invocations[0].ta_module_id();
+    if (!valid_module_id(module_id)) return TEEC_ERROR_BAD_PARAMETERS;
+
+    TEEC_Result res = ensure_batch_shm(ctx);
+    if (res != TEEC_SUCCESS) return res;
+
+    // 메일박스 앞부분에 트랜잭션별 struct arguments를 차례로 둔다
+    struct arguments* args = (struct arguments*)ctx->batch_shm.buffer;
+    for (size_t i = 0; i < invocations.size(); i++) {
+        pack_arguments(invocations[i].function_name, invocations[i].args, &args[i]);
+    }
+
+    prepare_batch_op(ctx, &op);
+    op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT, TEEC_VALUE_INOUT, TEEC_MEMREF_PARTIAL_INOUT,
+                                     TEEC_PARAM_TYPE_GET(op.paramTypes, 3));
+    op.params[0].tmpref.buffer = (void*)module_id.c_str();
+    op.params[0].tmpref.size = module_id.length();
+    op.params[1].value.a = invocations.size();
+
+    TX_LOG(ctx, "%s TEE에서 배치 실행 시작 (모듈 id: %s, 트랜잭션 %zu개)\n",
+           get_timestamp().c_str(), module_id.c_str(), invocations.size());
+    res = TEEC_InvokeCommand(&ctx->sess, COMMAND_RUN_BATCH, &op, &origin);
+    check_session(ctx, res, origin);
+    if (res != TEEC_SUCCESS) {
+        if (res == TEEC_ERROR_ITEM_NOT_FOUND && origin == TEEC_ORIGIN_TRUSTED_APP) report_not_installed(module_id);
+        printf("%s 배치 실행 실패! res=0x%x origin=0x%x\n", get_timestamp().c_str(), res, origin);
+        return res;
+    }
+
+    step->count = invocations.size();
+    read_batch_step(ctx, &op, step);
+    return TEEC_SUCCESS;
+}
+
+TEEC_Result continue_batch(tee_ctx* ctx, const kv_list& values, batch_step* step)
+{
+    TEEC_Operation op;
+    uint32_t origin;
+
+    if (!ctx->has_batch_shm || values.size() > BATCH_MAILBOX_SIZE / sizeof(struct batch_record))
+        return TEEC_ERROR_BAD_STATE;
+
+    // TA가 요청한 키의 값을 레코드로 넘긴다 (VAL_SIZE를 넘는 값은 빈 값, RESUME과 동일)
+    struct batch_record* rec = (struct batch_record*)ctx->batch_shm.buffer;
+    memset(rec, 0, values.size() * sizeof(*rec));
+    for (size_t i = 0; i < values.size(); i++) {
+        rec[i].type = GET_STATE_REQUEST;
+        strncpy(rec[i].key, values[i].first.c_str(), KEY_SIZE - 1);
+        if (values[i].second.length() < VAL_SIZE) {
+            strncpy(rec[i].value, values[i].second.c_str(), VAL_SIZE - 1);
+        }
+    }
+
+    prepare_batch_op(ctx, &op);
+    op.params[1].value.b = values.size();
+    TEEC_Result res = TEEC_InvokeCommand(&ctx->sess, COMMAND_BATCH_STATE, &op, &origin);
+    check_session(ctx, res, origin);
+    if (res != TEEC_SUCCESS) {
+        printf("%s 배치 재개 실패! res=0x%x origin=0x%x\n", get_timestamp().c_str(), res, origin);
+        return res;
+    }
+
+    read_batch_step(ctx, &op, step);
+    return TEEC_SUCCESS;
+}
+
+TEEC_Result abort_batch(tee_ctx* ctx)
+{
+    TEEC_Operation op;
+    uint32_t origin;
+
+    memset(&op, 0, sizeof(op));
+    op.paramTypes = TEEC_PARAM_TYPES(TEEC_NONE, TEEC_NONE, TEEC_NONE, TEEC_NONE);
+    TEEC_Result res = TEEC_InvokeCommand(&ctx->sess, COMMAND_ABORT_BATCH, &op, &origin);
+    check_session(ctx, res, origin);
+    return res;
+}
+
+/*
+ * GET/PUT 호스트콜을 StateBackend로 처리해 응답(값 또는 ack)을, ITER 요청은 페이지를 슬롯 메일박스에 쓴다.
+ * GET 값은 래퍼 응답에서 메일박스로 바로 복사된다 (메일박스에 들어가지 않는 값은 빈 값으로 넘긴다)
+ */
+bool answer_host_call(tee_ctx* ctx, StateBackend* state, const tx_step& step, StateIterators* iterators)
+{
+    if (step.slot >= TA_TX_SLOTS) return false;
+    step_mailbox* mb = slot_mailbox(ctx, step.slot);
+    size_t length = 0;
+    std::string ack;
+    switch (step.type) {
+        case GET_STATE_REQUEST:
+            TX_LOG(ctx, "%s [GET_STATE_REQUEST] key='%s'\n", get_timestamp().c_str(), step.key.c_str());
+            if (!state->get_state_into(step.key, mb->kv.value, VAL_SIZE, &length)) {
+                printf("%s ❌ GET_STATE 응답 수신 실패\n", get_timestamp().c_str());
+                return false;
+            }
+            TX_LOG(ctx, "%s [GET_STATE_RESPONSE] value='%.*s' (len=%zu)\n", get_timestamp().c_str(),
+                   length < VAL_SIZE ? (int)length : 0, mb->kv.value, length);
+            if (length >= VAL_SIZE) length = 0;
+            mb->kv.value[length] = '\0';
+            return true;
+        case PUT_STATE_REQUEST:
+            TX_LOG(ctx, "%s [PUT_STATE_REQUEST] key='%s', value='%s'\n", get_timestamp().c_str(), step.key.c_str(), step.value.c_str());
+            if (!state->put_state(step.key, step.value, &ack)) {
+                printf("%s PUT_STATE 응답 수신 실패\n", get_timestamp().c_str());
+                return false;
+            }
+            TX_LOG(ctx, "%s [PUT_STATE_RESPONSE] 확인 메시지: '%s' (len=%zu)\n",
+                   get_timestamp().c_str(), ack.c_str(), ack.length());
+            memset(&mb->ack, 0, sizeof(mb->ack));
+            if (ack.length() < ACK_SIZE) memcpy(mb->ack.acknowledgement, ack.data(), ack.length());
+            return true;
+        case ITER_OPEN_REQUEST:
+        case ITER_NEXT_REQUEST:
+            TX_LOG(ctx, "%s [%s] kind=%u id=%u key='%s'\n", get_timestamp().c_str(),
+                   step.type == ITER_OPEN_REQUEST ? "ITER_OPEN_REQUEST" : "ITER_NEXT_REQUEST",
+                   step.iter_kind, step.iter_id, step.key.c_str());
+            if (!iterators || !iterators->answer(step, (struct iter_reply*)mb)) {
+                printf("%s ❌ 반복자 페이지 수신 실패\n", get_timestamp().c_str());
+                return false;
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool execute_transaction(tee_ctx* ctx, const std::string& aot_file,
+                         const std::string& function_name,
+                         const std::vector<std::string>& args,
+                         StateBackend* state, std::string* response)
+{
+    tx_step step;
+    if (start_transaction(ctx, aot_file, function_name, args, &step) != TEEC_SUCCESS)
+        return false;
+
+    StateIterators iterators(state);
+    while (step.type != INVOCATION_RESPONSE) {
+        if (!answer_host_call(ctx, state, step, &iterators)) {
+            abort_transaction(ctx, step.slot);
+            return false;
+        }
+        if (resume_transaction(ctx, &step) != TEEC_SUCCESS) {
+            abort_transaction(ctx, step.slot);
+            return false;
+        }
+    }
+
+    TX_LOG(ctx, "%s [INVOCATION_RESPONSE] %s\n", get_timestamp().c_str(), step.response.c_str());
+    response->assign(step.response);
+    return true;
+}
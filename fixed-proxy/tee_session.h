@@ -0,0 +1,297 @@
+#ifndef TEE_SESSION_H
+#define TEE_SESSION_H
+
+#include <stdint.h>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// GlobalPlatform Client API
+#include <tee_client_api.h>
+
+#include "proxy_log.h"
+
+/* TEE resources */
+typedef struct _tee_ctx {
+	TEEC_Context ctx;
+	TEEC_Session sess;
+    uint8_t *output_buffer;
+    uint64_t output_buffer_size;
+    uint8_t *benchmark_buffer;
+    uint64_t benchmark_buffer_size;
+    bool quiet;     /* 트랜잭션 단위 로그 생략 (벤치마크용) */
+    bool needs_restart; /* TA가 죽었거나 통신이 끊겨 세션을 다시 열어야 함 */
+    TEEC_SharedMemory batch_shm;  /* 배치 메일박스 (첫 배치에서 할당, 세션 종료 시 해제) */
+    bool has_batch_shm;
+    TEEC_SharedMemory log_shm;    /* 체인코드 로그 링 + stdout (세션을 열 때 할당, 없으면 output_buffer) */
+    bool has_log_shm;
+    /*
+     * 단계 메일박스: TA 슬롯마다 한 칸(호스트콜 응답, ITER 페이지)과 워커만 쓰는 칸 하나(시작 메일박스,
+     * COMMAND_MULTI_STEP 레코드). allocate_buffers가 잡고 세션을 열 때마다 step_shm으로 등록한다.
+     * 세션을 다시 열어도 메모리는 그대로이므로 호스트콜에 답하는 스레드가 재시작과 겹쳐도 된다
+     */
+    uint8_t *step_buffer;
+    uint64_t step_buffer_size;
+    TEEC_SharedMemory step_shm;
+    bool has_step_shm;            /* 등록 실패면 step_buffer를 TEMP memref로 넘긴다 */
+} tee_ctx;
+
+/* TA(uuid)와 세션을 연다. 실패하면 컨텍스트를 정리하고 오류를 돌려준다 */
+TEEC_Result open_tee_session(tee_ctx* ctx, const TEEC_UUID& uuid);
+/* open_tee_session과 같지만 실패하면 프로세스를 끝낸다 (uuid NULL: TA_WAMR_UUID) */
+void prepare_tee_session(tee_ctx* ctx, const TEEC_UUID* uuid = NULL);
+/* 래퍼가 보내는 chaincode_uuid(16바이트, RFC 4122 순서)를 TEEC_UUID로 (길이가 다르면 false) */
+bool uuid_from_bytes(const std::string& bytes, TEEC_UUID* uuid);
+std::string uuid_to_string(const TEEC_UUID& uuid);
+void configure_heap_size(tee_ctx *ctx, uint32_t size);
+/* 이 세션에서 실행하는 트랜잭션마다의 연료 한도 (0이면 없음, 계량 모듈에만 적용) */
+void configure_fuel_limit(tee_ctx *ctx, uint64_t limit);
+void allocate_buffers(tee_ctx* ctx, uint64_t buffers_size);
+void terminate_tee_session(tee_ctx* ctx);
+void free_buffers(tee_ctx* ctx);
+long read_module_into_shm(tee_ctx* ctx, const std::string& path, TEEC_SharedMemory* shm);
+/*
+ * 모듈 버전: ./chaincode/<aot_file>.sha256 의 앞 16자리 (버전 이름일 뿐, 검증은 TA의 서명 확인).
+ * 파일이나 .sha256이 없으면 "". 버전이 붙은 TA 모듈 id는 "<aot_file>@<버전>"이다
+ * (버전이 없거나 붙이면 MODULE_ID_SIZE를 넘는 모듈은 aot_file 그대로)
+ */
+std::string read_module_version(const std::string& aot_file);
+std::string versioned_module_id(const std::string& aot_file, const std::string& version);
+/*
+ * 모듈 id(버전이 붙었으면 그 버전이어야 함)로 ./chaincode/<aot_file>을 TA 보안 저장소에 설치.
+ * 서명은 signature_path(기본 <이미지>.sig)에서 읽고 TA가 확인한다. replace는 다른 이미지로 설치된 id를
+ * 바꾸는 것으로, 서명도 REPLACE=1로 만들어야 한다.
+ * image_path를 주면 그 파일을 버전 확인 없이 설치한다 (AOT 캐시의 컴파일 결과)
+ */
+TEEC_Result install_module(tee_ctx* ctx, const std::string& module_id, const std::string& image_path = std::string(),
+                           const std::string& signature_path = std::string(), bool replace = false);
+/*
+ * 이 세션의 TA 인스턴스가 설치된 모듈을 미리 로드(재배치)해 두게 한다.
+ * instances개까지는 인스턴스화도 해 둔다 (실제로 준비된 수는 *ready)
+ */
+TEEC_Result preload_module(tee_ctx* ctx, const std::string& module_id, uint32_t instances = 0,
+                           uint32_t* ready = NULL);
+/* 설치된 모듈 버전을 보안 저장소에서 지운다 (실행 중인 인스턴스는 끝까지 실행) */
+TEEC_Result remove_module(tee_ctx* ctx, const std::string& module_id);
+/*
+ * 이 세션의 TA 인스턴스가 그 모듈(wamrc --enable-llvm-pgo)을 실행하며 쌓은 PGO 카운터를
+ * .profraw 바이트로 받는다 (TA를 PGO=1로 빌드해야 함, 아니면 TEEC_ERROR_NOT_SUPPORTED)
+ */
+TEEC_Result dump_module_profile(tee_ctx* ctx, const std::string& module_id, std::vector<uint8_t>* profile);
+
+typedef std::vector<std::pair<std::string, std::string> > kv_list;
+
+/* 범위/부분 복합 키/이력 조회 하나 (kind: ITER_RANGE / ITER_PARTIAL_COMPOSITE / ITER_HISTORY) */
+struct iterator_query {
+    iterator_query() : kind(0) {}
+    uint32_t kind;
+    std::string start_key;      /* RANGE: 시작 키, PARTIAL_COMPOSITE: object type, HISTORY: 키 */
+    std::string end_key;        /* RANGE: 끝 키 (포함하지 않음) */
+    std::vector<std::string> attributes;    /* PARTIAL_COMPOSITE: 앞쪽 속성들 */
+};
+
+/* 조회 결과 한 페이지 (HISTORY: 키 = 트랜잭션 id, 지워진 값은 빈 문자열) */
+struct state_page {
+    state_page() : has_more(false) {}
+    kv_list entries;
+    bool has_more;
+};
+
+/*
+ * 체인코드의 GET/PUT 호스트콜을 처리하는 상태 저장소.
+ * gRPC 서버에서는 chaincode_wrapper 스트림이, 벤치마크에서는 메모리 맵이 구현한다.
+ */
+class StateBackend {
+public:
+    virtual ~StateBackend() {}
+    virtual bool get_state(const std::string& key, std::string* value) = 0;
+    virtual bool put_state(const std::string& key, const std::string& value, std::string* ack) = 0;
+    /* get_state와 같고 원장 버전도 담는다 (기본: 버전 모름) */
+    virtual bool get_versioned(const std::string& key, std::string* value, std::string* version) {
+        version->clear();
+        return get_state(key, value);
+    }
+    /*
+     * 호스트콜 응답용 읽기: 값을 buf(TA와 공유하는 메일박스)에 바로 쓴다. *length는 값의 길이이고
+     * size 이상이면 buf에는 쓰지 않는다. version이 있으면 원장 버전도 담는다.
+     * 기본: get_state/get_versioned로 받아 복사
+     */
+    virtual bool get_state_into(const std::string& key, char* buf, size_t size, size_t* length,
+                                std::string* version = NULL) {
+        std::string value;
+        if (!(version ? get_versioned(key, &value, version) : get_state(key, &value))) return false;
+        *length = value.length();
+        if (value.length() < size) value.copy(buf, value.length());
+        return true;
+    }
+    /*
+     * 배치 실행의 한 라운드에서 필요한 키를 한 번에 읽는다 (기본: get_state 반복).
+     * versions가 있으면 키마다 원장 버전을 담는다 (모르면 빈 문자열)
+     */
+    virtual bool get_states(const std::vector<std::string>& keys, std::vector<std::string>* values,
+                            std::vector<std::string>* versions = NULL) {
+        values->assign(keys.size(), std::string());
+        if (versions) versions->assign(keys.size(), std::string());
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (!get_state(keys[i], &(*values)[i])) return false;
+        }
+        return true;
+    }
+    /*
+     * 조회를 id로 열고 첫 페이지(최대 page_size개)를 읽는다. 이후 페이지는 next_page로 받고,
+     * has_more가 거짓이 되면 저장소가 닫는다 (열린 채로 남은 것은 호출이 끝날 때 닫힌다).
+     * 기본: 지원하지 않음
+     */
+    virtual bool open_iterator(uint32_t id, const iterator_query& query, uint32_t page_size, state_page* page) {
+        (void)id; (void)query; (void)page_size; (void)page;
+        return false;
+    }
+    virtual bool next_page(uint32_t id, uint32_t page_size, state_page* page) {
+        (void)id; (void)page_size; (void)page;
+        return false;
+    }
+};
+
+/*
+ * 연료 계량 결과. chaincode/fuel_meter.py로 계량 코드를 넣은 모듈만 metered이고,
+ * fuel_used는 실행한 wasm 명령 수다 (월드 스위치나 네트워크 대기와 무관하게 결정적).
+ */
+struct tx_usage {
+    tx_usage() : metered(false), out_of_fuel(false), fuel_used(0) {}
+    bool metered;
+    bool out_of_fuel;       /* 한도를 넘어 TA가 중단시킴 (응답은 OUT_OF_FUEL) */
+    uint64_t fuel_used;
+};
+
+/*
+ * 트랜잭션 한 단계의 결과. TA는 호스트콜(GET/PUT)에서 멈추면 슬롯 번호와 요청을 돌려주고
+ * REE는 응답을 준비한 뒤 같은 세션에서 그 슬롯을 재개한다. 그 사이 세션에서는
+ * 다른 트랜잭션을 시작하거나 재개할 수 있다 (세션당 TA_TX_SLOTS개).
+ */
+struct tx_step {
+    uint32_t slot;
+    uint32_t type;          /* INVOCATION_RESPONSE / GET_STATE_REQUEST / PUT_STATE_REQUEST / ITER_* */
+    std::string key;        /* GET/PUT 요청 키, ITER_OPEN_REQUEST의 시작 키 */
+    std::string value;      /* PUT 요청 값 */
+    std::string response;   /* INVOCATION_RESPONSE의 체인코드 응답 */
+    tx_usage usage;         /* INVOCATION_RESPONSE: 연료 계량 결과 */
+    uint32_t iter_kind;     /* ITER_OPEN_REQUEST: 조회 종류 */
+    uint32_t iter_id;       /* ITER_NEXT_REQUEST: 반복자 번호 */
+    uint32_t max_bytes;     /* ITER_*: 응답 페이지 레코드의 최대 바이트 수 */
+    std::string end_key;    /* ITER_OPEN_REQUEST: 끝 키 (PARTIAL_COMPOSITE는 ITER_ATTR_SEPARATOR로 이은 속성들) */
+};
+
+/*
+ * 트랜잭션 마감. at이 지나거나 cancelled()가 참이면(예: gRPC 클라이언트 취소) 더 진행하지 않는다.
+ * TA에는 시작할 때 남은 시간을 넘겨 호스트 함수 호출마다 확인하게 하고, 진입 중인 TEE 호출이
+ * 마감을 넘기면 TEEC_RequestCancellation을 보낸다. 어느 쪽이든 TA는 그 인스턴스만 정리하고
+ * TEEC_ERROR_CANCEL을 돌려주며 세션은 다시 열지 않는다.
+ */
+struct tx_deadline {
+    tx_deadline() : at(std::chrono::steady_clock::time_point::max()) {}
+    std::chrono::steady_clock::time_point at;
+    std::function<bool()> cancelled;
+    bool bounded() const { return at != std::chrono::steady_clock::time_point::max() || cancelled; }
+    bool expired() const;
+    uint32_t budget_ms() const;     /* TA에 넘길 남은 시간 (마감 없으면 0, 지났으면 1) */
+};
+
+/*
+ * 설치되지 않은 모듈이면 TEEC_ERROR_ITEM_NOT_FOUND (--deploy로 설치). 빈 슬롯이 없으면 TEEC_ERROR_BUSY,
+ * 마감이 지나면 TEEC_ERROR_CANCEL (슬롯은 TA가 회수).
+ * prefetched: 미리 읽어 시작 메일박스에 실을 (키, 값) (최대 PREFETCH_MAX개, TA가 GET을 바로 답한다)
+ * 시작과 재개의 메일박스는 ctx->step_buffer에 있다 (함수 이름과 인자는 그곳으로 바로 복사한다)
+ */
+TEEC_Result start_transaction(tee_ctx* ctx, const std::string& module_id,
+                              const std::string& function_name,
+                              const std::vector<std::string>& args,
+                              tx_step* step, const tx_deadline* deadline = NULL,
+                              const kv_list* prefetched = NULL);
+/*
+ * step이 멈춘 호스트콜에 대한 응답(GET 값 / PUT ack / ITER 페이지)을 넘기고 다음 단계까지 실행.
+ * 응답은 answer_host_call이 그 슬롯의 메일박스에 이미 써 두었다
+ */
+TEEC_Result resume_transaction(tee_ctx* ctx, tx_step* step, const tx_deadline* deadline = NULL);
+TEEC_Result abort_transaction(tee_ctx* ctx, uint32_t slot);
+/* function_name을 arguments[0]에, 나머지 인자를 그 뒤에 넣는다 (ARG_SIZE로 잘림) */
+struct arguments;
+void pack_arguments(const std::string& function_name, const std::vector<std::string>& args,
+                    struct arguments* out);
+class StateIterators;
+/*
+ * step이 멈춘 호스트콜을 state로 처리해 응답을 ctx의 그 슬롯 메일박스(TA와 공유하는 메모리)에 바로 쓴다.
+ * ITER 요청은 iterators가 답한다 (없으면 실패). 슬롯 메일박스는 그 트랜잭션만 쓰므로
+ * 워커가 같은 세션에서 다른 트랜잭션을 실행하는 동안 다른 스레드에서 불러도 된다
+ */
+bool answer_host_call(tee_ctx* ctx, StateBackend* state, const tx_step& step, StateIterators* iterators = NULL);
+
+/* 배치에 들어가는 호출 하나 */
+struct tx_invocation {
+    std::string aot_file;
+    std::string module_id;  /* 실행할 모듈 버전 (ModuleRegistry가 정함, 비었으면 aot_file) */
+    std::string function_name;
+    std::vector<std::string> args;
+    kv_list prefetched;     /* 단건 시작: 미리 읽은 상태 (배치는 쓰지 않음) */
+
+    const std::string& ta_module_id() const { return module_id.empty() ? aot_file : module_id; }
+};
+
+/* run_steps로 함께 실행할 단계 하나: 트랜잭션 시작 또는 멈춘 슬롯 재개 */
+struct step_op {
+    step_op() : start(false), invocation(NULL), deadline(NULL), result(TEEC_ERROR_GENERIC) {}
+    bool start;
+    const tx_invocation* invocation;    /* start: 시작할 호출 */
+    const tx_deadline* deadline;        /* 없으면 NULL */
+    tx_step step;                       /* 재개: 멈춘 단계(응답은 슬롯 메일박스에 있음) / 결과: 다음 단계 */
+    TEEC_Result result;
+};
+
+/*
+ * 서로 독립인 단계 여러 개(최대 TA_TX_SLOTS)를 COMMAND_MULTI_STEP 한 번으로 실행한다.
+ * 결과는 단계마다 op->result와 op->step에 담긴다. 한 개면 단건 명령을 쓴다.
+ * 힙 할당 없이 돈다 (레코드는 step_buffer의 워커 칸에 쌓는다)
+ */
+void run_steps(tee_ctx* ctx, const std::vector<step_op*>& ops);
+
+
+/* 배치 트랜잭션 하나의 결과. 쓰기는 적용되지 않고 write_set으로만 돌아온다 */
+struct batch_result {
+    batch_result() : ok(false), executions(0) {}
+    bool ok;
+    std::string response;   /* 체인코드 응답, 실패하면 사유 */
+    kv_list read_set;
+    kv_list write_set;
+    std::vector<std::string> read_versions; /* read_set 순서: 원장 버전, 배치 안의 쓰기를 읽었으면 "tx:<i>" */
+    uint32_t executions;    /* 충돌로 다시 실행된 횟수 + 1 */
+    tx_usage usage;         /* 마지막 실행의 연료 계량 결과 */
+};
+
+/* RUN_BATCH / BATCH_STATE 한 번의 결과: TA가 아직 모르는 키 목록 또는 최종 결과 */
+struct batch_step {
+    size_t count;           /* 배치의 트랜잭션 수 (results 크기) */
+    bool done;
+    std::vector<std::string> missing;
+    std::vector<batch_result> results;
+};
+
+/*
+ * 같은 모듈을 부르는 호출 최대 BATCH_MAX_TX개를 이 세션의 TA에서 함께 실행한다.
+ * TA는 모든 트랜잭션이 끝나거나 모르는 키에서 멈출 때까지 돌고 돌아오므로, REE는
+ * 멈춘 키들을 한 번에 읽어 continue_batch로 넘긴다. 세션당 배치는 하나다.
+ */
+TEEC_Result start_batch(tee_ctx* ctx, const std::vector<tx_invocation>& invocations, batch_step* step);
+TEEC_Result continue_batch(tee_ctx* ctx, const kv_list& values, batch_step* step);
+TEEC_Result abort_batch(tee_ctx* ctx);
+
+/*
+ * 설치된 모듈(id = aot_file)로 트랜잭션 하나를 이 세션에서 끝까지 실행한다.
+ * 성공하면 체인코드 응답을 response에 담는다.
+ */
+bool execute_transaction(tee_ctx* ctx, const std::string& aot_file,
+                         const std::string& function_name,
+                         const std::vector<std::string>& args,
+                         StateBackend* state, std::string* response);
+
+#endif /* TEE_SESSION_H */
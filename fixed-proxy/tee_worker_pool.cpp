@@ -0,0 +1,866 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <map>
+#include <set>
+
+#include <wamr_ta.h>
+#include "chaincode_tee_ree_communication.h"
+
+#include "proxy_metrics.h"
+#include "ree_runtime.h"
+#include "state_iterators.h"
+#include "tee_worker_pool.h"
+
+/* 조회에 밀린 읽기-쓰기 작업이 이만큼 기다리면 우선 차선으로 올린다 */
+static const std::chrono::milliseconds STARVATION_MS(100);
+
+TeeWorkerPool::TeeWorkerPool(int workers, uint32_t heap_size, bool quiet, uint32_t max_window_us,
+                             uint64_t fuel_limit, const sched_options& sched, const TEEC_UUID* ta_uuid)
+    : heap_size_(heap_size), quiet_(quiet), max_window_us_(max_window_us), fuel_limit_(fuel_limit),
+      has_ta_uuid_(ta_uuid != NULL), ta_uuid_(ta_uuid ? *ta_uuid : TEEC_UUID()), classifier_(sched.read_only_prefixes), weights_(sched.weights),
+      virtual_time_(0), rw_inflight_(0), stopping_(false), ready_(0)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus <= 0) cpus = 1;
+    if (workers <= 0) workers = (int)cpus;
+
+    // 조회 차선은 최대 (전체 슬롯 - 1)개: 읽기-쓰기 트랜잭션도 적어도 하나는 실행된다
+    int total_slots = workers * TA_TX_SLOTS;
+    rw_slot_limit_ = std::max(total_slots - (int)sched.query_lane, 1);
+
+    printf("%s TEE 워커 풀 시작: 워커 %d개 (온라인 코어 %ld개, 마이크로 배칭 창 최대 %uus)\n",
+           get_timestamp().c_str(), workers, cpus, max_window_us_);
+    printf("%s 스케줄링: 슬롯 %d개 중 조회 전용 %d개, 가중치 지정 체인코드 %zu개\n",
+           get_timestamp().c_str(), total_slots, total_slots - rw_slot_limit_, weights_.size());
+    for (int i = 0; i < workers; i++) {
+        std::unique_ptr<Worker> w(new Worker());
+        w->index = i;
+        w->cpu = i % (int)cpus;
+        w->inflight = 0;
+        w->batch_busy = false;
+        w->window_us = 0;
+        w->group.reserve(TA_TX_SLOTS);
+        w->ops.reserve(TA_TX_SLOTS);
+        char name[48];
+        snprintf(name, sizeof(name), "microbatch_window_us{worker=%d}", i);
+        w->window_metric = proxy_metrics().find(name);
+        workers_.push_back(std::move(w));
+    }
+    for (size_t i = 0; i < workers_.size(); i++) {
+        Worker* w = workers_[i].get();
+        w->thread = std::thread(&TeeWorkerPool::worker_main, this, w);
+    }
+
+    // 모든 워커가 세션을 연 뒤에 요청을 받는다
+    std::unique_lock<std::mutex> lock(mutex_);
+    ready_cv_.wait(lock, [this] { return ready_ == (int)workers_.size(); });
+    modules_.reset(new ModuleRegistry(*this));
+    printf("%s TEE 워커 풀 준비 완료\n", get_timestamp().c_str());
+}
+
+TeeWorkerPool::~TeeWorkerPool()
+{
+    // 모듈 버전 준비/삭제는 워커에서 실행되므로 워커보다 먼저 멈춘다
+    modules_.reset();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (size_t i = 0; i < workers_.size(); i++) {
+        if (workers_[i]->thread.joinable()) workers_[i]->thread.join();
+    }
+}
+
+void TeeWorkerPool::open_session(Worker* w)
+{
+    prepare_tee_session(&w->ctx, has_ta_uuid_ ? &ta_uuid_ : NULL);
+    configure_heap_size(&w->ctx, heap_size_);
+    if (fuel_limit_) configure_fuel_limit(&w->ctx, fuel_limit_);
+}
+
+/* 계량 모듈의 연료 사용량을 함수별로 모은다 (용량 계획, 비정상적으로 비싼 함수 찾기) */
+static void record_usage(const tx_invocation& invocation, const tx_usage& usage)
+{
+    if (!usage.metered) return;
+    std::string label = "{function=" + invocation.aot_file + ":" + invocation.function_name + "}";
+    ProxyMetrics& m = proxy_metrics();
+    m.add("fuel_used", (double)usage.fuel_used);
+    m.add("fuel_metered_tx", 1);
+    m.add("fuel_used" + label, (double)usage.fuel_used);
+    m.add("fuel_metered_tx" + label, 1);
+    m.max("fuel_used_max" + label, (double)usage.fuel_used);
+    if (usage.out_of_fuel) {
+        m.add("tx_out_of_fuel", 1);
+        m.add("tx_out_of_fuel" + label, 1);
+    }
+}
+
+/* TA가 죽었거나 통신이 끊긴 경우: 이 워커의 세션만 다시 연다 (남은 슬롯은 사라짐) */
+void TeeWorkerPool::restart_if_needed(Worker* w)
+{
+    if (!w->ctx.needs_restart) return;
+    printf("%s 워커 %d: TEE 세션 재시작\n", get_timestamp().c_str(), w->index);
+    terminate_tee_session(&w->ctx);
+    open_session(w);
+    w->ctx.needs_restart = false;
+}
+
+void TeeWorkerPool::worker_main(Worker* w)
+{
+    // TEE 호출은 이 스레드가 있는 코어에서 실행되므로 워커를 코어에 고정
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(w->cpu, &set);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0) {
+        printf("%s 경고: 워커 %d 코어 %d 고정 실패 (rc=%d)\n", get_timestamp().c_str(), w->index, w->cpu, rc);
+    }
+
+    allocate_buffers(&w->ctx, 5 * 1024);
+    open_session(w);
+    w->ctx.quiet = quiet_;
+    printf("%s 워커 %d: 코어 %d에서 TEE 세션 준비\n", get_timestamp().c_str(), w->index, w->cpu);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_++;
+    }
+    ready_cv_.notify_all();
+
+    while (true) {
+        TaskPtr task;
+        std::vector<TaskPtr>& group = w->group;
+        group.clear();
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this, w] {
+                return stopping_ || !w->pinned.empty() || pick_shared(w, false) != queue_.end();
+            });
+            std::deque<TaskPtr>::iterator shared = pick_shared(w, false);
+            if (!w->pinned.empty()) {
+                task = w->pinned.front();
+                w->pinned.erase(w->pinned.begin());
+            } else if (shared != queue_.end()) {
+                task = *shared;
+                queue_.erase(shared);
+                take_shared(w, task);
+            } else {
+                break;  // stopping_
+            }
+            if (task->op) {
+                // 트랜잭션 단계: 창 동안 이 세션에서 함께 실행할 단계를 더 모은다
+                group.push_back(task);
+                collect_steps(w, lock, &group);
+            }
+        }
+
+        if (!group.empty()) {
+            run_group(w, group);
+            continue;
+        }
+
+        task->worker = w->index;
+        bool ok = task->job(&w->ctx);
+        restart_if_needed(w);
+        finish(task, ok);
+    }
+
+    terminate_tee_session(&w->ctx);
+    free_buffers(&w->ctx);
+}
+
+/*
+ * 이 워커가 지금 함께 실행할 수 있는 단계 작업 하나 (mutex_ 보유 상태에서 호출).
+ * 이 워커에 지정된 재개가 먼저이고, 빈 슬롯이 있으면 공유 큐의 시작도 가져간다.
+ */
+TeeWorkerPool::TaskPtr TeeWorkerPool::take_step(Worker* w)
+{
+    for (std::vector<TaskPtr>::iterator it = w->pinned.begin(); it != w->pinned.end(); ++it) {
+        if (!(*it)->op) continue;
+        TaskPtr task = *it;
+        w->pinned.erase(it);
+        return task;
+    }
+    std::deque<TaskPtr>::iterator it = pick_shared(w, true);
+    if (it == queue_.end()) return TaskPtr();
+    TaskPtr task = *it;
+    queue_.erase(it);
+    take_shared(w, task);
+    return task;
+}
+
+/*
+ * group의 첫 단계를 꺼낸 뒤 창(w->window_us)이 끝나거나 TA_TX_SLOTS개가 찰 때까지
+ * 단계를 더 모은다. 세션의 슬롯은 TA_TX_SLOTS개이므로 그보다 많이 모일 수는 없다.
+ */
+void TeeWorkerPool::collect_steps(Worker* w, std::unique_lock<std::mutex>& lock, std::vector<TaskPtr>* group)
+{
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::microseconds(w->window_us);
+    while (group->size() < TA_TX_SLOTS) {
+        TaskPtr next = take_step(w);
+        if (next) {
+            group->push_back(next);
+            continue;
+        }
+        if (stopping_ || w->window_us == 0) break;
+        if (cv_.wait_until(lock, deadline) == std::cv_status::timeout) {
+            next = take_step(w);
+            if (next) group->push_back(next);
+            break;
+        }
+    }
+}
+
+void TeeWorkerPool::run_group(Worker* w, const std::vector<TaskPtr>& group)
+{
+    std::chrono::steady_clock::time_point collected = std::chrono::steady_clock::now();
+    std::vector<step_op*>& ops = w->ops;
+    ops.clear();
+    double added_us = 0;
+    for (size_t i = 0; i < group.size(); i++) {
+        group[i]->worker = w->index;
+        ops.push_back(group[i]->op);
+        // 창 때문에 더 기다린 시간: 첫 단계는 창 전체, 늦게 온 단계는 도착 이후만
+        std::chrono::steady_clock::time_point since = std::max(group[i]->queued, collected -
+            std::chrono::microseconds(w->window_us));
+        if (collected > since)
+            added_us += std::chrono::duration_cast<std::chrono::microseconds>(collected - since).count();
+    }
+
+    run_steps(&w->ctx, ops);
+    restart_if_needed(w);
+
+    ProxyMetrics& m = proxy_metrics();
+    static const ProxyMetrics::metric entries = m.find("microbatch_entries");
+    static const ProxyMetrics::metric steps = m.find("microbatch_steps");
+    static const ProxyMetrics::metric capacity = m.find("microbatch_capacity");
+    static const ProxyMetrics::metric added_latency = m.find("microbatch_added_latency_us");
+    m.add(entries, 1);
+    m.add(steps, group.size());
+    m.add(capacity, TA_TX_SLOTS);
+    m.add(added_latency, added_us);
+    adapt_window(w, group.size());
+
+    for (size_t i = 0; i < group.size(); i++) {
+        finish(group[i], group[i]->op->result == TEEC_SUCCESS);
+    }
+}
+
+/* 두 개 이상 모였으면 창을 늘리고, 혼자였으면 줄인다. 가득 찼으면 그대로 */
+void TeeWorkerPool::adapt_window(Worker* w, size_t group_size)
+{
+    if (max_window_us_ == 0) return;
+    if (group_size == 1) {
+        w->window_us /= 2;
+    } else if (group_size < TA_TX_SLOTS) {
+        uint32_t step = std::max(max_window_us_ / 8, (uint32_t)1);
+        w->window_us = w->window_us == 0 ? step : std::min(w->window_us * 2, max_window_us_);
+    }
+    proxy_metrics().set(w->window_metric, w->window_us);
+}
+
+/* 이 워커가 지금 task를 가져갈 수 있는지 (슬롯/배치/조회 차선, mutex_ 보유 상태에서 호출) */
+bool TeeWorkerPool::can_take(const Worker* w, const Task& task) const
+{
+    if (task.reserve == RESERVE_TX_SLOT) {
+        if (w->inflight >= TA_TX_SLOTS) return false;
+        if (!task.cls.read_only && rw_inflight_ >= rw_slot_limit_) return false;
+    }
+    if (task.reserve == RESERVE_BATCH && w->batch_busy) return false;
+    return true;
+}
+
+/*
+ * 공유 큐에서 이 워커가 다음에 가져갈 작업 (mutex_ 보유 상태에서 호출).
+ * 가져갈 수 있는 작업 중 우선 차선(조회, 오래 밀린 작업)이 먼저이고, 같은 차선에서는
+ * 공정 큐 시작 태그가 가장 작은 것. steps_only면 묶어 실행할 트랜잭션 시작만 본다.
+ */
+std::deque<TeeWorkerPool::TaskPtr>::iterator TeeWorkerPool::pick_shared(const Worker* w, bool steps_only)
+{
+    std::chrono::steady_clock::time_point starved = std::chrono::steady_clock::now() - STARVATION_MS;
+    std::deque<TaskPtr>::iterator best = queue_.end();
+    int best_lane = 0;
+    for (std::deque<TaskPtr>::iterator it = queue_.begin(); it != queue_.end(); ++it) {
+        const Task& t = **it;
+        if (steps_only && !(t.op && t.reserve == RESERVE_TX_SLOT)) continue;
+        if (!can_take(w, t)) continue;
+        int lane = t.cls.read_only || t.queued < starved ? 0 : 1;
+        if (best == queue_.end() || lane < best_lane || (lane == best_lane && t.start_tag < (*best)->start_tag)) {
+            best = it;
+            best_lane = lane;
+        }
+    }
+    return best;
+}
+
+/* 공유 큐에서 꺼낸 작업을 이 워커에 배정한다 (mutex_ 보유 상태에서 호출) */
+void TeeWorkerPool::take_shared(Worker* w, const TaskPtr& task)
+{
+    // 시작 작업은 이 워커의 슬롯/배치를 예약한다 (끝나면 release_slot/release_batch)
+    if (task->reserve == RESERVE_TX_SLOT) {
+        w->inflight++;
+        if (!task->cls.read_only) rw_inflight_++;
+    }
+    if (task->reserve == RESERVE_BATCH) w->batch_busy = true;
+    virtual_time_ = std::max(virtual_time_, task->start_tag);
+
+    const char* lane = task->cls.read_only ? "{class=read-only}" : "{class=read-write}";
+    double waited_us = (double)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - task->queued).count();
+    ProxyMetrics& m = proxy_metrics();
+    m.add(std::string("sched_dispatched") + lane, 1);
+    m.add(std::string("sched_wait_us") + lane, waited_us);
+    if (!task->cls.chaincode.empty()) m.add("sched_dispatched{chaincode=" + task->cls.chaincode + "}", task->cost);
+}
+
+TeeWorkerPool::TaskPtr TeeWorkerPool::make_task(Reserve reserve)
+{
+    TaskPtr task(new Task());
+    task->op = NULL;
+    task->reserve = reserve;
+    task->cost = 1;
+    task->start_tag = 0;
+    task->worker = -1;
+    task->finished = false;
+    task->ok = false;
+    return task;
+}
+
+/* 워커가 작업을 끝냈다: 기다리는 스레드를 깨운다 */
+void TeeWorkerPool::finish(const TaskPtr& task, bool ok)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    task->ok = ok;
+    task->finished = true;
+    task->done.notify_one();
+}
+
+bool TeeWorkerPool::wait(const TaskPtr& task)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    task->done.wait(lock, [&task] { return task->finished; });
+    return task->ok;
+}
+
+bool TeeWorkerPool::submit(const TaskPtr& task, int* worker)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task->finished = false;
+        task->queued = std::chrono::steady_clock::now();
+        // 흐름의 앞 작업이 끝날 가상 시간과 지금 중 늦은 쪽에서 시작해 cost/가중치만큼 차지한다
+        std::map<std::string, uint32_t>::const_iterator weight = weights_.find(task->cls.chaincode);
+        double& finish = flow_finish_[task->cls.chaincode];
+        task->start_tag = std::max(virtual_time_, finish);
+        finish = task->start_tag + (double)task->cost / (weight != weights_.end() ? weight->second : 1);
+        queue_.push_back(task);
+    }
+    // 이 작업을 가져갈 수 없는 워커만 깨어날 수 있으므로 모두 깨운다
+    cv_.notify_all();
+    bool ok = wait(task);
+    if (worker) *worker = task->worker;
+    return ok;
+}
+
+void TeeWorkerPool::release_slot(int worker, bool read_only)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        workers_[worker]->inflight--;
+        if (!read_only) rw_inflight_--;
+    }
+    cv_.notify_all();
+}
+
+void TeeWorkerPool::release_batch(int worker)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        workers_[worker]->batch_busy = false;
+    }
+    cv_.notify_all();
+}
+
+bool TeeWorkerPool::submit_on(int worker, const TaskPtr& task, const std::function<void()>& meanwhile)
+{
+    task->worker = worker;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task->finished = false;
+        task->queued = std::chrono::steady_clock::now();
+        workers_[worker]->pinned.push_back(task);
+    }
+    cv_.notify_all();
+    if (meanwhile) meanwhile();
+    return wait(task);
+}
+
+bool TeeWorkerPool::run(const Job& job, int* worker)
+{
+    TaskPtr task = make_task(RESERVE_NONE);
+    task->job = job;
+    return submit(task, worker);
+}
+
+bool TeeWorkerPool::run_on(int worker, const Job& job)
+{
+    TaskPtr task = make_task(RESERVE_NONE);
+    task->job = job;
+    return submit_on(worker, task);
+}
+
+bool TeeWorkerPool::run_on_each(const Job& job)
+{
+    std::vector<TaskPtr> tasks;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < workers_.size(); i++) {
+            TaskPtr task = make_task(RESERVE_NONE);
+            task->job = job;
+            task->worker = (int)i;
+            tasks.push_back(task);
+            workers_[i]->pinned.push_back(task);
+        }
+    }
+    cv_.notify_all();
+
+    bool ok = true;
+    for (size_t i = 0; i < tasks.size(); i++) {
+        if (!wait(tasks[i])) ok = false;
+    }
+    return ok;
+}
+
+std::string TeeWorkerPool::current_module_id(const std::string& aot_file)
+{
+    module_lease module = modules_->acquire(aot_file);
+    return module ? module->module_id : aot_file;
+}
+
+bool TeeWorkerPool::execute(const std::string& aot_file, const std::string& function_name,
+                            const std::vector<std::string>& args, StateBackend* state,
+                            std::string* response, const tx_deadline& deadline, tx_usage* usage)
+{
+    tx_invocation invocation;
+    invocation.aot_file = aot_file;
+    invocation.function_name = function_name;
+    invocation.args = args;
+    return execute(std::move(invocation), state, response, deadline, usage);
+}
+
+bool TeeWorkerPool::execute(tx_invocation invocation, StateBackend* state, std::string* response,
+                            const tx_deadline& deadline, tx_usage* usage)
+{
+    // 끝날 때까지 이 버전을 잡고 있으므로 그 사이 모듈이 교체되어도 같은 버전으로 실행한다
+    module_lease module = modules_->acquire(invocation.aot_file);
+    if (module) invocation.module_id = module->module_id;
+
+    // manifest가 REE로 보낸 함수는 TEE 슬롯을 쓰지 않고 이 스레드에서 바로 실행한다
+    if (ReeRuntime::available() && classifier_.runs_in_ree(invocation)) {
+        tx_usage ree_usage;
+        if (!ree_runtime().execute(invocation, state, response, deadline, fuel_limit_, &ree_usage)) return false;
+        record_usage(invocation, ree_usage);
+        if (usage) *usage = ree_usage;
+        return !ree_usage.out_of_fuel;
+    }
+
+    // manifest의 prefetch 규칙이 알려 준 키는 TEE에 들어가기 전에 한 번에 읽어 시작 메일박스에 싣는다.
+    // TA는 그 키의 GET을 안에서 답하므로 첫 호스트콜 왕복(TEE 나감 + 재개)이 없어진다
+    std::vector<std::string> keys = classifier_.prefetch_keys(invocation);
+    if (keys.size() > PREFETCH_MAX) keys.resize(PREFETCH_MAX);
+    if (!keys.empty()) {
+        std::vector<std::string> values;
+        if (!state->get_states(keys, &values) || values.size() != keys.size()) {
+            printf("%s ❌ prefetch 상태 읽기 실패\n", get_timestamp().c_str());
+            return false;
+        }
+        for (size_t i = 0; i < keys.size(); i++) invocation.prefetched.push_back(std::make_pair(keys[i], values[i]));
+        proxy_metrics().add("state_prefetched_keys", keys.size());
+    }
+
+    // 시작과 재개는 단계 작업으로 넘겨 워커가 다른 트랜잭션의 단계와 함께 TEE에 넣을 수 있게 한다
+    step_op op;
+    op.start = true;
+    op.invocation = &invocation;
+    op.deadline = &deadline;
+    // 단계의 키/값/응답은 TA 메일박스 크기를 넘지 않으므로 미리 잡아 두면 호스트콜마다 늘어나지 않는다
+    op.step.key.reserve(KEY_SIZE);
+    op.step.value.reserve(VAL_SIZE);
+    op.step.response.reserve(RESPONSE_SIZE);
+    int worker = -1;
+    TaskPtr task = make_task(RESERVE_TX_SLOT);
+    task->op = &op;
+    task->cls = classify(invocation);
+    bool read_only = task->cls.read_only;
+    submit(task, &worker);
+    if (op.result != TEEC_SUCCESS) {
+        release_slot(worker, read_only);
+        if (op.result == TEEC_ERROR_CANCEL) proxy_metrics().add("tx_cancelled", 1);
+        return false;
+    }
+
+    bool ok = true;
+    StateIterators iterators(state);
+    // TA가 페이지를 처리하는 동안 열린 반복자의 다음 묶음을 래퍼에서 받아 둔다
+    std::function<void()> prefetch = [&iterators]() { iterators.prefetch(); };
+    // 재개는 같은 작업을 다시 넘긴다 (시작으로 잡은 슬롯은 끝날 때 release_slot으로 돌려준다)
+    task->reserve = RESERVE_NONE;
+    static const ProxyMetrics::metric host_calls = proxy_metrics().find("tx_host_calls");
+    while (op.step.type != INVOCATION_RESPONSE) {
+        // 호스트콜 왕복은 워커 밖(이 스레드)에서 기다리고, 그동안 워커는 다른 트랜잭션을 실행.
+        // 응답은 워커 세션의 공유 메모리에 있는 이 슬롯의 메일박스에 바로 쓴다
+        tee_ctx* log_ctx = &workers_[worker]->ctx;
+        uint32_t slot = op.step.slot;
+        proxy_metrics().add(host_calls, 1);
+        if (!answer_host_call(log_ctx, state, op.step, &iterators) || deadline.expired()) {
+            // 호스트 응답 실패 또는 마감 초과: 세션은 그대로 두고 이 슬롯만 회수
+            if (deadline.expired()) op.result = TEEC_ERROR_CANCEL;
+            run_on(worker, [slot](tee_ctx* ctx) { return abort_transaction(ctx, slot) == TEEC_SUCCESS; });
+            ok = false;
+            break;
+        }
+        op.start = false;
+        submit_on(worker, task, prefetch);
+        if (op.result != TEEC_SUCCESS) {
+            // TA가 취소로 이미 회수한 슬롯이면 abort는 아무 일도 하지 않는다
+            run_on(worker, [slot](tee_ctx* ctx) { return abort_transaction(ctx, slot) == TEEC_SUCCESS; });
+            ok = false;
+            break;
+        }
+    }
+    release_slot(worker, read_only);
+    if (!ok && op.result == TEEC_ERROR_CANCEL) proxy_metrics().add("tx_cancelled", 1);
+
+    if (ok) {
+        response->assign(op.step.response);
+        record_usage(invocation, op.step.usage);
+        if (usage) *usage = op.step.usage;
+        if (op.step.usage.out_of_fuel) ok = false;
+    }
+    return ok;
+}
+
+bool TeeWorkerPool::simulate_batch(const std::vector<tx_invocation>& invocations, StateBackend* state,
+                                   std::vector<batch_result>* results, const tx_deadline& deadline)
+{
+    std::lock_guard<std::mutex> serial(batch_mutex_);
+
+    struct Chunk {
+        std::vector<tx_invocation> txs;
+        std::vector<size_t> index;  /* invocations에서의 위치 */
+        int worker;
+        bool failed;
+        batch_step step;
+    };
+
+    // 모듈별로 모은 뒤 워커들에 고르게 나눠 자른다 (묶음당 최대 BATCH_MAX_TX개)
+    std::map<std::string, size_t> per_module;
+    for (size_t i = 0; i < invocations.size(); i++) per_module[invocations[i].ta_module_id()]++;
+    for (std::map<std::string, size_t>::iterator it = per_module.begin(); it != per_module.end(); ++it) {
+        size_t even = (it->second + workers_.size() - 1) / workers_.size();
+        it->second = std::min(even, (size_t)BATCH_MAX_TX);
+    }
+
+    std::vector<Chunk> chunks;
+    std::map<std::string, size_t> filling;
+    for (size_t i = 0; i < invocations.size(); i++) {
+        const std::string& module_id = invocations[i].ta_module_id();
+        std::map<std::string, size_t>::iterator it = filling.find(module_id);
+        if (it == filling.end() || chunks[it->second].txs.size() == per_module[module_id]) {
+            chunks.push_back(Chunk());
+            chunks.back().worker = -1;
+            chunks.back().failed = false;
+            filling[module_id] = chunks.size() - 1;
+        }
+        Chunk& c = chunks[filling[module_id]];
+        c.txs.push_back(invocations[i]);
+        c.index.push_back(i);
+    }
+
+    results->assign(invocations.size(), batch_result());
+    bool ok = true;
+    size_t wave = workers_.size();
+    for (size_t first = 0; ok && first < chunks.size(); first += wave) {
+        // 한 번에 워커 수만큼의 묶음만 진행한다 (워커마다 배치 하나)
+        size_t last = std::min(chunks.size(), first + wave);
+        auto in_parallel = [&](const std::function<void(Chunk&)>& f) {
+            if (last - first == 1) {
+                f(chunks[first]);
+                return;
+            }
+            std::vector<std::thread> threads;
+            for (size_t i = first; i < last; i++) threads.push_back(std::thread(f, std::ref(chunks[i])));
+            for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+        };
+        auto fail = [this](Chunk& c) {
+            run_on(c.worker, [](tee_ctx* ctx) { return abort_batch(ctx) == TEEC_SUCCESS; });
+            c.failed = true;
+        };
+
+        in_parallel([&](Chunk& c) {
+            TaskPtr task = make_task(RESERVE_BATCH);
+            // 묶음은 모듈 하나의 호출들: 그 체인코드의 흐름에서 호출 수만큼 차지한다
+            task->cls = classify(c.txs[0]);
+            for (size_t j = 1; j < c.txs.size() && task->cls.read_only; j++) {
+                task->cls.read_only = classify(c.txs[j]).read_only;
+            }
+            task->cost = (uint32_t)c.txs.size();
+            TEEC_Result res = TEEC_ERROR_GENERIC;
+            task->job = [&](tee_ctx* ctx) {
+                res = start_batch(ctx, c.txs, &c.step);
+                return res == TEEC_SUCCESS;
+            };
+            submit(task, &c.worker);
+            if (res != TEEC_SUCCESS) fail(c);
+        });
+
+        // 라운드마다 모든 묶음이 멈춘 키를 모아 한 번에 읽는다
+        while (ok) {
+            std::vector<std::string> keys;
+            std::set<std::string> seen;
+            for (size_t i = first; i < last; i++) {
+                const Chunk& c = chunks[i];
+                if (c.failed || c.step.done) continue;
+                for (size_t k = 0; k < c.step.missing.size(); k++) {
+                    if (seen.insert(c.step.missing[k]).second) keys.push_back(c.step.missing[k]);
+                }
+            }
+            if (keys.empty()) break;
+
+            if (deadline.expired()) {
+                printf("%s 배치 마감 초과, 진행 중인 묶음 중단\n", get_timestamp().c_str());
+                for (size_t i = first; i < last; i++) {
+                    if (!chunks[i].failed && !chunks[i].step.done) fail(chunks[i]);
+                }
+                ok = false;
+                break;
+            }
+
+            std::vector<std::string> values;
+            if (!state->get_states(keys, &values) || values.size() != keys.size()) {
+                printf("%s 배치 상태 일괄 읽기 실패 (키 %zu개)\n", get_timestamp().c_str(), keys.size());
+                for (size_t i = first; i < last; i++) {
+                    if (!chunks[i].failed && !chunks[i].step.done) fail(chunks[i]);
+                }
+                ok = false;
+                break;
+            }
+            std::map<std::string, std::string> fetched;
+            for (size_t k = 0; k < keys.size(); k++) fetched[keys[k]] = values[k];
+
+            in_parallel([&](Chunk& c) {
+                if (c.failed || c.step.done) return;
+                kv_list supply;
+                for (size_t k = 0; k < c.step.missing.size(); k++) {
+                    supply.push_back(std::make_pair(c.step.missing[k], fetched[c.step.missing[k]]));
+                }
+                TEEC_Result res = TEEC_ERROR_GENERIC;
+                run_on(c.worker, [&](tee_ctx* ctx) {
+                    res = continue_batch(ctx, supply, &c.step);
+                    return res == TEEC_SUCCESS;
+                });
+                if (res != TEEC_SUCCESS) fail(c);
+            });
+        }
+
+        for (size_t i = first; i < last; i++) {
+            Chunk& c = chunks[i];
+            if (c.worker >= 0) release_batch(c.worker);
+            for (size_t j = 0; j < c.index.size(); j++) {
+                batch_result& r = (*results)[c.index[j]];
+                if (c.failed) {
+                    r.ok = false;
+                    r.response = "BATCH_FAILED";
+                } else {
+                    r = c.step.results[j];
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+namespace {
+
+/* 검증을 통과한 트랜잭션이 남긴 쓰기 하나 */
+struct batch_write {
+    std::string value;
+    size_t writer;      /* invocations에서의 위치 */
+};
+
+/*
+ * 낙관적 배치 실행의 한 라운드가 보는 상태: 검증을 통과한 앞 트랜잭션들의 쓰기(overlay)가
+ * 먼저 보이고, 나머지 키는 래퍼에서 읽는다. 래퍼에서 읽은 값과 버전은 snapshot에 남겨
+ * 다시 실행하는 라운드도 같은 원장 스냅숏을 보게 한다.
+ */
+class OverlayStateBackend : public StateBackend {
+public:
+    typedef std::map<std::string, std::pair<std::string, std::string> > Snapshot;
+
+    OverlayStateBackend(StateBackend* base, const std::map<std::string, batch_write>& overlay, Snapshot* snapshot)
+        : base_(base), overlay_(overlay), snapshot_(snapshot) {}
+
+    bool get_state(const std::string& key, std::string* value) override {
+        std::vector<std::string> values;
+        if (!get_states(std::vector<std::string>(1, key), &values)) return false;
+        *value = values[0];
+        return true;
+    }
+
+    bool put_state(const std::string&, const std::string&, std::string*) override {
+        return false;
+    }
+
+    bool get_states(const std::vector<std::string>& keys, std::vector<std::string>* values,
+                    std::vector<std::string>* versions = NULL) override {
+        std::vector<std::string> missing;
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (!overlay_.count(keys[i]) && !snapshot_->count(keys[i])) missing.push_back(keys[i]);
+        }
+        if (!missing.empty()) {
+            std::vector<std::string> v, ver;
+            if (!base_->get_states(missing, &v, &ver) || v.size() != missing.size()) return false;
+            ver.resize(missing.size());
+            for (size_t i = 0; i < missing.size(); i++) (*snapshot_)[missing[i]] = std::make_pair(v[i], ver[i]);
+        }
+
+        values->assign(keys.size(), std::string());
+        if (versions) versions->assign(keys.size(), std::string());
+        for (size_t i = 0; i < keys.size(); i++) {
+            std::map<std::string, batch_write>::const_iterator w = overlay_.find(keys[i]);
+            if (w != overlay_.end()) {
+                (*values)[i] = w->second.value;
+                if (versions) (*versions)[i] = "tx:" + std::to_string(w->second.writer);
+            } else {
+                const std::pair<std::string, std::string>& kv = (*snapshot_)[keys[i]];
+                (*values)[i] = kv.first;
+                if (versions) (*versions)[i] = kv.second;
+            }
+        }
+        return true;
+    }
+
+private:
+    StateBackend* base_;
+    const std::map<std::string, batch_write>& overlay_;
+    Snapshot* snapshot_;
+};
+
+}
+
+bool TeeWorkerPool::execute_batch(const std::vector<tx_invocation>& requested, StateBackend* state,
+                                  std::vector<batch_result>* results, const tx_deadline& deadline)
+{
+    // 재실행 라운드도 처음 잡은 모듈 버전으로 실행한다
+    std::vector<tx_invocation> invocations(requested);
+    std::vector<module_lease> modules;
+    for (size_t i = 0; i < invocations.size(); i++) {
+        module_lease module = modules_->acquire(invocations[i].aot_file);
+        if (!module) continue;
+        invocations[i].module_id = module->module_id;
+        modules.push_back(module);
+    }
+
+    const long BASE = -1;   /* 원장에서 읽은 값 */
+    size_t n = invocations.size();
+    OverlayStateBackend::Snapshot snapshot;
+    std::map<std::string, batch_write> overlay;          /* 검증을 통과한 앞 트랜잭션들의 쓰기 */
+    std::vector<std::map<std::string, long> > seen(n);  /* 실행 때 읽은 키마다 보인 쓰기 (BASE: 원장) */
+    results->assign(n, batch_result());
+
+    // 주어진 트랜잭션들을 지금의 overlay 위에서 함께 실행하고, 읽은 키마다 누구의 쓰기를 봤는지 남긴다
+    auto run_round = [&](const std::vector<size_t>& which) {
+        std::vector<tx_invocation> txs;
+        for (size_t j = 0; j < which.size(); j++) txs.push_back(invocations[which[j]]);
+        OverlayStateBackend view(state, overlay, &snapshot);
+        std::vector<batch_result> out;
+        if (!simulate_batch(txs, &view, &out, deadline)) return false;
+
+        for (size_t j = 0; j < which.size(); j++) {
+            size_t i = which[j];
+            out[j].executions = (*results)[i].executions + 1;
+            (*results)[i] = out[j];
+            batch_result& r = (*results)[i];
+            seen[i].clear();
+            for (size_t k = 0; k < r.read_set.size(); k++) {
+                const std::string& key = r.read_set[k].first;
+                std::map<std::string, batch_write>::const_iterator w = overlay.find(key);
+                seen[i][key] = w != overlay.end() ? (long)w->second.writer : BASE;
+                r.read_versions.push_back(w != overlay.end() ? "tx:" + std::to_string(w->second.writer)
+                                                             : snapshot[key].second);
+            }
+        }
+        return true;
+    };
+    // 읽은 키마다 앞 트랜잭션들의 마지막 쓰기가 실행 때 본 것과 같아야 직렬 실행과 같은 결과
+    auto consistent = [&](size_t i) {
+        for (std::map<std::string, long>::const_iterator it = seen[i].begin(); it != seen[i].end(); ++it) {
+            std::map<std::string, batch_write>::const_iterator w = overlay.find(it->first);
+            if ((w != overlay.end() ? (long)w->second.writer : BASE) != it->second) return false;
+        }
+        return true;
+    };
+
+    // 1) 모두를 같은 스냅숏 위에서 추측 실행
+    std::vector<size_t> all(n);
+    for (size_t i = 0; i < n; i++) all[i] = i;
+    if (!run_round(all)) return false;
+
+    // 2) 요청 순서로 검증하며 쓰기를 overlay에 올리고, 충돌한 트랜잭션만 다시 실행
+    size_t validated = 0;
+    long rounds = 1, reexecuted = 0;
+    while (true) {
+        while (validated < n && consistent(validated)) {
+            const batch_result& r = (*results)[validated];
+            if (r.ok) {
+                for (size_t k = 0; k < r.write_set.size(); k++) {
+                    batch_write& w = overlay[r.write_set[k].first];
+                    w.value = r.write_set[k].second;
+                    w.writer = validated;
+                }
+            }
+            validated++;
+        }
+        if (validated == n) break;
+
+        // 첫 충돌 트랜잭션은 반드시 다시 실행한다 (검증된 앞부분만 보므로 다음 검증을 통과).
+        // 뒤의 트랜잭션은 검증된 쓰기와 어긋나고, 아직 검증되지 않은 앞 트랜잭션이 쓰는 키를
+        // 읽지 않는 것만 함께 다시 실행한다 (같은 키를 잇는 트랜잭션은 한 라운드에 하나씩 순서대로)
+        std::vector<size_t> rerun(1, validated);
+        std::set<std::string> pending;
+        for (size_t k = validated; k < n; k++) {
+            if (k > validated) {
+                bool waits = false;
+                for (std::map<std::string, long>::const_iterator it = seen[k].begin(); it != seen[k].end(); ++it) {
+                    if (pending.count(it->first)) waits = true;
+                }
+                if (!waits && !consistent(k)) rerun.push_back(k);
+            }
+            const kv_list& writes = (*results)[k].write_set;
+            for (size_t j = 0; j < writes.size(); j++) pending.insert(writes[j].first);
+        }
+        if (deadline.expired()) {
+            printf("%s 배치 마감 초과: 검증된 트랜잭션 %zu / %zu\n", get_timestamp().c_str(), validated, n);
+            proxy_metrics().add("tx_cancelled", n - validated);
+            return false;
+        }
+        rounds++;
+        reexecuted += rerun.size();
+        if (!run_round(rerun)) return false;
+    }
+
+    for (size_t i = 0; i < n; i++) record_usage(invocations[i], (*results)[i].usage);
+    ProxyMetrics& m = proxy_metrics();
+    m.add("batch_transactions", n);
+    m.add("batch_rounds", rounds);
+    m.add("batch_reexecutions", reexecuted);
+    if (reexecuted > 0) {
+        printf("%s 배치 충돌 재실행: 트랜잭션 %zu개 중 %ld번, 라운드 %ld\n", get_timestamp().c_str(), n, reexecuted, rounds);
+    }
+    return true;
+}
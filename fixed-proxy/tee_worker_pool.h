@@ -0,0 +1,205 @@
+#ifndef TEE_WORKER_POOL_H
+#define TEE_WORKER_POOL_H
+
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "module_registry.h"
+#include "proxy_metrics.h"
+#include "tee_session.h"
+#include "work_class.h"
+
+/* 공유 큐 스케줄링 설정 */
+struct sched_options {
+    sched_options() : query_lane(1) {
+        read_only_prefixes.push_back("query");
+        read_only_prefixes.push_back("get");
+        read_only_prefixes.push_back("read");
+    }
+    uint32_t query_lane;                        /* 읽기-쓰기 트랜잭션이 쓸 수 없는 슬롯 수 (풀 전체) */
+    std::map<std::string, uint32_t> weights;    /* aot_file → 공정 큐 가중치 (없으면 1) */
+    std::vector<std::string> read_only_prefixes;
+};
+
+/*
+ * TEE 워커 풀: 워커 스레드마다 한 코어에 고정(pin)된 채 전용 TEE 세션을 연다.
+ * TA는 세션마다 별도 인스턴스로 뜨고 TEEC_InvokeCommand를 호출한 코어에서 실행되므로
+ * 워커 수만큼의 트랜잭션이 서로 다른 코어에서 동시에 실행된다.
+ * gRPC 핸들러 스레드는 execute()로 트랜잭션을 넘긴다. TA 세션마다 TA_TX_SLOTS개의
+ * 트랜잭션이 상주할 수 있어, 한 트랜잭션이 호스트콜(GET/PUT) 왕복을 기다리는 동안
+ * 같은 워커는 다른 트랜잭션을 시작하거나 재개한다.
+ *
+ * 마이크로 배칭: 워커는 시작/재개 단계를 하나 꺼내면 짧은 창(window) 동안 이 세션에서
+ * 실행할 수 있는 단계를 더 모아(최대 TA_TX_SLOTS개) TEE에 한 번만 들어간다.
+ * 창은 워커마다 적응적으로 조절된다: 두 개 이상 모이면 늘리고(최대 max_window_us),
+ * 혼자 나가면 절반으로 줄여 부하가 적을 때는 지연을 더하지 않는다.
+ *
+ * 스케줄링: 공유 큐의 시작 작업은 체인코드(aot_file)별 흐름으로 나눠 가중 공정 큐
+ * (start-time fair queuing)로 꺼내므로, 한 체인코드의 긴 배치나 폭주가 다른 체인코드를
+ * 굶기지 않는다. 읽기 전용(조회) 작업은 우선 차선으로 먼저 꺼내고, 풀 전체 슬롯 중
+ * query_lane개는 조회만 쓸 수 있어 읽기-쓰기 트랜잭션이 슬롯을 모두 차지해도 조회가
+ * 바로 들어간다. 조회에 밀린 읽기-쓰기 작업도 STARVATION_MS가 지나면 같은 차선으로 올라간다.
+ */
+class TeeWorkerPool {
+public:
+    typedef std::function<bool(tee_ctx*)> Job;
+
+    static const uint32_t DEFAULT_BATCH_WINDOW_US = 200;
+
+    /*
+     * workers <= 0 이면 온라인 코어 수만큼 만든다. 모든 세션이 열린 뒤 반환.
+     * max_window_us: 마이크로 배칭 창의 상한 (0이면 이미 쌓인 단계만 묶는다)
+     * fuel_limit: 계량 모듈의 트랜잭션당 연료 한도 (0이면 없음)
+     * ta_uuid: 세션을 열 TA (NULL이면 TA_WAMR_UUID)
+     */
+    TeeWorkerPool(int workers, uint32_t heap_size, bool quiet = false,
+                  uint32_t max_window_us = DEFAULT_BATCH_WINDOW_US, uint64_t fuel_limit = 0,
+                  const sched_options& sched = sched_options(), const TEEC_UUID* ta_uuid = NULL);
+    ~TeeWorkerPool();
+
+    /*
+     * 트랜잭션 하나를 끝까지 실행한다. 시작은 빈 슬롯이 있는 워커에서, 재개는 슬롯이 있는
+     * 같은 워커에서 하고, 호스트콜 응답(state)은 호출한 스레드에서 기다린다.
+     * deadline이 지나거나 취소되면 슬롯을 회수하고 false (세션은 유지).
+     * 연료 한도를 넘어도 false이고 usage->out_of_fuel이 참이다.
+     * 시작 뒤 호스트콜마다의 재개는 힙 할당 없이 돈다 (작업 하나를 트랜잭션 끝까지 다시 쓴다)
+     */
+    bool execute(tx_invocation invocation, StateBackend* state, std::string* response,
+                 const tx_deadline& deadline = tx_deadline(), tx_usage* usage = NULL);
+    bool execute(const std::string& aot_file, const std::string& function_name,
+                 const std::vector<std::string>& args, StateBackend* state,
+                 std::string* response, const tx_deadline& deadline = tx_deadline(),
+                 tx_usage* usage = NULL);
+
+    /*
+     * 여러 호출을 배치로 낙관적으로 실행한다. 먼저 모두를 같은 원장 스냅숏 위에서 워커들에
+     * 나눠 동시에 실행한 뒤 요청 순서로 read set을 검증한다. 앞 트랜잭션의 쓰기를 읽었어야
+     * 하는 트랜잭션만 그 쓰기를 보이게 해 다시 실행하므로 결과는 요청 순서의 직렬 실행과 같다.
+     * 결과는 invocations 순서. 상태 읽기가 실패하거나 라운드 사이에 deadline이 지나면 false
+     */
+    bool execute_batch(const std::vector<tx_invocation>& invocations, StateBackend* state,
+                       std::vector<batch_result>* results, const tx_deadline& deadline = tx_deadline());
+
+    /* 먼저 비는 워커에서 job을 실행한다 (worker에 실행한 워커 번호) */
+    bool run(const Job& job, int* worker = NULL);
+    /* 지정한 워커에서 job을 실행한다 (슬롯 재개/회수) */
+    bool run_on(int worker, const Job& job);
+    /* 모든 워커(= 모든 TA 인스턴스)에서 job을 한 번씩 실행한다 (예: 모듈 예열) */
+    bool run_on_each(const Job& job);
+
+    int size() const { return (int)workers_.size(); }
+
+    /* 지금 새 호출이 실행할 aot_file의 모듈 id (버전이 바뀌면 결과 캐시 키도 바뀐다) */
+    std::string current_module_id(const std::string& aot_file);
+    /* 트래픽을 받기 전 aot_file을 모든 TA 인스턴스에 로드하고 instances개씩 인스턴스화해 둔다 */
+    bool warm_module(const std::string& aot_file, uint32_t instances, std::string* module_id, uint32_t* ready)
+    {
+        return modules_->warm(aot_file, instances, module_id, ready);
+    }
+
+    /* 호출의 스케줄링 분류 (수락 제어의 우선순위에도 쓴다) */
+    work_class classify(const tx_invocation& invocation) { return classifier_.classify(invocation); }
+
+private:
+    /* 공유 큐의 작업이 워커에서 예약하는 TA 자원 */
+    enum Reserve {
+        RESERVE_NONE,
+        RESERVE_TX_SLOT,    /* 트랜잭션 시작: 빈 슬롯이 있는 워커만 가져간다 */
+        RESERVE_BATCH,      /* 배치 시작: 진행 중인 배치가 없는 워커만 가져간다 */
+    };
+
+    struct Task {
+        Job job;
+        step_op* op;        /* job 대신 실행할 트랜잭션 단계 (다른 단계와 묶일 수 있음) */
+        Reserve reserve;
+        work_class cls;     /* 공정 큐의 흐름과 차선 */
+        uint32_t cost;      /* 공정 큐에서의 크기 (트랜잭션 수) */
+        double start_tag;   /* 공정 큐 시작 태그: 작은 것부터 꺼낸다 */
+        int worker;         /* 실행한 워커 */
+        std::chrono::steady_clock::time_point queued;
+        /* 끝나면 finish()가 mutex_ 아래에서 채운다 (같은 작업을 다시 넘기면 submit이 되돌린다) */
+        bool finished;
+        bool ok;
+        std::condition_variable done;
+    };
+    typedef std::shared_ptr<Task> TaskPtr;
+
+    struct Worker {
+        int index;
+        int cpu;
+        tee_ctx ctx;
+        std::vector<TaskPtr> pinned;  /* run_on/run_on_each로 이 워커에 지정된 작업 (앞이 먼저) */
+        int inflight;                 /* 호스트콜을 기다리며 TA에 남아 있는 트랜잭션 수 */
+        bool batch_busy;              /* 이 세션의 TA에 배치가 진행 중 */
+        uint32_t window_us;           /* 현재 마이크로 배칭 창 */
+        /* 한 번에 TEE에 넣을 단계 묶음: 워커 스레드만 쓰고 용량을 다시 쓴다 */
+        std::vector<TaskPtr> group;
+        std::vector<step_op*> ops;
+        ProxyMetrics::metric window_metric;   /* microbatch_window_us{worker=N} */
+        std::thread thread;
+    };
+
+    /*
+     * 호출들을 모듈별로 묶어 워커마다 한 묶음씩 동시에 돌리고, 라운드마다 모든 묶음이 멈춘
+     * 키를 모아 state->get_states로 한 번에 읽는다 (모두 같은 state를 본다).
+     * 풀마다 한 번에 하나만 돈다 (batch_mutex_)
+     */
+    bool simulate_batch(const std::vector<tx_invocation>& invocations, StateBackend* state,
+                        std::vector<batch_result>* results, const tx_deadline& deadline);
+    void worker_main(Worker* w);
+    void open_session(Worker* w);
+    void restart_if_needed(Worker* w);
+    std::deque<TaskPtr>::iterator pick_shared(const Worker* w, bool steps_only);
+    bool can_take(const Worker* w, const Task& task) const;
+    void take_shared(Worker* w, const TaskPtr& task);
+    TaskPtr take_step(Worker* w);
+    void collect_steps(Worker* w, std::unique_lock<std::mutex>& lock, std::vector<TaskPtr>* group);
+    void run_group(Worker* w, const std::vector<TaskPtr>& group);
+    void adapt_window(Worker* w, size_t group_size);
+    TaskPtr make_task(Reserve reserve);
+    void finish(const TaskPtr& task, bool ok);
+    bool wait(const TaskPtr& task);
+    bool submit(const TaskPtr& task, int* worker);
+    /* meanwhile: 작업을 넘긴 뒤 끝나기를 기다리기 전에 이 스레드에서 할 일 (예: 반복자 미리 읽기) */
+    bool submit_on(int worker, const TaskPtr& task, const std::function<void()>& meanwhile = std::function<void()>());
+    void release_slot(int worker, bool read_only);
+    void release_batch(int worker);
+
+    uint32_t heap_size_;
+    bool quiet_;
+    uint32_t max_window_us_;
+    uint64_t fuel_limit_;
+    bool has_ta_uuid_;
+    TEEC_UUID ta_uuid_;
+    WorkClassifier classifier_;
+    std::map<std::string, uint32_t> weights_;
+    int rw_slot_limit_;                     /* 읽기-쓰기 트랜잭션이 쓸 수 있는 슬롯 수 (풀 전체) */
+
+    /*
+     * simulate_batch를 풀마다 하나씩 돌린다. 한 파(wave)의 묶음은 모두 시작해야 라운드를 진행하므로
+     * 두 배치가 워커를 나눠 잡으면 서로 상대가 잡은 워커를 기다리며 멈춘다
+     */
+    std::mutex batch_mutex_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<TaskPtr> queue_;
+    double virtual_time_;                   /* 공정 큐 가상 시간: 마지막에 꺼낸 작업의 시작 태그 */
+    std::map<std::string, double> flow_finish_;  /* 흐름마다 마지막 작업의 종료 태그 */
+    int rw_inflight_;                       /* 슬롯을 차지한 읽기-쓰기 트랜잭션 수 */
+    bool stopping_;
+    int ready_;
+    std::condition_variable ready_cv_;
+
+    std::vector<std::unique_ptr<Worker> > workers_;
+    std::unique_ptr<ModuleRegistry> modules_;   /* 워커 풀이 멈추기 전에 먼저 정리한다 */
+};
+
+#endif /* TEE_WORKER_POOL_H */
@@ -0,0 +1,225 @@
+/*
+ * 호스트콜 경로 할당 검사 (make check): 트랜잭션 N개를 서버와 같은 경로(StreamStateBackend →
+ * CachingStateBackend → 워커 풀, 마감 있음)로 루프백 래퍼에 차례로 실행하고, 예열 뒤 호스트콜마다
+ * operator new가 0번인지 확인한다 (아니면 1로 끝난다). 호스트콜 응답을 워커 세션의 등록된 공유 메모리
+ * (슬롯 메일박스)에 쓰고 재개해 다음 요청이 나오기까지가 한 구간이다.
+ * 체인코드 로그를 남기는 함수는 로그 수집의 할당도 함께 세진다.
+ * -c는 상태 캐시 키 수 (기본 0: 모든 GET이 래퍼로 간다. 캐시를 켜면 미스가 캐시를 채우며 할당한다)
+ *   hostcall_alloc_test [-n 트랜잭션수] [-c 캐시키수] <aot_file> <function> [args...]
+ * 보드(OP-TEE TA와 서명된 모듈이 ./chaincode/에 있는 곳)에서 실행한다.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../state_cache.h"
+#include "../stream_state.h"
+#include "../tee_session.h"
+#include "../tee_worker_pool.h"
+
+using invocation::ChaincodeProxyMessage;
+using invocation::ChaincodeWrapperMessage;
+using invocation::GetStateResponse;
+
+/* 서버(main.cpp)와 같은 값 */
+static const uint32_t TA_HEAP_SIZE = 10 * 1024 * 1024;
+static const uint32_t TX_TIMEOUT_MS = 30 * 1000;
+static const size_t STATE_CACHE_MAX_VALUE_SIZE = 64 * 1024;
+
+/*
+ * 프로세스 전체의 operator new 횟수. heap_count_pause가 살아 있는 동안 그 스레드의 할당은 세지 않는다
+ * (루프백 래퍼가 원장에서 응답을 만드는 동안만: 실제로는 chaincode_wrapper 프로세스의 일이다)
+ */
+static std::atomic<unsigned long> heap_allocations(0);
+static thread_local bool heap_count_paused = false;
+
+void* operator new(size_t size)
+{
+    if (!heap_count_paused) heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+#endif
+
+struct heap_count_pause {
+    heap_count_pause() : was(heap_count_paused) { heap_count_paused = true; }
+    ~heap_count_pause() { heap_count_paused = was; }
+    bool was;
+};
+
+/*
+ * 루프백 chaincode_wrapper: 메모리 안의 원장으로 바로 답한다 (없는 키는 빈 값, 반복자는 빈 페이지).
+ * 전송만 흉내 낸다: 요청은 gRPC처럼 버퍼에 직렬화하고, 응답은 Read에서 프록시가 넘긴 (재사용하는)
+ * 메시지에 ParseFromString으로 디코드한다. 둘 다 센다. 세지 않는 것은 원장에서 응답을 만드는 일뿐이다.
+ * 호스트콜 요청마다 그 뒤 트랜잭션의 다음 요청(또는 end_transaction)까지의 할당을 모은다
+ */
+class LoopbackStream : public TransactionStream {
+public:
+    LoopbackStream() : measuring_(false), marked_(false), mark_(0), intervals_(0), allocations_(0), worst_(0) {}
+
+    void measure(bool on) { measuring_ = on; }
+    long intervals() const { return intervals_; }
+    unsigned long allocations() const { return allocations_; }
+    unsigned long worst() const { return worst_; }
+
+    void SendInitialMetadata() override {}
+
+    bool NextMessageSize(uint32_t* sz) override {
+        *sz = (uint32_t)reply_.size();
+        return true;
+    }
+
+    bool Read(ChaincodeWrapperMessage* msg) override {
+        return msg->ParseFromString(reply_);
+    }
+
+    bool Write(const ChaincodeProxyMessage& msg, grpc::WriteOptions) override {
+        if (!msg.SerializeToString(&request_)) return false;
+        close_interval(heap_allocations.load());
+        heap_count_pause pause;
+        // 최종 응답이나 읽기 확인이면 트랜잭션의 호스트콜은 끝났다
+        marked_ = msg.has_get_state_request() || msg.has_put_state_request() ||
+                  msg.has_open_iterator_request() || msg.has_next_page_request();
+        answer(msg);
+        mark_ = heap_allocations.load();
+        return true;
+    }
+
+    /* 트랜잭션 실행이 끝났다: 마지막 호스트콜의 구간을 닫는다 */
+    void end_transaction() {
+        close_interval(heap_allocations.load());
+        marked_ = false;
+    }
+
+private:
+    void close_interval(unsigned long now) {
+        if (!marked_ || !measuring_) return;
+        unsigned long n = now - mark_;
+        intervals_++;
+        allocations_ += n;
+        worst_ = std::max(worst_, n);
+    }
+
+    void answer(const ChaincodeProxyMessage& msg) {
+        ChaincodeWrapperMessage reply;
+        if (msg.has_get_state_request()) {
+            std::map<std::string, std::pair<std::string, uint64_t> >::const_iterator it =
+                ledger_.find(msg.get_state_request().key());
+            GetStateResponse* response = reply.mutable_get_state_response();
+            if (it != ledger_.end()) {
+                response->set_value(it->second.first);
+                response->set_version(std::to_string(it->second.second));
+            }
+        } else if (msg.has_put_state_request()) {
+            std::pair<std::string, uint64_t>& entry = ledger_[msg.put_state_request().key()];
+            entry.first = msg.put_state_request().value();
+            entry.second++;
+            reply.mutable_put_state_response()->set_acknowledgement("OK");
+        } else if (msg.has_validate_reads_request()) {
+            // 원장은 프록시를 지난 쓰기로만 바뀌므로 캐시에서 내준 읽기는 낡지 않는다
+            reply.mutable_validate_reads_response();
+        } else if (msg.has_open_iterator_request() || msg.has_next_page_request()) {
+            reply.mutable_iterator_page()->set_iterator_id(msg.has_open_iterator_request() ?
+                msg.open_iterator_request().iterator_id() : msg.next_page_request().iterator_id());
+        }
+        reply.SerializeToString(&reply_);
+    }
+
+    std::map<std::string, std::pair<std::string, uint64_t> > ledger_;  /* 키 → (값, 버전) */
+    std::string request_;   /* gRPC가 보낼 요청 바이트 (재사용) */
+    std::string reply_;
+    bool measuring_;
+    bool marked_;           /* 이 트랜잭션의 앞 호스트콜 요청 뒤 */
+    unsigned long mark_;    /* 그때의 할당 수 */
+    long intervals_;
+    unsigned long allocations_;
+    unsigned long worst_;
+};
+
+int main(int argc, char *argv[])
+{
+    const int warmup = 3;
+    int total = 200;
+    int cache_entries = 0;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            total = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            cache_entries = atoi(argv[++i]);
+        } else {
+            positional.push_back(argv[i]);
+        }
+    }
+    if (positional.size() < 2 || total <= 0 || cache_entries < 0) {
+        printf("사용법: %s [-n 트랜잭션수] [-c 캐시키수] <aot_file> <function> [args...]\n", argv[0]);
+        return 1;
+    }
+    tx_invocation inv;
+    inv.aot_file = positional[0];
+    inv.function_name = positional[1];
+    inv.args.assign(positional.begin() + 2, positional.end());
+
+    // 서버의 예열 목록과 같이 서명을 확인받아 설치하고 TA 인스턴스에 로드한다
+    TeeWorkerPool pool(1, TA_HEAP_SIZE, true);
+    std::string module_id;
+    uint32_t ready = 0;
+    if (!pool.warm_module(inv.aot_file, 1, &module_id, &ready)) {
+        printf("%s 모듈 배포 실패: %s (<aot_file>.sig 서명과 TA 공개 키 확인)\n", get_timestamp().c_str(),
+               inv.aot_file.c_str());
+        return 1;
+    }
+
+    LoopbackStream stream;
+    StateCache cache((size_t)cache_entries, STATE_CACHE_MAX_VALUE_SIZE);
+    int failed = 0;
+    std::string response;   // 서버에서 응답은 gRPC 메시지로 나가므로 트랜잭션마다 새로 잡지 않는다
+    for (int i = 0; i < warmup + total; i++) {
+        stream.measure(i >= warmup);
+        StreamStateBackend wrapper_state(&stream);
+        CachingStateBackend state(&wrapper_state, &cache);
+        tx_deadline deadline;
+        deadline.at = std::chrono::steady_clock::now() + std::chrono::milliseconds(TX_TIMEOUT_MS);
+        tx_usage usage;
+        if (!pool.execute(inv, &state, &response, deadline, &usage)) failed++;
+        stream.end_transaction();
+    }
+
+    printf("\n%8s %8s %12s %12s %10s\n", "tx", "failed", "host-calls", "allocations", "worst");
+    printf("%8d %8d %12ld %12lu %10lu\n\n", total, failed, stream.intervals(), stream.allocations(), stream.worst());
+    if (failed) {
+        printf("%s 실패한 트랜잭션 %d개\n", get_timestamp().c_str(), failed);
+        return 1;
+    }
+    if (stream.intervals() == 0) {
+        printf("%s 래퍼로 나가는 호스트콜이 없는 함수여서 잴 구간이 없음\n", get_timestamp().c_str());
+        return 1;
+    }
+    if (stream.allocations() > 0) {
+        printf("%s ❌ 호스트콜 경로에서 힙 할당 %lu번 (호스트콜당 최대 %lu번)\n", get_timestamp().c_str(),
+               stream.allocations(), stream.worst());
+        return 1;
+    }
+    printf("%s ✅ 호스트콜 경로에서 힙 할당 없음\n", get_timestamp().c_str());
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+
+#include "proxy_metrics.h"
+#include "warmup.h"
+
+/* 32자리 hex → 16바이트 (하이픈은 건너뛴다) */
+static bool parse_uuid(const std::string& hex, std::string* bytes)
+{
+    std::string digits;
+    for (size_t i = 0; i < hex.size(); i++) {
+        if (hex[i] != '-') digits += hex[i];
+    }
+    if (digits.size() != 32) return false;
+    bytes->clear();
+    for (size_t i = 0; i < digits.size(); i += 2) {
+        char* end;
+        std::string pair = digits.substr(i, 2);
+        long v = strtol(pair.c_str(), &end, 16);
+        if (*end) return false;
+        *bytes += (char)v;
+    }
+    return true;
+}
+
+bool Warmup::read_manifest(const std::string& path, uint32_t default_instances, std::vector<warmup_entry>* entries)
+{
+    std::ifstream manifest(path.c_str());
+    if (!manifest) return false;
+
+    std::string line;
+    while (std::getline(manifest, line)) {
+        std::istringstream words(line.substr(0, line.find('#')));
+        warmup_entry entry;
+        std::string word;
+        if (!(words >> entry.aot_file)) continue;
+        entry.instances = default_instances;
+        bool valid = true;
+        while (valid && words >> word) {
+            if (word.compare(0, 10, "instances=") == 0) {
+                entry.instances = (uint32_t)strtoul(word.c_str() + 10, NULL, 10);
+            } else if (word.compare(0, 5, "uuid=") == 0) {
+                valid = parse_uuid(word.substr(5), &entry.chaincode_uuid);
+            } else {
+                valid = false;
+            }
+        }
+        if (!valid) {
+            printf("%s 경고: %s의 잘못된 줄 무시: %s\n", get_timestamp().c_str(), path.c_str(), line.c_str());
+            continue;
+        }
+        entries->push_back(entry);
+    }
+    return true;
+}
+
+bool Warmup::run(ChaincodePools& pools, const std::vector<warmup_entry>& entries)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < entries.size(); i++) {
+        warmup_result result;
+        result.entry = entries[i];
+        result.module_id = entries[i].aot_file;
+
+        std::shared_ptr<TeeWorkerPool> pool;
+        if (pools.acquire(entries[i].chaincode_uuid, &pool) != ChaincodePools::OK) {
+            printf("%s 예열 실패: %s (체인코드 TA를 열 수 없음)\n", get_timestamp().c_str(),
+                   entries[i].aot_file.c_str());
+        } else {
+            if (!entries[i].chaincode_uuid.empty()) pinned_.push_back(pool);
+            result.workers = pool->size();
+            result.ok = pool->warm_module(entries[i].aot_file, entries[i].instances, &result.module_id, &result.ready);
+            printf("%s 예열%s: %s (워커 %d개, 미리 만든 인스턴스 %u개)\n", get_timestamp().c_str(),
+                   result.ok ? "" : " 실패", result.module_id.c_str(), result.workers, result.ready);
+        }
+        results_.push_back(result);
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    proxy_metrics().set("warmup_ms", ms);
+    if (!entries.empty()) {
+        printf("%s 예열 완료: 모듈 %zu개, %.1fms%s\n", get_timestamp().c_str(), entries.size(), ms,
+               ok() ? "" : " (일부 실패)");
+    }
+    return ok();
+}
+
+bool Warmup::ok() const
+{
+    for (size_t i = 0; i < results_.size(); i++) {
+        if (!results_[i].ok) return false;
+    }
+    return true;
+}
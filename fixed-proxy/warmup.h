@@ -0,0 +1,54 @@
+#ifndef WARMUP_H
+#define WARMUP_H
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "chaincode_pools.h"
+
+/* 기본 예열 목록 (있으면 읽는다) */
+#define DEFAULT_WARMUP_MANIFEST "./chaincode/warmup.manifest"
+
+/* 예열 목록의 한 줄: <aot_file> [instances=N] [uuid=<32자리 hex>] */
+struct warmup_entry {
+    warmup_entry() : instances(0) {}
+    std::string aot_file;
+    uint32_t instances;         /* TA 인스턴스(워커)마다 미리 만들 인스턴스 수 */
+    std::string chaincode_uuid; /* 16바이트, "": 기본 풀 */
+};
+
+/* 예열한 모듈 하나의 결과 (Health RPC가 알려 준다) */
+struct warmup_result {
+    warmup_result() : workers(0), ready(0), ok(false) {}
+    warmup_entry entry;
+    std::string module_id;
+    int workers;
+    uint32_t ready;             /* 모든 워커에 준비된 인스턴스 수 */
+    bool ok;
+};
+
+/*
+ * 서버가 포트를 열기 전에 예열 목록의 모듈을 워커 풀마다 설치/로드하고 인스턴스를 미리 만든다.
+ * 그러면 첫 트래픽도 모듈 로드나 인스턴스화 없이 실행한다.
+ * chaincode_uuid 풀은 예열하면서 열고 서버가 끝날 때까지 닫지 않는다 (idle_timeout_s 무시).
+ */
+class Warmup {
+public:
+    /* path를 읽는다. 파일이 없으면 빈 목록 (default_instances: instances=가 없는 줄) */
+    static bool read_manifest(const std::string& path, uint32_t default_instances,
+                              std::vector<warmup_entry>* entries);
+
+    /* 모두 예열한다. 하나라도 실패하면 false (서버는 degraded로 계속 뜬다) */
+    bool run(ChaincodePools& pools, const std::vector<warmup_entry>& entries);
+
+    const std::vector<warmup_result>& results() const { return results_; }
+    bool ok() const;
+
+private:
+    std::vector<warmup_result> results_;
+    std::vector<std::shared_ptr<TeeWorkerPool> > pinned_;   /* 예열한 체인코드 풀 */
+};
+
+#endif /* WARMUP_H */
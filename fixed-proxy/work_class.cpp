@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include "work_class.h"
+
+/* 모듈/manifest 파일이 바뀌었는지 다시 확인하는 간격 */
+static const std::chrono::seconds RECHECK_INTERVAL(1);
+/* 모듈이 상태를 쓰려면 이 호스트 함수를 import해야 한다 (AOT 파일의 import 이름 문자열) */
+static const char WRITE_IMPORT[] = "cc_put_state";
+
+static long file_mtime(const std::string& path)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return -1;
+    return (long)st.st_mtime;
+}
+
+WorkClassifier::WorkClassifier(const std::vector<std::string>& read_only_prefixes)
+    : read_only_prefixes_(read_only_prefixes)
+{
+}
+
+void WorkClassifier::load(const std::string& aot_file, module_info* info)
+{
+    std::string aot_path = "./chaincode/" + aot_file;
+    info->writes = true;
+    info->read_only.clear();
+    info->read_write.clear();
+    info->prefetch.clear();
+    info->ree.clear();
+
+    std::ifstream module(aot_path.c_str(), std::ios::binary);
+    if (module) {
+        std::string bytes((std::istreambuf_iterator<char>(module)), std::istreambuf_iterator<char>());
+        info->writes = bytes.find(WRITE_IMPORT) != std::string::npos;
+    }
+
+    std::ifstream manifest((aot_path + ".manifest").c_str());
+    std::string line;
+    while (std::getline(manifest, line)) {
+        std::istringstream words(line.substr(0, line.find('#')));
+        std::string kind, function;
+        if (!(words >> kind)) continue;
+        if (kind == "prefetch") {
+            std::string expr;
+            prefetch_rule rule;
+            if (!(words >> function) || !std::getline(words, expr) || !parse_prefetch(expr, &rule)) {
+                printf("%s 경고: %s.manifest의 잘못된 prefetch 규칙 무시: %s\n", get_timestamp().c_str(),
+                       aot_path.c_str(), line.c_str());
+                continue;
+            }
+            info->prefetch[function].push_back(rule);
+            continue;
+        }
+        std::set<std::string>* target = kind == "read-only" ? &info->read_only
+                                      : kind == "read-write" ? &info->read_write
+                                      : kind == "ree" ? &info->ree : NULL;
+        if (!target) {
+            printf("%s 경고: %s.manifest의 알 수 없는 항목 무시: %s\n", get_timestamp().c_str(), aot_path.c_str(),
+                   kind.c_str());
+            continue;
+        }
+        while (words >> function) target->insert(function);
+    }
+
+    size_t rules = 0;
+    for (std::map<std::string, std::vector<prefetch_rule> >::const_iterator it = info->prefetch.begin();
+         it != info->prefetch.end(); ++it) {
+        rules += it->second.size();
+    }
+    printf("%s 작업 분류: %s (%s, manifest 읽기 전용 %zu개 / 읽기-쓰기 %zu개 / prefetch 규칙 %zu개 / REE %zu개)\n",
+           get_timestamp().c_str(), aot_file.c_str(), info->writes ? "cc_put_state 사용" : "읽기 전용 모듈",
+           info->read_only.size(), info->read_write.size(), rules, info->ree.size());
+}
+
+/* "arg0", "\"prefix:\" + arg1" 처럼 +로 이은 항들 */
+bool WorkClassifier::parse_prefetch(const std::string& expr, prefetch_rule* rule)
+{
+    size_t i = 0;
+    bool want_term = true;
+    while (i < expr.size()) {
+        char c = expr[i];
+        if (c == ' ' || c == '\t' || c == '\r') {
+            i++;
+        } else if (!want_term && c == '+') {
+            want_term = true;
+            i++;
+        } else if (want_term && c == '"') {
+            size_t end = expr.find('"', i + 1);
+            if (end == std::string::npos) return false;
+            prefetch_term term;
+            term.literal = expr.substr(i + 1, end - i - 1);
+            rule->push_back(term);
+            want_term = false;
+            i = end + 1;
+        } else if (want_term && expr.compare(i, 3, "arg") == 0) {
+            size_t end = i + 3;
+            while (end < expr.size() && expr[end] >= '0' && expr[end] <= '9') end++;
+            if (end == i + 3) return false;
+            prefetch_term term;
+            term.arg = atoi(expr.substr(i + 3, end - i - 3).c_str());
+            rule->push_back(term);
+            want_term = false;
+            i = end;
+        } else {
+            return false;
+        }
+    }
+    return !rule->empty() && !want_term;
+}
+
+const WorkClassifier::module_info& WorkClassifier::module(const std::string& aot_file)
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::map<std::string, module_info>::iterator it = modules_.find(aot_file);
+    if (it != modules_.end() && now - it->second.checked < RECHECK_INTERVAL) return it->second;
+
+    std::string aot_path = "./chaincode/" + aot_file;
+    long module_mtime = file_mtime(aot_path);
+    long manifest_mtime = file_mtime(aot_path + ".manifest");
+    if (it == modules_.end() || it->second.module_mtime != module_mtime || it->second.manifest_mtime != manifest_mtime) {
+        module_info& info = modules_[aot_file];
+        info.module_mtime = module_mtime;
+        info.manifest_mtime = manifest_mtime;
+        load(aot_file, &info);
+        it = modules_.find(aot_file);
+    }
+    it->second.checked = now;
+    return it->second;
+}
+
+work_class WorkClassifier::classify(const tx_invocation& invocation)
+{
+    work_class cls;
+    cls.chaincode = invocation.aot_file;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    const module_info& info = module(invocation.aot_file);
+    if (info.read_write.count(invocation.function_name)) {
+        cls.read_only = false;
+    } else if (info.read_only.count(invocation.function_name) || !info.writes) {
+        cls.read_only = true;
+    } else {
+        for (size_t i = 0; i < read_only_prefixes_.size(); i++) {
+            if (invocation.function_name.compare(0, read_only_prefixes_[i].size(), read_only_prefixes_[i]) == 0) {
+                cls.read_only = true;
+                break;
+            }
+        }
+    }
+    return cls;
+}
+
+std::vector<std::string> WorkClassifier::prefetch_keys(const tx_invocation& invocation)
+{
+    std::vector<std::string> keys;
+    std::lock_guard<std::mutex> lock(mutex_);
+    const module_info& info = module(invocation.aot_file);
+    const char* functions[] = { invocation.function_name.c_str(), "*" };
+    for (size_t f = 0; f < 2; f++) {
+        std::map<std::string, std::vector<prefetch_rule> >::const_iterator rules = info.prefetch.find(functions[f]);
+        if (rules == info.prefetch.end()) continue;
+        for (size_t r = 0; r < rules->second.size(); r++) {
+            const prefetch_rule& rule = rules->second[r];
+            std::string key;
+            bool complete = true;
+            for (size_t t = 0; t < rule.size() && complete; t++) {
+                if (rule[t].arg < 0) key += rule[t].literal;
+                else if ((size_t)rule[t].arg < invocation.args.size()) key += invocation.args[rule[t].arg];
+                else complete = false;
+            }
+            if (complete && !key.empty() && std::find(keys.begin(), keys.end(), key) == keys.end()) {
+                keys.push_back(key);
+            }
+        }
+    }
+    return keys;
+}
+
+bool WorkClassifier::runs_in_ree(const tx_invocation& invocation)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const module_info& info = module(invocation.aot_file);
+    return info.ree.count("*") || info.ree.count(invocation.function_name);
+}
@@ -0,0 +1,80 @@
+#ifndef WORK_CLASS_H
+#define WORK_CLASS_H
+
+#include <stdint.h>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "tee_session.h"
+
+/* 스케줄링 분류: 어느 체인코드의 작업인지(공정 큐의 흐름)와 읽기 전용(조회) 여부 */
+struct work_class {
+    work_class() : read_only(false) {}
+    std::string chaincode;  /* 흐름 키 = aot_file (generic job은 "") */
+    bool read_only;
+};
+
+/*
+ * manifest의 prefetch 규칙 하나: 항들을 이어 붙인 것이 키다.
+ * 항은 arg<N>(호출 인자, cc_get_arg와 같은 번호) 또는 "문자열"이다
+ */
+struct prefetch_term {
+    prefetch_term() : arg(-1) {}
+    int arg;                /* -1이면 literal */
+    std::string literal;
+};
+typedef std::vector<prefetch_term> prefetch_rule;
+
+/*
+ * 호출을 분류한다. 다음 순서로 읽기 전용인지 정한다.
+ *   1. ./chaincode/<aot_file>.manifest 의 "read-only <함수>..." / "read-write <함수>..." 줄
+ *   2. 모듈이 cc_put_state를 import하지 않으면 모든 함수가 읽기 전용
+ *   3. 함수 이름이 read_only_prefixes 중 하나로 시작 (기본: query, get, read)
+ * 분류는 스케줄링 우선순위에만 쓰인다. 읽기 전용으로 잘못 분류돼도 TA는 쓰기를 그대로
+ * 처리하므로 결과는 달라지지 않고 조회 전용 자리를 함께 쓸 뿐이다.
+ * 모듈과 manifest는 처음 볼 때 읽고, 파일이 바뀌면(mtime) 다시 읽는다.
+ *
+ * manifest의 "prefetch <함수|*> <식>" 줄은 호출이 처음 읽을 키를 알려 준다
+ * (예: prefetch query arg0, prefetch * "balance:" + arg1). 프록시는 TEE에 들어가기 전에
+ * 그 키를 읽어 시작 메일박스에 실으므로 첫 GET_STATE 왕복이 없어진다.
+ * 규칙이 틀려도 결과는 같다: 쓰이지 않은 키는 read set에 하나 더 남을 뿐이다.
+ *
+ * manifest의 "ree <함수>..." 줄("ree *": 모듈 전체)은 기밀성이 필요 없는 함수를 TEE 밖에서
+ * 실행하게 한다 (ReeRuntime). REE 런타임 없이 빌드했으면 무시한다.
+ */
+class WorkClassifier {
+public:
+    explicit WorkClassifier(const std::vector<std::string>& read_only_prefixes);
+
+    work_class classify(const tx_invocation& invocation);
+    /* 이 호출에 맞는 prefetch 규칙으로 만든 키 (중복 없이 규칙 순서, 인자가 모자란 규칙은 건너뜀) */
+    std::vector<std::string> prefetch_keys(const tx_invocation& invocation);
+    /* manifest가 이 호출을 REE에서 실행하라고 했는지 */
+    bool runs_in_ree(const tx_invocation& invocation);
+
+private:
+    struct module_info {
+        std::chrono::steady_clock::time_point checked;
+        long module_mtime;
+        long manifest_mtime;
+        bool writes;                        /* cc_put_state import (모르면 참) */
+        std::set<std::string> read_only;    /* manifest */
+        std::set<std::string> read_write;   /* manifest */
+        std::set<std::string> ree;          /* manifest ("*": 모두) */
+        std::map<std::string, std::vector<prefetch_rule> > prefetch;   /* 함수("*": 모두) → 규칙 */
+    };
+
+    const module_info& module(const std::string& aot_file);
+    static void load(const std::string& aot_file, module_info* info);
+    static bool parse_prefetch(const std::string& expr, prefetch_rule* rule);
+
+    std::vector<std::string> read_only_prefixes_;
+    std::mutex mutex_;
+    std::map<std::string, module_info> modules_;
+};
+
+#endif /* WORK_CLASS_H */
@@ -7,6 +7,9 @@ __attribute__((import_module("env"))) int cc_get_function(char *out, int out_len
 __attribute__((import_module("env"))) int cc_get_arg(int idx, char *out, int out_len);
 __attribute__((import_module("env"))) int cc_get_state(const char *key, int key_len, char *out, int out_len);
 __attribute__((import_module("env"))) int cc_put_state(const char *key, int key_len, const char *val, int val_len);
+__attribute__((import_module("env"))) int cc_iter_open(int kind, const char *a, int a_len, const char *b, int b_len, void *out, int out_len);
+__attribute__((import_module("env"))) int cc_iter_next(int iter_id, void *out, int out_len);
+__attribute__((import_module("env"))) int cc_iter_close(int iter_id);
 __attribute__((import_module("env"))) void cc_return_response(const char *msg, int msg_len);
 __attribute__((import_module("env"))) void cc_log(const char *msg, int msg_len);
 __attribute__((import_module("env"))) int debug_log(int step_num);
@@ -29,8 +32,12 @@ static void s_ultoa(unsigned long v, char *out, int out_len) {
     int k=0; while (i && k < out_len-1) out[k++] = buf[--i]; out[k]=0;
 }
 
+// 길이가 정해진 숫자 문자열 (반복자 페이지의 값은 NUL로 끝나지 않음)
+static unsigned long s_atoul_n(const unsigned char *s, unsigned int n) { unsigned long v=0; for (unsigned int i=0;i<n && s[i]>='0' && s[i]<='9';i++) v = v*10 + (unsigned long)(s[i]-'0'); return v; }
+static unsigned int s_load32(const unsigned char *p) { return (unsigned int)p[0] | ((unsigned int)p[1]<<8) | ((unsigned int)p[2]<<16) | ((unsigned int)p[3]<<24); }
+
 // 체인코드 내부 상태
-enum Op { OP_NONE=0, OP_CREATE=1, OP_ADD=2, OP_QUERY=3 };
+enum Op { OP_NONE=0, OP_CREATE=1, OP_ADD=2, OP_QUERY=3, OP_TOTAL=4 };
 static int fsm_state = 0; // 0: idle
 static enum Op current_op = OP_NONE;
 
@@ -38,6 +45,8 @@ static enum Op current_op = OP_NONE;
 #define KEY_MAX   64
 #define ARG_MAX   64
 #define VAL_MAX   256
+#define PAGE_MAX  4096  // 반복자 페이지 (헤더 16바이트 + [u32 klen][key][u32 vlen][value] 레코드)
+#define ITER_RANGE 0
 
 // fsm_state 범례
 // 0: idle - 초기 상태
@@ -46,6 +55,7 @@ static enum Op current_op = OP_NONE;
 // 21: ADD_AFTER_GET - add 작업 중 get_state 완료 후 상태  
 // 22: ADD_AFTER_PUT - add 작업 중 put_state 완료 후 상태
 // 31: QUERY_AFTER_GET - query 작업 중 get_state 완료 후 상태
+// 41: TOTAL_AFTER_PAGE - total 작업 중 반복자 페이지를 받은 후 상태
 
 // 변수 선언
 static char g_function[KEY_MAX];
@@ -54,6 +64,8 @@ static char g_arg1[ARG_MAX];
 static char g_person[KEY_MAX];
 static char g_cur_val[VAL_MAX];
 static char g_tmp[VAL_MAX];
+static unsigned char g_page[16 + PAGE_MAX];
+static unsigned long g_total;
 
 // 조기 종료 플래그
 static int g_should_exit = 0;
@@ -146,6 +158,43 @@ static void cc_do_query_resume() {
     }
 }
 
+// total: [arg0, arg1) 범위의 값을 페이지 단위로 읽어 합한다
+static void cc_do_total_init() {
+    s_memset(g_arg0, 0, ARG_MAX);
+    s_memset(g_arg1, 0, ARG_MAX);
+    (void)cc_get_arg(0, g_arg0, ARG_MAX);
+    (void)cc_get_arg(1, g_arg1, ARG_MAX);
+    g_total = 0;
+    if (cc_iter_open(ITER_RANGE, g_arg0, s_strlen(g_arg0), g_arg1, s_strlen(g_arg1), g_page, (int)sizeof(g_page)) < 0) {
+        cc_return_response("ERROR", 5);
+        current_op = OP_NONE; return;
+    }
+    fsm_state = 41; // TOTAL_AFTER_PAGE
+}
+
+static void cc_do_total_resume() {
+    if (fsm_state != 41) return;
+    unsigned int iter_id = s_load32(g_page);
+    unsigned int count = s_load32(g_page + 4);
+    unsigned int has_more = s_load32(g_page + 8);
+    unsigned int used = s_load32(g_page + 12);
+    const unsigned char *p = g_page + 16, *end = p + (used < PAGE_MAX ? used : PAGE_MAX);
+    for (unsigned int i = 0; i < count && p + 4 <= end; i++) {
+        unsigned int klen = s_load32(p); p += 4 + klen;
+        if (p + 4 > end) break;
+        unsigned int vlen = s_load32(p); p += 4;
+        if (p + vlen > end) break;
+        g_total += s_atoul_n(p, vlen); p += vlen;
+    }
+    if (has_more && cc_iter_next((int)iter_id, g_page, (int)sizeof(g_page)) == 0)
+        return;
+    (void)cc_iter_close((int)iter_id);
+    s_memset(g_tmp, 0, VAL_MAX);
+    s_ultoa(g_total, g_tmp, VAL_MAX);
+    cc_return_response(g_tmp, s_strlen(g_tmp));
+    fsm_state = 0; current_op = OP_NONE;
+}
+
 // 외부 진입점
 void step_init(void) {
 }
@@ -170,6 +219,7 @@ void step_resume(void) {
             }
             if (s_streq(g_function, "add"))    { current_op = OP_ADD;    cc_do_add_init();    goto end_function; }
             if (s_streq(g_function, "query"))  { current_op = OP_QUERY;  cc_do_query_init();  goto end_function; }
+            if (s_streq(g_function, "total"))  { current_op = OP_TOTAL;  cc_do_total_init();  goto end_function; }
             cc_return_response("ERROR", 5);
             goto end_function;
         }
@@ -179,6 +229,7 @@ void step_resume(void) {
     if (current_op == OP_CREATE) { cc_do_create_resume(); goto end_function; }
     if (current_op == OP_ADD)    { cc_do_add_resume();    goto end_function; }
     if (current_op == OP_QUERY)  { cc_do_query_resume();  goto end_function; }
+    if (current_op == OP_TOTAL)  { cc_do_total_resume();  goto end_function; }
     
     cc_return_response("ERROR", 5);
 
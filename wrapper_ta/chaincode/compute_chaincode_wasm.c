@@ -0,0 +1,146 @@
+// 계산 위주 WASM 체인코드 (PGO 효과 비교용, 호스트콜이 적고 분기가 많은 루프)
+#include <stdint.h>
+
+// 네이티브 임포트 선언 (coffee_chaincode_wasm.c와 같은 ABI)
+#if defined(__wasm__)
+__attribute__((import_module("env"))) int cc_get_function(char *out, int out_len);
+__attribute__((import_module("env"))) int cc_get_arg(int idx, char *out, int out_len);
+__attribute__((import_module("env"))) int cc_get_state(const char *key, int key_len, char *out, int out_len);
+__attribute__((import_module("env"))) int cc_put_state(const char *key, int key_len, const char *val, int val_len);
+__attribute__((import_module("env"))) void cc_return_response(const char *msg, int msg_len);
+
+__attribute__((import_module("env"))) void *memset(void *s, int c, unsigned long n);
+__attribute__((import_module("env"))) void *memcpy(void *d, const void *s, unsigned long n);
+__attribute__((import_module("env"))) void *memmove(void *d, const void *s, unsigned long n);
+#endif
+
+// 경량 유틸리티(표준 라이브러리 대체)
+static int s_strlen(const char *s) { int n = 0; while (s && s[n]) n++; return n; }
+static void s_memset(void *dst, int v, int n) { unsigned char *p = (unsigned char*)dst; for (int i=0;i<n;i++) p[i] = (unsigned char)v; }
+static int s_streq(const char *a, const char *b) { int i=0; for (;;i++){ char ca=a[i], cb=b[i]; if (ca!=cb) return 0; if (ca==0) return 1; } }
+static unsigned long s_atoul(const char *s) { unsigned long v=0; int i=0; while (s && s[i]>='0' && s[i]<='9') { v = v*10 + (unsigned long)(s[i]-'0'); i++; } return v; }
+static void s_ultoa(unsigned long long v, char *out, int out_len) {
+    if (!out || out_len <= 0) return;
+    if (v == 0) { if (out_len>0) out[0]='0'; if (out_len>1) out[1]=0; return; }
+    char buf[32]; int i=0; while (v && i < (int)sizeof(buf)) { buf[i++] = (char)('0' + (v % 10)); v/=10; }
+    int k=0; while (i && k < out_len-1) out[k++] = buf[--i]; out[k]=0;
+}
+
+// 체인코드 내부 상태
+enum Op { OP_NONE=0, OP_WORK=1, OP_MINE=2 };
+static int fsm_state = 0; // 0: idle
+static enum Op current_op = OP_NONE;
+
+#define KEY_MAX   64
+#define ARG_MAX   64
+#define VAL_MAX   256
+#define WORK_MAX_ROUNDS 10000000UL
+#define MINE_MAX_BITS   24
+
+// fsm_state 범례
+// 0: idle - 초기 상태
+// 51: MINE_AFTER_GET - mine 작업 중 get_state 완료 후 상태
+// 52: MINE_AFTER_PUT - mine 작업 중 put_state 완료 후 상태
+
+static char g_function[KEY_MAX];
+static char g_arg0[ARG_MAX];
+static char g_arg1[ARG_MAX];
+static char g_key[KEY_MAX + 8];
+static char g_cur_val[VAL_MAX];
+static char g_tmp[VAL_MAX];
+
+static uint64_t fnv1a(const char *s, int n, uint64_t h) {
+    for (int i = 0; i < n; i++) { h ^= (unsigned char)s[i]; h *= 0x100000001b3ULL; }
+    return h;
+}
+
+// work: xorshift 수열의 각 값에 대해 콜라츠 단계를 몇 번 밟고 값의 종류에 따라 다르게 섞는다.
+// 분기 방향이 값에 따라 치우쳐 있어 PGO의 블록 배치/분기 예측 힌트가 효과를 보는 형태
+static uint64_t do_work(uint64_t seed, unsigned long rounds) {
+    uint64_t x = seed ? seed : 0x9e3779b97f4a7c15ULL, acc = 0;
+    for (unsigned long r = 0; r < rounds; r++) {
+        x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+        uint64_t n = (x & 0xffff) | 1;
+        int steps = 0;
+        while (n != 1 && steps < 32) { n = (n & 1) ? 3 * n + 1 : n >> 1; steps++; }
+        switch (x & 7) {
+            case 0: acc += (uint64_t)steps * 31; break;
+            case 1: acc ^= x >> 3; break;
+            case 7: acc = (acc << 1) | (acc >> 63); break;
+            default: acc += n + (uint64_t)steps; break;
+        }
+    }
+    return acc;
+}
+
+// work: 상태를 읽지 않는 순수 계산 (호스트콜 없이 한 step에 끝난다)
+static void cc_do_work() {
+    s_memset(g_arg0, 0, ARG_MAX);
+    s_memset(g_arg1, 0, ARG_MAX);
+    (void)cc_get_arg(0, g_arg0, ARG_MAX);
+    (void)cc_get_arg(1, g_arg1, ARG_MAX);
+    unsigned long rounds = s_atoul(g_arg1);
+    if (rounds > WORK_MAX_ROUNDS) rounds = WORK_MAX_ROUNDS;
+    s_memset(g_tmp, 0, VAL_MAX);
+    s_ultoa(do_work(s_atoul(g_arg0), rounds), g_tmp, VAL_MAX);
+    cc_return_response(g_tmp, s_strlen(g_tmp));
+    current_op = OP_NONE;
+}
+
+// mine: arg0 키의 값 뒤에 붙였을 때 해시의 상위 arg1비트가 0이 되는 가장 작은 nonce를 찾아 <arg0>.nonce에 쓴다
+static void cc_do_mine_init() {
+    s_memset(g_key, 0, sizeof(g_key));
+    s_memset(g_arg1, 0, ARG_MAX);
+    s_memset(g_cur_val, 0, VAL_MAX);
+    (void)cc_get_arg(0, g_key, KEY_MAX);
+    (void)cc_get_arg(1, g_arg1, ARG_MAX);
+    (void)cc_get_state(g_key, s_strlen(g_key), g_cur_val, VAL_MAX);
+    fsm_state = 51; // MINE_AFTER_GET
+}
+
+static void cc_do_mine_resume() {
+    if (fsm_state == 51) {
+        unsigned long bits = s_atoul(g_arg1);
+        if (bits > MINE_MAX_BITS) bits = MINE_MAX_BITS;
+        uint64_t base = fnv1a(g_cur_val, s_strlen(g_cur_val), 0xcbf29ce484222325ULL);
+        uint64_t mask = bits ? ~0ULL << (64 - bits) : 0;
+        unsigned long long nonce = 0;
+        for (;; nonce++) {
+            char n[24];
+            s_ultoa(nonce, n, sizeof(n));
+            if ((fnv1a(n, s_strlen(n), base) & mask) == 0) break;
+        }
+        s_memset(g_tmp, 0, VAL_MAX);
+        s_ultoa(nonce, g_tmp, VAL_MAX);
+        int key_len = s_strlen(g_key);
+        const char *suffix = ".nonce";
+        for (int i = 0; suffix[i]; i++) g_key[key_len++] = suffix[i];
+        (void)cc_put_state(g_key, key_len, g_tmp, s_strlen(g_tmp));
+        fsm_state = 52; return;
+    }
+    if (fsm_state == 52) {
+        cc_return_response(g_tmp, s_strlen(g_tmp));
+        fsm_state = 0; current_op = OP_NONE; return;
+    }
+}
+
+// 외부 진입점
+void step_init(void) {
+}
+
+void step_resume(void) {
+    if (current_op == OP_NONE) {
+        if (!g_function[0]) (void)cc_get_function(g_function, KEY_MAX);
+        if (s_streq(g_function, "work")) { current_op = OP_WORK; cc_do_work(); return; }
+        if (s_streq(g_function, "mine")) { current_op = OP_MINE; cc_do_mine_init(); return; }
+        cc_return_response("ERROR", 5);
+        return;
+    }
+    if (current_op == OP_MINE) { cc_do_mine_resume(); return; }
+    cc_return_response("ERROR", 5);
+}
+
+int main(void) {
+    step_init();
+    return 0;
+}
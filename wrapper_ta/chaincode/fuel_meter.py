@@ -0,0 +1,443 @@
+#!/usr/bin/env python3
+"""
+WASM 체인코드에 연료(fuel) 계량 코드를 넣는다.
+
+    python3 fuel_meter.py in.wasm out.wasm
+
+기본 블록(분기 대상에서 다음 제어 명령까지)마다 들어 있는 wasm 명령 수를 블록 시작에서
+i64 전역 카운터(남은 연료)에서 뺀다. 카운터가 음수가 되면 env.cc_fuel(남은 연료)를 불러
+TA에서 연료를 더 받는다. TA는 트랜잭션 한도를 넘으면 인스턴스를 멈춘다.
+실행이 끝나면 TA는 내보낸 __fuel_left()로 남은 양을 읽어 사용량(받은 양 - 남은 양)을 계산한다.
+
+연료 = 실행한 wasm 명령 수이므로 플랫폼/AOT 코드/월드 스위치와 무관하게 결정적이다.
+계량 코드 자체는 세지 않는다. 바뀐 함수 인덱스를 따라가지 못하는 name 섹션은 버린다.
+"""
+
+import sys
+
+FUEL_IMPORT_MODULE = b"env"
+FUEL_IMPORT_NAME = b"cc_fuel"
+FUEL_LEFT_EXPORT = b"__fuel_left"
+
+I64 = 0x7E
+FUNC_TYPE = 0x60
+
+SEC_CUSTOM, SEC_TYPE, SEC_IMPORT, SEC_FUNCTION, SEC_TABLE, SEC_MEMORY, SEC_GLOBAL, \
+    SEC_EXPORT, SEC_START, SEC_ELEMENT, SEC_CODE, SEC_DATA, SEC_DATACOUNT = range(13)
+# 새로 만들어야 할 때 끼워 넣을 위치를 정하는 표준 섹션 순서 (datacount는 code 앞)
+SECTION_ORDER = [SEC_TYPE, SEC_IMPORT, SEC_FUNCTION, SEC_TABLE, SEC_MEMORY, SEC_GLOBAL,
+                 SEC_EXPORT, SEC_START, SEC_ELEMENT, SEC_DATACOUNT, SEC_CODE, SEC_DATA]
+
+# 명령 이후 새 기본 블록이 시작되는 제어 명령
+OP_UNREACHABLE, OP_BLOCK, OP_LOOP, OP_IF, OP_ELSE, OP_END = 0x00, 0x02, 0x03, 0x04, 0x05, 0x0B
+OP_BR, OP_BR_IF, OP_BR_TABLE, OP_RETURN, OP_CALL, OP_CALL_INDIRECT = 0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11
+BLOCK_ENDS = {OP_UNREACHABLE, OP_BLOCK, OP_LOOP, OP_IF, OP_ELSE, OP_END,
+              OP_BR, OP_BR_IF, OP_BR_TABLE, OP_RETURN}
+
+
+class WasmError(Exception):
+    pass
+
+
+class Reader:
+    def __init__(self, data, pos=0, end=None):
+        self.data = data
+        self.pos = pos
+        self.end = len(data) if end is None else end
+
+    def done(self):
+        return self.pos >= self.end
+
+    def byte(self):
+        if self.pos >= self.end:
+            raise WasmError("unexpected end of input")
+        b = self.data[self.pos]
+        self.pos += 1
+        return b
+
+    def bytes(self, n):
+        if self.pos + n > self.end:
+            raise WasmError("unexpected end of input")
+        b = self.data[self.pos:self.pos + n]
+        self.pos += n
+        return b
+
+    def u32(self):
+        result, shift = 0, 0
+        while True:
+            b = self.byte()
+            result |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                return result
+
+    def sleb(self):
+        result, shift = 0, 0
+        while True:
+            b = self.byte()
+            result |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                if b & 0x40:
+                    result -= 1 << shift
+                return result
+
+    def name(self):
+        return self.bytes(self.u32())
+
+
+def u32(n):
+    out = bytearray()
+    while True:
+        b = n & 0x7F
+        n >>= 7
+        if n:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return bytes(out)
+
+
+def sleb(n):
+    out = bytearray()
+    while True:
+        b = n & 0x7F
+        n >>= 7
+        if (n == 0 and not b & 0x40) or (n == -1 and b & 0x40):
+            out.append(b)
+            return bytes(out)
+        out.append(b | 0x80)
+
+
+def vec(items):
+    return u32(len(items)) + b"".join(items)
+
+
+def name(s):
+    return u32(len(s)) + s
+
+
+def read_instr(r):
+    """
+    명령 하나를 읽어 (opcode, call 대상 함수 인덱스 또는 None)을 돌려준다.
+    즉시값은 건너뛴다. 함수 인덱스를 담는 call/ref.func만 따로 알려준다.
+    """
+    op = r.byte()
+    if op in (OP_BLOCK, OP_LOOP, OP_IF):
+        b = r.data[r.pos] if r.pos < r.end else 0
+        if b in (0x40, 0x7F, 0x7E, 0x7D, 0x7C, 0x7B, 0x70, 0x6F):
+            r.byte()
+        else:
+            r.sleb()  # 타입 인덱스 (multi-value 블록)
+    elif op in (OP_BR, OP_BR_IF):
+        r.u32()
+    elif op == OP_BR_TABLE:
+        for _ in range(r.u32() + 1):
+            r.u32()
+    elif op == OP_CALL:
+        return op, r.u32()
+    elif op == OP_CALL_INDIRECT:
+        r.u32()
+        r.u32()
+    elif op == 0x1C:  # select t*
+        r.bytes(r.u32())
+    elif 0x20 <= op <= 0x26:  # local.*, global.*, table.get/set
+        r.u32()
+    elif 0x28 <= op <= 0x3E:  # load/store memarg
+        r.u32()
+        r.u32()
+    elif op in (0x3F, 0x40):  # memory.size/grow
+        r.byte()
+    elif op == 0x41:
+        r.sleb()
+    elif op == 0x42:
+        r.sleb()
+    elif op == 0x43:
+        r.bytes(4)
+    elif op == 0x44:
+        r.bytes(8)
+    elif op == 0xD0:  # ref.null t
+        r.byte()
+    elif op == 0xD2:  # ref.func
+        return op, r.u32()
+    elif op == 0xFC:
+        sub = r.u32()
+        if sub <= 7:
+            pass  # trunc_sat
+        elif sub == 8:  # memory.init
+            r.u32()
+            r.byte()
+        elif sub in (9, 13, 15, 16, 17):  # data.drop, elem.drop, table.grow/size/fill
+            r.u32()
+        elif sub == 10:  # memory.copy
+            r.byte()
+            r.byte()
+        elif sub == 11:  # memory.fill
+            r.byte()
+        elif sub in (12, 14):  # table.init, table.copy
+            r.u32()
+            r.u32()
+        else:
+            raise WasmError("unsupported 0xFC opcode %d" % sub)
+    elif op in (0xFD, 0xFE):
+        raise WasmError("SIMD/threads opcodes are not supported (0x%X)" % op)
+    return op, None
+
+
+def remap_call(out, op, target, shift_from):
+    out.append(op)
+    out += u32(target + 1 if target >= shift_from else target)
+
+
+def remap_const_expr(r, shift_from):
+    """상수식(전역 초기값, 세그먼트 오프셋)을 다시 쓴다. ref.func의 함수 인덱스는 본문과 같이 민다"""
+    out = bytearray()
+    while True:
+        start = r.pos
+        op, target = read_instr(r)
+        if target is not None:
+            remap_call(out, op, target, shift_from)
+        else:
+            out += r.data[start:r.pos]
+        if op == OP_END:
+            return bytes(out)
+
+
+def charge(cost, fuel_global, fuel_func):
+    """블록 시작에 넣는 코드: fuel -= cost; if (fuel < 0) fuel = cc_fuel(fuel);"""
+    g = u32(fuel_global)
+    return (b"\x23" + g + b"\x42" + sleb(cost) + b"\x7D" + b"\x24" + g +
+            b"\x23" + g + b"\x42\x00" + b"\x53" +
+            b"\x04\x40" + b"\x23" + g + b"\x10" + u32(fuel_func) + b"\x24" + g + b"\x0B")
+
+
+def instrument_body(body, n_func_imports, fuel_global, fuel_func):
+    r = Reader(body)
+    out = bytearray()
+    for _ in range(r.u32()):  # 지역 변수 선언은 그대로
+        r.u32()
+        r.byte()
+    out += body[:r.pos]
+
+    region = bytearray()  # 아직 계량 코드를 넣지 않은 현재 블록
+    cost = 0
+    while not r.done():
+        start = r.pos
+        op, target = read_instr(r)
+        if op not in (OP_ELSE, OP_END):  # 구조 표시일 뿐 실행되는 명령이 아니다
+            cost += 1
+        if target is not None:
+            remap_call(region, op, target, n_func_imports)
+        else:
+            region += body[start:r.pos]
+        if op in BLOCK_ENDS:
+            if cost:
+                out += charge(cost, fuel_global, fuel_func)
+            out += region
+            region = bytearray()
+            cost = 0
+    if cost:
+        out += charge(cost, fuel_global, fuel_func)
+    out += region
+    return bytes(out)
+
+
+def read_sections(data):
+    if data[:4] != b"\0asm" or data[4:8] != b"\x01\0\0\0":
+        raise WasmError("not a wasm module (version 1)")
+    r = Reader(data, 8)
+    sections = []
+    while not r.done():
+        sid = r.byte()
+        size = r.u32()
+        sections.append([sid, r.bytes(size)])
+    return sections
+
+
+def section_name(payload):
+    return Reader(payload).name()
+
+
+def instrument(data):
+    sections = read_sections(data)
+    by_id = {}
+    for s in sections:
+        if s[0] != SEC_CUSTOM:
+            by_id[s[0]] = s
+
+    def ensure(sid):
+        if sid in by_id:
+            return by_id[sid]
+        s = [sid, u32(0)]
+        pos = len(sections)
+        later = SECTION_ORDER[SECTION_ORDER.index(sid) + 1:]
+        for i, other in enumerate(sections):
+            if other[0] in later:
+                pos = i
+                break
+        sections.insert(pos, s)
+        by_id[sid] = s
+        return s
+
+    # 이미 계량된 모듈은 다시 넣지 않는다
+    if SEC_EXPORT in by_id:
+        r = Reader(by_id[SEC_EXPORT][1])
+        for _ in range(r.u32()):
+            if r.name() == FUEL_LEFT_EXPORT:
+                raise WasmError("module is already instrumented")
+            r.byte()
+            r.u32()
+
+    # 타입: (i64) -> i64 (cc_fuel), () -> i64 (__fuel_left)
+    types = ensure(SEC_TYPE)
+    r = Reader(types[1])
+    entries = []
+    for _ in range(r.u32()):
+        start = r.pos
+        if r.byte() != FUNC_TYPE:
+            raise WasmError("unsupported type entry")
+        r.bytes(r.u32())
+        r.bytes(r.u32())
+        entries.append(bytes(types[1][start:r.pos]))
+    fuel_type_entry = bytes([FUNC_TYPE, 1, I64, 1, I64])
+    left_type_entry = bytes([FUNC_TYPE, 0, 1, I64])
+    for entry in (fuel_type_entry, left_type_entry):
+        if entry not in entries:
+            entries.append(entry)
+    fuel_type = entries.index(fuel_type_entry)
+    left_type = entries.index(left_type_entry)
+    types[1] = vec(entries)
+
+    # 임포트: 함수 임포트 끝에 env.cc_fuel 추가 (정의된 함수 인덱스가 모두 1씩 밀린다)
+    imports = ensure(SEC_IMPORT)
+    r = Reader(imports[1])
+    entries = []
+    n_func_imports = 0
+    n_global_imports = 0
+    for _ in range(r.u32()):
+        start = r.pos
+        r.name()
+        r.name()
+        kind = r.byte()
+        if kind == 0:
+            r.u32()
+            n_func_imports += 1
+        elif kind == 1:  # table
+            r.byte()
+            flags = r.byte()
+            r.u32()
+            if flags & 1:
+                r.u32()
+        elif kind == 2:  # memory
+            flags = r.byte()
+            r.u32()
+            if flags & 1:
+                r.u32()
+        elif kind == 3:  # global
+            r.byte()
+            r.byte()
+            n_global_imports += 1
+        else:
+            raise WasmError("unsupported import kind %d" % kind)
+        entries.append(bytes(imports[1][start:r.pos]))
+    entries.append(name(FUEL_IMPORT_MODULE) + name(FUEL_IMPORT_NAME) + b"\x00" + u32(fuel_type))
+    imports[1] = vec(entries)
+    fuel_func = n_func_imports
+
+    # 함수: __fuel_left 선언 추가
+    funcs = ensure(SEC_FUNCTION)
+    r = Reader(funcs[1])
+    decls = [u32(r.u32()) for _ in range(r.u32())]
+    left_func = n_func_imports + 1 + len(decls)
+    decls.append(u32(left_type))
+    funcs[1] = vec(decls)
+
+    # 전역: 남은 연료 (mut i64 = 0, 첫 블록에서 바로 cc_fuel로 받는다)
+    globals_ = ensure(SEC_GLOBAL)
+    r = Reader(globals_[1])
+    entries = []
+    for _ in range(r.u32()):
+        head = r.bytes(2)  # valtype, mut
+        entries.append(bytes(head) + remap_const_expr(r, n_func_imports))
+    fuel_global = n_global_imports + len(entries)
+    entries.append(bytes([I64, 1, 0x42, 0x00, OP_END]))
+    globals_[1] = vec(entries)
+
+    def shift(idx):
+        return idx + 1 if idx >= n_func_imports else idx
+
+    # 내보내기: 함수 인덱스 보정 + __fuel_left
+    exports = ensure(SEC_EXPORT)
+    r = Reader(exports[1])
+    entries = []
+    for _ in range(r.u32()):
+        n = r.name()
+        kind = r.byte()
+        idx = r.u32()
+        entries.append(name(n) + bytes([kind]) + u32(shift(idx) if kind == 0 else idx))
+    entries.append(name(FUEL_LEFT_EXPORT) + b"\x00" + u32(left_func))
+    exports[1] = vec(entries)
+
+    if SEC_START in by_id:
+        by_id[SEC_START][1] = u32(shift(Reader(by_id[SEC_START][1]).u32()))
+
+    if SEC_ELEMENT in by_id:
+        payload = by_id[SEC_ELEMENT][1]
+        r = Reader(payload)
+        entries = []
+        for _ in range(r.u32()):
+            start = r.pos
+            flags = r.u32()
+            if flags > 3:
+                raise WasmError("element segments with expressions are not supported")
+            if flags == 2:
+                r.u32()
+            head = bytearray(payload[start:r.pos])
+            if flags in (0, 2):
+                head += remap_const_expr(r, n_func_imports)
+            if flags in (1, 2, 3):
+                head.append(r.byte())  # elemkind funcref
+            idxs = [u32(shift(r.u32())) for _ in range(r.u32())]
+            entries.append(bytes(head) + vec(idxs))
+        by_id[SEC_ELEMENT][1] = vec(entries)
+
+    # 코드: 본문마다 계량 코드를 넣고 __fuel_left 본문 추가
+    code = ensure(SEC_CODE)
+    r = Reader(code[1])
+    bodies = []
+    for _ in range(r.u32()):
+        body = r.bytes(r.u32())
+        new_body = instrument_body(body, n_func_imports, fuel_global, fuel_func)
+        bodies.append(u32(len(new_body)) + new_body)
+    left_body = b"\x00" + b"\x23" + u32(fuel_global) + bytes([OP_END])
+    bodies.append(u32(len(left_body)) + left_body)
+    code[1] = vec(bodies)
+
+    out = bytearray(b"\0asm\x01\0\0\0")
+    for sid, payload in sections:
+        if sid == SEC_CUSTOM and section_name(payload) == b"name":
+            continue
+        out.append(sid)
+        out += u32(len(payload))
+        out += payload
+    return bytes(out)
+
+
+def main(argv):
+    if len(argv) != 3:
+        sys.stderr.write("usage: %s in.wasm out.wasm\n" % argv[0])
+        return 2
+    with open(argv[1], "rb") as f:
+        data = f.read()
+    try:
+        out = instrument(data)
+    except WasmError as e:
+        sys.stderr.write("%s: %s\n" % (argv[1], e))
+        return 1
+    with open(argv[2], "wb") as f:
+        f.write(out)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
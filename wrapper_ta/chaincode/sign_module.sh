@@ -0,0 +1,19 @@
+#!/bin/sh
+# 모듈 설치 서명: TA(ta/module_signature.c)가 빌드할 때 넣은 공개 키로 확인하는 값
+#   <이미지>.sig = RSA PKCS#1 v1.5 서명(SHA-256(모듈 id || '\0' || SHA-256(이미지) || replace 바이트))
+# 모듈 id는 프록시가 설치하는 id(<파일>@<버전>)와 같아야 하고, replace=1은 이미 다른 이미지로
+# 설치된 id를 바꾸는 서명이다 (fixed-proxy --deploy --replace).
+# 사용법: sign_module.sh <개인 키> <이미지> <모듈 id> [replace(0|1)]
+set -e
+key=$1
+image=$2
+id=$3
+replace=${4:-0}
+[ -f "$key" ] || { echo "❌ 서명 키가 없습니다: $key (make signing-key)"; exit 1; }
+[ -f "$image" ] || { echo "❌ 이미지가 없습니다: $image"; exit 1; }
+case "$replace" in
+    0|1) ;;
+    *) echo "❌ replace는 0 또는 1: $replace"; exit 1 ;;
+esac
+{ printf '%s\000' "$id"; openssl dgst -sha256 -binary "$image"; printf "\\00$replace"; } \
+    | openssl dgst -sha256 -sign "$key" -out "$image.sig"
@@ -0,0 +1,360 @@
+#include <tee_internal_api.h>
+#include <tee_internal_api_extensions.h>
+#include <string.h>
+
+#include "wasm_export.h"
+
+#include "logging.h"
+#include "batch.h"
+#include "chaincode_tee_ree_communication.h"
+
+enum batch_tx_state {
+    BATCH_TX_NEW,       /* 아직 인스턴스가 없음 (힙이 모자라면 다른 트랜잭션이 끝날 때까지 미룸) */
+    BATCH_TX_RUNNING,
+    BATCH_TX_WAITING,   /* 배치 캐시에 없는 키(tx.key)를 기다리는 중 */
+    BATCH_TX_DONE,
+};
+
+struct batch_tx {
+    chaincode_tx_ctx tx;
+    enum batch_tx_state state;
+    bool failed;
+    char result[VAL_SIZE];  /* 체인코드 응답 또는 실패 사유 */
+    uint32_t flags;         /* RESPONSE_FUEL_* (인스턴스를 정리하기 전에 기록) */
+    uint64_t fuel_used;
+    uint32_t reads;
+    uint32_t writes;
+    struct key_value read_set[BATCH_RW_MAX];
+    struct key_value write_set[BATCH_RW_MAX];
+};
+
+/* 트랜잭션마다 서로 다른 키를 BATCH_RW_MAX개까지만 읽으므로 캐시가 넘칠 일은 없다 */
+#define BATCH_CACHE_MAX (BATCH_MAX_TX * BATCH_RW_MAX)
+
+struct chaincode_batch {
+    cached_module *module;
+    uint32_t count;
+    struct batch_tx txs[BATCH_MAX_TX];
+    uint32_t cached;
+    struct key_value cache[BATCH_CACHE_MAX];  /* REE에서 받은 읽기 값 (배치 전체의 스냅숏) */
+};
+
+static void copy_str(char *dst, const char *src, size_t size)
+{
+    size_t n = strnlen(src, size - 1);
+
+    TEE_MemMove(dst, src, n);
+    dst[n] = '\0';
+}
+
+static struct key_value *find_kv(struct key_value *set, uint32_t n, const char *key)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        if (!strncmp(set[i].key, key, KEY_SIZE))
+            return &set[i];
+    }
+    return NULL;
+}
+
+/* 응답(또는 실패 사유)을 남기고 인스턴스를 돌려준다. read/write set은 결과로 보고될 때까지 유지 */
+static void finish_tx(struct batch_tx *bt, const char *failure)
+{
+    chaincode_tx_ctx *tx = &bt->tx;
+
+    TEE_MemFill(bt->result, 0, sizeof(bt->result));
+    if (failure) {
+        bt->failed = true;
+        copy_str(bt->result, failure, sizeof(bt->result));
+    } else if (tx->has_response && tx->response[0]) {
+        copy_str(bt->result, tx->response, sizeof(bt->result));
+    } else {
+        copy_str(bt->result, tx->has_response ? "EMPTY_RESPONSE" : "NO_RESPONSE", sizeof(bt->result));
+    }
+    bt->fuel_used = invocation_fuel_used(tx);
+    bt->flags = (tx->metered ? RESPONSE_FUEL_METERED : 0) | (tx->out_of_fuel ? RESPONSE_OUT_OF_FUEL : 0);
+    release_invocation(tx);
+    bt->state = BATCH_TX_DONE;
+}
+
+/*
+ * GET_STATE를 TA 안에서 처리: 이미 읽은 키는 read set에서, 처음 읽는 키는 배치 캐시에서.
+ * 캐시에 없으면 WAITING으로 두고 false (다음 BATCH_STATE 라운드에서 재시도)
+ */
+static bool answer_read(struct chaincode_batch *b, struct batch_tx *bt)
+{
+    chaincode_tx_ctx *tx = &bt->tx;
+    struct key_value *kv = find_kv(bt->read_set, bt->reads, tx->key);
+
+    if (!kv) {
+        if (bt->reads == BATCH_RW_MAX) {
+            finish_tx(bt, "BATCH_READ_SET_FULL");
+            return false;
+        }
+        kv = find_kv(b->cache, b->cached, tx->key);
+        if (!kv) {
+            bt->state = BATCH_TX_WAITING;
+            return false;
+        }
+        bt->read_set[bt->reads++] = *kv;
+    }
+    deliver_state_value(tx, kv->value);
+    bt->state = BATCH_TX_RUNNING;
+    return true;
+}
+
+/* PUT_STATE는 REE로 보내지 않고 write set에 쌓는다 (같은 키는 마지막 값만) */
+static bool record_write(struct batch_tx *bt)
+{
+    chaincode_tx_ctx *tx = &bt->tx;
+    struct key_value *kv = find_kv(bt->write_set, bt->writes, tx->key);
+
+    if (!kv) {
+        if (bt->writes == BATCH_RW_MAX) {
+            finish_tx(bt, "BATCH_WRITE_SET_FULL");
+            return false;
+        }
+        kv = &bt->write_set[bt->writes++];
+        TEE_MemFill(kv, 0, sizeof(*kv));
+        copy_str(kv->key, tx->key, KEY_SIZE);
+    }
+    TEE_MemFill(kv->value, 0, VAL_SIZE);
+    copy_str(kv->value, tx->value, VAL_SIZE);
+    tx->pending_type = 0;
+    return true;
+}
+
+/* 트랜잭션을 끝나거나 캐시에 없는 키를 만날 때까지 실행 (world switch 없음) */
+static void run_tx(struct chaincode_batch *b, struct batch_tx *bt)
+{
+    chaincode_tx_ctx *tx = &bt->tx;
+
+    for (;;) {
+        if (!call_step(tx->runtime, "step_resume")) {
+            const char *ex = wasm_runtime_get_exception(tx->runtime->module_inst);
+            EMSG("batch tx %u: step_resume failed: %s", tx->slot, ex ? ex : "(null)");
+            finish_tx(bt, tx->out_of_fuel ? "OUT_OF_FUEL" : "RUNTIME_ERROR");
+            return;
+        }
+
+        if (tx->pending_type == GET_STATE_REQUEST) {
+            if (!answer_read(b, bt))
+                return;
+        } else if (tx->pending_type == PUT_STATE_REQUEST) {
+            if (!record_write(bt))
+                return;
+        } else if (tx->pending_type == ITER_OPEN_REQUEST || tx->pending_type == ITER_NEXT_REQUEST) {
+            /* 범위 조회는 읽기 집합을 키 단위로 검증할 수 없으므로 배치에서 실행하지 않는다 */
+            finish_tx(bt, "BATCH_ITERATOR_UNSUPPORTED");
+            return;
+        } else {
+            finish_tx(bt, NULL);
+            return;
+        }
+    }
+}
+
+/* REE가 보낸 키 중 실제로 기다리는 트랜잭션이 있는 것만 캐시에 넣는다 */
+static bool is_awaited(const struct chaincode_batch *b, const char *key)
+{
+    for (uint32_t i = 0; i < b->count; i++) {
+        if (b->txs[i].state == BATCH_TX_WAITING && !strncmp(b->txs[i].tx.key, key, KEY_SIZE))
+            return true;
+    }
+    return false;
+}
+
+static uint32_t resident_count(const struct chaincode_batch *b)
+{
+    uint32_t n = 0;
+
+    for (uint32_t i = 0; i < b->count; i++) {
+        if (b->txs[i].state == BATCH_TX_WAITING)
+            n++;
+    }
+    return n;
+}
+
+/* 인스턴스를 만들고 step_init 후 실행. 미뤘으면 false */
+static bool start_tx(struct chaincode_batch *b, struct batch_tx *bt)
+{
+    TEE_Result r = instantiate_invocation(&bt->tx, b->module);
+
+    if (r != TEE_SUCCESS) {
+        /* 상주 중인 트랜잭션이 끝나 힙을 돌려주면 다시 시도 */
+        if (resident_count(b))
+            return false;
+        EMSG("batch tx %u: instantiate failed. Error: %x", bt->tx.slot, r);
+        finish_tx(bt, "INSTANTIATE_FAILED");
+        return true;
+    }
+    bt->tx.in_use = true;
+    bt->state = BATCH_TX_RUNNING;
+
+    if (!call_step(bt->tx.runtime, "step_init")) {
+        finish_tx(bt, bt->tx.out_of_fuel ? "OUT_OF_FUEL" : "STEP_INIT_FAILED");
+        return true;
+    }
+    run_tx(b, bt);
+    return true;
+}
+
+/* 더 진행할 수 있는 트랜잭션이 없을 때까지 시작/재개를 반복 */
+static void advance(struct chaincode_batch *b)
+{
+    bool progress = true;
+
+    while (progress) {
+        progress = false;
+        for (uint32_t i = 0; i < b->count; i++) {
+            struct batch_tx *bt = &b->txs[i];
+
+            if (bt->state == BATCH_TX_NEW) {
+                if (start_tx(b, bt))
+                    progress = true;
+            } else if (bt->state == BATCH_TX_WAITING) {
+                if (answer_read(b, bt)) {
+                    run_tx(b, bt);
+                    progress = true;
+                }
+            }
+        }
+    }
+}
+
+static void put_record(struct batch_record *rec, uint32_t tx, uint32_t type,
+                       const char *key, const char *value)
+{
+    TEE_MemFill(rec, 0, sizeof(*rec));
+    rec->tx = tx;
+    rec->type = type;
+    if (key)
+        copy_str(rec->key, key, KEY_SIZE);
+    if (value)
+        copy_str(rec->value, value, VAL_SIZE);
+}
+
+/*
+ * 멈춘 트랜잭션이 있으면 기다리는 키 목록(BATCH_NEED_STATE)을, 모두 끝났으면
+ * 트랜잭션별 read set, write set, 응답(BATCH_DONE)을 메일박스에 쓴다.
+ */
+static TEE_Result write_records(chaincode_session_ctx *sc, TEE_Param params[4])
+{
+    struct chaincode_batch *b = sc->batch;
+    struct batch_record *rec = params[2].memref.buffer;
+    uint32_t n = 0;
+
+    for (uint32_t i = 0; i < b->count; i++) {
+        const char *key = b->txs[i].tx.key;
+        bool dup = false;
+
+        if (b->txs[i].state != BATCH_TX_WAITING)
+            continue;
+        for (uint32_t j = 0; j < n && !dup; j++)
+            dup = !strncmp(rec[j].key, key, KEY_SIZE);
+        if (!dup)
+            put_record(&rec[n++], i, GET_STATE_REQUEST, key, NULL);
+    }
+    if (n) {
+        params[1].value.a = BATCH_NEED_STATE;
+        params[1].value.b = n;
+        return TEE_SUCCESS;
+    }
+
+    for (uint32_t i = 0; i < b->count; i++) {
+        struct batch_tx *bt = &b->txs[i];
+
+        for (uint32_t j = 0; j < bt->reads; j++)
+            put_record(&rec[n++], i, GET_STATE_REQUEST, bt->read_set[j].key, bt->read_set[j].value);
+        for (uint32_t j = 0; j < bt->writes; j++)
+            put_record(&rec[n++], i, PUT_STATE_REQUEST, bt->write_set[j].key, bt->write_set[j].value);
+        put_record(&rec[n], i, bt->failed ? ERROR : INVOCATION_RESPONSE, NULL, bt->result);
+        rec[n].flags = bt->flags;
+        rec[n].fuel_used_lo = (uint32_t)bt->fuel_used;
+        rec[n].fuel_used_hi = (uint32_t)(bt->fuel_used >> 32);
+        n++;
+    }
+    params[1].value.a = BATCH_DONE;
+    params[1].value.b = n;
+    batch_release(sc);
+    return TEE_SUCCESS;
+}
+
+TEE_Result batch_start(chaincode_session_ctx *sc, cached_module *cm, TEE_Param params[4])
+{
+    uint32_t count = params[1].value.a;
+    const struct arguments *args = params[2].memref.buffer;
+    struct chaincode_batch *b;
+
+    if (!count || count > BATCH_MAX_TX)
+        return TEE_ERROR_BAD_PARAMETERS;
+    if (params[2].memref.size < BATCH_MAILBOX_SIZE)
+        return TEE_ERROR_SHORT_BUFFER;
+
+    if (sc->batch) {
+        IMSG("dropping an unfinished batch");
+        batch_release(sc);
+    }
+
+    b = TEE_Malloc(sizeof(*b), TEE_MALLOC_FILL_ZERO);
+    if (!b) {
+        EMSG("Memory allocation failed! batch (%u bytes)", (uint32_t)sizeof(*b));
+        return TEE_ERROR_OUT_OF_MEMORY;
+    }
+    module_cache_acquire(cm);
+    b->module = cm;
+    b->count = count;
+    /* 메일박스는 결과로 덮어쓰므로 인자는 먼저 모두 복사해 둔다 */
+    for (uint32_t i = 0; i < count; i++) {
+        b->txs[i].tx.slot = i;
+        b->txs[i].tx.fuel_limit = sc->fuel_limit;
+        TEE_MemMove(&b->txs[i].tx.args, &args[i], sizeof(struct arguments));
+        b->txs[i].state = BATCH_TX_NEW;
+    }
+    sc->batch = b;
+
+    advance(b);
+    return write_records(sc, params);
+}
+
+TEE_Result batch_supply_state(chaincode_session_ctx *sc, TEE_Param params[4])
+{
+    struct chaincode_batch *b = sc->batch;
+    const struct batch_record *rec = params[2].memref.buffer;
+    uint32_t n = params[1].value.b;
+
+    if (params[2].memref.size < BATCH_MAILBOX_SIZE)
+        return TEE_ERROR_SHORT_BUFFER;
+    if (n > BATCH_MAILBOX_SIZE / sizeof(*rec))
+        return TEE_ERROR_BAD_PARAMETERS;
+
+    for (uint32_t i = 0; i < n; i++) {
+        struct key_value kv;
+
+        TEE_MemFill(&kv, 0, sizeof(kv));
+        copy_str(kv.key, rec[i].key, KEY_SIZE);
+        copy_str(kv.value, rec[i].value, VAL_SIZE);
+        if (!is_awaited(b, kv.key) || find_kv(b->cache, b->cached, kv.key))
+            continue;
+        if (b->cached == BATCH_CACHE_MAX) {
+            EMSG("batch cache is full, ignoring key %s", kv.key);
+            continue;
+        }
+        b->cache[b->cached++] = kv;
+    }
+
+    advance(b);
+    return write_records(sc, params);
+}
+
+void batch_release(chaincode_session_ctx *sc)
+{
+    struct chaincode_batch *b = sc->batch;
+
+    if (!b)
+        return;
+    for (uint32_t i = 0; i < b->count; i++)
+        release_invocation(&b->txs[i].tx);
+    module_cache_release(b->module);
+    TEE_Free(b);
+    sc->batch = NULL;
+}
@@ -32,6 +32,52 @@ static void *to_native(wasm_module_inst_t inst, uint32_t app_offset, uint32_t si
     return result;
 }
 
+/*
+ * 마감/취소 확인: 상태 접근과 로그는 매번, 메모리 함수는 64번에 한 번 확인한다.
+ * 지났으면 인스턴스를 종료시키고(네이티브가 돌아가면 WASM 호출이 예외로 끝남) 참을 반환
+ */
+static bool terminate_if_expired(wasm_exec_env_t exec_env, bool every_call)
+{
+    chaincode_tx_ctx *tx = tx_from_exec_env(exec_env);
+    if (!tx)
+        return false;
+    if (!every_call && (++tx->deadline_checks & 63))
+        return false;
+    if (!invocation_expired(tx))
+        return false;
+    wasm_runtime_terminate(wasm_runtime_get_module_inst(exec_env));
+    return true;
+}
+
+/*
+ * 연료 충전 (fuel_meter.py가 넣은 env.cc_fuel): 계량 코드가 남은 연료가 음수가 되면 부른다.
+ * FUEL_REFILL씩(한도가 있으면 한도까지) 더 주고 새 남은 양을 돌려준다. 한도를 다 썼으면
+ * 예외로 인스턴스를 멈춘다. 충전마다 마감도 확인하므로 호스트콜 없는 루프도 멈출 수 있다
+ */
+static int64_t cc_fuel_native(wasm_exec_env_t exec_env, int64_t left)
+{
+    chaincode_tx_ctx *tx = tx_from_exec_env(exec_env);
+    uint64_t grant = FUEL_REFILL;
+
+    if (!tx)
+        return left + FUEL_REFILL;
+    tx->fuel_left = left;
+    if (terminate_if_expired(exec_env, true))
+        return left;
+    if (tx->fuel_limit) {
+        if (tx->fuel_granted >= tx->fuel_limit) {
+            tx->out_of_fuel = true;
+            wasm_runtime_set_exception(wasm_runtime_get_module_inst(exec_env), "out of fuel");
+            return left;
+        }
+        if (grant > tx->fuel_limit - tx->fuel_granted)
+            grant = tx->fuel_limit - tx->fuel_granted;
+    }
+    tx->fuel_granted += grant;
+    tx->fuel_left = left + (int64_t)grant;
+    return tx->fuel_left;
+}
+
 /*
  * 네이티브 함수 구현
  * 서명 규칙(WAMR):
@@ -71,15 +117,16 @@ static int cc_get_function_native(wasm_exec_env_t exec_env, uint32_t out_ptr, in
         return 0;
     }
 
-    /* 세션 컨텍스트 확인 */
-    /* DMSG("Checking session context: %p", g_chaincode_sess); */
-    if (!g_chaincode_sess) {
-        EMSG("g_chaincode_sess is NULL");
+    /* 트랜잭션 컨텍스트 확인 */
+    chaincode_tx_ctx *tx = tx_from_exec_env(exec_env);
+    /* DMSG("Checking transaction context: %p", tx); */
+    if (!tx) {
+        EMSG("transaction context is NULL");
         return 0;
     }
     
     /* 세션 컨텍스트에서 function 추출: args.arguments[0] */
-    const char *function = g_chaincode_sess->args.arguments[0];
+    const char *function = tx->args.arguments[0];
     /* DMSG("Function from session: %p", function); */
     if (!function) {
         /* DMSG("Function is NULL, using empty string"); */
@@ -106,15 +153,18 @@ static int cc_get_function_native(wasm_exec_env_t exec_env, uint32_t out_ptr, in
 
 static int cc_get_arg_native(wasm_exec_env_t exec_env, int idx, uint32_t out_ptr, int out_len)
 {
+    if (terminate_if_expired(exec_env, true))
+        return 0;
     wasm_module_inst_t inst = wasm_runtime_get_module_inst(exec_env);
     char *out = (char*)to_native(inst, out_ptr, (uint32_t)out_len);
     /* DMSG("cc_get_arg in, idx=%d, out_len=%d", idx, out_len); */
     if (!out || out_len <= 0)
         return 0;
 
+    chaincode_tx_ctx *tx = tx_from_exec_env(exec_env);
     const char *arg = "";
-    if (g_chaincode_sess && idx >= 0 && idx < ARGS_NUMBER)
-        arg = g_chaincode_sess->args.arguments[idx+1]; /* arguments[0]는 function, 그 뒤가 args */
+    if (tx && idx >= 0 && idx < ARGS_NUMBER)
+        arg = tx->args.arguments[idx+1]; /* arguments[0]는 function, 그 뒤가 args */
     size_t len = safe_strlen(arg, (size_t)out_len - 1);
     TEE_MemFill(out, 0, (size_t)out_len);
     if (len > 0)
@@ -126,6 +176,8 @@ static int cc_get_state_native(wasm_exec_env_t exec_env,
                                uint32_t key_ptr, int key_len,
                                uint32_t out_ptr, int out_len)
 {
+    if (terminate_if_expired(exec_env, true))
+        return 0;
     wasm_module_inst_t inst = wasm_runtime_get_module_inst(exec_env);
     char *out = (char*)to_native(inst, out_ptr, (uint32_t)out_len);
     const char *key = (const char*)to_native(inst, key_ptr, (uint32_t)(key_len > 0 ? key_len : 0));
@@ -147,13 +199,14 @@ static int cc_get_state_native(wasm_exec_env_t exec_env,
     }
 
     /* 공유버퍼로 요청 전달을 위해 세션 컨텍스트 저장 후 예외로 YIELD */
-    if (!g_chaincode_sess) {
+    chaincode_tx_ctx *tx = tx_from_exec_env(exec_env);
+    if (!tx) {
         /* DMSG("cc_get_state: no session context"); */
         return 0;
     }
     
     /* DMSG("cc_get_state: about to clear key buffer"); */
-    TEE_MemFill(g_chaincode_sess->key, 0, KEY_SIZE);
+    TEE_MemFill(tx->key, 0, KEY_SIZE);
     /* DMSG("cc_get_state: key buffer cleared"); */
     
     int klen = key_len < KEY_SIZE-1 ? key_len : KEY_SIZE-1;
@@ -161,17 +214,17 @@ static int cc_get_state_native(wasm_exec_env_t exec_env,
     
     if (klen > 0 && key) {
         /* DMSG("cc_get_state: about to copy key"); */
-        TEE_MemMove(g_chaincode_sess->key, key, (size_t)klen);
+        TEE_MemMove(tx->key, key, (size_t)klen);
         /* DMSG("cc_get_state: key copied"); */
     }
 
     /* 세션 컨텍스트에 GET_STATE_REQUEST 설정 */
     /* DMSG("cc_get_state: setting pending_type to GET_STATE_REQUEST"); */
-    g_chaincode_sess->pending_type = GET_STATE_REQUEST;
+    tx->pending_type = GET_STATE_REQUEST;
     
     /* WASM 출력 버퍼 정보 저장 */
-    g_chaincode_sess->wasm_out_offset = out_ptr;
-    g_chaincode_sess->wasm_out_len = out_len;
+    tx->wasm_out_offset = out_ptr;
+    tx->wasm_out_len = out_len;
     /* DMSG("[DEBUG] cc_get_state: wasm_out_offset=0x%x, wasm_out_len=%d", out_ptr, out_len); */
     
     /* DMSG("cc_get_state: pending_type set, returning key length: %d", klen); */
@@ -182,28 +235,100 @@ static int cc_put_state_native(wasm_exec_env_t exec_env,
                                uint32_t key_ptr, int key_len,
                                uint32_t val_ptr, int val_len)
 {
+    if (terminate_if_expired(exec_env, true))
+        return -1;
     wasm_module_inst_t inst = wasm_runtime_get_module_inst(exec_env);
     const char *key = (const char*)to_native(inst, key_ptr, (uint32_t)(key_len > 0 ? key_len : 0));
     const char *val = (const char*)to_native(inst, val_ptr, (uint32_t)(val_len > 0 ? val_len : 0));
     /* DMSG("cc_put_state in, key_len=%d, val_len=%d", key_len, val_len); */
-    if (!g_chaincode_sess)
+    chaincode_tx_ctx *tx = tx_from_exec_env(exec_env);
+    if (!tx)
         return -1;
-    TEE_MemFill(g_chaincode_sess->key, 0, KEY_SIZE);
-    TEE_MemFill(g_chaincode_sess->value, 0, VAL_SIZE);
+    TEE_MemFill(tx->key, 0, KEY_SIZE);
+    TEE_MemFill(tx->value, 0, VAL_SIZE);
     int klen = key_len < KEY_SIZE-1 ? key_len : KEY_SIZE-1;
     int vlen = val_len < VAL_SIZE-1 ? val_len : VAL_SIZE-1;
     if (klen > 0 && key)
-        TEE_MemMove(g_chaincode_sess->key, key, (size_t)klen);
+        TEE_MemMove(tx->key, key, (size_t)klen);
     if (vlen > 0 && val)
-        TEE_MemMove(g_chaincode_sess->value, val, (size_t)vlen);
+        TEE_MemMove(tx->value, val, (size_t)vlen);
 
-    g_chaincode_sess->pending_type = PUT_STATE_REQUEST;
-    g_chaincode_sess->wasm_out_offset = 0;
-    g_chaincode_sess->wasm_out_len = 0;
+    tx->pending_type = PUT_STATE_REQUEST;
+    tx->wasm_out_offset = 0;
+    tx->wasm_out_len = 0;
     /* 예외 발생 없이 요청만 표시 */
     return -1;
 }
 
+/* 조회 결과 페이지를 받을 WASM 버퍼를 기억한다 (헤더가 들어가지 않으면 false) */
+static bool request_page(wasm_module_inst_t inst, chaincode_tx_ctx *tx, uint32_t out_ptr, int out_len)
+{
+    if (out_len <= (int)sizeof(struct iter_page_header) || !to_native(inst, out_ptr, (uint32_t)out_len))
+        return false;
+    tx->wasm_out_offset = out_ptr;
+    tx->wasm_out_len = out_len;
+    return true;
+}
+
+static void copy_key(char dst[KEY_SIZE], const char *src, int len)
+{
+    int n = len < KEY_SIZE - 1 ? len : KEY_SIZE - 1;
+    TEE_MemFill(dst, 0, KEY_SIZE);
+    if (n > 0 && src)
+        TEE_MemMove(dst, src, (size_t)n);
+}
+
+/*
+ * 범위(ITER_RANGE: a 이상 b 미만), 부분 복합 키(ITER_PARTIAL_COMPOSITE: a = object type,
+ * b = 속성들을 ITER_ATTR_SEPARATOR로 이은 것), 이력(ITER_HISTORY: a = 키) 조회를 연다.
+ * cc_get_state처럼 요청만 남기고 돌아가며, 다음 step_resume 전에 out에 첫 페이지
+ * (struct iter_page_header + 레코드)가 채워진다. 0: 요청함, -1: 잘못된 인자
+ */
+static int cc_iter_open_native(wasm_exec_env_t exec_env, int kind,
+                               uint32_t a_ptr, int a_len, uint32_t b_ptr, int b_len,
+                               uint32_t out_ptr, int out_len)
+{
+    if (terminate_if_expired(exec_env, true))
+        return -1;
+    wasm_module_inst_t inst = wasm_runtime_get_module_inst(exec_env);
+    const char *a = (const char*)to_native(inst, a_ptr, (uint32_t)(a_len > 0 ? a_len : 0));
+    const char *b = (const char*)to_native(inst, b_ptr, (uint32_t)(b_len > 0 ? b_len : 0));
+    chaincode_tx_ctx *tx = tx_from_exec_env(exec_env);
+    if (!tx || (a_len > 0 && !a) || (b_len > 0 && !b) || kind < ITER_RANGE || kind > ITER_HISTORY
+        || !request_page(inst, tx, out_ptr, out_len))
+        return -1;
+
+    copy_key(tx->key, a, a_len);
+    copy_key(tx->iter_end, b, b_len);
+    tx->iter_kind = (uint32_t)kind;
+    tx->iter_id = 0;
+    tx->pending_type = ITER_OPEN_REQUEST;
+    return 0;
+}
+
+/* cc_iter_open이 페이지 헤더로 알려 준 반복자의 다음 페이지를 out에 받는다 (has_more가 1일 때) */
+static int cc_iter_next_native(wasm_exec_env_t exec_env, int iter_id, uint32_t out_ptr, int out_len)
+{
+    if (terminate_if_expired(exec_env, true))
+        return -1;
+    wasm_module_inst_t inst = wasm_runtime_get_module_inst(exec_env);
+    chaincode_tx_ctx *tx = tx_from_exec_env(exec_env);
+    if (!tx || !request_page(inst, tx, out_ptr, out_len))
+        return -1;
+
+    tx->iter_id = (uint32_t)iter_id;
+    tx->pending_type = ITER_NEXT_REQUEST;
+    return 0;
+}
+
+/* 반복자는 호출이 끝날 때 REE(프록시와 래퍼)가 함께 닫으므로 TEE를 나가지 않는다 */
+static int cc_iter_close_native(wasm_exec_env_t exec_env, int iter_id)
+{
+    (void)exec_env;
+    (void)iter_id;
+    return 0;
+}
+
 /* cc_return_response 함수를 int 반환 타입으로 구현 */
 static int cc_return_response_native(wasm_exec_env_t exec_env, uint32_t msg_ptr, int msg_len)
 {
@@ -216,29 +341,32 @@ static int cc_return_response_native(wasm_exec_env_t exec_env, uint32_t msg_ptr,
     }
     
     const char *msg = (const char*)to_native(inst, msg_ptr, (uint32_t)(msg_len > 0 ? msg_len : 0));
-    if (!g_chaincode_sess) {
-        EMSG("cc_return_response: no session context");
+    chaincode_tx_ctx *tx = tx_from_exec_env(exec_env);
+    if (!tx) {
+        EMSG("cc_return_response: no transaction context");
         return 0;
     }
     
     int n = (msg_len < (int)RESPONSE_SIZE - 1) ? msg_len : ((int)RESPONSE_SIZE - 1);
-    TEE_MemFill(g_chaincode_sess->response, 0, RESPONSE_SIZE);
+    TEE_MemFill(tx->response, 0, RESPONSE_SIZE);
     
     if (msg && n > 0) {
-        TEE_MemMove(g_chaincode_sess->response, msg, (size_t)n);
+        TEE_MemMove(tx->response, msg, (size_t)n);
         /* DMSG("[DEBUG] cc_return_response: copied response '%.*s'", n, msg); */
     }
     
-    g_chaincode_sess->response[n] = '\0';
-    g_chaincode_sess->has_response = 1;
+    tx->response[n] = '\0';
+    tx->has_response = 1;
     
-    /* DMSG("[DEBUG] cc_return_response: set response='%s', has_response=1", g_chaincode_sess->response); */
+    /* DMSG("[DEBUG] cc_return_response: set response='%s', has_response=1", tx->response); */
     return n; // 복사된 바이트 수 반환
 }
 
 static int cc_log_native(wasm_exec_env_t exec_env, uint32_t msg_ptr, int msg_len)
 {
     /* DMSG("[DEBUG] cc_log in, msg_ptr=0x%x, msg_len=%d", msg_ptr, msg_len); */
+    if (terminate_if_expired(exec_env, true))
+        return 0;
     
     wasm_module_inst_t inst = wasm_runtime_get_module_inst(exec_env);
     if (!inst) {
@@ -248,11 +376,10 @@ static int cc_log_native(wasm_exec_env_t exec_env, uint32_t msg_ptr, int msg_len
     
     const char *msg = (const char*)to_native(inst, msg_ptr, (uint32_t)(msg_len > 0 ? msg_len : 0));
     if (msg && msg_len > 0) {
-        char buf[128];
-        int n = msg_len < (int)sizeof(buf)-1 ? msg_len : (int)sizeof(buf)-1;
-        TEE_MemFill(buf, 0, sizeof(buf));
-        TEE_MemMove(buf, msg, (size_t)n);
-        /* DMSG("cc_log: %s", buf); */
+        /* REE의 로그 링에 바로 쓴다 (월드 스위치 없음, 자리가 없으면 버려지고 dropped로 센다) */
+        int n = msg_len < LOG_RECORD_MAX ? msg_len : LOG_RECORD_MAX;
+        chaincode_tx_ctx *tx = tx_from_exec_env(exec_env);
+        log_ring_append(tx ? tx->slot : 0, msg, (size_t)n);
         return n;
     }
     return 0;
@@ -262,12 +389,15 @@ static int cc_log_native(wasm_exec_env_t exec_env, uint32_t msg_ptr, int msg_len
 static int debug_log_native(wasm_exec_env_t exec_env, int step_num)
 {
     /* DMSG("WASM DEBUG: step %d reached", step_num); */
+    terminate_if_expired(exec_env, true);
     return 0; // 성공
 }
 
 /* 표준 C 빌트인 대체 (컴파일러가 생성하는 env.mem*) */
 static uint32_t env_memset_native(wasm_exec_env_t exec_env, uint32_t dst_ptr, int c, uint32_t n)
 {
+    if (terminate_if_expired(exec_env, false))
+        return 0;
     wasm_module_inst_t inst = wasm_runtime_get_module_inst(exec_env);
     void *dst = to_native(inst, dst_ptr, n);
     if (!dst && n)
@@ -279,6 +409,8 @@ static uint32_t env_memset_native(wasm_exec_env_t exec_env, uint32_t dst_ptr, in
 
 static uint32_t env_memcpy_native(wasm_exec_env_t exec_env, uint32_t dst_ptr, uint32_t src_ptr, uint32_t n)
 {
+    if (terminate_if_expired(exec_env, false))
+        return 0;
     wasm_module_inst_t inst = wasm_runtime_get_module_inst(exec_env);
     void *dst = to_native(inst, dst_ptr, n);
     void *src = to_native(inst, src_ptr, n);
@@ -291,6 +423,8 @@ static uint32_t env_memcpy_native(wasm_exec_env_t exec_env, uint32_t dst_ptr, ui
 
 static uint32_t env_memmove_native(wasm_exec_env_t exec_env, uint32_t dst_ptr, uint32_t src_ptr, uint32_t n)
 {
+    if (terminate_if_expired(exec_env, false))
+        return 0;
     wasm_module_inst_t inst = wasm_runtime_get_module_inst(exec_env);
     void *dst = to_native(inst, dst_ptr, n);
     void *src = to_native(inst, src_ptr, n);
@@ -307,12 +441,16 @@ NativeSymbol chaincode_native_symbols[] = {
     { "cc_get_arg",            cc_get_arg_native,            "(iii)i",  NULL },
     { "cc_get_state",          cc_get_state_native,          "(iiii)i", NULL },
     { "cc_put_state",          cc_put_state_native,          "(iiii)i", NULL },
+    { "cc_iter_open",          cc_iter_open_native,          "(iiiiiii)i", NULL },
+    { "cc_iter_next",          cc_iter_next_native,          "(iii)i",  NULL },
+    { "cc_iter_close",         cc_iter_close_native,         "(i)i",    NULL },
     { "cc_return_response",    cc_return_response_native,    "(ii)i",   NULL },
     { "cc_log",                cc_log_native,                "(ii)i",   NULL },
     { "debug_log",             debug_log_native,             "(i)i",    NULL },
     { "memset",                env_memset_native,            "(iii)i",  NULL },
     { "memcpy",                env_memcpy_native,            "(iii)i",  NULL },
     { "memmove",               env_memmove_native,           "(iii)i",  NULL },
+    { "cc_fuel",               cc_fuel_native,               "(I)I",    NULL },
 };
 
 uint32_t chaincode_native_symbols_size = sizeof(chaincode_native_symbols);
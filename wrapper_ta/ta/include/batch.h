@@ -0,0 +1,19 @@
+#ifndef TA_BATCH_H
+#define TA_BATCH_H
+
+#include <tee_internal_api.h>
+
+#include "session.h"
+#include "module_cache.h"
+
+/*
+ * 배치 실행: 같은 모듈의 트랜잭션 여러 개(최대 BATCH_MAX_TX)를 세션에 상주시키고
+ * 상태 읽기는 TA 안의 배치 캐시로 처리한다. 캐시에 없는 키는 모든 트랜잭션이 멈출 때까지
+ * 모았다가 한 번에 REE에 요청하고, 쓰기는 REE로 보내지 않고 트랜잭션별 write set에 쌓는다.
+ * 세션당 배치는 하나이며, 새 배치를 시작하면 끝나지 않은 이전 배치는 버린다.
+ */
+TEE_Result batch_start(chaincode_session_ctx *sc, cached_module *cm, TEE_Param params[4]);
+TEE_Result batch_supply_state(chaincode_session_ctx *sc, TEE_Param params[4]);
+void batch_release(chaincode_session_ctx *sc);
+
+#endif /* TA_BATCH_H */
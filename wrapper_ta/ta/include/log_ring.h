@@ -0,0 +1,29 @@
+#ifndef TA_LOG_RING_H
+#define TA_LOG_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "chaincode_tee_ree_communication.h"
+
+/*
+ * 세션의 로그 링 쓰기 상태. 공유 메모리의 head/dropped는 REE에 보여 주기만 하고,
+ * 쓸 위치는 TA가 가진 head로만 정한다 (REE가 헤더를 바꿔도 링 밖에 쓰지 않는다).
+ */
+struct log_ring_writer {
+    uint32_t head;
+    uint32_t dropped;
+};
+
+/*
+ * 명령마다 params[3] 버퍼에 링이 있으면 writer와 함께 현재 링으로 잡는다 (없으면 링 없음).
+ * TA 인스턴스는 명령을 하나씩 처리하므로 명령이 끝날 때까지 유효하다
+ */
+void log_ring_bind(struct log_ring_writer *w, void *buffer, size_t size);
+/* 현재 링 뒤의 stdout 영역 (링이 없으면 그대로) */
+void log_ring_stdout_area(void **buffer, uint64_t *size);
+/* 레코드 하나를 덧붙인다. 링이 없거나 자리가 없으면 false (자리가 없던 것은 dropped에 센다) */
+bool log_ring_append(uint32_t slot, const char *msg, size_t len);
+
+#endif /* TA_LOG_RING_H */
@@ -0,0 +1,83 @@
+#ifndef TA_MODULE_CACHE_H
+#define TA_MODULE_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <tee_internal_api.h>
+
+#include "wasm_export.h"
+#include "wasm.h"
+#include "chaincode_tee_ree_communication.h"
+
+/* TA 인스턴스 안에 보관하는 최대 모듈 수 */
+#define MODULE_CACHE_MAX_ENTRIES 4
+/* 모듈마다 미리 만들어 두는 인스턴스 수 상한 (세션의 트랜잭션 슬롯 수 TA_TX_SLOTS) */
+#define MODULE_READY_MAX 4
+/* 이만큼의 트랜잭션 동안 풀이 한 번도 비지 않았으면 목표를 하나 줄인다 */
+#define MODULE_READY_WINDOW 32
+
+/* 미리 만들어 둔 인스턴스: 트랜잭션 시작은 포인터 두 개를 꺼내기만 한다 */
+typedef struct ready_instance {
+    wasm_module_inst_t module_inst;
+    wasm_exec_env_t exec_env;
+} ready_instance;
+
+/*
+ * 로드(재배치)가 끝난 모듈. image는 REE 버퍼에서 한 번만 복사한 신뢰 사본이며
+ * XIP 이미지라면 WAMR가 코드를 다시 복사하지 않고 여기서 바로 실행한다.
+ */
+typedef struct cached_module {
+    char id[MODULE_ID_SIZE];   /* 보안 저장소에 설치된 모듈이면 그 id, 아니면 "" */
+    uint8_t hash[RA_HASH_SIZE / 8];
+    uint8_t *image;
+    uint32_t image_size;
+    bool xip;
+    wasm_module_t module;
+    uint32_t users;            /* 살아있는 인스턴스 수, 0일 때만 축출 */
+    bool retired;              /* 새 버전으로 교체됨: 조회되지 않고 users가 0이 되면 해제 */
+    ready_instance ready[MODULE_READY_MAX]; /* 아직 트랜잭션에 주지 않은 인스턴스 */
+    uint32_t ready_count;
+    uint32_t ready_target;     /* 관찰한 수요: 비어 있을 때 온 트랜잭션마다 늘고 남으면 줄인다 */
+    uint32_t ready_floor;      /* COMMAND_PRELOAD_MODULE이 요청한 최소 */
+    uint32_t ready_takes;      /* 이번 관찰 구간(MODULE_READY_WINDOW)의 트랜잭션 수 */
+    uint32_t ready_low;        /* 이번 관찰 구간에 가장 적게 남았던 수 */
+    struct cached_module *next;
+} cached_module;
+
+/* 서명 없는 REE 이미지: UNSIGNED_MODULES=1로 빌드한 TA만 받는다 (아니면 TEE_ERROR_ACCESS_DENIED) */
+TEE_Result module_cache_get(const uint8_t *ree_image, uint32_t ree_image_size,
+                            bool reload, cached_module **out,
+                            struct module_load_stats *stats);
+TEE_Result module_cache_get_by_id(const char *module_id, cached_module **out);
+/* 로드하고 인스턴스를 instances개(최대 MODULE_READY_MAX)까지 미리 만들어 둔다 */
+TEE_Result module_cache_preload(const char *module_id, uint32_t instances, uint32_t *ready);
+/* 미리 만든 인스턴스를 하나 꺼낸다. 없으면 false (수요로 기록하고 호출한 쪽이 직접 만든다) */
+bool module_cache_take_ready(cached_module *entry, wasm_module_inst_t *inst, wasm_exec_env_t *exec_env);
+/* 목표보다 모자란 풀을 최대 budget개까지 채운다 (트랜잭션이 끝난 TEE 진입의 마지막에 호출) */
+void module_cache_refill(uint32_t budget);
+/* 힙이 모자랄 때: 미리 만든 인스턴스를 모두 내리고 목표를 최소로 되돌린다 */
+void module_cache_trim_ready(void);
+/*
+ * 서명(module_signature.h)을 확인하고 설치한다. 다른 이미지로 설치된 id는 replace가 서명에 포함된
+ * 경우에만 바꾸고(아니면 TEE_ERROR_ACCESS_CONFLICT), 같은 이미지는 다시 쓰지 않는다
+ */
+TEE_Result module_cache_install(const char *module_id, const uint8_t *ree_image,
+                                uint32_t ree_image_size, const uint8_t *signature,
+                                uint32_t signature_size, bool replace, cached_module **out);
+/* 분할 업로드: begin → chunk(순서대로) ... → commit */
+TEE_Result module_cache_upload_begin(const char *module_id, uint32_t total_size);
+TEE_Result module_cache_upload_chunk(uint32_t offset, const uint8_t *chunk, uint32_t chunk_size);
+TEE_Result module_cache_upload_commit(const uint8_t *signature, uint32_t signature_size,
+                                      bool replace, cached_module **out);
+/*
+ * 캐시된 모듈의 PGO 카운터(.profraw)를 buf에 복사한다. *size: 들어올 때 buf 크기, 나갈 때 쓴(모자라면
+ * 필요한) 바이트 수. 카운터는 모듈에 있어 이 인스턴스에서 실행한 모든 트랜잭션이 쌓인다
+ */
+TEE_Result module_cache_dump_profile(const char *module_id, void *buf, uint32_t *size);
+/* 설치된 버전을 보안 저장소에서 지우고 캐시 사본을 내린다 */
+TEE_Result module_cache_remove(const char *module_id);
+void module_cache_acquire(cached_module *entry);
+void module_cache_release(cached_module *entry);
+void module_cache_clear(void);
+
+#endif /* TA_MODULE_CACHE_H */
@@ -0,0 +1,20 @@
+#ifndef TA_MODULE_SIGNATURE_H
+#define TA_MODULE_SIGNATURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <tee_internal_api.h>
+
+#include "chaincode_tee_ree_communication.h"
+
+/*
+ * 모듈 설치 서명 확인. 서명은 빌드 호스트가 비밀 키로 만들고(chaincode/sign_module.sh),
+ * TA에는 빌드할 때 공개 키(ta/Makefile의 MODULE_SIGNING_PUBKEY)만 들어간다.
+ * 서명 대상은 module_id || '\0' || SHA-256(이미지) || replace(1바이트) 이고 RSA PKCS#1 v1.5 + SHA-256.
+ * 모듈 id(버전 포함)와 교체 허용 여부까지 서명되므로 REE는 서명된 이미지를 다른 id로 설치하거나
+ * 설치된 id를 허락 없이 덮어쓸 수 없다.
+ */
+TEE_Result module_signature_verify(const char *module_id, const uint8_t image_hash[MODULE_HASH_SIZE],
+                                   bool replace, const uint8_t *signature, uint32_t signature_size);
+
+#endif /* TA_MODULE_SIGNATURE_H */
@@ -0,0 +1,26 @@
+#ifndef TA_MODULE_STORE_H
+#define TA_MODULE_STORE_H
+
+#include <stdint.h>
+#include <tee_internal_api.h>
+
+#include "wasm.h"
+
+#define STORED_MODULE_MAGIC 0x57414d4d /* "WAMM" */
+
+/* 보안 저장소 객체 = 헤더 + AOT 이미지 */
+struct stored_module_header {
+    uint32_t magic;
+    uint32_t image_size;
+    uint32_t xip;
+    uint8_t hash[RA_HASH_SIZE / 8];
+};
+
+TEE_Result module_store_write(const char *module_id, const struct stored_module_header *hdr,
+                              const uint8_t *image);
+TEE_Result module_store_open(const char *module_id, TEE_ObjectHandle *obj,
+                             struct stored_module_header *hdr);
+TEE_Result module_store_read_image(TEE_ObjectHandle obj, uint8_t *image, uint32_t image_size);
+TEE_Result module_store_remove(const char *module_id);
+
+#endif /* TA_MODULE_STORE_H */
@@ -1,29 +1,83 @@
 #ifndef TA_SESSION_H
 #define TA_SESSION_H
 
+#include <stdbool.h>
 #include <stdint.h>
+#include <tee_internal_api.h>
+#include <wamr_ta.h>
 #include "chaincode_tee_ree_communication.h"
+#include "log_ring.h"
 #include "wasm.h"
+#include "wasm_export.h"
+
+/* 트랜잭션 슬롯: 호스트콜을 기다리는 동안에도 세션에 남아 있는 트랜잭션 하나 */
+typedef struct chaincode_tx_ctx {
+    uint32_t slot;  /* 세션 안에서의 번호 (COMMAND_RESUME_WASM의 params[1].value.b) */
+    bool in_use;
 
-typedef struct chaincode_session_ctx {
     struct arguments args; /* arguments[0]를 function으로 사용 */
     int pending_type; /* 0 none, 1 GET_STATE_REQUEST, 2 PUT_STATE_REQUEST */
     char key[KEY_SIZE];
     char value[VAL_SIZE];
     uint32_t wasm_out_offset; /* WASM out 버퍼의 앱 오프셋 (포인터 보관 금지) */
     int wasm_out_len;
+    /* ITER_OPEN/NEXT_REQUEST: 조회 종류, 반복자 번호, 끝 키 (시작 키는 key) */
+    uint32_t iter_kind;
+    uint32_t iter_id;
+    char iter_end[KEY_SIZE];
 
     char response[RESPONSE_SIZE];
     int has_response;
 
-    /* Persistent runtime (mode 2) */
-    wamr_context *runtime; /* owned while invocation in progress */
-    uint8_t *heap_buf_owned;
-    uint8_t *trusted_wasm_owned;
-} chaincode_session_ctx;
+    /* 시작할 때 REE가 미리 읽어 넘긴 상태 (struct start_request): 이 키의 GET은 TA 안에서 답한다 */
+    uint32_t prefetched;
+    struct key_value prefetch[PREFETCH_MAX];
 
-extern chaincode_session_ctx *g_chaincode_sess;
+    /* 트랜잭션 전용 WASM 인스턴스 (런타임 힙 풀과 모듈 캐시는 TA 인스턴스 공용) */
+    wamr_context wasm;
+    wamr_context *runtime; /* 트랜잭션 진행 중에는 &wasm, 아니면 NULL */
+    struct cached_module *module; /* 진행 중인 인스턴스가 사용하는 캐시 모듈 */
 
-#endif /* TA_SESSION_H */
+    /* 마감: 시작할 때 REE가 넘긴 남은 시간으로 정한 TEE 시각 (has_deadline이 거짓이면 없음) */
+    bool has_deadline;
+    TEE_Time deadline;
+    bool cancelled;           /* 마감이 지났거나 REE가 취소 요청 → 인스턴스를 멈추고 슬롯 회수 */
+    uint32_t deadline_checks; /* 메모리 함수 호출 수 (몇 번에 한 번만 시각 확인) */
+
+    /* 연료 계량 (fuel_meter.py로 계량 코드를 넣은 모듈만): 사용량 = 받은 양 - 남은 양 */
+    bool metered;
+    bool out_of_fuel;
+    uint64_t fuel_limit;    /* 트랜잭션 한도 (0이면 없음), 시작할 때 세션 설정에서 복사 */
+    uint64_t fuel_granted;  /* cc_fuel로 넘겨준 연료 합 */
+    int64_t fuel_left;      /* 마지막 cc_fuel 호출 때 WASM에 남아 있던 연료 */
+} chaincode_tx_ctx;
 
+typedef struct chaincode_session_ctx {
+    chaincode_tx_ctx tx[TA_TX_SLOTS];
+    struct chaincode_batch *batch; /* 진행 중인 배치 (COMMAND_RUN_BATCH), 없으면 NULL */
+    uint64_t fuel_limit;           /* COMMAND_CONFIGURE_FUEL: 트랜잭션당 연료 한도 (0이면 없음) */
+    struct log_ring_writer log;    /* params[3]의 체인코드 로그 링에 쓴 위치 */
+} chaincode_session_ctx;
+
+/* main.c: 트랜잭션 인스턴스 수명 관리 (슬롯 실행과 배치 실행이 함께 사용) */
+struct cached_module;
+TEE_Result instantiate_invocation(chaincode_tx_ctx *tx, struct cached_module *cm);
+bool call_step(wamr_context *ctx, const char *name);
+void deliver_state_value(chaincode_tx_ctx *tx, const char *value);
+void release_invocation(chaincode_tx_ctx *tx);
+/* 마감이 지났거나 이번 명령에 TEEC_RequestCancellation이 왔는지 (한 번 참이면 계속 참) */
+bool invocation_expired(chaincode_tx_ctx *tx);
+/* 계량 모듈이면 지금까지 쓴 연료, 아니면 0 (인스턴스를 정리하기 전에 부른다) */
+uint64_t invocation_fuel_used(chaincode_tx_ctx *tx);
 
+/*
+ * 네이티브 임포트는 전역 대신 인스턴스의 custom data(start_invocation에서 설정)로
+ * 자기 트랜잭션을 찾는다.
+ */
+static inline chaincode_tx_ctx *tx_from_exec_env(wasm_exec_env_t exec_env)
+{
+    wasm_module_inst_t inst = wasm_runtime_get_module_inst(exec_env);
+    return inst ? (chaincode_tx_ctx *)wasm_runtime_get_custom_data(inst) : NULL;
+}
+
+#endif /* TA_SESSION_H */
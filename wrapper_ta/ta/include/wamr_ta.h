@@ -1,13 +1,103 @@
 #ifndef TA_WAMR_H
 #define TA_WAMR_H
 
+/* 체인코드마다 따로 TA를 두려면 make CHAINCODE_TA_UUID=... 로 빌드한다 (ta/Makefile) */
+#ifndef TA_WAMR_UUID
 #define TA_WAMR_UUID \
   { 0xb4c5d6e7, 0xf8a9, 0x4321, \
     { 0x87, 0x65, 0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc } }
+#endif
 
+// RUN_WASM and LOAD_MODULE take an unsigned image straight from the REE. Only TAs built with
+// UNSIGNED_MODULES=1 (development and --bench-load) accept them; others return TEE_ERROR_ACCESS_DENIED
 #define COMMAND_RUN_WASM        0
 #define COMMAND_CONFIGURE_HEAP  1
 // Future: resume WASM execution after host handled a proxy request (GET/PUT)
 #define COMMAND_RESUME_WASM     2
+// Load (hash, copy once, relocate) an AOT image into the TA module cache; params[2] returns
+// struct module_load_stats (chaincode_tee_ree_communication.h)
+#define COMMAND_LOAD_MODULE     3
+// Verify an AOT image's signature and persist it in OP-TEE secure storage under a module id
+#define COMMAND_INSTALL_MODULE  4
+// Same as COMMAND_RUN_WASM, but params[0] names an installed module id
+#define COMMAND_RUN_WASM_BY_ID  5
+// Chunked install for images larger than one shared-memory transfer:
+// BEGIN(id, total size) -> CHUNK(data, offset) ... -> COMMIT(expected hash, flags)
+#define COMMAND_UPLOAD_BEGIN    6
+#define COMMAND_UPLOAD_CHUNK    7
+#define COMMAND_UPLOAD_COMMIT   8
+// Drop an in-flight transaction slot (params[0].value.a) without resuming it
+#define COMMAND_ABORT_TX        9
+// Batch execution of many invocations of one module (see BATCH_* in chaincode_tee_ree_communication.h):
+// RUN_BATCH(id, params[1].value.a = count, params[2] = struct arguments[count]) runs every
+// transaction until it finishes or reads a key the TA does not have yet; BATCH_STATE delivers
+// those keys (params[1].value.b records) and continues. Both answer BATCH_NEED_STATE with the
+// missing keys or BATCH_DONE with read sets, write sets and responses. Writes stay in the TA.
+#define COMMAND_RUN_BATCH       10
+#define COMMAND_BATCH_STATE     11
+#define COMMAND_ABORT_BATCH     12
+// Several RUN_WASM_BY_ID / RESUME_WASM steps in one entry: params[1].value.a = record count
+// (at most TA_TX_SLOTS), params[2] = struct step_record[count], each answered in place
+#define COMMAND_MULTI_STEP      13
+// Per-invocation fuel limit of this session: params[0].value.a/b = low/high 32 bits (0 = unlimited)
+#define COMMAND_CONFIGURE_FUEL  14
+// Load an installed module id (params[0]) into this instance's cache without running it and
+// keep at least params[1].value.a instances of it instantiated (at most MODULE_READY_MAX); the
+// number actually ready is returned in params[1].value.b. Beyond that floor the pool follows
+// demand and is refilled at the end of each TEE entry in which transactions finished
+#define COMMAND_PRELOAD_MODULE  15
+// Delete an installed module id (params[0]) from secure storage and drop its cached copy
+#define COMMAND_REMOVE_MODULE   16
+// Copy the PGO counters this instance collected for a cached module id (params[0]) into
+// params[1] (LLVM .profraw bytes for llvm-profdata). A short buffer returns
+// TEE_ERROR_SHORT_BUFFER with the needed size in params[1]. Only modules compiled with
+// wamrc --enable-llvm-pgo have counters; TAs built without PGO=1 return TEE_ERROR_NOT_SUPPORTED
+#define COMMAND_DUMP_PROFILE    17
+
+/*
+ * Module ids may carry a version: "<aot_file>@<version>". When one version is preloaded or
+ * installed, this instance retires its other cached versions of the same aot_file: unused
+ * ones are freed at once, ones with live instances when their last instance is released.
+ * The REE installs and preloads a new version before sending it any transaction, and
+ * removes the old one once no transaction of it is in flight.
+ */
+
+/*
+ * Each session keeps up to TA_TX_SLOTS transactions resident. RUN_WASM(_BY_ID)
+ * returns the slot in params[1].value.b and COMMAND_RESUME_WASM names it in the
+ * same field, so the REE can start or resume another transaction while one waits
+ * on a host call. TEE_ERROR_BUSY means every slot of the session is in flight.
+ *
+ * RUN_WASM_BY_ID takes the transaction's remaining time in ms in params[1].value.a
+ * (0 = no deadline). Once it passes, or TEEC_RequestCancellation hits the command,
+ * the next host function call terminates the instance, the slot is freed and the
+ * command returns TEE_ERROR_CANCEL; the session itself stays usable.
+ */
+#define TA_TX_SLOTS             4
+
+/*
+ * Fuel metering: modules instrumented by chaincode/fuel_meter.py count executed wasm
+ * instructions and ask the TA for more fuel (env.cc_fuel) every FUEL_REFILL units. Their
+ * final INVOCATION_RESPONSE carries RESPONSE_FUEL_METERED and the fuel used; past the
+ * session's limit the instance traps, the slot is freed and the response is OUT_OF_FUEL
+ * with RESPONSE_OUT_OF_FUEL. Every refill also checks the deadline, so metered modules
+ * are cancellable even inside loops without host calls.
+ */
+#define FUEL_REFILL             100000
+#define FUEL_LEFT_EXPORT        "__fuel_left"
+
+/* COMMAND_LOAD_MODULE flags (params[1].value.a) */
+#define LOAD_FLAG_RELOAD        (1 << 0)  /* evict a cached copy first (cold load); TEE_ERROR_BUSY while it is in use */
+
+/*
+ * COMMAND_INSTALL_MODULE: params[0] image, params[1] module id, params[2] signature, params[3].value.a flags.
+ * COMMAND_UPLOAD_COMMIT: params[0] signature, params[1].value.a flags.
+ * The signature is checked against the public key built into the TA and covers the module id, the
+ * image hash and INSTALL_FLAG_REPLACE (module_signature.h). An id already installed with another
+ * image is only overwritten when the flag is set and signed, otherwise the install returns
+ * TEE_ERROR_ACCESS_CONFLICT. Installing the same image again changes nothing.
+ * Wasm bytecode is refused with TEE_ERROR_NOT_SUPPORTED unless the TA is built with INTERP=1.
+ */
+#define INSTALL_FLAG_REPLACE    (1 << 1)
 
 #endif /* TA_WAMR_H */
@@ -6,6 +6,8 @@
 #include "wasm_export.h"
 
 #define RA_HASH_SIZE    256
+/* 트랜잭션 실행 환경(exec_env)의 스택 크기 */
+#define WASM_EXEC_STACK_SIZE    (256 * 1024)
 
 typedef struct wamr_context_
 {
@@ -26,9 +28,12 @@ extern wamr_context *singleton_wamr_context;
 // Native Functions 제거 - Pure WASM 테스트용
 
 void TA_SetOutputBuffer(void *output_buffer, uint64_t output_buffer_size);
+TEE_Result TA_HashBuffer(const uint8_t *buffer, uint32_t buffer_size, uint8_t hash[RA_HASH_SIZE / 8]);
 TEE_Result TA_HashWasmBytecode(wamr_context *ctx);
-TEE_Result TA_InitializeWamrRuntime(wamr_context* context, int argc, char** argv);
+TEE_Result TA_InitializeWamrRuntime(wamr_context* context);
+TEE_Result TA_InstantiateWamrModule(wamr_context* context, int argc, char** argv);
 TEE_Result TA_ExecuteWamrRuntime(wamr_context* context);
+void TA_DestroyWamrInstance(wamr_context* context);
 void TA_TearDownWamrRuntime(wamr_context* context);
 
 #endif /* WASM_H */ 
\ No newline at end of file
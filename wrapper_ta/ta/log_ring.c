@@ -0,0 +1,65 @@
+#include <tee_internal_api.h>
+
+#include "log_ring.h"
+
+static struct log_ring *current_ring;
+static struct log_ring_writer *current_writer;
+
+void log_ring_bind(struct log_ring_writer *w, void *buffer, size_t size)
+{
+    current_ring = NULL;
+    current_writer = NULL;
+    if (!w || !buffer || size < sizeof(struct log_ring))
+        return;
+    struct log_ring *ring = buffer;
+    if (__atomic_load_n(&ring->magic, __ATOMIC_RELAXED) != LOG_RING_MAGIC)
+        return;
+    current_ring = ring;
+    current_writer = w;
+}
+
+void log_ring_stdout_area(void **buffer, uint64_t *size)
+{
+    if (!current_ring || (void *)current_ring != *buffer || *size < sizeof(struct log_ring))
+        return;
+    *buffer = (uint8_t *)*buffer + sizeof(struct log_ring);
+    *size -= sizeof(struct log_ring);
+}
+
+/* at(누적 위치)부터 len 바이트를 링에 쓴다 (끝에 닿으면 앞으로 이어서) */
+static void ring_write(struct log_ring *ring, uint32_t at, const void *src, size_t len)
+{
+    uint32_t pos = at % LOG_RING_DATA;
+    size_t first = LOG_RING_DATA - pos < len ? LOG_RING_DATA - pos : len;
+    TEE_MemMove(ring->data + pos, src, first);
+    if (first < len)
+        TEE_MemMove(ring->data, (const uint8_t *)src + first, len - first);
+}
+
+bool log_ring_append(uint32_t slot, const char *msg, size_t len)
+{
+    struct log_ring *ring = current_ring;
+    struct log_ring_writer *w = current_writer;
+    if (!ring || !w)
+        return false;
+    if (len > LOG_RECORD_MAX)
+        len = LOG_RECORD_MAX;
+
+    /* tail은 REE가 쓰므로 믿지 않는다: 쓴 것보다 앞서거나 너무 뒤면 가득 찬 것으로 본다 */
+    uint32_t need = (uint32_t)(sizeof(struct log_record) + len);
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    uint32_t used = w->head - tail;
+    if (used > LOG_RING_DATA || LOG_RING_DATA - used < need) {
+        w->dropped++;
+        __atomic_store_n(&ring->dropped, w->dropped, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    struct log_record rec = { (uint16_t)len, (uint8_t)slot, 0 };
+    ring_write(ring, w->head, &rec, sizeof(rec));
+    ring_write(ring, w->head + sizeof(rec), msg, len);
+    w->head += need;
+    /* 레코드를 다 쓴 뒤에 head를 보인다 (REE는 acquire로 읽음) */
+    __atomic_store_n(&ring->head, w->head, __ATOMIC_RELEASE);
+    return true;
+}
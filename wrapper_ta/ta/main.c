@@ -11,6 +11,8 @@
 #include "session.h"
 #include "include/chaincode_native_functions.h"
 #include "chaincode_tee_ree_communication.h"
+#include "module_cache.h"
+#include "batch.h"
 #include <string.h>
 
 /* 메모리 기반 통신용 구조체 정의 */
@@ -29,14 +31,28 @@ struct chaincode_response {
     char data[256];
 };
 
+/*
+ * TA 인스턴스 공용 상태: WAMR 런타임(힙 풀)과 모듈 캐시는 프로세스 단위다.
+ * 트랜잭션 상태는 모두 세션 컨텍스트(sess_ctx)에 있으므로 세션끼리 공유하지 않는다.
+ * TA_FLAGS에 SINGLE_INSTANCE가 없어 세션마다 별도 인스턴스가 만들어지고,
+ * 프록시의 워커(코어별 세션)가 서로 다른 코어에서 동시에 실행된다.
+ */
 static uint32_t heap_size;
-chaincode_session_ctx *g_chaincode_sess = NULL;
+static uint8_t *runtime_heap_buf;
 
 TEE_Result TA_CreateEntryPoint(void) {
     return TEE_SUCCESS;
 }
 
 void TA_DestroyEntryPoint(void) {
+    if (runtime_heap_buf) {
+        wamr_context none;
+        TEE_MemFill(&none, 0, sizeof(none));
+        module_cache_clear();
+        TA_TearDownWamrRuntime(&none);
+        TEE_Free(runtime_heap_buf);
+        runtime_heap_buf = NULL;
+    }
 }
 
 TEE_Result TA_OpenSessionEntryPoint(uint32_t param_types, TEE_Param __maybe_unused params[4], void __maybe_unused **sess_ctx) {
@@ -49,26 +65,177 @@ TEE_Result TA_OpenSessionEntryPoint(uint32_t param_types, TEE_Param __maybe_unus
       return TEE_ERROR_BAD_PARAMETERS;
 
     (void)&params;
-    if (!g_chaincode_sess) {
-        g_chaincode_sess = TEE_Malloc(sizeof(*g_chaincode_sess), 0);
-        if (!g_chaincode_sess)
-            return TEE_ERROR_OUT_OF_MEMORY;
-        TEE_MemFill(g_chaincode_sess, 0, sizeof(*g_chaincode_sess));
-    }
-    *sess_ctx = g_chaincode_sess;
+    chaincode_session_ctx *sc = TEE_Malloc(sizeof(*sc), TEE_MALLOC_FILL_ZERO);
+    if (!sc)
+        return TEE_ERROR_OUT_OF_MEMORY;
+    for (uint32_t i = 0; i < TA_TX_SLOTS; i++)
+        sc->tx[i].slot = i;
+    *sess_ctx = sc;
 
     return TEE_SUCCESS;
 }
 
 void TA_CloseSessionEntryPoint(void __maybe_unused *sess_ctx) {
-    (void)&sess_ctx;
+    chaincode_session_ctx *sc = sess_ctx;
+    if (!sc)
+        return;
+    for (uint32_t i = 0; i < TA_TX_SLOTS; i++)
+        release_invocation(&sc->tx[i]);
+    batch_release(sc);
+    TEE_Free(sc);
 }
 
 static TEE_Result TA_SetHeapSize(uint32_t size) {
+    /* 런타임이 이미 힙 풀을 잡은 뒤에는 크기를 바꿀 수 없다 */
+    if (runtime_heap_buf && size != heap_size)
+        return TEE_ERROR_BAD_STATE;
     heap_size = size;
     return TEE_SUCCESS;
 }
 
+/* WAMR 런타임은 첫 실행 때 한 번만 초기화하고 TA 인스턴스가 끝날 때까지 유지 */
+static TEE_Result ensure_runtime(void)
+{
+    wamr_context init_ctx;
+
+    if (runtime_heap_buf)
+        return TEE_SUCCESS;
+
+    runtime_heap_buf = TEE_Malloc(heap_size, 0);
+    if (!runtime_heap_buf) {
+        EMSG("Memory allocation failed! heap_buf (%u bytes)", heap_size);
+        return TEE_ERROR_OUT_OF_MEMORY;
+    }
+
+    TEE_MemFill(&init_ctx, 0, sizeof(init_ctx));
+    init_ctx.heap_buf = runtime_heap_buf;
+    init_ctx.heap_size = heap_size;
+    /* 네이티브 임포트 등록 (env 모듈) */
+    init_ctx.native_symbols = chaincode_native_symbols;
+    init_ctx.native_symbols_size = chaincode_native_symbols_size;
+
+    TEE_Result r = TA_InitializeWamrRuntime(&init_ctx);
+    if (r != TEE_SUCCESS) {
+        TEE_Free(runtime_heap_buf);
+        runtime_heap_buf = NULL;
+    }
+    return r;
+}
+
+/* 이번 TEE 진입에서 끝난 트랜잭션 수: 진입을 마치기 전에 그만큼 인스턴스 풀을 채운다 */
+static uint32_t refill_budget;
+
+/* 트랜잭션이 끝나면 인스턴스만 정리하고 런타임과 모듈 캐시는 남겨둔다. 슬롯은 비워진다 */
+void release_invocation(chaincode_tx_ctx *tx)
+{
+    if (tx->runtime) {
+        TA_DestroyWamrInstance(tx->runtime);
+        refill_budget++;
+    }
+    module_cache_release(tx->module);
+    tx->module = NULL;
+    tx->runtime = NULL;
+    tx->pending_type = 0;
+    tx->wasm_out_offset = 0;
+    tx->wasm_out_len = 0;
+    tx->has_response = 0;
+    tx->prefetched = 0;
+    tx->has_deadline = false;
+    tx->cancelled = false;
+    tx->metered = false;
+    tx->out_of_fuel = false;
+    tx->in_use = false;
+}
+
+/* 남은 시간(ms)으로 트랜잭션 마감을 정한다 (0이면 마감 없음) */
+static void set_deadline(chaincode_tx_ctx *tx, uint32_t budget_ms)
+{
+    tx->cancelled = false;
+    tx->deadline_checks = 0;
+    tx->has_deadline = budget_ms != 0;
+    if (!tx->has_deadline)
+        return;
+    TEE_GetSystemTime(&tx->deadline);
+    tx->deadline.seconds += budget_ms / 1000;
+    tx->deadline.millis += budget_ms % 1000;
+    if (tx->deadline.millis >= 1000) {
+        tx->deadline.seconds++;
+        tx->deadline.millis -= 1000;
+    }
+}
+
+bool invocation_expired(chaincode_tx_ctx *tx)
+{
+    TEE_Time now;
+
+    if (tx->cancelled)
+        return true;
+    if (TEE_GetCancellationFlag()) {
+        tx->cancelled = true;
+        return true;
+    }
+    if (tx->has_deadline) {
+        TEE_GetSystemTime(&now);
+        if (now.seconds > tx->deadline.seconds ||
+            (now.seconds == tx->deadline.seconds && now.millis >= tx->deadline.millis))
+            tx->cancelled = true;
+    }
+    return tx->cancelled;
+}
+
+uint64_t invocation_fuel_used(chaincode_tx_ctx *tx)
+{
+    int64_t left = tx->fuel_left;
+
+    if (!tx->metered || !tx->runtime)
+        return 0;
+    /* 정상 종료면 마지막 충전 이후의 소비까지 WASM 전역에서 읽는다 (중단된 인스턴스는 충전 시점 값) */
+    if (!tx->out_of_fuel && !tx->cancelled) {
+        wasm_module_inst_t inst = tx->runtime->module_inst;
+        wasm_function_inst_t fn = wasm_runtime_lookup_function(inst, FUEL_LEFT_EXPORT, NULL);
+        wasm_exec_env_t env = wasm_runtime_create_exec_env(inst, 4 * 1024);
+        uint32_t argv[2] = { 0, 0 };
+
+        if (fn && env && wasm_runtime_call_wasm(env, fn, 0, argv))
+            TEE_MemMove(&left, argv, sizeof(left));
+        else
+            wasm_runtime_clear_exception(inst);
+        if (env)
+            wasm_runtime_destroy_exec_env(env);
+    }
+    return (int64_t)tx->fuel_granted > left ? (uint64_t)((int64_t)tx->fuel_granted - left) : 0;
+}
+
+/* 최종 응답에 계량 결과를 붙인다 */
+static void report_fuel(chaincode_tx_ctx *tx, struct invocation_response *resp)
+{
+    uint64_t used = invocation_fuel_used(tx);
+
+    resp->flags = (tx->metered ? RESPONSE_FUEL_METERED : 0) | (tx->out_of_fuel ? RESPONSE_OUT_OF_FUEL : 0);
+    resp->fuel_used_lo = (uint32_t)used;
+    resp->fuel_used_hi = (uint32_t)(used >> 32);
+}
+
+/* 빈 트랜잭션 슬롯을 잡는다. 모두 호스트콜 대기 중이면 NULL */
+static chaincode_tx_ctx *alloc_tx(chaincode_session_ctx *sc)
+{
+    for (uint32_t i = 0; i < TA_TX_SLOTS; i++) {
+        if (!sc->tx[i].in_use) {
+            sc->tx[i].in_use = true;
+            return &sc->tx[i];
+        }
+    }
+    return NULL;
+}
+
+/* REE가 지정한 슬롯(params[1].value.b)이 진행 중인 트랜잭션인지 확인 */
+static chaincode_tx_ctx *lookup_tx(chaincode_session_ctx *sc, uint32_t slot)
+{
+    if (!sc || slot >= TA_TX_SLOTS || !sc->tx[slot].in_use || !sc->tx[slot].runtime)
+        return NULL;
+    return &sc->tx[slot];
+}
+
 /* 안전 strlen: 최대 max_len까지 */
 static size_t safe_strlen(const char *s, size_t max_len)
 {
@@ -79,7 +246,7 @@ static size_t safe_strlen(const char *s, size_t max_len)
 }
 
 /* step 함수 호출 */
-static bool call_step(wamr_context *ctx, const char *name)
+bool call_step(wamr_context *ctx, const char *name)
 {
     
     // 함수 조회
@@ -92,7 +259,7 @@ static bool call_step(wamr_context *ctx, const char *name)
         wasm_function_inst_t main_fn = wasm_runtime_lookup_function(ctx->module_inst, "main", NULL);
         wasm_function_inst_t get_req_fn = wasm_runtime_lookup_function(ctx->module_inst, "get_request_ptr", NULL);
         wasm_function_inst_t get_resp_fn = wasm_runtime_lookup_function(ctx->module_inst, "get_response_ptr", NULL);
-        
+        /* DMSG("main=%p get_request_ptr=%p get_response_ptr=%p",
              main_fn, get_req_fn, get_resp_fn); */
         
         return false;
@@ -106,7 +273,7 @@ static bool call_step(wamr_context *ctx, const char *name)
 
     // exec_env가 없으면 필요할 때 생성
     if (!ctx->exec_env) {
-        ctx->exec_env = wasm_runtime_create_exec_env(ctx->module_inst, 256 * 1024);
+        ctx->exec_env = wasm_runtime_create_exec_env(ctx->module_inst, WASM_EXEC_STACK_SIZE);
         if (!ctx->exec_env) {
             EMSG("Failed to create exec_env on demand");
             return false;
@@ -171,43 +338,88 @@ static bool call_step(wamr_context *ctx, const char *name)
 
 
 
+/* 기다리는 GET의 키가 시작할 때 받은 prefetch에 있으면 그 값을 넘기고 true (REE 왕복 없음) */
+static bool answer_prefetched(chaincode_tx_ctx *tx)
+{
+    if (tx->pending_type != GET_STATE_REQUEST)
+        return false;
+    size_t klen = safe_strlen(tx->key, KEY_SIZE - 1);
+    for (uint32_t i = 0; i < tx->prefetched; i++) {
+        const struct key_value *kv = &tx->prefetch[i];
+        if (safe_strlen(kv->key, KEY_SIZE - 1) == klen && !TEE_MemCompare(kv->key, tx->key, klen)) {
+            deliver_state_value(tx, kv->value);
+            return true;
+        }
+    }
+    return false;
+}
+
 /* 메모리 기반 통신 처리 */
 /* 호스트콜(yield/resume) 중심 처리: 네이티브 임포트가 pending_type을 설정하면
  * 여기서 TEEC 파라미터에 요청을 써서 즉시 반환하고, RESUME 호출에서 응답을 복사한 뒤
  * WASM의 step_resume을 실행한다. */
-static TEE_Result process_hostcall_flow(chaincode_session_ctx *sc, TEE_Param params[4])
+static TEE_Result process_hostcall_flow(chaincode_tx_ctx *tx, TEE_Param params[4])
 {
+    params[1].value.b = tx->slot;
 
-    /* 1) step_resume를 호출하여 WASM이 네이티브 임포트를 통해 요청을 생성하게 함 */
+    /* 1) step_resume를 호출하여 WASM이 네이티브 임포트를 통해 요청을 생성하게 함
+     *    (prefetch로 받은 키의 GET은 여기서 답하고 바로 다음 step_resume을 실행) */
 
-    bool ok = call_step(sc->runtime, "step_resume");
+    bool ok;
+    do {
+        ok = call_step(tx->runtime, "step_resume");
+    } while (ok && answer_prefetched(tx));
     
     if (!ok) {
-        const char *ex = wasm_runtime_get_exception(sc->runtime->module_inst);
-        EMSG("step_resume failed: %s", ex ? ex : "(null)");
+        const char *ex = wasm_runtime_get_exception(tx->runtime->module_inst);
+        bool cancelled = tx->cancelled;
+        EMSG("step_resume failed: %s", cancelled ? "cancelled (deadline)" : ex ? ex : "(null)");
         params[1].value.a = INVOCATION_RESPONSE;
         struct invocation_response *err = (struct invocation_response *)params[2].memref.buffer;
         TEE_MemFill(err, 0, sizeof(*err));
-        TEE_MemMove(err->execution_response, "RUNTIME_ERROR", 13);
-        return TEE_SUCCESS;
+        if (cancelled)
+            TEE_MemMove(err->execution_response, "CANCELLED", 9);
+        else if (tx->out_of_fuel)
+            TEE_MemMove(err->execution_response, "OUT_OF_FUEL", 11);
+        else
+            TEE_MemMove(err->execution_response, "RUNTIME_ERROR", 13);
+        report_fuel(tx, err);
+        release_invocation(tx);
+        /* 마감/취소로 멈춘 인스턴스는 이미 정리됐으므로 세션은 그대로 쓴다 */
+        return cancelled ? TEE_ERROR_CANCEL : TEE_SUCCESS;
     }
     
 
     /* 2) 네이티브 임포트가 설정한 pending_type을 확인하여 호스트로 요청 전달 */
 
-    if (sc->pending_type == GET_STATE_REQUEST) {
+    if (tx->pending_type == GET_STATE_REQUEST) {
         params[1].value.a = GET_STATE_REQUEST;
         struct key_value *kv = (struct key_value *)params[2].memref.buffer;
         TEE_MemFill(kv, 0, sizeof(*kv));
-        TEE_MemMove(kv->key, sc->key, safe_strlen(sc->key, KEY_SIZE-1));
+        TEE_MemMove(kv->key, tx->key, safe_strlen(tx->key, KEY_SIZE-1));
         return TEE_SUCCESS;
     }
-    if (sc->pending_type == PUT_STATE_REQUEST) {
+    if (tx->pending_type == PUT_STATE_REQUEST) {
         params[1].value.a = PUT_STATE_REQUEST;
         struct key_value *kv = (struct key_value *)params[2].memref.buffer;
         TEE_MemFill(kv, 0, sizeof(*kv));
-        TEE_MemMove(kv->key, sc->key, safe_strlen(sc->key, KEY_SIZE-1));
-        TEE_MemMove(kv->value, sc->value, safe_strlen(sc->value, VAL_SIZE-1));
+        TEE_MemMove(kv->key, tx->key, safe_strlen(tx->key, KEY_SIZE-1));
+        TEE_MemMove(kv->value, tx->value, safe_strlen(tx->value, VAL_SIZE-1));
+        return TEE_SUCCESS;
+    }
+    if (tx->pending_type == ITER_OPEN_REQUEST || tx->pending_type == ITER_NEXT_REQUEST) {
+        /* 페이지는 WASM 버퍼(헤더 포함)와 공유 메모리 응답 크기를 넘지 않게 요청 */
+        uint32_t room = (uint32_t)tx->wasm_out_len - sizeof(struct iter_page_header);
+        params[1].value.a = tx->pending_type;
+        struct iter_request *ir = (struct iter_request *)params[2].memref.buffer;
+        TEE_MemFill(ir, 0, sizeof(*ir));
+        ir->kind = tx->iter_kind;
+        ir->iter_id = tx->iter_id;
+        ir->max_bytes = room < ITER_PAGE_BYTES ? room : ITER_PAGE_BYTES;
+        if (tx->pending_type == ITER_OPEN_REQUEST) {
+            TEE_MemMove(ir->start, tx->key, safe_strlen(tx->key, KEY_SIZE-1));
+            TEE_MemMove(ir->end, tx->iter_end, safe_strlen(tx->iter_end, KEY_SIZE-1));
+        }
         return TEE_SUCCESS;
     }
 
@@ -218,25 +430,267 @@ static TEE_Result process_hostcall_flow(chaincode_session_ctx *sc, TEE_Param par
     TEE_MemFill(final_resp, 0, sizeof(*final_resp));
     
     /* 실제 response 값 사용 */
-    if (g_chaincode_sess && g_chaincode_sess->has_response) {
-        size_t resp_len = safe_strlen(g_chaincode_sess->response, RESPONSE_SIZE - 1);
+    if (tx->has_response) {
+        size_t resp_len = safe_strlen(tx->response, RESPONSE_SIZE - 1);
         if (resp_len > 0) {
-            TEE_MemMove(final_resp->execution_response, g_chaincode_sess->response, resp_len);
+            TEE_MemMove(final_resp->execution_response, tx->response, resp_len);
         } else {
             TEE_MemMove(final_resp->execution_response, "EMPTY_RESPONSE", 14);
         }
     } else {
         TEE_MemMove(final_resp->execution_response, "NO_RESPONSE", 11);
     }
+    report_fuel(tx, final_resp);
     
+    release_invocation(tx);
     return TEE_SUCCESS;
 }
 
-TEE_Result TA_InvokeCommandEntryPoint(void __maybe_unused *sess_ctx, uint32_t cmd_id, uint32_t param_types, TEE_Param params[4])
+/* GET_STATE 응답 값을 WASM out 버퍼에 복사 (앱 오프셋 → 네이티브 변환) 후 대기 상태 해제 */
+void deliver_state_value(chaincode_tx_ctx *tx, const char *value)
 {
-    (void)&sess_ctx;
-    uint32_t exp_param_types = 0;
+    size_t max_len = tx->wasm_out_len > 0 ? (size_t)tx->wasm_out_len - 1 : 0;
+    int len = (int)safe_strlen(value, max_len < VAL_SIZE - 1 ? max_len : VAL_SIZE - 1);
+
+    void *out_native = NULL;
+    if (tx->wasm_out_offset && tx->wasm_out_len > 0) {
+        bool addr_valid = wasm_runtime_validate_app_addr(tx->runtime->module_inst, tx->wasm_out_offset, (uint32_t)tx->wasm_out_len);
+        if (addr_valid) {
+            out_native = wasm_runtime_addr_app_to_native(tx->runtime->module_inst, tx->wasm_out_offset);
+        }
+    }
+    if (out_native && len > 0) {
+        TEE_MemFill(out_native, 0, (size_t)tx->wasm_out_len);
+        TEE_MemMove(out_native, value, (size_t)len);
+    }
+    tx->pending_type = 0;
+    tx->wasm_out_offset = 0;
+    tx->wasm_out_len = 0;
+}
+
+/*
+ * ITER 응답(struct iter_reply)을 WASM 버퍼에 헤더와 레코드 그대로 복사하고 대기 상태 해제.
+ * 공유 메모리는 REE가 바꿀 수 있으므로 헤더를 먼저 복사해 둔 값으로만 크기를 검사한다.
+ */
+static bool deliver_iter_page(chaincode_tx_ctx *tx, const void *buffer, size_t size)
+{
+    struct iter_page_header header;
+    if (size < sizeof(header))
+        return false;
+    TEE_MemMove(&header, buffer, sizeof(header));
+
+    size_t room = (size_t)tx->wasm_out_len - sizeof(header);
+    if (header.used > size - sizeof(header) || header.used > room || header.used > ITER_PAGE_BYTES) {
+        EMSG("iterator page too large: %u bytes", header.used);
+        return false;
+    }
+    if (!wasm_runtime_validate_app_addr(tx->runtime->module_inst, tx->wasm_out_offset, (uint32_t)tx->wasm_out_len))
+        return false;
+    uint8_t *out = (uint8_t *)wasm_runtime_addr_app_to_native(tx->runtime->module_inst, tx->wasm_out_offset);
+    TEE_MemMove(out, &header, sizeof(header));
+    TEE_MemMove(out + sizeof(header), (const uint8_t *)buffer + sizeof(header), header.used);
+
+    tx->pending_type = 0;
+    tx->wasm_out_offset = 0;
+    tx->wasm_out_len = 0;
+    return true;
+}
+
+/* 캐시된 모듈로 트랜잭션 전용 인스턴스를 만들고 네이티브 임포트가 찾을 수 있게 연결 */
+TEE_Result instantiate_invocation(chaincode_tx_ctx *tx, cached_module *cm)
+{
+    tx->wasm.module = cm->module;
+    tx->wasm.wasm_bytecode = cm->image;
+    tx->wasm.wasm_bytecode_size = cm->image_size;
+    TEE_MemMove(tx->wasm.wasm_bytecode_hash, cm->hash, sizeof(cm->hash));
+
+    /* 모듈의 풀에 미리 만들어 둔 인스턴스가 있으면 꺼내기만 한다 (채우기는 TEE 진입의 끝에서) */
+    if (module_cache_take_ready(cm, &tx->wasm.module_inst, &tx->wasm.exec_env)) {
+        singleton_wamr_context = &tx->wasm;
+    } else {
+        TEE_Result r = TA_InstantiateWamrModule(&tx->wasm, 1, (char*[]){(char*)""});
+        if (r != TEE_SUCCESS) {
+            /* 미리 만든 인스턴스들이 힙을 잡고 있으면 내려놓고 한 번 더 */
+            module_cache_trim_ready();
+            r = TA_InstantiateWamrModule(&tx->wasm, 1, (char*[]){(char*)""});
+        }
+        if (r != TEE_SUCCESS)
+            return r;
+    }
+    wasm_runtime_set_custom_data(tx->wasm.module_inst, tx);
+    /* fuel_meter.py가 넣은 __fuel_left가 있으면 계량 모듈 (전역은 0에서 시작해 첫 블록에서 충전) */
+    tx->metered = wasm_runtime_lookup_function(tx->wasm.module_inst, FUEL_LEFT_EXPORT, NULL) != NULL;
+    tx->out_of_fuel = false;
+    tx->fuel_granted = 0;
+    tx->fuel_left = 0;
+    module_cache_acquire(cm);
+    tx->module = cm;
+    tx->runtime = &tx->wasm;
+    return TEE_SUCCESS;
+}
+
+/* 공유 메모리의 모듈 id를 NUL 종단 문자열로 복사 */
+static TEE_Result copy_module_id(char module_id[MODULE_ID_SIZE], const TEE_Param *param)
+{
+    uint32_t len = param->memref.size;
+
+    if (!len || len >= MODULE_ID_SIZE)
+        return TEE_ERROR_BAD_PARAMETERS;
+    TEE_MemFill(module_id, 0, MODULE_ID_SIZE);
+    TEE_MemMove(module_id, param->memref.buffer, len);
+    module_id[safe_strlen(module_id, len)] = '\0';
+    return module_id[0] ? TEE_SUCCESS : TEE_ERROR_BAD_PARAMETERS;
+}
+
+/* 캐시된 모듈로 트랜잭션 인스턴스를 만들고 step_init 후 첫 호스트콜까지 실행 */
+static TEE_Result start_invocation(chaincode_tx_ctx *tx, cached_module *cm, TEE_Param params[4])
+{
+    /* stdout 버퍼 설정 */
+    TA_SetOutputBuffer(params[3].memref.buffer, params[3].memref.size);
+
+    /* arguments 수신 - params[2]에서 struct arguments 읽기 */
+    /* DMSG("arguments: shared=%u expected=%u",
+         (uint32_t)params[2].memref.size, (uint32_t)sizeof(struct arguments)); */
+    if (params[2].memref.size >= sizeof(struct arguments)) {
+        TEE_MemMove(&tx->args, params[2].memref.buffer, sizeof(struct arguments));
+    } else {
+        TEE_MemFill(&tx->args, 0, sizeof(struct arguments));
+    }
+
+    /* REE가 미리 읽어 둔 상태 (struct start_request를 보낸 경우만) */
+    tx->prefetched = 0;
+    if (params[2].memref.size >= sizeof(struct start_request)) {
+        const struct start_request *start = params[2].memref.buffer;
+        uint32_t n = start->prefetched < PREFETCH_MAX ? start->prefetched : PREFETCH_MAX;
+        TEE_MemMove(tx->prefetch, start->prefetch, n * sizeof(struct key_value));
+        for (uint32_t i = 0; i < n; i++) {
+            tx->prefetch[i].key[KEY_SIZE - 1] = '\0';
+            tx->prefetch[i].value[VAL_SIZE - 1] = '\0';
+        }
+        tx->prefetched = n;
+    }
+
+    /* 응답 타입 초기화, 슬롯 번호는 이후 RESUME에서 REE가 다시 넘겨준다 */
+    params[1].value.a = 0;
+    params[1].value.b = tx->slot;
+
+    TEE_Result r = instantiate_invocation(tx, cm);
+    if (r != TEE_SUCCESS) {
+        release_invocation(tx);
+        return r;
+    }
+    
+    /* WASM 런타임 상태 재확인 (exec_env는 필요시 생성되므로 module_inst만 확인) */
+    if (!tx->runtime->module_inst) {
+        EMSG("Runtime state corrupted before step_init - module_inst is NULL");
+        release_invocation(tx);
+        return TEE_ERROR_GENERIC;
+    }
     
+    bool ok = call_step(tx->runtime, "step_init");
+    
+    if (!ok) {
+        const char *ex = wasm_runtime_get_exception(tx->runtime->module_inst);
+        if (tx->cancelled) {
+            EMSG("step_init cancelled (deadline)");
+            release_invocation(tx);
+            return TEE_ERROR_CANCEL;
+        }
+        EMSG("step_init failed with exception: %s", ex ? ex : "(null)");
+        params[1].value.a = INVOCATION_RESPONSE;
+        struct invocation_response *error_resp = (struct invocation_response *)params[2].memref.buffer;
+        TEE_MemFill(error_resp, 0, sizeof(*error_resp));
+        if (tx->out_of_fuel) {
+            /* 한도 초과는 체인코드의 실패로 응답한다 (step_resume 경로와 같음) */
+            TEE_MemMove(error_resp->execution_response, "OUT_OF_FUEL", 11);
+            report_fuel(tx, error_resp);
+            release_invocation(tx);
+            return TEE_SUCCESS;
+        }
+        TEE_MemMove(error_resp->execution_response, "STEP_INIT_FAILED", 17);
+        release_invocation(tx);
+        return TEE_ERROR_GENERIC;
+    }
+
+    /* 호스트콜 처리 */
+    return process_hostcall_flow(tx, params);
+}
+
+/*
+ * COMMAND_RUN_WASM_BY_ID: 바이트코드 전송/해시 없이 id로 캐시 또는 보안 저장소에서 로드해 시작.
+ * params[1].value.a = 남은 시간(ms, 0이면 마감 없음)
+ */
+static TEE_Result run_by_id(chaincode_session_ctx *sc, TEE_Param params[4])
+{
+    char module_id[MODULE_ID_SIZE];
+    chaincode_tx_ctx *tx;
+
+    TEE_Result r = copy_module_id(module_id, &params[0]);
+    if (r != TEE_SUCCESS) return r;
+
+    r = ensure_runtime();
+    if (r != TEE_SUCCESS) return r;
+
+    cached_module *cm = NULL;
+    r = module_cache_get_by_id(module_id, &cm);
+    if (r != TEE_SUCCESS) return r;
+
+    tx = alloc_tx(sc);
+    if (!tx) return TEE_ERROR_BUSY;
+    /* 마감/취소는 호스트 함수 호출마다 확인한다 (TEEC_RequestCancellation은 마스크를 풀어야 보인다) */
+    TEE_UnmaskCancellation();
+    set_deadline(tx, params[1].value.a);
+    tx->fuel_limit = sc->fuel_limit;
+    return start_invocation(tx, cm, params);
+}
+
+/* COMMAND_RESUME_WASM: 슬롯(params[1].value.b)으로 지정된 트랜잭션에 호스트 응답을 넘기고 재개 */
+static TEE_Result resume_slot(chaincode_session_ctx *sc, TEE_Param params[4])
+{
+    chaincode_tx_ctx *tx = lookup_tx(sc, params[1].value.b);
+    if (!tx) {
+        return TEE_ERROR_BAD_STATE;
+    }
+
+    /* 호스트콜 왕복 동안 마감이 지났으면 재개하지 않고 슬롯을 회수 */
+    TEE_UnmaskCancellation();
+    if (invocation_expired(tx)) {
+        EMSG("slot %u cancelled before resume (deadline)", tx->slot);
+        release_invocation(tx);
+        return TEE_ERROR_CANCEL;
+    }
+
+    /* 출력 버퍼는 호출마다 새로 매핑되므로 재개할 때도 다시 지정 */
+    TA_SetOutputBuffer(params[3].memref.buffer, params[3].memref.size);
+
+    /* 호스트 응답을 WASM 버퍼에 복사 */
+    if (tx->pending_type == GET_STATE_REQUEST) {
+        struct key_value *kv = (struct key_value *)params[2].memref.buffer;
+        deliver_state_value(tx, kv->value);
+    } else if (tx->pending_type == PUT_STATE_REQUEST) {
+        /* PUT은 별도 out 없음. ACK는 cc_put_state_native 이후의 다음 step에서 처리됨 */
+        tx->pending_type = 0;
+    } else if (tx->pending_type == ITER_OPEN_REQUEST || tx->pending_type == ITER_NEXT_REQUEST) {
+        if (!deliver_iter_page(tx, params[2].memref.buffer, params[2].memref.size)) {
+            release_invocation(tx);
+            return TEE_ERROR_BAD_PARAMETERS;
+        }
+    }
+
+    /* 재개 후 다음 단계 진행 */
+    return process_hostcall_flow(tx, params);
+}
+
+static TEE_Result dispatch_command(void *sess_ctx, uint32_t cmd_id, uint32_t param_types, TEE_Param params[4])
+{
+    uint32_t exp_param_types = 0;
+    chaincode_session_ctx *session = sess_ctx;
+
+    /* 실행 명령의 params[3]: 앞에 로그 링이 있으면 이 명령 동안 cc_log가 그곳에 쓴다 */
+    if (session && TEE_PARAM_TYPE_GET(param_types, 3) == TEE_PARAM_TYPE_MEMREF_INOUT)
+        log_ring_bind(&session->log, params[3].memref.buffer, params[3].memref.size);
+    else
+        log_ring_bind(NULL, NULL, 0);
 
     switch (cmd_id) {
     case COMMAND_CONFIGURE_HEAP:
@@ -245,128 +699,314 @@ TEE_Result TA_InvokeCommandEntryPoint(void __maybe_unused *sess_ctx, uint32_t cm
         if (exp_param_types != param_types) return TEE_ERROR_BAD_PARAMETERS;
         return TA_SetHeapSize(params[0].value.a);
 
+    case COMMAND_CONFIGURE_FUEL:
+        exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT, TEE_PARAM_TYPE_NONE,
+                         TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE);
+        if (param_types == exp_param_types) {
+            chaincode_session_ctx *sc = sess_ctx;
+            if (!sc) return TEE_ERROR_GENERIC;
+            /* 이후 이 세션에서 시작하는 트랜잭션과 배치에 적용 */
+            sc->fuel_limit = ((uint64_t)params[0].value.b << 32) | params[0].value.a;
+            return TEE_SUCCESS;
+        }
+        return TEE_ERROR_BAD_PARAMETERS;
+
     case COMMAND_RUN_WASM:
         exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT, TEE_PARAM_TYPE_VALUE_INOUT,
                              TEE_PARAM_TYPE_MEMREF_INOUT, TEE_PARAM_TYPE_MEMREF_INOUT);
         if (param_types == exp_param_types) {
-            chaincode_session_ctx *sc = g_chaincode_sess;
+            chaincode_session_ctx *sc = sess_ctx;
+            chaincode_tx_ctx *tx;
             if (!sc) return TEE_ERROR_GENERIC;
 
-            /* stdout 버퍼 설정 */
-            TA_SetOutputBuffer(params[3].memref.buffer, params[3].memref.size);
-
-            /* arguments 수신 - params[2]에서 struct arguments 읽기 */
-                 (uint32_t)params[2].memref.size, (uint32_t)sizeof(struct arguments)); */
-            if (params[2].memref.size >= sizeof(struct arguments)) {
-                TEE_MemMove(&sc->args, params[2].memref.buffer, sizeof(struct arguments));
-            } else {
-                TEE_MemFill(&sc->args, 0, sizeof(struct arguments));
-            }
-            
-            
-            /* 응답 타입 초기화 */
-            params[1].value.a = 0;
-
             /* WAMR 런타임 준비(보존) */
-            sc->heap_buf_owned = TEE_Malloc(heap_size, 0);
-            
-            sc->trusted_wasm_owned = TEE_Malloc(params[0].memref.size, 0);
-            
-            if (!sc->heap_buf_owned || !sc->trusted_wasm_owned) {
-                EMSG("Memory allocation failed! heap_buf: %p, trusted_wasm: %p", 
-                     sc->heap_buf_owned, sc->trusted_wasm_owned);
-                return TEE_ERROR_OUT_OF_MEMORY;
-            }
-            TEE_MemMove(sc->trusted_wasm_owned, params[0].memref.buffer, params[0].memref.size);
-
-            static wamr_context runtime_ctx; /* 세션 전용 컨텍스트 */
-            TEE_MemFill(&runtime_ctx, 0, sizeof(runtime_ctx));
-            runtime_ctx.heap_buf = sc->heap_buf_owned;
-            runtime_ctx.heap_size = heap_size;
-            /* 네이티브 임포트 등록 (env 모듈) */
-            runtime_ctx.native_symbols = chaincode_native_symbols;
-            runtime_ctx.native_symbols_size = chaincode_native_symbols_size;
-            runtime_ctx.wasm_bytecode = sc->trusted_wasm_owned;
-            runtime_ctx.wasm_bytecode_size = params[0].memref.size;
-
-            TEE_Result r = TA_InitializeWamrRuntime(&runtime_ctx, 1, (char*[]){(char*)""});
+            TEE_Result r = ensure_runtime();
+            if (r != TEE_SUCCESS) return r;
+
+            /* 모듈은 캐시에서 가져오고, 없을 때만 한 번 복사 + 재배치 */
+            cached_module *cm = NULL;
+            r = module_cache_get(params[0].memref.buffer, params[0].memref.size, false, &cm, NULL);
             if (r != TEE_SUCCESS) return r;
-            sc->runtime = &runtime_ctx;
-            
-            /* WASM 런타임 상태 재확인 (exec_env는 필요시 생성되므로 module_inst만 확인) */
-            if (!sc->runtime->module_inst) {
-                EMSG("Runtime state corrupted before step_init - module_inst is NULL");
-                return TEE_ERROR_GENERIC;
-            }
-            
-            bool ok = call_step(sc->runtime, "step_init");
-            
-            /* step_init 후 런타임 상태 확인 */
-            
-            if (!ok) {
-                const char *ex = wasm_runtime_get_exception(sc->runtime->module_inst);
-                EMSG("step_init failed with exception: %s", ex ? ex : "(null)");
-                params[1].value.a = INVOCATION_RESPONSE;
-                struct invocation_response *error_resp = (struct invocation_response *)params[2].memref.buffer;
-                TEE_MemFill(error_resp, 0, sizeof(*error_resp));
-                TEE_MemMove(error_resp->execution_response, "STEP_INIT_FAILED", 17);
-                return TEE_ERROR_GENERIC;
-            }
 
-            /* 호스트콜 처리 */
-            return process_hostcall_flow(sc, params);
+            tx = alloc_tx(sc);
+            if (!tx) return TEE_ERROR_BUSY;
+            tx->fuel_limit = sc->fuel_limit;
+            return start_invocation(tx, cm, params);
         }
         break;
 
-    case COMMAND_RESUME_WASM:
-        exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_VALUE_INOUT,
+    case COMMAND_RUN_WASM_BY_ID:
+        exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT, TEE_PARAM_TYPE_VALUE_INOUT,
                              TEE_PARAM_TYPE_MEMREF_INOUT, TEE_PARAM_TYPE_MEMREF_INOUT);
         if (param_types == exp_param_types) {
-            chaincode_session_ctx *sc = g_chaincode_sess;
-            if (!sc) {
-                return TEE_ERROR_GENERIC;
-            }
-            if (!sc->runtime) {
-                return TEE_ERROR_GENERIC;
-            }
+            if (!sess_ctx) return TEE_ERROR_GENERIC;
+            return run_by_id(sess_ctx, params);
+        }
+        return TEE_ERROR_BAD_PARAMETERS;
+
+    case COMMAND_INSTALL_MODULE:
+        exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT, TEE_PARAM_TYPE_MEMREF_INPUT,
+                             TEE_PARAM_TYPE_MEMREF_INPUT, TEE_PARAM_TYPE_VALUE_INPUT);
+        if (param_types == exp_param_types) {
+            chaincode_session_ctx *sc = sess_ctx;
+            char module_id[MODULE_ID_SIZE];
+            uint8_t signature[MODULE_SIGNATURE_MAX];
+            uint32_t signature_size = params[2].memref.size;
+            cached_module *cm = NULL;
+            if (!sc) return TEE_ERROR_GENERIC;
+
+            TEE_Result r = copy_module_id(module_id, &params[1]);
+            if (r != TEE_SUCCESS) return r;
+
+            /* 서명은 REE가 바꾸지 못하도록 먼저 TA 메모리로 복사한다 */
+            if (!signature_size || signature_size > sizeof(signature)) return TEE_ERROR_BAD_PARAMETERS;
+            TEE_MemMove(signature, params[2].memref.buffer, signature_size);
+
+            r = ensure_runtime();
+            if (r != TEE_SUCCESS) return r;
+
+            return module_cache_install(module_id, params[0].memref.buffer, params[0].memref.size,
+                                        signature, signature_size,
+                                        params[3].value.a & INSTALL_FLAG_REPLACE, &cm);
+        }
+        return TEE_ERROR_BAD_PARAMETERS;
+
+    case COMMAND_UPLOAD_BEGIN:
+        exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT, TEE_PARAM_TYPE_VALUE_INPUT,
+                             TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE);
+        if (param_types == exp_param_types) {
+            chaincode_session_ctx *sc = sess_ctx;
+            char module_id[MODULE_ID_SIZE];
+            if (!sc) return TEE_ERROR_GENERIC;
+
+            TEE_Result r = copy_module_id(module_id, &params[0]);
+            if (r != TEE_SUCCESS) return r;
+
+            r = ensure_runtime();
+            if (r != TEE_SUCCESS) return r;
+
+            return module_cache_upload_begin(module_id, params[1].value.a);
+        }
+        return TEE_ERROR_BAD_PARAMETERS;
+
+    case COMMAND_UPLOAD_CHUNK:
+        exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT, TEE_PARAM_TYPE_VALUE_INPUT,
+                             TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE);
+        if (param_types == exp_param_types) {
+            return module_cache_upload_chunk(params[1].value.a, params[0].memref.buffer,
+                                             params[0].memref.size);
+        }
+        return TEE_ERROR_BAD_PARAMETERS;
+
+    case COMMAND_UPLOAD_COMMIT:
+        exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT, TEE_PARAM_TYPE_VALUE_INPUT,
+                             TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE);
+        if (param_types == exp_param_types) {
+            uint8_t signature[MODULE_SIGNATURE_MAX];
+            uint32_t signature_size = params[0].memref.size;
+            cached_module *cm = NULL;
+
+            if (!signature_size || signature_size > sizeof(signature)) return TEE_ERROR_BAD_PARAMETERS;
+            TEE_MemMove(signature, params[0].memref.buffer, signature_size);
+
+            return module_cache_upload_commit(signature, signature_size,
+                                              params[1].value.a & INSTALL_FLAG_REPLACE, &cm);
+        }
+        return TEE_ERROR_BAD_PARAMETERS;
+
+    case COMMAND_PRELOAD_MODULE:
+        exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT, TEE_PARAM_TYPE_VALUE_INOUT,
+                             TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE);
+        if (param_types == exp_param_types) {
+            char module_id[MODULE_ID_SIZE];
+            if (!sess_ctx) return TEE_ERROR_GENERIC;
+
+            TEE_Result r = copy_module_id(module_id, &params[0]);
+            if (r != TEE_SUCCESS) return r;
+
+            r = ensure_runtime();
+            if (r != TEE_SUCCESS) return r;
+
+            /* 재배치까지 끝내 두면 이 버전의 첫 트랜잭션은 인스턴스화만 한다.
+             * 인스턴스까지 만들어 두면 그 수만큼의 트랜잭션은 인스턴스화도 하지 않는다 */
+            return module_cache_preload(module_id, params[1].value.a, &params[1].value.b);
+        }
+        return TEE_ERROR_BAD_PARAMETERS;
+
+    case COMMAND_REMOVE_MODULE:
+        exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT, TEE_PARAM_TYPE_NONE,
+                             TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE);
+        if (param_types == exp_param_types) {
+            char module_id[MODULE_ID_SIZE];
+            if (!sess_ctx) return TEE_ERROR_GENERIC;
+
+            TEE_Result r = copy_module_id(module_id, &params[0]);
+            if (r != TEE_SUCCESS) return r;
+            return module_cache_remove(module_id);
+        }
+        return TEE_ERROR_BAD_PARAMETERS;
 
-            /* 호스트 응답을 WASM 버퍼에 복사 (앱 오프셋 → 네이티브 변환) */
-            if (sc->pending_type == GET_STATE_REQUEST) {
-                struct key_value *kv = (struct key_value *)params[2].memref.buffer;
-                int len = (int)safe_strlen(kv->value, (size_t)sc->wasm_out_len - 1);
-                
-                void *out_native = NULL;
-                if (sc->wasm_out_offset && sc->wasm_out_len > 0) {
-                    bool addr_valid = wasm_runtime_validate_app_addr(sc->runtime->module_inst, sc->wasm_out_offset, (uint32_t)sc->wasm_out_len);
-                    if (addr_valid) {
-                        out_native = wasm_runtime_addr_app_to_native(sc->runtime->module_inst, sc->wasm_out_offset);
-                    }
-                } else {
-                }
-                if (out_native && len > 0) {
-                    TEE_MemFill(out_native, 0, (size_t)sc->wasm_out_len);
-                    TEE_MemMove(out_native, kv->value, (size_t)len);
-                } else {
-                }
-                sc->pending_type = 0;
-                sc->wasm_out_offset = 0;
-                sc->wasm_out_len = 0;
-            } else if (sc->pending_type == PUT_STATE_REQUEST) {
-                struct acknowledgement *ack = (struct acknowledgement *)params[2].memref.buffer;
-                /* PUT은 별도 out 없음. ACK는 cc_put_state_native 이후의 다음 step에서 처리됨 */
-                sc->pending_type = 0;
+    case COMMAND_DUMP_PROFILE:
+        exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT, TEE_PARAM_TYPE_MEMREF_OUTPUT,
+                             TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE);
+        if (param_types == exp_param_types) {
+            char module_id[MODULE_ID_SIZE];
+            if (!sess_ctx) return TEE_ERROR_GENERIC;
+
+            TEE_Result r = copy_module_id(module_id, &params[0]);
+            if (r != TEE_SUCCESS) return r;
+            /* 크기가 모자라면 필요한 크기를 memref.size로 알려 준다 (GP 규약) */
+            return module_cache_dump_profile(module_id, params[1].memref.buffer, &params[1].memref.size);
+        }
+        return TEE_ERROR_BAD_PARAMETERS;
+
+    case COMMAND_LOAD_MODULE:
+        exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT, TEE_PARAM_TYPE_VALUE_INPUT,
+                             TEE_PARAM_TYPE_MEMREF_OUTPUT, TEE_PARAM_TYPE_NONE);
+        if (param_types == exp_param_types) {
+            chaincode_session_ctx *sc = sess_ctx;
+            struct module_load_stats stats;
+            cached_module *cm = NULL;
+            if (!sc) return TEE_ERROR_GENERIC;
+
+            TEE_Result r = ensure_runtime();
+            if (r != TEE_SUCCESS) return r;
+
+            TEE_MemFill(&stats, 0, sizeof(stats));
+            r = module_cache_get(params[0].memref.buffer, params[0].memref.size,
+                                 params[1].value.a & LOAD_FLAG_RELOAD, &cm, &stats);
+            if (r != TEE_SUCCESS) return r;
+
+            if (params[2].memref.size < sizeof(stats)) {
+                params[2].memref.size = sizeof(stats);
+                return TEE_ERROR_SHORT_BUFFER;
             }
+            TEE_MemMove(params[2].memref.buffer, &stats, sizeof(stats));
+            params[2].memref.size = sizeof(stats);
+            return TEE_SUCCESS;
+        }
+        return TEE_ERROR_BAD_PARAMETERS;
 
-            /* 재개 후 다음 단계 진행 */
-            return process_hostcall_flow(sc, params);
+    case COMMAND_RESUME_WASM:
+        exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_VALUE_INOUT,
+                             TEE_PARAM_TYPE_MEMREF_INOUT, TEE_PARAM_TYPE_MEMREF_INOUT);
+        if (param_types == exp_param_types) {
+            return resume_slot(sess_ctx, params);
         } else {
             return TEE_ERROR_BAD_PARAMETERS;
         }
         break;
 
+    case COMMAND_MULTI_STEP:
+        exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_VALUE_INPUT,
+                             TEE_PARAM_TYPE_MEMREF_INOUT, TEE_PARAM_TYPE_MEMREF_INOUT);
+        if (param_types == exp_param_types) {
+            uint32_t count = params[1].value.a;
+            struct step_record *rec = params[2].memref.buffer;
+            if (!sess_ctx) return TEE_ERROR_GENERIC;
+            if (!count || count > TA_TX_SLOTS || params[2].memref.size < count * sizeof(*rec))
+                return TEE_ERROR_BAD_PARAMETERS;
+
+            /* 레코드마다 단건 명령과 같은 파라미터를 꾸며 같은 경로로 처리. 실패는 그 레코드에만 남긴다 */
+            for (uint32_t i = 0; i < count; i++) {
+                TEE_Param p[4];
+                TEE_MemFill(p, 0, sizeof(p));
+                p[0].memref.buffer = rec[i].module_id;
+                p[0].memref.size = safe_strlen(rec[i].module_id, MODULE_ID_SIZE);
+                p[1].value.a = rec[i].budget_ms;
+                p[1].value.b = rec[i].slot;
+                p[2].memref.buffer = &rec[i].mailbox;
+                p[2].memref.size = sizeof(rec[i].mailbox);
+                p[3] = params[3];
+
+                if (rec[i].op == STEP_OP_START)
+                    rec[i].result = run_by_id(sess_ctx, p);
+                else if (rec[i].op == STEP_OP_RESUME)
+                    rec[i].result = resume_slot(sess_ctx, p);
+                else
+                    rec[i].result = TEE_ERROR_BAD_PARAMETERS;
+                rec[i].type = p[1].value.a;
+                rec[i].slot = p[1].value.b;
+            }
+            return TEE_SUCCESS;
+        }
+        return TEE_ERROR_BAD_PARAMETERS;
+
+    case COMMAND_ABORT_TX:
+        exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT, TEE_PARAM_TYPE_NONE,
+                             TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE);
+        if (param_types == exp_param_types) {
+            /* REE 쪽에서 포기한 트랜잭션(스트림 종료 등)의 슬롯과 인스턴스를 회수 */
+            chaincode_tx_ctx *tx = lookup_tx(sess_ctx, params[0].value.a);
+            if (!tx) return TEE_ERROR_ITEM_NOT_FOUND;
+            release_invocation(tx);
+            return TEE_SUCCESS;
+        }
+        return TEE_ERROR_BAD_PARAMETERS;
+
+    case COMMAND_RUN_BATCH:
+        exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_MEMREF_INPUT, TEE_PARAM_TYPE_VALUE_INOUT,
+                             TEE_PARAM_TYPE_MEMREF_INOUT, TEE_PARAM_TYPE_MEMREF_INOUT);
+        if (param_types == exp_param_types) {
+            chaincode_session_ctx *sc = sess_ctx;
+            char module_id[MODULE_ID_SIZE];
+            if (!sc) return TEE_ERROR_GENERIC;
+
+            TEE_Result r = copy_module_id(module_id, &params[0]);
+            if (r != TEE_SUCCESS) return r;
+
+            r = ensure_runtime();
+            if (r != TEE_SUCCESS) return r;
+
+            cached_module *cm = NULL;
+            r = module_cache_get_by_id(module_id, &cm);
+            if (r != TEE_SUCCESS) return r;
+
+            TA_SetOutputBuffer(params[3].memref.buffer, params[3].memref.size);
+            return batch_start(sc, cm, params);
+        }
+        return TEE_ERROR_BAD_PARAMETERS;
+
+    case COMMAND_BATCH_STATE:
+        exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_VALUE_INOUT,
+                             TEE_PARAM_TYPE_MEMREF_INOUT, TEE_PARAM_TYPE_MEMREF_INOUT);
+        if (param_types == exp_param_types) {
+            chaincode_session_ctx *sc = sess_ctx;
+            if (!sc || !sc->batch) return TEE_ERROR_BAD_STATE;
+
+            TA_SetOutputBuffer(params[3].memref.buffer, params[3].memref.size);
+            return batch_supply_state(sc, params);
+        }
+        return TEE_ERROR_BAD_PARAMETERS;
+
+    case COMMAND_ABORT_BATCH:
+        exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE,
+                             TEE_PARAM_TYPE_NONE, TEE_PARAM_TYPE_NONE);
+        if (param_types == exp_param_types) {
+            if (!sess_ctx) return TEE_ERROR_GENERIC;
+            batch_release(sess_ctx);
+            return TEE_SUCCESS;
+        }
+        return TEE_ERROR_BAD_PARAMETERS;
+
     default:
         return TEE_ERROR_BAD_PARAMETERS;
     }
     
     return TEE_ERROR_BAD_PARAMETERS;
+}
+
+TEE_Result TA_InvokeCommandEntryPoint(void __maybe_unused *sess_ctx, uint32_t cmd_id, uint32_t param_types, TEE_Param params[4])
+{
+    TEE_Result r = dispatch_command(sess_ctx, cmd_id, param_types, params);
+
+    /*
+     * 응답은 이미 공유 메모리에 있다. 이번 진입에서 끝난 트랜잭션이 쓰고 내려놓은 만큼 인스턴스 풀을
+     * 다시 채워 두면 다음 트랜잭션의 시작에는 인스턴스화가 없다 (끝난 트랜잭션이 내놓은 힙을 그대로 쓴다)
+     */
+    if (refill_budget) {
+        module_cache_refill(refill_budget);
+        refill_budget = 0;
+    }
+    return r;
 }
\ No newline at end of file
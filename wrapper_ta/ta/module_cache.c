@@ -0,0 +1,742 @@
+#include <tee_internal_api.h>
+#include <tee_internal_api_extensions.h>
+#include <string.h>
+
+#include "wasm_export.h"
+#include "bh_platform.h"
+
+#include "logging.h"
+#include "module_cache.h"
+#include "module_store.h"
+#include "module_signature.h"
+
+static cached_module *cache_head;
+static uint32_t cache_entries;
+/* 모듈 이미지 사본이 차지한 보안 메모리 (WAMR 힙 풀 밖)와 그 최고치 */
+static uint32_t image_bytes;
+static uint32_t image_bytes_peak;
+
+/*
+ * 진행 중인 분할 업로드 (TA 인스턴스당 하나). entry->image가 최종 버퍼이고
+ * 조각은 신뢰 사본으로 복사된 직후 그 자리에서 digest에 누적된다.
+ */
+static struct {
+    char id[MODULE_ID_SIZE];
+    cached_module *entry;
+    uint32_t total_size;
+    uint32_t received;
+    TEE_OperationHandle digest;
+} upload;
+
+static uint32_t elapsed_ms(const TEE_Time *start, const TEE_Time *end)
+{
+    return (end->seconds - start->seconds) * 1000 + end->millis - start->millis;
+}
+
+/* XIP 이미지는 실행 가능한 영역에 있어야 하므로 WAMR 플랫폼의 os_mmap을 사용 */
+static uint8_t *alloc_image(uint32_t size, bool xip)
+{
+    uint8_t *image;
+
+    if (xip)
+        image = os_mmap(NULL, size, MMAP_PROT_READ | MMAP_PROT_WRITE | MMAP_PROT_EXEC, 0);
+    else
+        image = TEE_Malloc(size, TEE_MALLOC_NO_FILL);
+    if (image) {
+        image_bytes += size;
+        if (image_bytes > image_bytes_peak)
+            image_bytes_peak = image_bytes;
+    }
+    return image;
+}
+
+static void free_image(uint8_t *image, uint32_t size, bool xip)
+{
+    if (!image)
+        return;
+    if (xip)
+        os_munmap(image, size);
+    else
+        TEE_Free(image);
+    image_bytes -= size;
+}
+
+/* 이번 로드 동안의 이미지 최고치 + WAMR 힙 풀 highmark (풀은 되돌릴 수 없어 세션 시작부터의 값) */
+static uint32_t heap_peak_bytes(void)
+{
+    mem_alloc_info_t info;
+
+    if (!wasm_runtime_get_mem_alloc_info(&info))
+        return image_bytes_peak;
+    return image_bytes_peak + info.highmark_size;
+}
+
+static void drop_ready(cached_module *entry)
+{
+    while (entry->ready_count) {
+        wamr_context ctx;
+
+        TEE_MemFill(&ctx, 0, sizeof(ctx));
+        ctx.module_inst = entry->ready[--entry->ready_count].module_inst;
+        ctx.exec_env = entry->ready[entry->ready_count].exec_env;
+        TA_DestroyWamrInstance(&ctx);
+    }
+}
+
+/* 인스턴스와 실행 환경(call_step이 쓰는 것과 같은 스택 크기)을 하나 만들어 풀에 넣는다 */
+static bool make_ready(cached_module *entry)
+{
+    wamr_context ctx;
+
+    if (entry->ready_count >= MODULE_READY_MAX)
+        return false;
+    TEE_MemFill(&ctx, 0, sizeof(ctx));
+    ctx.module = entry->module;
+    if (TA_InstantiateWamrModule(&ctx, 1, (char *[]){(char *)""}) != TEE_SUCCESS)
+        return false;
+    ctx.exec_env = wasm_runtime_create_exec_env(ctx.module_inst, WASM_EXEC_STACK_SIZE);
+    if (!ctx.exec_env) {
+        TA_DestroyWamrInstance(&ctx);
+        return false;
+    }
+    entry->ready[entry->ready_count].module_inst = ctx.module_inst;
+    entry->ready[entry->ready_count].exec_env = ctx.exec_env;
+    entry->ready_count++;
+    return true;
+}
+
+static void free_entry(cached_module *entry)
+{
+    drop_ready(entry);
+    if (entry->module)
+        wasm_runtime_unload(entry->module);
+    free_image(entry->image, entry->image_size, entry->xip);
+    TEE_Free(entry);
+}
+
+static void unlink_entry(cached_module *entry)
+{
+    cached_module **link = &cache_head;
+    while (*link && *link != entry)
+        link = &(*link)->next;
+    if (*link) {
+        *link = entry->next;
+        cache_entries--;
+    }
+}
+
+static cached_module *lookup(const uint8_t hash[RA_HASH_SIZE / 8])
+{
+    cached_module *entry;
+    for (entry = cache_head; entry; entry = entry->next) {
+        if (!entry->retired && !TEE_MemCompare(entry->hash, hash, RA_HASH_SIZE / 8))
+            return entry;
+    }
+    return NULL;
+}
+
+static cached_module *lookup_id(const char *module_id)
+{
+    cached_module *entry;
+    for (entry = cache_head; entry; entry = entry->next) {
+        if (entry->id[0] && !entry->retired && !strncmp(entry->id, module_id, MODULE_ID_SIZE))
+            return entry;
+    }
+    return NULL;
+}
+
+/* 쓰는 인스턴스가 없으면 바로 해제하고, 있으면 마지막 인스턴스가 끝날 때 해제한다 */
+static void retire_entry(cached_module *entry)
+{
+    if (entry->users) {
+        entry->retired = true;
+        drop_ready(entry);
+        return;
+    }
+    unlink_entry(entry);
+    free_entry(entry);
+}
+
+/* "<aot_file>@<버전>"에서 aot_file 부분의 길이 (버전이 없으면 전체) */
+static uint32_t base_len(const char *module_id)
+{
+    uint32_t len = strnlen(module_id, MODULE_ID_SIZE - 1);
+    const char *at = memchr(module_id, '@', len);
+
+    return at ? (uint32_t)(at - module_id) : len;
+}
+
+/* current가 올라왔으니 같은 aot_file의 다른 버전들을 내린다 */
+static void retire_other_versions(const cached_module *current)
+{
+    uint32_t len = base_len(current->id);
+    cached_module *entry, *next;
+
+    for (entry = cache_head; entry; entry = next) {
+        next = entry->next;
+        if (entry == current || entry->retired || !entry->id[0])
+            continue;
+        if (base_len(entry->id) == len && !strncmp(entry->id, current->id, len)) {
+            IMSG("module %s replaced by %s (%u users left)", entry->id, current->id, entry->users);
+            retire_entry(entry);
+        }
+    }
+}
+
+/* 가장 오래된(리스트 끝) 미사용 모듈 하나를 내보낸다 */
+static void evict_one(void)
+{
+    cached_module *entry, *victim = NULL;
+    for (entry = cache_head; entry; entry = entry->next) {
+        if (!entry->users)
+            victim = entry;
+    }
+    if (victim) {
+        unlink_entry(victim);
+        free_entry(victim);
+    }
+}
+
+static cached_module *new_entry(uint32_t image_size, bool xip)
+{
+    cached_module *entry;
+
+    if (cache_entries >= MODULE_CACHE_MAX_ENTRIES)
+        evict_one();
+
+    entry = TEE_Malloc(sizeof(*entry), TEE_MALLOC_FILL_ZERO);
+    if (!entry)
+        return NULL;
+
+    entry->xip = xip;
+    entry->image_size = image_size;
+    entry->image = alloc_image(image_size, xip);
+    if (!entry->image) {
+        EMSG("module image allocation failed (%u bytes, xip=%d)", image_size, xip);
+        TEE_Free(entry);
+        return NULL;
+    }
+    return entry;
+}
+
+/* 신뢰 사본의 해시와 XIP 여부가 기대값과 같은지 확인 */
+static TEE_Result verify_image(cached_module *entry, const uint8_t expected[RA_HASH_SIZE / 8])
+{
+    TEE_Result res = TA_HashBuffer(entry->image, entry->image_size, entry->hash);
+
+    if (res == TEE_SUCCESS && TEE_MemCompare(entry->hash, expected, RA_HASH_SIZE / 8))
+        res = TEE_ERROR_SECURITY;
+    if (res == TEE_SUCCESS && wasm_runtime_is_xip_file(entry->image, entry->image_size) != entry->xip)
+        res = TEE_ERROR_SECURITY;
+    if (res != TEE_SUCCESS)
+        EMSG("module image verification failed. Error: %x", res);
+    return res;
+}
+
+/* 바이트코드(.wasm)는 인터프리터를 넣어 빌드한 TA(INTERP=1)에서만 실행할 수 있다 */
+static TEE_Result check_package(const cached_module *entry)
+{
+#ifndef TA_WASM_INTERP
+    if (get_package_type(entry->image, entry->image_size) == Wasm_Module_Bytecode) {
+        EMSG("wasm bytecode needs a TA built with INTERP=1 (WAMR fast interpreter); deploy an AOT image instead");
+        return TEE_ERROR_NOT_SUPPORTED;
+    }
+#else
+    (void)entry;
+#endif
+    return TEE_SUCCESS;
+}
+
+/* 재배치는 여기서 한 번만 수행되고 이후 트랜잭션은 인스턴스화만 한다 */
+static TEE_Result load_entry(cached_module *entry)
+{
+    char error_buf[128];
+    TEE_Result res = check_package(entry);
+
+    if (res != TEE_SUCCESS)
+        return res;
+
+    entry->module = wasm_runtime_load(entry->image, entry->image_size, error_buf, sizeof(error_buf));
+    if (!entry->module) {
+        EMSG("Load wasm module failed. error: %s", error_buf);
+        return TEE_ERROR_BAD_FORMAT;
+    }
+
+    entry->next = cache_head;
+    cache_head = entry;
+    cache_entries++;
+    /* 바이트코드(.wasm)면 fast interpreter로, AOT면 네이티브 코드로 실행된다 */
+    IMSG("module cached: %u bytes, xip=%d, aot=%d", entry->image_size, entry->xip,
+         get_package_type(entry->image, entry->image_size) == Wasm_Module_AoT);
+    return TEE_SUCCESS;
+}
+
+TEE_Result module_cache_get(const uint8_t *ree_image, uint32_t ree_image_size,
+                            bool reload, cached_module **out,
+                            struct module_load_stats *stats)
+{
+    uint8_t hash[RA_HASH_SIZE / 8];
+    cached_module *entry;
+    TEE_Time start, end;
+    TEE_Result res;
+
+#ifndef TA_UNSIGNED_MODULES
+    /* 서명 없는 REE 이미지는 UNSIGNED_MODULES=1로 빌드한 TA에서만 실행한다 */
+    EMSG("unsigned module images are disabled: install a signed module (COMMAND_INSTALL_MODULE)");
+    return TEE_ERROR_ACCESS_DENIED;
+#endif
+    if (!ree_image_size)
+        return TEE_ERROR_BAD_PARAMETERS;
+
+    TEE_GetSystemTime(&start);
+
+    /* 캐시 조회는 REE 버퍼를 복사하지 않고 해시만으로 한다 */
+    res = TA_HashBuffer(ree_image, ree_image_size, hash);
+    if (res != TEE_SUCCESS)
+        return res;
+
+    entry = lookup(hash);
+    if (entry && reload) {
+        /* 실행 중인 인스턴스가 있는 사본은 내릴 수 없다: 캐시 적중으로 답하지 않는다 */
+        if (entry->users) {
+            EMSG("cannot reload a module in use (%u users)", entry->users);
+            return TEE_ERROR_BUSY;
+        }
+        unlink_entry(entry);
+        free_entry(entry);
+        entry = NULL;
+    }
+    image_bytes_peak = image_bytes;
+
+    if (entry) {
+        if (stats) {
+            stats->cache_hit = 1;
+            stats->xip = entry->xip;
+            stats->image_size = entry->image_size;
+            stats->heap_peak_bytes = heap_peak_bytes();
+        }
+        *out = entry;
+        return TEE_SUCCESS;
+    }
+
+    entry = new_entry(ree_image_size, wasm_runtime_is_xip_file(ree_image, ree_image_size));
+    if (!entry)
+        return TEE_ERROR_OUT_OF_MEMORY;
+
+    /* REE 버퍼에서 신뢰 영역으로의 유일한 복사 */
+    TEE_MemMove(entry->image, ree_image, ree_image_size);
+
+    /* 복사 도중 REE가 버퍼를 바꿨을 수 있으므로 신뢰 사본으로 다시 확인 */
+    res = verify_image(entry, hash);
+    if (res == TEE_SUCCESS)
+        res = load_entry(entry);
+    if (res != TEE_SUCCESS) {
+        free_entry(entry);
+        return res;
+    }
+
+    TEE_GetSystemTime(&end);
+    if (stats) {
+        stats->cache_hit = 0;
+        stats->xip = entry->xip;
+        stats->image_size = entry->image_size;
+        stats->copied_bytes = entry->image_size;
+        stats->load_time_ms = elapsed_ms(&start, &end);
+        stats->heap_peak_bytes = heap_peak_bytes();
+    }
+    *out = entry;
+    return TEE_SUCCESS;
+}
+
+/* 설치된 모듈: 캐시에 없으면(콜드 TA) 보안 저장소에서 최종 버퍼로 바로 읽는다 */
+TEE_Result module_cache_get_by_id(const char *module_id, cached_module **out)
+{
+    struct stored_module_header hdr;
+    TEE_ObjectHandle obj = TEE_HANDLE_NULL;
+    cached_module *entry;
+    TEE_Result res;
+
+    entry = lookup_id(module_id);
+    if (entry) {
+        *out = entry;
+        return TEE_SUCCESS;
+    }
+
+    res = module_store_open(module_id, &obj, &hdr);
+    if (res != TEE_SUCCESS)
+        return res;
+
+    entry = new_entry(hdr.image_size, hdr.xip);
+    if (!entry) {
+        TEE_CloseObject(obj);
+        return TEE_ERROR_OUT_OF_MEMORY;
+    }
+
+    res = module_store_read_image(obj, entry->image, entry->image_size);
+    TEE_CloseObject(obj);
+    if (res == TEE_SUCCESS)
+        res = verify_image(entry, hdr.hash);
+    if (res == TEE_SUCCESS) {
+        TEE_MemMove(entry->id, module_id, strnlen(module_id, MODULE_ID_SIZE - 1));
+        res = load_entry(entry);
+    }
+    if (res != TEE_SUCCESS) {
+        EMSG("loading stored module %s failed. Error: %x", module_id, res);
+        free_entry(entry);
+        return res;
+    }
+
+    *out = entry;
+    return TEE_SUCCESS;
+}
+
+/*
+ * 새 버전을 쓰기 전에 미리 로드하고 같은 aot_file의 다른 버전들을 내린다.
+ * 이전 버전으로 늦게 시작한 트랜잭션이 그 버전을 다시 로드해도 새 버전은 내리지 않는다
+ */
+TEE_Result module_cache_preload(const char *module_id, uint32_t instances, uint32_t *ready)
+{
+    cached_module *entry = NULL;
+    TEE_Result res = module_cache_get_by_id(module_id, &entry);
+
+    if (res != TEE_SUCCESS)
+        return res;
+    retire_other_versions(entry);
+
+    /* 힙이 모자라면 만든 만큼만 둔다 (트랜잭션은 남은 것을 쓰고 모자라면 직접 만든다) */
+    if (instances > MODULE_READY_MAX)
+        instances = MODULE_READY_MAX;
+    entry->ready_floor = instances;
+    if (entry->ready_target < instances)
+        entry->ready_target = instances;
+    while (entry->ready_count < entry->ready_target && make_ready(entry))
+        ;
+    *ready = entry->ready_count;
+    return TEE_SUCCESS;
+}
+
+bool module_cache_take_ready(cached_module *entry, wasm_module_inst_t *inst, wasm_exec_env_t *exec_env)
+{
+    if (!entry->ready_count) {
+        /* 비어 있을 때 온 트랜잭션만큼 수요가 있다 */
+        if (entry->ready_target < MODULE_READY_MAX)
+            entry->ready_target++;
+        entry->ready_takes = 0;
+        entry->ready_low = 0;
+        return false;
+    }
+    entry->ready_count--;
+    *inst = entry->ready[entry->ready_count].module_inst;
+    *exec_env = entry->ready[entry->ready_count].exec_env;
+
+    /* 한 구간 내내 남았으면 남은 만큼은 쓰이지 않는 힙이므로 목표를 줄인다 */
+    if (!entry->ready_takes || entry->ready_count < entry->ready_low)
+        entry->ready_low = entry->ready_count;
+    if (++entry->ready_takes >= MODULE_READY_WINDOW) {
+        if (entry->ready_low && entry->ready_target > entry->ready_floor)
+            entry->ready_target--;
+        entry->ready_takes = 0;
+    }
+    return true;
+}
+
+void module_cache_refill(uint32_t budget)
+{
+    cached_module *entry;
+
+    for (entry = cache_head; entry && budget; entry = entry->next) {
+        while (budget && !entry->retired && entry->ready_count < entry->ready_target) {
+            if (!make_ready(entry))
+                return;
+            budget--;
+        }
+    }
+}
+
+void module_cache_trim_ready(void)
+{
+    cached_module *entry;
+
+    for (entry = cache_head; entry; entry = entry->next) {
+        drop_ready(entry);
+        entry->ready_target = entry->ready_floor;
+        entry->ready_takes = 0;
+    }
+}
+
+/*
+ * entry->hash가 계산된 신뢰 사본의 서명을 TA에 넣은 공개 키로 확인하고 보안 저장소에 기록한 뒤
+ * 캐시에 올린다. 다른 이미지로 이미 설치된 id는 서명된 replace 없이는 덮어쓰지 않고, 같은 이미지면
+ * 다시 쓰지 않는다. entry는 이 함수가 가져가며 *out에 넣지 않았으면 해제한다.
+ */
+static TEE_Result commit_install(const char *module_id, cached_module *entry,
+                                 const uint8_t *signature, uint32_t signature_size,
+                                 bool replace, cached_module **out)
+{
+    struct stored_module_header hdr;
+    TEE_ObjectHandle obj = TEE_HANDLE_NULL;
+    cached_module *old;
+    bool stored = false;
+    TEE_Result res;
+
+    res = module_signature_verify(module_id, entry->hash, replace, signature, signature_size);
+    if (res == TEE_SUCCESS)
+        res = check_package(entry);  /* 실행할 수 없는 이미지는 저장하지 않는다 */
+    if (res == TEE_SUCCESS && wasm_runtime_is_xip_file(entry->image, entry->image_size) != entry->xip)
+        res = TEE_ERROR_SECURITY;
+    if (res != TEE_SUCCESS) {
+        free_entry(entry);
+        return res;
+    }
+
+    /* 열 수 없는(손상된) 객체도 설치된 것으로 본다: replace로만 덮어쓴다 */
+    res = module_store_open(module_id, &obj, &hdr);
+    if (res == TEE_SUCCESS) {
+        TEE_CloseObject(obj);
+        stored = !TEE_MemCompare(hdr.hash, entry->hash, sizeof(hdr.hash));
+    }
+    if (res != TEE_ERROR_ITEM_NOT_FOUND && !stored && !replace) {
+        EMSG("module %s is already installed with another image (no signed replace)", module_id);
+        free_entry(entry);
+        return TEE_ERROR_ACCESS_CONFLICT;
+    }
+
+    /* 검증이 끝난 뒤에야 캐시의 이전 사본을 내린다. 실행 중인 인스턴스는 그 사본으로 끝까지 실행한다 */
+    old = lookup_id(module_id);
+    if (old && stored && !TEE_MemCompare(old->hash, entry->hash, sizeof(old->hash))) {
+        free_entry(entry);
+        *out = old;
+        return TEE_SUCCESS;
+    }
+    if (old)
+        retire_entry(old);
+
+    res = TEE_SUCCESS;
+    if (!stored) {
+        TEE_MemFill(&hdr, 0, sizeof(hdr));
+        hdr.magic = STORED_MODULE_MAGIC;
+        hdr.image_size = entry->image_size;
+        hdr.xip = entry->xip;
+        TEE_MemMove(hdr.hash, entry->hash, sizeof(hdr.hash));
+        res = module_store_write(module_id, &hdr, entry->image);
+    }
+    if (res == TEE_SUCCESS) {
+        TEE_MemMove(entry->id, module_id, strnlen(module_id, MODULE_ID_SIZE - 1));
+        res = load_entry(entry);
+    }
+    if (res != TEE_SUCCESS) {
+        free_entry(entry);
+        return res;
+    }
+
+    retire_other_versions(entry);
+    IMSG("module %s %s (%u bytes, xip=%d)", module_id, stored ? "reloaded" : "installed",
+         entry->image_size, entry->xip);
+    *out = entry;
+    return TEE_SUCCESS;
+}
+
+/*
+ * 배포 시 한 번: 한 번의 파라미터로 전달된 서명된 이미지를 복사해 설치한다. 같은 id를 다른 이미지로
+ * 바꾸는 것은 replace까지 서명된 경우뿐이고, 이전 모듈로 실행 중인 인스턴스는 이전 사본으로 끝까지 실행한다
+ */
+TEE_Result module_cache_install(const char *module_id, const uint8_t *ree_image,
+                                uint32_t ree_image_size, const uint8_t *signature,
+                                uint32_t signature_size, bool replace, cached_module **out)
+{
+    cached_module *entry;
+    TEE_Result res;
+
+    if (!ree_image_size)
+        return TEE_ERROR_BAD_PARAMETERS;
+
+    entry = new_entry(ree_image_size, wasm_runtime_is_xip_file(ree_image, ree_image_size));
+    if (!entry)
+        return TEE_ERROR_OUT_OF_MEMORY;
+    TEE_MemMove(entry->image, ree_image, ree_image_size);
+
+    res = TA_HashBuffer(entry->image, entry->image_size, entry->hash);
+    if (res != TEE_SUCCESS) {
+        free_entry(entry);
+        return res;
+    }
+
+    return commit_install(module_id, entry, signature, signature_size, replace, out);
+}
+
+static void upload_reset(void)
+{
+    if (upload.digest != TEE_HANDLE_NULL)
+        TEE_FreeOperation(upload.digest);
+    if (upload.entry)
+        free_entry(upload.entry);
+    TEE_MemFill(&upload, 0, sizeof(upload));
+}
+
+/* 새 업로드를 시작한다. 이전에 끝나지 않은 업로드는 버린다 */
+TEE_Result module_cache_upload_begin(const char *module_id, uint32_t total_size)
+{
+    TEE_Result res;
+
+    upload_reset();
+    if (!total_size)
+        return TEE_ERROR_BAD_PARAMETERS;
+
+    res = TEE_AllocateOperation(&upload.digest, TEE_ALG_SHA256, TEE_MODE_DIGEST, 0);
+    if (res != TEE_SUCCESS) {
+        EMSG("TEE_AllocateOperation failed. Error: %x", res);
+        upload.digest = TEE_HANDLE_NULL;
+        return res;
+    }
+
+    TEE_MemMove(upload.id, module_id, strnlen(module_id, MODULE_ID_SIZE - 1));
+    upload.total_size = total_size;
+    return TEE_SUCCESS;
+}
+
+/*
+ * 조각은 순서대로만 받는다(offset == 지금까지 받은 크기). 최종 버퍼는 첫 조각의
+ * AOT 헤더로 XIP 여부를 판단해 할당하며, 커밋 때 전체 이미지로 다시 확인한다.
+ */
+TEE_Result module_cache_upload_chunk(uint32_t offset, const uint8_t *chunk, uint32_t chunk_size)
+{
+    uint8_t *dst;
+
+    if (upload.digest == TEE_HANDLE_NULL)
+        return TEE_ERROR_BAD_STATE;
+    if (offset != upload.received || !chunk_size ||
+        chunk_size > upload.total_size - upload.received) {
+        EMSG("unexpected chunk: offset %u size %u (received %u of %u)",
+             offset, chunk_size, upload.received, upload.total_size);
+        upload_reset();
+        return TEE_ERROR_BAD_PARAMETERS;
+    }
+
+    if (!upload.entry) {
+        upload.entry = new_entry(upload.total_size, wasm_runtime_is_xip_file(chunk, chunk_size));
+        if (!upload.entry) {
+            upload_reset();
+            return TEE_ERROR_OUT_OF_MEMORY;
+        }
+    }
+
+    /* REE 조각을 최종 위치로 한 번 복사하고 해시는 신뢰 사본 쪽에서 계산 */
+    dst = upload.entry->image + offset;
+    TEE_MemMove(dst, chunk, chunk_size);
+    TEE_DigestUpdate(upload.digest, dst, chunk_size);
+    upload.received += chunk_size;
+    return TEE_SUCCESS;
+}
+
+TEE_Result module_cache_upload_commit(const uint8_t *signature, uint32_t signature_size,
+                                      bool replace, cached_module **out)
+{
+    uint32_t digest_len = RA_HASH_SIZE / 8;
+    cached_module *entry = upload.entry;
+    char module_id[MODULE_ID_SIZE];
+    TEE_Result res;
+
+    if (!entry || upload.received != upload.total_size) {
+        EMSG("upload incomplete: received %u of %u", upload.received, upload.total_size);
+        upload_reset();
+        return TEE_ERROR_BAD_STATE;
+    }
+
+    res = TEE_DigestDoFinal(upload.digest, NULL, 0, entry->hash, &digest_len);
+    TEE_MemMove(module_id, upload.id, MODULE_ID_SIZE);
+    /* 이후 entry의 소유권은 이 함수에 있다 */
+    upload.entry = NULL;
+    upload_reset();
+    if (res != TEE_SUCCESS) {
+        EMSG("TEE_DigestDoFinal failed. Error: %x", res);
+        free_entry(entry);
+        return res;
+    }
+
+    return commit_install(module_id, entry, signature, signature_size, replace, out);
+}
+
+void module_cache_acquire(cached_module *entry)
+{
+    entry->users++;
+}
+
+void module_cache_release(cached_module *entry)
+{
+    if (!entry || !entry->users)
+        return;
+    entry->users--;
+    if (!entry->users && entry->retired) {
+        IMSG("retired module %s freed", entry->id);
+        unlink_entry(entry);
+        free_entry(entry);
+    }
+}
+
+TEE_Result module_cache_dump_profile(const char *module_id, void *buf, uint32_t *size)
+{
+#ifdef TA_PGO
+    cached_module *entry = lookup_id(module_id);
+    wamr_context ctx;
+    wasm_module_inst_t inst;
+    uint32_t needed;
+    TEE_Result res = TEE_SUCCESS;
+
+    if (!entry)
+        return TEE_ERROR_ITEM_NOT_FOUND;
+
+    /* 덤프 API는 인스턴스를 받는다: 미리 만든 것이 있으면 빌리고 없으면 잠깐 만든다 */
+    TEE_MemFill(&ctx, 0, sizeof(ctx));
+    if (entry->ready_count) {
+        inst = entry->ready[0].module_inst;
+    } else {
+        ctx.module = entry->module;
+        if (TA_InstantiateWamrModule(&ctx, 1, (char *[]){(char *)""}) != TEE_SUCCESS)
+            return TEE_ERROR_OUT_OF_MEMORY;
+        inst = ctx.module_inst;
+    }
+
+    needed = wasm_runtime_get_pgo_prof_data_size(inst);
+    if (!needed) {
+        EMSG("module %s has no PGO counters (not built with --enable-llvm-pgo)", module_id);
+        res = TEE_ERROR_NOT_SUPPORTED;
+    } else if (*size < needed) {
+        res = TEE_ERROR_SHORT_BUFFER;
+    } else {
+        needed = wasm_runtime_dump_pgo_prof_data_to_buf(inst, buf, *size);
+        if (!needed)
+            res = TEE_ERROR_GENERIC;
+    }
+    *size = needed;
+
+    if (ctx.module_inst)
+        TA_DestroyWamrInstance(&ctx);
+    return res;
+#else
+    (void)module_id;
+    (void)buf;
+    (void)size;
+    return TEE_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+/* 진행 중인 인스턴스는 캐시 사본으로 끝까지 실행한다 */
+TEE_Result module_cache_remove(const char *module_id)
+{
+    cached_module *entry = lookup_id(module_id);
+
+    if (entry)
+        retire_entry(entry);
+    return module_store_remove(module_id);
+}
+
+void module_cache_clear(void)
+{
+    upload_reset();
+    while (cache_head) {
+        cached_module *entry = cache_head;
+        cache_head = entry->next;
+        free_entry(entry);
+    }
+    cache_entries = 0;
+}
@@ -0,0 +1,85 @@
+#include <tee_internal_api.h>
+#include <tee_internal_api_extensions.h>
+#include <string.h>
+
+#include "logging.h"
+#include "module_signature.h"
+
+#ifndef MODULE_SIGNING_MODULUS
+#error "MODULE_SIGNING_MODULUS is not set: build with ta/Makefile (MODULE_SIGNING_PUBKEY)"
+#endif
+
+/* 빌드할 때 넣은 서명 공개 키 (openssl rsa -modulus, 지수는 65537) */
+static const uint8_t signing_modulus[] = MODULE_SIGNING_MODULUS;
+static const uint8_t signing_exponent[] = { 0x01, 0x00, 0x01 };
+
+/* 키를 못 읽으면 모듈러스가 비어 들어온다: RSA 2048/3072/4096만 받는다 (크기가 틀리면 배열 크기가 음수) */
+typedef char signing_modulus_size_check[(sizeof(signing_modulus) == 256 || sizeof(signing_modulus) == 384 ||
+                                         sizeof(signing_modulus) == 512) ? 1 : -1];
+
+static TEE_Result signed_digest(const char *module_id, const uint8_t image_hash[MODULE_HASH_SIZE],
+                                bool replace, uint8_t digest[MODULE_HASH_SIZE])
+{
+    TEE_OperationHandle op = TEE_HANDLE_NULL;
+    uint32_t digest_len = MODULE_HASH_SIZE;
+    uint8_t flag = replace ? 1 : 0;
+    TEE_Result res;
+
+    res = TEE_AllocateOperation(&op, TEE_ALG_SHA256, TEE_MODE_DIGEST, 0);
+    if (res != TEE_SUCCESS) {
+        EMSG("TEE_AllocateOperation failed. Error: %x", res);
+        return res;
+    }
+    /* id 뒤의 '\0'까지 넣어 id와 해시의 경계를 고정한다 */
+    TEE_DigestUpdate(op, module_id, strnlen(module_id, MODULE_ID_SIZE - 1) + 1);
+    TEE_DigestUpdate(op, image_hash, MODULE_HASH_SIZE);
+    res = TEE_DigestDoFinal(op, &flag, sizeof(flag), digest, &digest_len);
+    TEE_FreeOperation(op);
+    return res;
+}
+
+TEE_Result module_signature_verify(const char *module_id, const uint8_t image_hash[MODULE_HASH_SIZE],
+                                   bool replace, const uint8_t *signature, uint32_t signature_size)
+{
+    TEE_ObjectHandle key = TEE_HANDLE_NULL;
+    TEE_OperationHandle op = TEE_HANDLE_NULL;
+    TEE_Attribute attrs[2];
+    uint8_t digest[MODULE_HASH_SIZE];
+    TEE_Result res;
+
+    if (!signature || signature_size != sizeof(signing_modulus)) {
+        EMSG("module %s: missing or malformed signature (%u bytes)", module_id, signature_size);
+        return TEE_ERROR_SECURITY;
+    }
+
+    res = signed_digest(module_id, image_hash, replace, digest);
+    if (res == TEE_SUCCESS)
+        res = TEE_AllocateTransientObject(TEE_TYPE_RSA_PUBLIC_KEY, sizeof(signing_modulus) * 8, &key);
+    if (res == TEE_SUCCESS) {
+        TEE_InitRefAttribute(&attrs[0], TEE_ATTR_RSA_MODULUS, signing_modulus, sizeof(signing_modulus));
+        TEE_InitRefAttribute(&attrs[1], TEE_ATTR_RSA_PUBLIC_EXPONENT, signing_exponent, sizeof(signing_exponent));
+        res = TEE_PopulateTransientObject(key, attrs, 2);
+    }
+    if (res == TEE_SUCCESS)
+        res = TEE_AllocateOperation(&op, TEE_ALG_RSASSA_PKCS1_V1_5_SHA256, TEE_MODE_VERIFY,
+                                    sizeof(signing_modulus) * 8);
+    if (res == TEE_SUCCESS)
+        res = TEE_SetOperationKey(op, key);
+    if (res != TEE_SUCCESS) {
+        EMSG("signature key setup failed. Error: %x", res);
+        goto out;
+    }
+
+    res = TEE_AsymmetricVerifyDigest(op, NULL, 0, digest, sizeof(digest), signature, signature_size);
+    if (res != TEE_SUCCESS) {
+        EMSG("module %s: signature does not verify (replace=%d). Error: %x", module_id, replace, res);
+        res = TEE_ERROR_SECURITY;
+    }
+
+out:
+    if (op != TEE_HANDLE_NULL)
+        TEE_FreeOperation(op);
+    if (key != TEE_HANDLE_NULL)
+        TEE_FreeTransientObject(key);
+    return res;
+}
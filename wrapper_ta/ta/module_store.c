@@ -0,0 +1,99 @@
+#include <tee_internal_api.h>
+#include <tee_internal_api_extensions.h>
+#include <string.h>
+
+#include "logging.h"
+#include "module_store.h"
+#include "chaincode_tee_ree_communication.h"
+
+#define OBJECT_ID_PREFIX "cc:"
+
+/* 모듈 id → 보안 저장소 객체 id ("cc:<module_id>") */
+static uint32_t object_id(const char *module_id, char out[MODULE_ID_SIZE + sizeof(OBJECT_ID_PREFIX)])
+{
+    uint32_t prefix_len = sizeof(OBJECT_ID_PREFIX) - 1;
+    uint32_t id_len = strnlen(module_id, MODULE_ID_SIZE - 1);
+
+    TEE_MemMove(out, OBJECT_ID_PREFIX, prefix_len);
+    TEE_MemMove(out + prefix_len, module_id, id_len);
+    return prefix_len + id_len;
+}
+
+TEE_Result module_store_write(const char *module_id, const struct stored_module_header *hdr,
+                              const uint8_t *image)
+{
+    char id[MODULE_ID_SIZE + sizeof(OBJECT_ID_PREFIX)];
+    uint32_t id_len = object_id(module_id, id);
+    uint32_t flags = TEE_DATA_FLAG_ACCESS_READ | TEE_DATA_FLAG_ACCESS_WRITE |
+                     TEE_DATA_FLAG_ACCESS_WRITE_META | TEE_DATA_FLAG_OVERWRITE;
+    TEE_ObjectHandle obj;
+    TEE_Result res;
+
+    res = TEE_CreatePersistentObject(TEE_STORAGE_PRIVATE, id, id_len, flags,
+                                     TEE_HANDLE_NULL, NULL, 0, &obj);
+    if (res != TEE_SUCCESS) {
+        EMSG("TEE_CreatePersistentObject failed for %s. Error: %x", module_id, res);
+        return res;
+    }
+
+    res = TEE_WriteObjectData(obj, hdr, sizeof(*hdr));
+    if (res == TEE_SUCCESS)
+        res = TEE_WriteObjectData(obj, image, hdr->image_size);
+    if (res != TEE_SUCCESS) {
+        EMSG("TEE_WriteObjectData failed for %s. Error: %x", module_id, res);
+        TEE_CloseAndDeletePersistentObject1(obj);
+        return res;
+    }
+
+    TEE_CloseObject(obj);
+    return TEE_SUCCESS;
+}
+
+TEE_Result module_store_open(const char *module_id, TEE_ObjectHandle *obj,
+                             struct stored_module_header *hdr)
+{
+    char id[MODULE_ID_SIZE + sizeof(OBJECT_ID_PREFIX)];
+    uint32_t id_len = object_id(module_id, id);
+    uint32_t read = 0;
+    TEE_Result res;
+
+    res = TEE_OpenPersistentObject(TEE_STORAGE_PRIVATE, id, id_len,
+                                   TEE_DATA_FLAG_ACCESS_READ, obj);
+    if (res != TEE_SUCCESS)
+        return res;
+
+    res = TEE_ReadObjectData(*obj, hdr, sizeof(*hdr), &read);
+    if (res == TEE_SUCCESS && (read != sizeof(*hdr) || hdr->magic != STORED_MODULE_MAGIC))
+        res = TEE_ERROR_BAD_FORMAT;
+    if (res != TEE_SUCCESS) {
+        EMSG("stored module %s is corrupted. Error: %x", module_id, res);
+        TEE_CloseObject(*obj);
+        *obj = TEE_HANDLE_NULL;
+    }
+    return res;
+}
+
+TEE_Result module_store_read_image(TEE_ObjectHandle obj, uint8_t *image, uint32_t image_size)
+{
+    uint32_t read = 0;
+    TEE_Result res = TEE_ReadObjectData(obj, image, image_size, &read);
+
+    if (res == TEE_SUCCESS && read != image_size)
+        res = TEE_ERROR_BAD_FORMAT;
+    return res;
+}
+
+/* 다른 TA 인스턴스가 읽는 중이면 TEE_ERROR_ACCESS_CONFLICT (REE가 나중에 다시 지운다) */
+TEE_Result module_store_remove(const char *module_id)
+{
+    char id[MODULE_ID_SIZE + sizeof(OBJECT_ID_PREFIX)];
+    uint32_t id_len = object_id(module_id, id);
+    TEE_ObjectHandle obj;
+    TEE_Result res;
+
+    res = TEE_OpenPersistentObject(TEE_STORAGE_PRIVATE, id, id_len,
+                                   TEE_DATA_FLAG_ACCESS_WRITE_META, &obj);
+    if (res != TEE_SUCCESS)
+        return res;
+    return TEE_CloseAndDeletePersistentObject1(obj);
+}
@@ -1,6 +1,6 @@
 global-incdirs-y += include
 global-incdirs-y += ../../../../../runtime/core/iwasm/include/ ../../../../../runtime/core/app-framework/base/app
-srcs-y += wasm.c main.c chaincode_native_functions.c
+srcs-y += wasm.c main.c chaincode_native_functions.c module_cache.c module_store.c module_signature.c batch.c log_ring.c
 
 # Method 2 includes the static (trusted) library between the --start-group and
 # --end-group arguments.
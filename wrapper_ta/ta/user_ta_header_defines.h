@@ -5,6 +5,7 @@
 
 #define TA_UUID TA_WAMR_UUID
 
+/* SINGLE_INSTANCE를 쓰지 않는다: 세션마다 별도 TA 인스턴스가 생겨 코어별로 병렬 실행된다 */
 #define TA_FLAGS TA_FLAG_EXEC_DDR
 
 #define TA_STACK_SIZE (3 * 1024)
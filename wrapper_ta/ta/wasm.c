@@ -2,6 +2,7 @@
 #include <tee_internal_api_extensions.h>
 #include "logging.h"
 #include "wasm.h"
+#include "log_ring.h"
 #include <string.h>
 
 wamr_context *singleton_wamr_context;
@@ -25,22 +26,24 @@ static void utils_print_byte_array(uint8_t *byte_array, int byte_array_len)
 #endif
 
 void TA_SetOutputBuffer(void *output_buffer, uint64_t output_buffer_size) {
+    /* 앞에 로그 링이 있으면 그 뒤만 stdout으로 쓴다 */
+    log_ring_stdout_area(&output_buffer, &output_buffer_size);
     vedliot_set_output_buffer(output_buffer, output_buffer_size);
 }
 
-TEE_Result TA_HashWasmBytecode(wamr_context *ctx) {
+TEE_Result TA_HashBuffer(const uint8_t *buffer, uint32_t buffer_size, uint8_t hash[RA_HASH_SIZE / 8]) {
     TEE_Result res = TEE_SUCCESS;
-    TEE_OperationHandle operation_handle;
+    TEE_OperationHandle operation_handle = TEE_HANDLE_NULL;
     uint32_t expected_digest_len = RA_HASH_SIZE / 8;
-	uint32_t digest_len = RA_HASH_SIZE;
+	uint32_t digest_len = RA_HASH_SIZE / 8;
 
     res = TEE_AllocateOperation(&operation_handle, TEE_ALG_SHA256, TEE_MODE_DIGEST, 0);
     if (res != TEE_SUCCESS) {
         EMSG("TEE_AllocateOperation failed. Error: %x", res);
-        goto out;
+        return res;
     }
 
-    res = TEE_DigestDoFinal(operation_handle, ctx->wasm_bytecode, ctx->wasm_bytecode_size, ctx->wasm_bytecode_hash, &digest_len);
+    res = TEE_DigestDoFinal(operation_handle, buffer, buffer_size, hash, &digest_len);
     if (res != TEE_SUCCESS) {
         EMSG("TEE_DigestDoFinal failed. Error: %x", res);
         goto out;
@@ -57,7 +60,12 @@ out:
     return res;
 }
 
-TEE_Result TA_InitializeWamrRuntime(wamr_context* context, int argc, char** argv)
+TEE_Result TA_HashWasmBytecode(wamr_context *ctx) {
+    return TA_HashBuffer(ctx->wasm_bytecode, ctx->wasm_bytecode_size, ctx->wasm_bytecode_hash);
+}
+
+/* 런타임(힙 풀 + 네이티브 심볼)은 TA 인스턴스당 한 번만 초기화한다 */
+TEE_Result TA_InitializeWamrRuntime(wamr_context* context)
 {
     RuntimeInitArgs init_args;
     TEE_MemFill(&init_args, 0, sizeof(RuntimeInitArgs));
@@ -75,11 +83,17 @@ TEE_Result TA_InitializeWamrRuntime(wamr_context* context, int argc, char** argv
         return TEE_ERROR_GENERIC;
     }
 
+    return TEE_SUCCESS;
+}
+
+/* context->module은 모듈 캐시가 소유하며, 여기서는 트랜잭션용 인스턴스만 만든다 */
+TEE_Result TA_InstantiateWamrModule(wamr_context* context, int argc, char** argv)
+{
     char error_buf[128];
-    context->module = wasm_runtime_load(context->wasm_bytecode, context->wasm_bytecode_size, error_buf, sizeof(error_buf));
-    if(!context->module) {
-        EMSG("Load wasm module failed. error: %s\n", error_buf);
-        return TEE_ERROR_GENERIC;
+
+    if (!context->module) {
+        EMSG("Instantiate wasm module failed. module is NULL");
+        return TEE_ERROR_BAD_STATE;
     }
 
     wasm_runtime_set_wasi_args(context->module, NULL, 0, NULL, 0, NULL, 0, argv, argc);
@@ -97,9 +111,8 @@ TEE_Result TA_InitializeWamrRuntime(wamr_context* context, int argc, char** argv
     }
 
     // WASM 모듈 정보 디버깅
-    IMSG("WASM module loaded successfully");
+    IMSG("WASM module instantiated");
     IMSG("Module instance: %p", context->module_inst);
-    IMSG("Exec env: %p", context->exec_env);
     singleton_wamr_context = context;
 
     return TEE_SUCCESS;
@@ -157,9 +170,10 @@ TEE_Result TA_ExecuteWamrRuntime(wamr_context* context)
     return TEE_SUCCESS;
 }
 
-void TA_TearDownWamrRuntime(wamr_context* context)
+void TA_DestroyWamrInstance(wamr_context* context)
 {
-    singleton_wamr_context = NULL;
+    if (singleton_wamr_context == context)
+        singleton_wamr_context = NULL;
 
     if (context->exec_env) {
         wasm_runtime_destroy_exec_env(context->exec_env);
@@ -169,8 +183,14 @@ void TA_TearDownWamrRuntime(wamr_context* context)
     if (context->module_inst)
     {
         wasm_runtime_deinstantiate(context->module_inst);
+        context->module_inst = NULL;
     }
+}
 
-    if (context->module) wasm_runtime_unload(context->module);
+/* 모듈 언로드는 모듈 캐시(module_cache_clear)가 먼저 끝낸 뒤 호출해야 한다 */
+void TA_TearDownWamrRuntime(wamr_context* context)
+{
+    TA_DestroyWamrInstance(context);
+    context->module = NULL;
     wasm_runtime_destroy();
 }